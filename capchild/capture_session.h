@@ -56,6 +56,8 @@ typedef struct _capture_session {
     Buffer buf;                           /**< Buffer we're reading packet data into */
     struct wtap *wtap;                    /**< current wtap file */
     struct _info_data *cap_data_info;     /**< stats for this capture */
+    struct ws_shm_ring *live_ring;        /**< shared memory the child also hands packets over in, if any */
+    guint32   live_ring_seq;              /**< number of capture files the child has reported */
 } capture_session;
 
 extern void
@@ -19,6 +19,7 @@
 
 #include <signal.h>
 
+#include <wsutil/shm_ring.h>
 #include <wsutil/strtoi.h>
 
 #ifdef _WIN32
@@ -129,6 +130,26 @@ capture_session_init(capture_session *cap_session, capture_file *cf)
 #endif
     cap_session->count                           = 0;
     cap_session->session_started                 = FALSE;
+    cap_session->live_ring                       = NULL;
+    cap_session->live_ring_seq                   = 0;
+}
+
+/*
+ * The capture child is gone; stop reading from the shared memory ring
+ * and remove it.
+ */
+static void
+sync_pipe_close_live_ring(capture_session *cap_session)
+{
+    capture_file *cf = cap_session->cf;
+
+    if (cap_session->live_ring == NULL)
+        return;
+
+    if (cf != NULL && cf->provider.wth != NULL)
+        wtap_set_live_ring(cf->provider.wth, NULL, 0);
+    ws_shm_ring_close(cap_session->live_ring);
+    cap_session->live_ring = NULL;
 }
 
 /* Append an arg (realloc) to an argc/argv array */
@@ -250,6 +271,28 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         argv = sync_pipe_add_arg(argv, &argc, capture_opts->capture_comment);
     }
 
+    /*
+     * Have the child hand packets over in shared memory as well as
+     * writing them to the file, so that we don't have to read them
+     * back from the file. If we can't set that up, just use the file.
+     */
+    sync_pipe_close_live_ring(cap_session);
+    cap_session->live_ring_seq = 0;
+    if (capture_opts->live_ring_size != 0) {
+        gchar *ring_err = NULL;
+
+        cap_session->live_ring = ws_shm_ring_create(
+            MIN(capture_opts->live_ring_size, WS_SHM_RING_MAX_SIZE / 1024) * 1024, &ring_err);
+        if (cap_session->live_ring != NULL) {
+            argv = sync_pipe_add_arg(argv, &argc, "--live-ring");
+            argv = sync_pipe_add_arg(argv, &argc, ws_shm_ring_name(cap_session->live_ring));
+        } else {
+            g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_WARNING,
+                  "Not handing packets over in shared memory: %s", ring_err);
+            g_free(ring_err);
+        }
+    }
+
     if (capture_opts->multi_files_on) {
         if (capture_opts->has_autostop_filesize) {
             char sfilesize[ARGV_NUMBER_LEN];
@@ -436,6 +479,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         report_failure("Couldn't create sync pipe: %s",
                        win32strerror(GetLastError()));
         free_argv(argv, argc);
+        sync_pipe_close_live_ring(cap_session);
         return FALSE;
     }
 
@@ -453,6 +497,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         CloseHandle(sync_pipe_read);
         CloseHandle(sync_pipe_write);
         free_argv(argv, argc);
+        sync_pipe_close_live_ring(cap_session);
         return FALSE;
     }
 
@@ -469,6 +514,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         ws_close(sync_pipe_read_fd);    /* Should close sync_pipe_read */
         CloseHandle(sync_pipe_write);
         free_argv(argv, argc);
+        sync_pipe_close_live_ring(cap_session);
         return FALSE;
     }
 
@@ -487,6 +533,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         CloseHandle(sync_pipe_write);
         CloseHandle(signal_pipe);
         free_argv(argv, argc);
+        sync_pipe_close_live_ring(cap_session);
         return FALSE;
     }
 
@@ -530,6 +577,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         CloseHandle(signal_pipe);
         free_argv(argv, argc);
         g_string_free(args, TRUE);
+        sync_pipe_close_live_ring(cap_session);
         return FALSE;
     }
     cap_session->fork_child = pi.hProcess;
@@ -544,6 +592,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         /* Couldn't create the pipe between parent and child. */
         report_failure("Couldn't create sync pipe: %s", g_strerror(errno));
         free_argv(argv, argc);
+        sync_pipe_close_live_ring(cap_session);
         return FALSE;
     }
 
@@ -596,6 +645,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
 #ifdef _WIN32
         ws_close(cap_session->signal_pipe_write_fd);
 #endif
+        sync_pipe_close_live_ring(cap_session);
         return FALSE;
     }
 
@@ -1651,6 +1701,7 @@ sync_pipe_input_cb(gint source, gpointer user_data)
         g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "sync_pipe_input_cb: cleaning extcap pipe");
         extcap_if_cleanup(cap_session->capture_opts, &primary_msg);
         capture_input_closed(cap_session, primary_msg);
+        sync_pipe_close_live_ring(cap_session);
         g_free(primary_msg);
         return FALSE;
     }
@@ -1658,6 +1709,7 @@ sync_pipe_input_cb(gint source, gpointer user_data)
     /* we got a valid message block from the child, process it */
     switch(indicator) {
     case SP_FILE:
+        cap_session->live_ring_seq++;
         if(!capture_input_new_file(cap_session, buffer)) {
             g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "sync_pipe_input_cb: file failed, closing capture");
 
@@ -1679,6 +1731,7 @@ sync_pipe_input_cb(gint source, gpointer user_data)
                "standard output", as the capture file. */
             sync_pipe_stop(cap_session);
             capture_input_closed(cap_session, NULL);
+            sync_pipe_close_live_ring(cap_session);
             return FALSE;
         }
         break;
@@ -115,6 +115,7 @@ capture_opts_init(capture_options *capture_opts)
     capture_opts->has_autostop_duration           = FALSE;
     capture_opts->autostop_duration               = 60.0;             /* 1 min */
     capture_opts->capture_comment                 = NULL;
+    capture_opts->live_ring_size                  = 0;
 
     capture_opts->output_to_pipe                  = FALSE;
     capture_opts->capture_child                   = FALSE;
@@ -252,6 +253,8 @@ capture_opts_log(const char *log_domain, GLogLevelFlags log_level, capture_optio
     g_log(log_domain, log_level, "AutostopPackets (%u) : %u", capture_opts->has_autostop_packets, capture_opts->autostop_packets);
     g_log(log_domain, log_level, "AutostopFilesize(%u) : %u (KB)", capture_opts->has_autostop_filesize, capture_opts->autostop_filesize);
     g_log(log_domain, log_level, "AutostopDuration(%u) : %.3f", capture_opts->has_autostop_duration, capture_opts->autostop_duration);
+
+    g_log(log_domain, log_level, "LiveRingSize        : %u (KB)", capture_opts->live_ring_size);
 }
 
 /*
@@ -780,6 +783,9 @@ capture_opts_add_opt(capture_options *capture_opts, int opt, const char *optarg_
         }
         capture_opts->capture_comment = g_strdup(optarg_str_p);
         break;
+    case LONGOPT_LIVE_RING_SIZE:  /* hand packets over in shared memory */
+        capture_opts->live_ring_size = get_nonzero_guint32(optarg_str_p, "live ring size");
+        break;
     case 'a':        /* autostop criteria */
         if (set_autostop_criterion(capture_opts, optarg_str_p) == FALSE) {
             cmdarg_err("Invalid or unknown -a flag \"%s\"", optarg_str_p);
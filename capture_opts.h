@@ -53,6 +53,7 @@ extern "C" {
 #define LONGOPT_NUM_CAP_COMMENT   128
 #define LONGOPT_LIST_TSTAMP_TYPES 129
 #define LONGOPT_SET_TSTAMP_TYPE   130
+#define LONGOPT_LIVE_RING_SIZE    131
 
 /*
  * Options for capturing common to all capturing programs.
@@ -93,7 +94,8 @@ extern "C" {
     {"snapshot-length",       required_argument, NULL, 's'}, \
     {"linktype",              required_argument, NULL, 'y'}, \
     {"list-time-stamp-types", no_argument,       NULL, LONGOPT_LIST_TSTAMP_TYPES}, \
-    {"time-stamp-type",       required_argument, NULL, LONGOPT_SET_TSTAMP_TYPE},
+    {"time-stamp-type",       required_argument, NULL, LONGOPT_SET_TSTAMP_TYPE}, \
+    {"live-ring-size",        required_argument, NULL, LONGOPT_LIVE_RING_SIZE},
 
 
 #define OPTSTRING_CAPTURE_COMMON \
@@ -317,6 +319,10 @@ typedef struct capture_options_tag {
     gchar             *capture_comment;       /** capture comment to write to the
                                                   output file */
 
+    guint32            live_ring_size;        /**< size in KB of the shared memory
+                                                   ring the capture child hands
+                                                   packets over in, 0 for none */
+
     /* internally used (don't touch from outside) */
     gboolean           output_to_pipe;        /**< save_file is a pipe (named or stdout) */
     gboolean           capture_child;         /**< hidden option: Wireshark child mode */
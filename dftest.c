@@ -16,12 +16,18 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
 #include <glib.h>
 
 #include <epan/epan.h>
 #include <epan/timestamp.h>
 #include <epan/prefs.h>
 #include <epan/dfilter/dfilter.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
 
 #ifdef HAVE_PLUGINS
 #include <wsutil/plugins.h>
@@ -30,15 +36,22 @@
 #include <wsutil/privileges.h>
 #include <wsutil/report_message.h>
 
+#include <wsutil/buffer.h>
 #include <wiretap/wtap.h>
 
+#ifndef HAVE_GETOPT_LONG
+#include "wsutil/wsgetopt.h"
+#endif
+
 #include "ui/util.h"
+#include "ui/failure_message.h"
 
 static void failure_warning_message(const char *msg_format, va_list ap);
 static void open_failure_message(const char *filename, int err,
 	gboolean for_writing);
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
+static int benchmark_filter(dfilter_t *df, const char *cf_name, guint rounds);
 
 int
 main(int argc, char **argv)
@@ -47,6 +60,10 @@ main(int argc, char **argv)
 	char		*text;
 	dfilter_t	*df;
 	gchar		*err_msg;
+	int		opt;
+	const char	*cf_name = NULL;
+	guint		rounds = 1000;
+	int		ret = 0;
 
 	/*
 	 * Get credential information for later use.
@@ -91,14 +108,30 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
-	/* Check for filter on command line */
-	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+	/* Check for options and a filter on the command line. A leading "+"
+	 * stops option parsing at the first non-option, so filters such as
+	 * "-1 == foo" are left alone. */
+	while ((opt = getopt(argc, argv, "+n:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			rounds = (guint)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			cf_name = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: dftest [-r <infile> [-n <rounds>]] <filter>\n");
+			exit(1);
+		}
+	}
+
+	if (argc <= optind) {
+		fprintf(stderr, "Usage: dftest [-r <infile> [-n <rounds>]] <filter>\n");
 		exit(1);
 	}
 
 	/* Get filter text */
-	text = get_args_as_string(argc, argv, 1);
+	text = get_args_as_string(argc, argv, optind);
 
 	printf("Filter: \"%s\"\n", text);
 
@@ -118,10 +151,104 @@ main(int argc, char **argv)
 	else
 		dfilter_dump(df);
 
+	if (df != NULL && cf_name != NULL)
+		ret = benchmark_filter(df, cf_name, rounds);
+
 	dfilter_free(df);
 	epan_cleanup();
 	g_free(text);
-	exit(0);
+	exit(ret);
+}
+
+static const nstime_t *
+dftest_get_frame_ts(struct packet_provider_data *prov _U_, guint32 frame_num _U_)
+{
+	static nstime_t empty;
+
+	return &empty;
+}
+
+/*
+ * Dissect each record of "cf_name" once and run the compiled filter
+ * "rounds" times against the resulting tree. Only the filter evaluations
+ * are timed, so this measures the display filter VM in isolation.
+ */
+static int
+benchmark_filter(dfilter_t *df, const char *cf_name, guint rounds)
+{
+	static const struct packet_provider_funcs funcs = {
+		dftest_get_frame_ts,
+		NULL,
+		NULL,
+		NULL
+	};
+	epan_t		*session;
+	epan_dissect_t	edt;
+	wtap		*wth;
+	wtap_rec	rec;
+	Buffer		buf;
+	frame_data	fdata;
+	gint64		data_offset;
+	gint64		start;
+	gint64		elapsed_us = 0;
+	guint32		framenum = 0;
+	guint32		cum_bytes = 0;
+	guint64		evaluations = 0;
+	guint64		matches = 0;
+	int		err;
+	gchar		*err_info = NULL;
+	guint		i;
+
+	wth = wtap_open_offline(cf_name, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		cfile_open_failure_message("dftest", cf_name, err, err_info);
+		return 2;
+	}
+
+	session = epan_new(NULL, &funcs);
+	epan_dissect_init(&edt, session, TRUE, FALSE);
+	wtap_rec_init(&rec);
+	ws_buffer_init(&buf, 1514);
+
+	while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+		frame_data_init(&fdata, ++framenum, &rec, data_offset, cum_bytes);
+		cum_bytes = fdata.cum_bytes;
+		epan_dissect_prime_with_dfilter(&edt, df);
+		epan_dissect_run(&edt, wtap_file_type_subtype(wth), &rec,
+		    tvb_new_real_data(ws_buffer_start_ptr(&buf),
+			rec.rec_header.packet_header.caplen,
+			rec.rec_header.packet_header.caplen),
+		    &fdata, NULL);
+
+		start = g_get_monotonic_time();
+		for (i = 0; i < rounds; i++) {
+			if (dfilter_apply_edt(df, &edt))
+				matches++;
+		}
+		elapsed_us += g_get_monotonic_time() - start;
+		evaluations += rounds;
+
+		epan_dissect_reset(&edt);
+		frame_data_destroy(&fdata);
+	}
+	if (err != 0) {
+		cfile_read_failure_message("dftest", cf_name, err, err_info);
+	}
+
+	printf("\n%u frames, %" G_GUINT64_FORMAT " evaluations, %" G_GUINT64_FORMAT " matches in %.3f s",
+	    framenum, evaluations, matches, elapsed_us / 1000000.0);
+	if (elapsed_us > 0) {
+		printf(" (%.0f evaluations/s)",
+		    evaluations * 1000000.0 / elapsed_us);
+	}
+	printf("\n");
+
+	ws_buffer_free(&buf);
+	wtap_rec_cleanup(&rec);
+	epan_dissect_cleanup(&edt);
+	epan_free(session);
+	wtap_close(wth);
+	return err != 0 ? 2 : 0;
 }
 
 /*
@@ -58,6 +58,7 @@
 #endif /* _WIN32 */
 
 #include "writecap/pcapio.h"
+#include "writecap/compressed_output.h"
 
 #ifndef _WIN32
 #include <sys/un.h>
@@ -65,6 +66,7 @@
 
 #include <ui/clopts_common.h>
 #include <wsutil/privileges.h>
+#include <wsutil/shm_ring.h>
 
 #include "sync_pipe.h"
 
@@ -111,12 +113,20 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
 
+/*
+ * The writer sleeps here when all packet queues are empty; capture threads
+ * only take the mutex to wake it up, and only when it is waiting.
+ */
+static GMutex pcap_queue_mtx;
+static GCond pcap_queue_cond;
+static gint pcap_queue_writer_waiting;
+
+/* Sequence number of the next element queued on any interface. */
+static gint pcap_queue_seq;
+
 static gboolean capture_child = FALSE; /* FALSE: standalone call, TRUE: this is an Wireshark capture child */
 #ifdef _WIN32
 static gchar *sig_pipe_name = NULL;
@@ -224,6 +234,42 @@ typedef struct _pcapng_pipe_info {
 
 struct _loop_data; /* forward declaration so we can use it in the cap_pipe_dispatch function pointer */
 
+/* Keep what the capture thread and the writer write in cache lines of their own. */
+#define PCAP_QUEUE_LINE     64
+
+/*
+ * The queue of packets a capture thread hands over to the writer, used
+ * when capturing with threads. Every interface has one, so the capture
+ * threads don't contend with each other.
+ *
+ * It is a single-producer, single-consumer ring over a slab allocated when
+ * the capture starts; elements, followed by their data, are carved out of
+ * it in order. head and tail are free-running byte counts, and the slab is
+ * a power of two in size, so they are turned into offsets by masking. The
+ * capture thread publishes head once per dispatch and the writer hands
+ * space back once per batch, so in the steady state queueing a packet
+ * takes neither an allocation nor a lock.
+ */
+typedef struct _pcap_queue {
+    guint8     *slab;
+    guint32     size;
+    guint32     mask;
+    guint8      pad0[PCAP_QUEUE_LINE - sizeof(guint8 *) - 2 * sizeof(guint32)];
+    /* written by the capture thread only */
+    gint        head;               /**< published end of the queued elements */
+    gint        packets_in;         /**< published number of elements queued so far */
+    guint32     next_head;          /**< end of the elements queued, published or not */
+    guint32     next_packets_in;
+    guint32     max_bytes;          /**< high-water marks */
+    guint32     max_packets;
+    guint8      pad1[PCAP_QUEUE_LINE - 6 * sizeof(guint32)];
+    /* written by the writer only */
+    gint        tail;               /**< published end of the elements written */
+    gint        packets_out;        /**< published number of elements written so far */
+    guint32     next_tail;          /**< end of the elements written, published or not */
+    guint32     next_packets_out;
+} pcap_queue;
+
 /*
  * A source of packets from which we're capturing.
  */
@@ -238,6 +284,7 @@ typedef struct _capture_src {
     gboolean                     pcap_err;
     guint                        interface_id;
     GThread                     *tid;
+    pcap_queue                  *queue;                  /**< packets queued for the writer */
     int                          snaplen;
     int                          linktype;
     gboolean                     ts_nsec;                /**< TRUE if we're using nanosecond precision. */
@@ -303,6 +350,7 @@ typedef struct _loop_data {
     FILE     *pdh;
     int       save_file_fd;
     char     *io_buffer;           /**< Our IO buffer if we increase the size from the standard size */
+    compressed_output *compressor; /**< Compresses the output file, if not a ring buffer */
     guint64   bytes_written;       /**< Bytes written for the current file. */
     /* autostop conditions */
     int       packets_written;     /**< Packets written for the current file. */
@@ -313,8 +361,14 @@ typedef struct _loop_data {
     int      interval_s;
 } loop_data;
 
+/*
+ * An element of a packet queue. The data normally follows it in the slab;
+ * data too big to be queued that way is put on the heap. An element with a
+ * space of 0 marks the end of the slab, the next one is at its start.
+ */
 typedef struct _pcap_queue_element {
-    capture_src        *pcap_src;
+    guint32             space;      /**< bytes taken in the slab */
+    guint32             seq;        /**< order in which elements were queued, on all interfaces */
     union {
         struct pcap_pkthdr  phdr;
         struct pcapng_block_header_s  bh;
@@ -322,6 +376,14 @@ typedef struct _pcap_queue_element {
     u_char             *pd;
 } pcap_queue_element;
 
+#define PCAP_QUEUE_ALIGN(len)   (((guint32)(len) + 7U) & ~7U)
+
+/* Elements with at most this much data are queued in the slab. */
+#define PCAP_QUEUE_MAX_INLINE   WTAP_MAX_PACKET_SIZE_STANDARD
+
+/* The writer takes at most this many elements per queue at a time. */
+#define PCAP_QUEUE_BATCH        64
+
 /*
  * This needs to be static, so that the SIGINT handler can clear the "go"
  * flag and for saved_shb_idb_lock.
@@ -372,6 +434,20 @@ static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
 static guint64 start_time;
+static output_compression_t output_compression = OUTPUT_UNCOMPRESSED;
+
+/*
+ * Shared memory ring in which we hand what we write to the capture file
+ * over to our parent as well (hidden option --live-ring).
+ */
+static char        *live_ring_name;
+static ws_shm_ring *live_ring;
+static GByteArray  *live_ring_data;     /**< written, not yet published */
+static guint64      live_ring_offset;   /**< file offset of live_ring_data */
+static guint32      live_ring_seq;      /**< number of files written so far */
+
+static void live_ring_attach(void);
+static void live_ring_publish(void);
 
 static void capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
                                          const u_char *pd);
@@ -390,6 +466,7 @@ static void WS_NORETURN exit_main(int err);
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(unsigned int packet_count);
 static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name);
+static void report_queue_high_water(guint32 packets, guint32 bytes, const gchar *name);
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(capture_options *capture_opts, guint i, const char *errmsg);
 
@@ -462,11 +539,13 @@ print_usage(FILE *output)
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --compress <type>        compress the output file(s) while writing them\n");
+    fprintf(output, "                           (%s)\n", compressed_output_names());
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
-    fprintf(output, "  -N <packet_limit>        maximum number of packets buffered within dumpcap\n");
+    fprintf(output, "  -N <packet_limit>        maximum number of packets buffered per interface\n");
     fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
-    fprintf(output, "                           within dumpcap\n");
+    fprintf(output, "                           per interface (def: 1000000)\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -v                       print version information and exit\n");
@@ -3082,9 +3161,30 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     if (capture_opts->multi_files_on) {
         ld->pdh = ringbuf_init_libpcap_fdopen(&err);
     } else {
-        ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
+        int fd = ld->save_file_fd;
+
+        if (output_compression != OUTPUT_UNCOMPRESSED) {
+            /* Write to the compressor; it owns the file from now on. */
+            ld->compressor = compressed_output_open(ld->save_file_fd, output_compression,
+                                                    &fd, &err);
+        }
+        if (output_compression != OUTPUT_UNCOMPRESSED && ld->compressor == NULL) {
+            ld->pdh = NULL;
+        } else {
+            ld->pdh = ws_fdopen(fd, "wb");
+            if (ld->pdh == NULL) {
+                err = errno;
+            }
+        }
         if (ld->pdh == NULL) {
-            err = errno;
+            if (ld->compressor != NULL) {
+                int co_err;
+
+                ws_close(fd);
+                compressed_output_close(ld->compressor, &co_err);
+                ld->compressor = NULL;
+                ld->save_file_fd = -1;
+            }
         } else {
             size_t buffsize = IO_BUF_SIZE;
 #ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
@@ -3121,6 +3221,13 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
             ld->pdh = NULL;
             g_free(ld->io_buffer);
             ld->io_buffer = NULL;
+            if (ld->compressor != NULL) {
+                int co_err;
+
+                compressed_output_close(ld->compressor, &co_err);
+                ld->compressor = NULL;
+                ld->save_file_fd = -1;
+            }
         }
     }
 
@@ -3200,6 +3307,18 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
         }
         g_free(ld->io_buffer);
         ld->io_buffer = NULL;
+        if (ld->compressor != NULL) {
+            /* Wait for the end of the compressed data to be written. */
+            int co_err;
+
+            if (!compressed_output_close(ld->compressor, &co_err) && success) {
+                if (err_close != NULL) {
+                    *err_close = co_err;
+                }
+                success = FALSE;
+            }
+            ld->compressor = NULL;
+        }
         return success;
     }
 }
@@ -3470,7 +3589,8 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                 /* ringbuffer is enabled */
                 *save_file_fd = ringbuf_init(capfile_name,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
-                                             capture_opts->group_read_access);
+                                             capture_opts->group_read_access,
+                                             output_compression);
 
                 /* capfile_name is unused as the ringbuffer provides its own filename. */
                 if (*save_file_fd != -1) {
@@ -3667,6 +3787,120 @@ do_file_switch_or_stop(capture_options *capture_opts)
     return TRUE;
 }
 
+/* Allocate the packet queue of a capture source, before its thread starts. */
+static void
+pcap_queue_init(capture_src *pcap_src)
+{
+    pcap_queue *queue = g_new0(pcap_queue, 1);
+    guint64 want;
+    guint32 size = 64 * 1024;
+
+    /*
+     * Room for the byte limit, plus what may be wasted when wrapping around
+     * and the element that takes the queue over the limit.
+     */
+    want = (guint64)pcap_queue_byte_limit +
+        2 * PCAP_QUEUE_ALIGN(sizeof(pcap_queue_element) + PCAP_QUEUE_MAX_INLINE);
+    while (size < want && size < 0x80000000U)
+        size <<= 1;
+
+    queue->slab = (guint8 *)g_malloc(size);
+    queue->size = size;
+    queue->mask = size - 1;
+    pcap_src->queue = queue;
+}
+
+static void
+pcap_queue_free(capture_src *pcap_src)
+{
+    if (pcap_src->queue == NULL)
+        return;
+
+    g_free(pcap_src->queue->slab);
+    g_free(pcap_src->queue);
+    pcap_src->queue = NULL;
+}
+
+/*
+ * Capture thread: get an element with room for len bytes of data, or NULL
+ * if the queue is over its limits. The element is queued by
+ * pcap_queue_push().
+ */
+static pcap_queue_element *
+pcap_queue_alloc(capture_src *pcap_src, guint32 len)
+{
+    pcap_queue *queue = pcap_src->queue;
+    pcap_queue_element *queue_element;
+    guint32 tail, used, packets, space, offset, waste;
+    gboolean inline_data = len <= PCAP_QUEUE_MAX_INLINE;
+
+    tail = (guint32)g_atomic_int_get(&queue->tail);
+    packets = queue->next_packets_in - (guint32)g_atomic_int_get(&queue->packets_out);
+    used = queue->next_head - tail;
+    if ((pcap_queue_byte_limit != 0 && used >= pcap_queue_byte_limit) ||
+        (pcap_queue_packet_limit != 0 && packets >= pcap_queue_packet_limit)) {
+        return NULL;
+    }
+
+    space = PCAP_QUEUE_ALIGN(sizeof(pcap_queue_element) + (inline_data ? len : 0));
+    offset = queue->next_head & queue->mask;
+    waste = (space > queue->size - offset) ? queue->size - offset : 0;
+    if (waste + space > queue->size - used) {
+        /* Can't happen while under the byte limit, see pcap_queue_init(). */
+        return NULL;
+    }
+    if (waste != 0) {
+        /* Doesn't fit before the end of the slab; go back to its start. */
+        ((pcap_queue_element *)(queue->slab + offset))->space = 0;
+        queue->next_head += waste;
+        offset = 0;
+    }
+
+    queue_element = (pcap_queue_element *)(queue->slab + offset);
+    queue_element->space = space;
+    queue_element->pd = inline_data ? (u_char *)(queue_element + 1) : (u_char *)g_malloc(len);
+    return queue_element;
+}
+
+/* Capture thread: queue the element got from pcap_queue_alloc(). */
+static void
+pcap_queue_push(capture_src *pcap_src, pcap_queue_element *queue_element)
+{
+    pcap_queue *queue = pcap_src->queue;
+    guint32 used, packets;
+
+    queue_element->seq = (guint32)g_atomic_int_add(&pcap_queue_seq, 1);
+    queue->next_head += queue_element->space;
+    queue->next_packets_in++;
+
+    used = queue->next_head - (guint32)g_atomic_int_get(&queue->tail);
+    packets = queue->next_packets_in - (guint32)g_atomic_int_get(&queue->packets_out);
+    if (used > queue->max_bytes)
+        queue->max_bytes = used;
+    if (packets > queue->max_packets)
+        queue->max_packets = packets;
+}
+
+/* Capture thread: make the elements pushed so far visible to the writer. */
+static void
+pcap_queue_publish(capture_src *pcap_src)
+{
+    pcap_queue *queue = pcap_src->queue;
+
+    if ((guint32)queue->head == queue->next_head)
+        return;
+
+    /* This is a full barrier, so the elements are visible first. */
+    g_atomic_int_set(&queue->packets_in, (gint)queue->next_packets_in);
+    g_atomic_int_set(&queue->head, (gint)queue->next_head);
+
+    if (g_atomic_int_get(&pcap_queue_writer_waiting)) {
+        g_mutex_lock(&pcap_queue_mtx);
+        g_cond_signal(&pcap_queue_cond);
+        g_mutex_unlock(&pcap_queue_mtx);
+    }
+}
+
 static void *
 pcap_read_handler(void* arg)
 {
@@ -3680,6 +3914,7 @@ pcap_read_handler(void* arg)
     while (global_ld.go && pcap_src->cap_pipe_err == PIPOK) {
         /* dispatch incoming packets */
         capture_loop_dispatch(&global_ld, errmsg, sizeof(errmsg), pcap_src);
+        pcap_queue_publish(pcap_src);
     }
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Stopped thread for interface %d.",
@@ -3688,46 +3923,129 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
-/* Try to pop an item off the packet queue and if it exists, write it */
-static gboolean
-capture_loop_dequeue_packet(void) {
+/* Writer: get the oldest element published in a packet queue, if any. */
+static pcap_queue_element *
+pcap_queue_peek(pcap_queue *queue)
+{
+    guint32 head = (guint32)g_atomic_int_get(&queue->head);
+    guint32 offset;
     pcap_queue_element *queue_element;
 
-    g_async_queue_lock(pcap_queue);
-    queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            pcap_queue_bytes -= queue_element->u.bh.block_total_length;
-        } else {
-            pcap_queue_bytes -= queue_element->u.phdr.caplen;
+    while (queue->next_tail != head) {
+        offset = queue->next_tail & queue->mask;
+        queue_element = (pcap_queue_element *)(queue->slab + offset);
+        if (queue_element->space != 0)
+            return queue_element;
+        queue->next_tail += queue->size - offset;
+    }
+    return NULL;
+}
+
+/* Writer: write the element got from pcap_queue_peek() and dequeue it. */
+static void
+pcap_queue_write(capture_src *pcap_src, pcap_queue_element *queue_element)
+{
+    pcap_queue *queue = pcap_src->queue;
+
+    if (pcap_src->from_pcapng) {
+        capture_loop_write_pcapng_cb(pcap_src, &queue_element->u.bh,
+                                     queue_element->pd);
+    } else {
+        capture_loop_write_packet_cb((u_char *)pcap_src, &queue_element->u.phdr,
+                                     queue_element->pd);
+    }
+    if (queue_element->pd != (u_char *)(queue_element + 1))
+        g_free(queue_element->pd);
+    queue->next_tail += queue_element->space;
+    queue->next_packets_out++;
+}
+
+/* Writer: hand the space of the elements written back to the capture thread. */
+static void
+pcap_queue_release(pcap_queue *queue)
+{
+    if (queue->next_tail == (guint32)queue->tail)
+        return;
+
+    /* This is a full barrier, so the writes out of the space are done first. */
+    g_atomic_int_set(&queue->packets_out, (gint)queue->next_packets_out);
+    g_atomic_int_set(&queue->tail, (gint)queue->next_tail);
+}
+
+static gboolean
+pcap_queues_empty(void)
+{
+    guint i;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_queue *queue = g_array_index(global_ld.pcaps, capture_src *, i)->queue;
+
+        if (g_atomic_int_get(&queue->head) != queue->tail)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Write a batch of elements from the packet queues, in the order in which
+ * they were queued on all interfaces, as a single queue would, rather than
+ * a batch from each queue in turn. A capture thread publishes what it
+ * queued once per dispatch, so an element can still be written after one
+ * queued later on another interface whose thread published first.
+ */
+static guint
+pcap_queues_drain(void)
+{
+    guint i;
+    guint count = 0;
+    capture_src *pcap_src, *oldest_src;
+    pcap_queue_element *queue_element, *oldest;
+
+    while (count < PCAP_QUEUE_BATCH * global_ld.pcaps->len) {
+        oldest_src = NULL;
+        oldest = NULL;
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            queue_element = pcap_queue_peek(pcap_src->queue);
+            if (queue_element != NULL &&
+                (oldest == NULL || (gint32)(queue_element->seq - oldest->seq) < 0)) {
+                oldest_src = pcap_src;
+                oldest = queue_element;
+            }
         }
-        pcap_queue_packets -= 1;
+        if (oldest == NULL)
+            break;
+        pcap_queue_write(oldest_src, oldest);
+        count++;
     }
-    g_async_queue_unlock(pcap_queue);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a block of type 0x%08x of length %d captured on interface %d.",
-                  queue_element->u.bh.block_type, queue_element->u.bh.block_total_length,
-                  queue_element->pcap_src->interface_id);
 
-            capture_loop_write_pcapng_cb(queue_element->pcap_src,
-                                        &queue_element->u.bh,
-                                        queue_element->pd);
-        } else {
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                "Dequeued a packet of length %d captured on interface %d.",
-                queue_element->u.phdr.caplen, queue_element->pcap_src->interface_id);
+    for (i = 0; i < global_ld.pcaps->len; i++)
+        pcap_queue_release(g_array_index(global_ld.pcaps, capture_src *, i)->queue);
+    return count;
+}
 
-            capture_loop_write_packet_cb((u_char *) queue_element->pcap_src,
-                                        &queue_element->u.phdr,
-                                        queue_element->pd);
+/*
+ * Write what the capture threads queued, and return the number of elements
+ * written. If there is nothing, wait up to WRITER_THREAD_TIMEOUT for them.
+ */
+static guint
+capture_loop_dequeue_packets(void)
+{
+    guint count = pcap_queues_drain();
+
+    if (count == 0) {
+        g_mutex_lock(&pcap_queue_mtx);
+        g_atomic_int_set(&pcap_queue_writer_waiting, 1);
+        /* Check after saying we're waiting, so no wakeup can be missed. */
+        if (pcap_queues_empty()) {
+            g_cond_wait_until(&pcap_queue_cond, &pcap_queue_mtx,
+                              g_get_monotonic_time() + WRITER_THREAD_TIMEOUT);
         }
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        return TRUE;
+        g_atomic_int_set(&pcap_queue_writer_waiting, 0);
+        g_mutex_unlock(&pcap_queue_mtx);
+        count = pcap_queues_drain();
     }
-    return FALSE;
+    return count;
 }
 
 /* Do the low-level work of a capture.
@@ -3766,6 +4084,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.pdh                 = NULL;
     global_ld.save_file_fd        = -1;
     global_ld.io_buffer           = NULL;
+    global_ld.compressor          = NULL;
     global_ld.file_count          = 0;
     global_ld.file_duration_timer = NULL;
     global_ld.next_interval_time  = 0;
@@ -3782,6 +4101,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                                  secondary_errmsg, sizeof(secondary_errmsg))) {
         goto error;
     }
+
+    /* We no longer have special privileges, so we can open the live ring. */
+    live_ring_attach();
+
     for (i = 0; i < capture_opts->ifaces->len; i++) {
         pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
         interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
@@ -3876,11 +4199,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            pcap_queue_init(pcap_src);
             /* XXX - Add an interface name here? */
             pcap_src->tid = g_thread_new("Capture read", pcap_read_handler, pcap_src);
         }
@@ -3888,13 +4209,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            gboolean dequeued = capture_loop_dequeue_packet();
-
-            if (dequeued) {
-                inpkts = 1;
-            } else {
-                inpkts = 0;
-            }
+            inpkts = capture_loop_dequeue_packets();
         } else {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, 0);
             inpkts = capture_loop_dispatch(&global_ld, errmsg,
@@ -4008,12 +4323,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_src->interface_id);
         }
-        while (1) {
-            gboolean dequeued = capture_loop_dequeue_packet();
-            if (!dequeued) {
-                break;
-            }
-            global_ld.inpkts_to_sync_pipe += 1;
+        /* Nothing gets queued any more, write what's left. */
+        while ((inpkts = pcap_queues_drain()) > 0) {
+            global_ld.inpkts_to_sync_pipe += inpkts;
             if (capture_opts->output_to_pipe) {
                 fflush(global_ld.pdh);
             }
@@ -4084,6 +4396,16 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     } else
         close_ok = TRUE;
 
+    if (live_ring != NULL) {
+        guint64 overrun_records, overrun_bytes;
+
+        live_ring_publish();
+        ws_shm_ring_get_overruns(live_ring, &overrun_records, &overrun_bytes);
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+              "Live ring: %" G_GINT64_MODIFIER "u writes (%" G_GINT64_MODIFIER "u bytes) didn't fit and are read from the file",
+              overrun_records, overrun_bytes);
+    }
+
     /* there might be packets not yet notified to the parent */
     /* (do this after closing the file, so all packets are already flushed) */
     if (global_ld.inpkts_to_sync_pipe) {
@@ -4135,6 +4457,11 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             }
         }
         report_packet_drops(received, pcap_dropped, pcap_src->dropped, pcap_src->flushed, stats->ps_ifdrop, interface_opts->display_name);
+        if (pcap_src->queue != NULL) {
+            report_queue_high_water(pcap_src->queue->max_packets, pcap_src->queue->max_bytes,
+                                    interface_opts->display_name);
+            pcap_queue_free(pcap_src);
+        }
     }
 
     /* close the input file (pcap or capture pipe) */
@@ -4248,12 +4575,71 @@ capture_loop_get_errmsg(char *errmsg, size_t errmsglen, char *secondary_errmsg,
     }
 }
 
+/*
+ * Hand what we write over in shared memory as well, if asked to.
+ * The offsets in the ring are those of the uncompressed data, so that
+ * doesn't work if we compress.
+ *
+ * The ring is a file our parent created; only open it once we've
+ * dropped any special privileges, so it can't be used to get at a file
+ * the user couldn't open.
+ */
+static void
+live_ring_attach(void)
+{
+    gchar *ring_err = NULL;
+
+    if (live_ring_name == NULL || output_compression != OUTPUT_UNCOMPRESSED)
+        return;
+
+    live_ring = ws_shm_ring_attach(live_ring_name, &ring_err);
+    if (live_ring != NULL) {
+        live_ring_data = g_byte_array_new();
+        pcapio_set_tee(live_ring_tee);
+    } else {
+        /* Our parent will just read everything from the file. */
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "%s", ring_err);
+        g_free(ring_err);
+    }
+}
+
+/* Publish what we wrote since the last time to the live ring. */
+static void
+live_ring_publish(void)
+{
+    if (live_ring == NULL || live_ring_data->len == 0)
+        return;
+
+    /* If it doesn't fit, our parent reads it from the file instead. */
+    ws_shm_ring_put(live_ring, live_ring_seq, live_ring_offset,
+                    live_ring_data->data, live_ring_data->len);
+    live_ring_offset += live_ring_data->len;
+    g_byte_array_set_size(live_ring_data, 0);
+}
+
+/*
+ * Gets everything written to the capture file(s) while a live ring is in
+ * use. A write at offset 0 starts a new file.
+ */
+static void
+live_ring_tee(const guint8 *data, size_t data_length, guint64 offset)
+{
+    if (offset == 0 || offset != live_ring_offset + live_ring_data->len) {
+        live_ring_publish();
+        if (offset == 0)
+            live_ring_seq++;
+        live_ring_offset = offset;
+    }
+    g_byte_array_append(live_ring_data, data, (guint)data_length);
+}
+
 /*
  * We wrote one packet. Update some statistics and check if we've met any
  * autostop or ring buffer conditions.
  */
 static void
 capture_loop_wrote_one_packet(capture_src *pcap_src) {
+    live_ring_publish();
     global_ld.packets_captured++;
     global_ld.packets_written++;
     pcap_src->received++;
@@ -4404,7 +4790,6 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
 {
     capture_src        *pcap_src = (capture_src *) (void *) pcap_src_p;
     pcap_queue_element *queue_element;
-    gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4414,49 +4799,18 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
+    queue_element = pcap_queue_alloc(pcap_src, phdr->caplen);
     if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
         pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_src->interface_id);
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    queue_element->u.phdr = *phdr;
+    memcpy(queue_element->pd, pd, phdr->caplen);
+    pcap_queue_push(pcap_src, queue_element);
+    pcap_src->received++;
 }
 
 /* one pcapng block was captured, queue it */
@@ -4464,7 +4818,6 @@ static void
 capture_loop_queue_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_header_s *bh, u_char *pd)
 {
     pcap_queue_element *queue_element;
-    gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4474,49 +4827,18 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_he
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
+    queue_element = pcap_queue_alloc(pcap_src, bh->block_total_length);
     if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.bh = *bh;
-    queue_element->pd = (u_char *)g_malloc(bh->block_total_length);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, bh->block_total_length);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += bh->block_total_length;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
         pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               bh->block_total_length, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a block of type 0x%08x of length %d captured on interface %u.",
-              bh->block_type, bh->block_total_length, pcap_src->interface_id);
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    queue_element->u.bh = *bh;
+    memcpy(queue_element->pd, pd, bh->block_total_length);
+    pcap_queue_push(pcap_src, queue_element);
+    pcap_src->received++;
 }
 
 static int
@@ -4595,10 +4917,14 @@ main(int argc, char *argv[])
 {
     char             *err_msg;
     int               opt;
+#define LONGOPT_LIVE_RING 4096
+#define LONGOPT_COMPRESS  4097
     static const struct option long_options[] = {
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         LONGOPT_CAPTURE_COMMON
+        {"live-ring", required_argument, NULL, LONGOPT_LIVE_RING},
+        {"compress", required_argument, NULL, LONGOPT_COMPRESS},
         {0, 0, 0, 0 }
     };
 
@@ -4945,6 +5271,7 @@ main(int argc, char *argv[])
         case 'g':        /* enable group read access on file(s) */
         case 'i':        /* Use interface x */
         case LONGOPT_SET_TSTAMP_TYPE: /* Set capture timestamp type */
+        case LONGOPT_LIVE_RING_SIZE: /* Hand packets over in shared memory */
         case 'n':        /* Use pcapng format */
         case 'p':        /* Don't capture in promiscuous mode */
         case 'P':        /* Use pcap format */
@@ -4996,6 +5323,19 @@ main(int argc, char *argv[])
 #endif
             break;
 
+            /*** hidden option: shared memory ring to hand packets over in ***/
+        case LONGOPT_LIVE_RING:
+            g_free(live_ring_name);
+            live_ring_name = g_strdup(optarg);
+            break;
+
+        case LONGOPT_COMPRESS:   /* Compress the output file(s) */
+            if (!compressed_output_lookup(optarg, &output_compression)) {
+                cmdarg_err("\"%s\" isn't a valid compression type; use one of %s.",
+                           optarg, compressed_output_names());
+                exit_main(1);
+            }
+            break;
         case 'q':        /* Quiet */
             quiet = TRUE;
             break;
@@ -5086,6 +5426,9 @@ main(int argc, char *argv[])
         /* XXX: Are these defaults good enough? */
         pcap_queue_byte_limit = 1000 * 1000;
         pcap_queue_packet_limit = 1000;
+    } else if (pcap_queue_byte_limit == 0) {
+        /* The byte limit also sizes the queues, so there has to be one. */
+        pcap_queue_byte_limit = 1000 * 1000;
     }
     if (arg_error) {
         print_usage(stderr);
@@ -5443,6 +5786,8 @@ report_packet_count(unsigned int packet_count)
     char count_str[SP_DECISIZE+1+1];
     static unsigned int count = 0;
 
+    live_ring_publish();
+
     if (capture_child) {
         g_snprintf(count_str, sizeof(count_str), "%u", packet_count);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "Packets: %s", count_str);
@@ -5458,6 +5803,7 @@ report_packet_count(unsigned int packet_count)
 static void
 report_new_capture_file(const char *filename)
 {
+    live_ring_publish();
     if (capture_child) {
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "File: %s", filename);
         pipe_write_block(2, SP_FILE, filename);
@@ -5555,6 +5901,22 @@ report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32
     }
 }
 
+static void
+report_queue_high_water(guint32 packets, guint32 bytes, const gchar *name)
+{
+    /* The parent has no use for this, it only goes to the log. */
+    if (capture_child) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+            "Packets queued on interface '%s' at most: %u (%u bytes)",
+            name, packets, bytes);
+    } else {
+        fprintf(stderr,
+            "Packets queued on interface '%s' at most: %u (%u bytes)\n",
+            name, packets, bytes);
+        fflush(stderr);
+    }
+}
+
 
 /************************************************************************************************/
 /* signal_pipe handling */
@@ -66,7 +66,7 @@
 #include <ui/cmdarg_err.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
-#include <wsutil/wsgcrypt.h>
+#include <wsutil/dedup.h>
 #include <wsutil/plugins.h>
 #include <wsutil/privileges.h>
 #include <wsutil/report_message.h>
@@ -101,18 +101,11 @@ struct select_item {
 /*
  * Duplicate frame detection
  */
-typedef struct _fd_hash_t {
-    guint8     digest[16];
-    guint32    len;
-    nstime_t   frame_time;
-} fd_hash_t;
-
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
-#define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
+#define MAX_DUP_DEPTH     1000000   /* the maximum window (in packets) for de-duplication */
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
+static ws_dedup *dedup         = NULL;
 static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
 
 static guint32   ignored_bytes  = 0;  /* Used with -I */
 
@@ -584,14 +577,11 @@ remove_vlan_info(const wtap_packet_header *phdr, guint8* fd, guint32* len) {
 }
 
 static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-    int i;
+is_duplicate(guint8* fd, guint32 len, const nstime_t *current) {
     const struct ieee80211_radiotap_header* tap_header;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     guint32 offset = ignored_bytes;
-    guint32 new_len;
-    guint8 *new_fd;
 
     if (len <= ignored_bytes) {
         offset = 0;
@@ -605,143 +595,25 @@ is_duplicate(guint8* fd, guint32 len) {
             offset = 0;
     }
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
-
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
-
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
-
-    fd_hash[cur_dup_entry].len = len;
-
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
-
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
-    }
-
-    return FALSE;
-}
-
-static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
-
-    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 offset = ignored_bytes;
-    guint32 new_len;
-    guint8 *new_fd;
-
-    if (len <= ignored_bytes) {
-        offset = 0;
-    }
-
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
-
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
-
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
-
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
-    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
-
     /*
-     * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
-     *
-     * Of course this assumes that the input trace file is
-     * "well-formed" in the sense that the packet timestamps are
-     * in strict chronologically increasing order (which is NOT
-     * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
+     * Look for duplicates. With a time window this assumes that the
+     * packet timestamps are in chronological order (which is NOT always
+     * the case!!); a packet never matches one with a later timestamp.
      */
+    return ws_dedup_add(dedup, &fd[offset], len - offset, len, current);
+}
 
-    for (i = cur_dup_entry - 1;; i--) {
-        nstime_t delta;
-        int cmp;
-
-        if (i < 0)
-            i = dup_window - 1;
-
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
-            break;
-        }
-
-        if (nstime_is_unset(&(fd_hash[i].frame_time))) {
-            /*
-             * We've decremented to an unused fd_hash[] entry.
-             * Check no more!
-             */
-            break;
-        }
-
-        nstime_delta(&delta, current, &fd_hash[i].frame_time);
-
-        if (delta.secs < 0 || delta.nsecs < 0) {
-            /*
-             * A negative delta implies that the current packet
-             * has an absolute timestamp less than the cached packet
-             * that it is being compared to.  This is NOT a normal
-             * situation since trace files usually have packets in
-             * chronological order (oldest to newest).
-             *
-             * There are several possible ways to deal with this:
-             * 1. 'continue' dup checking with the next cached frame.
-             * 2. 'break' from looking for a duplicate of the current frame.
-             * 3. Take the absolute value of the delta and see if that
-             * falls within the specifed dup time window.
-             *
-             * Currently this code does option 1.  But it would pretty
-             * easy to add yet-another-editcap-option to select one of
-             * the other behaviors for dealing with out-of-sequence
-             * packets.
-             */
-            continue;
-        }
-
-        cmp = nstime_cmp(&delta, &relative_time_window);
-
-        if (cmp > 0) {
-            /*
-             * The delta time indicates that we are now looking at
-             * cached packets beyond the specified dup time window.
-             * Check no more!
-             */
-            break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
-    }
+static void
+print_dedup_hash(const char *what, guint count, guint32 len)
+{
+    guint8 hash[WS_DEDUP_HASH_LEN];
+    int i;
 
-    return FALSE;
+    ws_dedup_last_hash(dedup, hash);
+    fprintf(stderr, "%s: %u, Len: %u, Hash: ", what, count, len);
+    for (i = 0; i < WS_DEDUP_HASH_LEN; i++)
+        fprintf(stderr, "%02x", hash[i]);
+    fprintf(stderr, "\n");
 }
 
 static void
@@ -766,7 +638,7 @@ print_usage(FILE *output)
     fprintf(output, "  -D <dup window>        remove packet if duplicate; configurable <dup window>.\n");
     fprintf(output, "                         Valid <dup window> values are 0 to %d.\n", MAX_DUP_DEPTH);
     fprintf(output, "                         NOTE: A <dup window> of 0 with -v (verbose option) is\n");
-    fprintf(output, "                         useful to print MD5 hashes.\n");
+    fprintf(output, "                         useful to print packet hashes.\n");
     fprintf(output, "  -w <dup time window>   remove packet if duplicate packet is found EQUAL TO OR\n");
     fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
     fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
@@ -811,7 +683,7 @@ print_usage(FILE *output)
     fprintf(output, "                         the pseudo-random number generator. This allows one to\n");
     fprintf(output, "                         repeat a particular sequence of errors.\n");
     fprintf(output, "  -I <bytes to ignore>   ignore the specified number of bytes at the beginning\n");
-    fprintf(output, "                         of the frame during MD5 hash calculation, unless the\n");
+    fprintf(output, "                         of the frame during hash calculation, unless the\n");
     fprintf(output, "                         frame is too short, then the full frame is used.\n");
     fprintf(output, "                         Useful to remove duplicated packets taken on\n");
     fprintf(output, "                         several routers (different mac addresses for\n");
@@ -848,7 +720,7 @@ print_usage(FILE *output)
     fprintf(output, "  -v                     verbose output.\n");
     fprintf(output, "                         If -v is used with any of the 'Duplicate Packet\n");
     fprintf(output, "                         Removal' options (-d, -D or -w) then Packet lengths\n");
-    fprintf(output, "                         and MD5 hashes are printed to standard-error.\n");
+    fprintf(output, "                         and packet hashes are printed to standard-error.\n");
 }
 
 struct string_elem {
@@ -1559,12 +1431,10 @@ main(int argc, char *argv[])
     if (keep_em == FALSE)
         max_packet_number = G_MAXUINT;
 
-    if (dup_detect || dup_detect_by_time) {
-        for (i = 0; i < dup_window; i++) {
-            memset(&fd_hash[i].digest, 0, 16);
-            fd_hash[i].len = 0;
-            nstime_set_unset(&fd_hash[i].frame_time);
-        }
+    if (dup_detect) {
+        dedup = ws_dedup_new_count(dup_window);
+    } else if (dup_detect_by_time) {
+        dedup = ws_dedup_new_time(&relative_time_window, dup_window);
     }
 
     /* Read all of the packets in turn */
@@ -1836,28 +1706,18 @@ main(int argc, char *argv[])
 
                 /* suppress duplicates by packet window */
                 if (dup_detect) {
-                    if (is_duplicate(buf, rec->rec_header.packet_header.caplen)) {
+                    if (is_duplicate(buf, rec->rec_header.packet_header.caplen, NULL)) {
                         if (verbose) {
-                            fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
-                                    count,
-                                    rec->rec_header.packet_header.caplen);
-                            for (i = 0; i < 16; i++)
-                                fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
-                            fprintf(stderr, "\n");
+                            print_dedup_hash("Skipped", count,
+                                             rec->rec_header.packet_header.caplen);
                         }
                         duplicate_count++;
                         count++;
                         continue;
                     } else {
                         if (verbose) {
-                            fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
-                                    count,
-                                    rec->rec_header.packet_header.caplen);
-                            for (i = 0; i < 16; i++)
-                                fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
-                            fprintf(stderr, "\n");
+                            print_dedup_hash("Packet", count,
+                                             rec->rec_header.packet_header.caplen);
                         }
                     }
                 } /* suppression of duplicates */
@@ -1870,30 +1730,20 @@ main(int argc, char *argv[])
                         current.secs  = rec->ts.secs;
                         current.nsecs = rec->ts.nsecs;
 
-                        if (is_duplicate_rel_time(buf,
-                                                  rec->rec_header.packet_header.caplen,
-                                                  &current)) {
+                        if (is_duplicate(buf,
+                                         rec->rec_header.packet_header.caplen,
+                                         &current)) {
                             if (verbose) {
-                                fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
-                                        count,
-                                        rec->rec_header.packet_header.caplen);
-                                for (i = 0; i < 16; i++)
-                                    fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
-                                fprintf(stderr, "\n");
+                                print_dedup_hash("Skipped", count,
+                                                 rec->rec_header.packet_header.caplen);
                             }
                             duplicate_count++;
                             count++;
                             continue;
                         } else {
                             if (verbose) {
-                                fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
-                                        count,
-                                        rec->rec_header.packet_header.caplen);
-                                for (i = 0; i < 16; i++)
-                                    fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
-                                fprintf(stderr, "\n");
+                                print_dedup_hash("Packet", count,
+                                                 rec->rec_header.packet_header.caplen);
                             }
                         }
                     }
@@ -2081,6 +1931,7 @@ main(int argc, char *argv[])
     }
 
 clean_exit:
+    ws_dedup_free(dedup);
     if (dsb_filenames) {
         g_array_free(dsb_types, TRUE);
         g_ptr_array_free(dsb_filenames, TRUE);
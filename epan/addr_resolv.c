@@ -83,12 +83,14 @@
 #include "addr_and_mask.h"
 #include "ipv6.h"
 #include "addr_resolv.h"
+#include "resolv_db.h"
 #include "wsutil/filesystem.h"
 
 #include <wsutil/report_message.h>
 #include <wsutil/file_util.h>
 #include <wsutil/pint.h>
 #include <wsutil/inet_addr.h>
+#include <wsutil/lpm_trie.h>
 
 #include <epan/strutil.h>
 #include <epan/to_str-int.h>
@@ -107,30 +109,7 @@
 #define ENAME_ENTERPRISES "enterprises.tsv"
 
 #define HASHETHSIZE      2048
-#define HASHHOSTSIZE     2048
 #define HASHIPXNETSIZE    256
-#define SUBNETLENGTHSIZE   32  /*1-32 inc.*/
-
-/* hash table used for IPv4 lookup */
-
-#define HASH_IPV4_ADDRESS(addr) (g_htonl(addr) & (HASHHOSTSIZE - 1))
-
-
-typedef struct sub_net_hashipv4 {
-    guint             addr;
-    /* XXX: No longer needed?*/
-    guint8            flags;          /* B0 dummy_entry, B1 resolve, B2 If the address is used in the trace */
-    struct sub_net_hashipv4   *next;
-    gchar             name[MAXNAMELEN];
-} sub_net_hashipv4_t;
-
-/* Array of entries of subnets of different lengths */
-typedef struct {
-    gsize        mask_length;      /*1-32*/
-    guint32      mask;             /* e.g. 255.255.255.*/
-    sub_net_hashipv4_t** subnet_addresses; /* Hash table of subnet addresses */
-} subnet_length_entry_t;
-
 
 /* hash table used for IPX network lookup */
 
@@ -236,8 +215,16 @@ static wmem_map_t *eth_hashtable = NULL;
 static wmem_map_t *serv_port_hashtable = NULL;
 static GHashTable *enterprises_hashtable = NULL;
 
-static subnet_length_entry_t subnet_length_entries[SUBNETLENGTHSIZE]; /* Ordered array of entries */
-static gboolean have_subnet_entry = FALSE;
+/* Precompiled databases of the global files, NULL if we parsed the text */
+static resolv_db_t *manuf_db = NULL;
+static resolv_db_t *wka_db = NULL;
+static resolv_db_t *services_db = NULL;
+static resolv_db_t *enterprises_db = NULL;
+static gboolean resolv_dbs_copied = FALSE;
+
+/* Subnet names from the subnets files, by prefix */
+static ws_lpm_trie *ipv4_subnets = NULL;
+static ws_lpm_trie *ipv6_subnets = NULL;
 
 static gboolean new_resolved_objects = FALSE;
 
@@ -540,7 +527,41 @@ fgetline(char *buf, int size, FILE *fp)
  *  Local function definitions
  */
 static subnet_entry_t subnet_lookup(const guint32 addr);
-static void subnet_entry_set(guint32 subnet_addr, const guint8 mask_length, const gchar* name);
+static void subnet_entry_set(ws_lpm_trie *subnets, const guint8 *subnet_addr, const guint8 mask_length, const gchar* name);
+
+/*
+ * Look up the entry for a port, copying it from the services database
+ * the first time. Returns NULL if there is none.
+ */
+static serv_port_t *
+serv_port_lookup(const guint port)
+{
+    serv_port_t *serv_port_table;
+    const guint8 *record;
+    const char *name;
+    guint8 key[2];
+
+    serv_port_table = (serv_port_t *)wmem_map_lookup(serv_port_hashtable, GUINT_TO_POINTER(port));
+    if (serv_port_table != NULL || services_db == NULL || port > G_MAXUINT16)
+        return serv_port_table;
+
+    phton16(key, (guint16)port);
+    record = resolv_db_find(services_db, RESOLV_DB_SERVICES, key);
+    if (record == NULL)
+        return NULL;
+
+    serv_port_table = wmem_new0(wmem_epan_scope(), serv_port_t);
+    if ((name = resolv_db_string(services_db, RESOLV_DB_SERVICES, record, 0)) != NULL)
+        serv_port_table->tcp_name = wmem_strdup(wmem_epan_scope(), name);
+    if ((name = resolv_db_string(services_db, RESOLV_DB_SERVICES, record, 1)) != NULL)
+        serv_port_table->udp_name = wmem_strdup(wmem_epan_scope(), name);
+    if ((name = resolv_db_string(services_db, RESOLV_DB_SERVICES, record, 2)) != NULL)
+        serv_port_table->sctp_name = wmem_strdup(wmem_epan_scope(), name);
+    if ((name = resolv_db_string(services_db, RESOLV_DB_SERVICES, record, 3)) != NULL)
+        serv_port_table->dccp_name = wmem_strdup(wmem_epan_scope(), name);
+    wmem_map_insert(serv_port_hashtable, GUINT_TO_POINTER(port), serv_port_table);
+    return serv_port_table;
+}
 
 
 static void
@@ -548,7 +569,7 @@ add_service_name(port_type proto, const guint port, const char *service_name)
 {
     serv_port_t *serv_port_table;
 
-    serv_port_table = (serv_port_t *)wmem_map_lookup(serv_port_hashtable, GUINT_TO_POINTER(port));
+    serv_port_table = serv_port_lookup(port);
     if (serv_port_table == NULL) {
         serv_port_table = wmem_new0(wmem_epan_scope(), serv_port_t);
         wmem_map_insert(serv_port_hashtable, GUINT_TO_POINTER(port), serv_port_table);
@@ -685,7 +706,7 @@ _serv_name_lookup(port_type proto, guint port, serv_port_t **value_ret)
 {
     serv_port_t *serv_port_table;
 
-    serv_port_table = (serv_port_t *)wmem_map_lookup(serv_port_hashtable, GUINT_TO_POINTER(port));
+    serv_port_table = serv_port_lookup(port);
 
     if (value_ret != NULL)
         *value_ret = serv_port_table;
@@ -746,7 +767,10 @@ initialize_services(void)
     if (g_services_path == NULL) {
         g_services_path = get_datafile_path(ENAME_SERVICES);
     }
-    parse_services_file(g_services_path);
+    /* Use its precompiled database if it's up to date */
+    services_db = resolv_db_open(g_services_path);
+    if (services_db == NULL)
+        parse_services_file(g_services_path);
 
     /* Compute the pathname of the personal services file */
     if (g_pservices_path == NULL) {
@@ -768,6 +792,8 @@ static void
 service_name_lookup_cleanup(void)
 {
     serv_port_hashtable = NULL;
+    resolv_db_close(services_db);
+    services_db = NULL;
     g_free(g_services_path);
     g_services_path = NULL;
     g_free(g_pservices_path);
@@ -823,7 +849,10 @@ initialize_enterprises(void)
     if (g_enterprises_path == NULL) {
         g_enterprises_path = get_datafile_path(ENAME_ENTERPRISES);
     }
-    parse_enterprises_file(g_enterprises_path);
+    /* Use its precompiled database if it's up to date */
+    enterprises_db = resolv_db_open(g_enterprises_path);
+    if (enterprises_db == NULL)
+        parse_enterprises_file(g_enterprises_path);
 
     if (g_penterprises_path == NULL) {
         g_penterprises_path = get_persconffile_path(ENAME_ENTERPRISES, FALSE);
@@ -834,7 +863,20 @@ initialize_enterprises(void)
 const gchar *
 try_enterprises_lookup(guint32 value)
 {
-    return (const gchar *)g_hash_table_lookup(enterprises_hashtable, GUINT_TO_POINTER(value));
+    const gchar *name;
+    const guint8 *record;
+    guint8 key[4];
+
+    /* The personal file overrides the global one */
+    name = (const gchar *)g_hash_table_lookup(enterprises_hashtable, GUINT_TO_POINTER(value));
+    if (name != NULL || enterprises_db == NULL)
+        return name;
+
+    phton32(key, value);
+    record = resolv_db_find(enterprises_db, RESOLV_DB_ENTERPRISES, key);
+    if (record == NULL)
+        return NULL;
+    return resolv_db_string(enterprises_db, RESOLV_DB_ENTERPRISES, record, 0);
 }
 
 const gchar *
@@ -866,6 +908,8 @@ enterprises_cleanup(void)
     g_assert(enterprises_hashtable);
     g_hash_table_destroy(enterprises_hashtable);
     enterprises_hashtable = NULL;
+    resolv_db_close(enterprises_db);
+    enterprises_db = NULL;
     g_assert(g_enterprises_path);
     g_free(g_enterprises_path);
     g_enterprises_path = NULL;
@@ -921,13 +965,40 @@ fill_dummy_ip4(const guint addr, hashipv4_t* volatile tp)
 }
 
 
-/* Fill in an IP6 structure with the string form of the address.
+/* Fill in an IP6 structure with info from subnets file or just with the
+ * string form of the address.
  */
 static void
 fill_dummy_ip6(hashipv6_t* volatile tp)
 {
+    const gchar* subnet_name;
+    guint mask_length;
+
     /* Overwrite if we get async DNS reply */
-    g_strlcpy(tp->name, tp->ip6, MAXNAMELEN);
+
+    /* Do we have a subnet for this address? */
+    subnet_name = (const gchar *)ws_lpm_trie_lookup(ipv6_subnets, tp->addr, &mask_length);
+    if (subnet_name != NULL && mask_length < 128) {
+        /* Print name, then the interface ID part of the address */
+        ws_in6_addr host_addr;
+        gchar buffer[WS_INET6_ADDRSTRLEN];
+        guint i;
+
+        memcpy(host_addr.bytes, tp->addr, sizeof host_addr.bytes);
+        for (i = 0; i < mask_length / 8; i++)
+            host_addr.bytes[i] = 0;
+        if (mask_length % 8)
+            host_addr.bytes[i] &= (guint8)(0xff >> (mask_length % 8));
+        ip6_to_str_buf(&host_addr, buffer, WS_INET6_ADDRSTRLEN);
+
+        /* The host part mostly starts with zeroes, shown as "::" */
+        g_snprintf(tp->name, MAXNAMELEN, "%s%s%s", subnet_name,
+                   buffer[0] == ':' ? "" : ":", buffer);
+    } else if (subnet_name != NULL) {
+        g_strlcpy(tp->name, subnet_name, MAXNAMELEN);
+    } else {
+        g_strlcpy(tp->name, tp->ip6, MAXNAMELEN);
+    }
 }
 
 #ifdef HAVE_C_ARES
@@ -1445,7 +1516,7 @@ get_ethbyaddr(const guint8 *addr)
 } /* get_ethbyaddr */
 
 static hashmanuf_t *
-manuf_hash_new_entry(const guint8 *addr, char* name, char* longname)
+manuf_hash_new_entry(const guint8 *addr, const char* name, const char* longname)
 {
     guint manuf_key;
     hashmanuf_t *manuf_value;
@@ -1480,7 +1551,7 @@ manuf_hash_new_entry(const guint8 *addr, char* name, char* longname)
 }
 
 static void
-wka_hash_new_entry(const guint8 *addr, char* name)
+wka_hash_new_entry(const guint8 *addr, const char* name)
 {
     guint8 *wka_key;
 
@@ -1490,6 +1561,52 @@ wka_hash_new_entry(const guint8 *addr, char* name)
     wmem_map_insert(wka_hashtable, wka_key, wmem_strdup(wmem_epan_scope(), name));
 }
 
+/*
+ * Find a record in the wka database, then in the manuf one; the wka file
+ * is read after the manuf file, so its entries win.
+ */
+static const guint8 *
+ether_db_find(resolv_db_section_e section, const guint8 *key, resolv_db_t **db)
+{
+    const guint8 *record;
+
+    if ((record = resolv_db_find(wka_db, section, key)) != NULL) {
+        *db = wka_db;
+        return record;
+    }
+    if ((record = resolv_db_find(manuf_db, section, key)) != NULL) {
+        *db = manuf_db;
+        return record;
+    }
+    return NULL;
+}
+
+/*
+ * Look up the manufacturer table entry for an OUI, copying it from the
+ * databases the first time. Returns NULL if there is none.
+ */
+static hashmanuf_t *
+manuf_hash_lookup(const guint32 manuf_key)
+{
+    hashmanuf_t  *manuf_value;
+    const guint8 *record;
+    resolv_db_t  *db;
+    guint8        addr[3];
+
+    manuf_value = (hashmanuf_t *)wmem_map_lookup(manuf_hashtable, GUINT_TO_POINTER(manuf_key));
+    if (manuf_value != NULL || manuf_db == NULL)
+        return manuf_value;
+
+    addr[0] = (guint8)(manuf_key >> 16);
+    addr[1] = (guint8)(manuf_key >> 8);
+    addr[2] = (guint8)manuf_key;
+    record = ether_db_find(RESOLV_DB_MANUF, addr, &db);
+    if (record == NULL)
+        return NULL;
+    return manuf_hash_new_entry(addr, resolv_db_string(db, RESOLV_DB_MANUF, record, 0),
+                                resolv_db_string(db, RESOLV_DB_MANUF, record, 1));
+}
+
 static void
 add_manuf_name(const guint8 *addr, unsigned int mask, gchar *name, gchar *longname)
 {
@@ -1530,7 +1647,7 @@ manuf_name_lookup(const guint8 *addr)
 
 
     /* first try to find a "perfect match" */
-    manuf_value = (hashmanuf_t*)wmem_map_lookup(manuf_hashtable, GUINT_TO_POINTER(manuf_key));
+    manuf_value = manuf_hash_lookup(manuf_key);
     if (manuf_value != NULL) {
         return manuf_value;
     }
@@ -1542,7 +1659,7 @@ manuf_name_lookup(const guint8 *addr)
      * 0x02 locally administered bit */
     if ((manuf_key & 0x00010000) != 0) {
         manuf_key &= 0x00FEFFFF;
-        manuf_value = (hashmanuf_t*)wmem_map_lookup(manuf_hashtable, GUINT_TO_POINTER(manuf_key));
+        manuf_value = manuf_hash_lookup(manuf_key);
         if (manuf_value != NULL) {
             return manuf_value;
         }
@@ -1553,13 +1670,15 @@ manuf_name_lookup(const guint8 *addr)
 
 } /* manuf_name_lookup */
 
-static gchar *
+static const gchar *
 wka_name_lookup(const guint8 *addr, const unsigned int mask)
 {
     guint8     masked_addr[6];
     guint      num;
     gint       i;
-    gchar     *name;
+    const gchar *name;
+    const guint8 *record;
+    resolv_db_t *db;
 
     if (wka_hashtable == NULL) {
         return NULL;
@@ -1574,7 +1693,9 @@ wka_name_lookup(const guint8 *addr, const unsigned int mask)
     for (; i < 6; i++)
         masked_addr[i] = 0;
 
-    name = (gchar *)wmem_map_lookup(wka_hashtable, masked_addr);
+    name = (const gchar *)wmem_map_lookup(wka_hashtable, masked_addr);
+    if (name == NULL && (record = ether_db_find(RESOLV_DB_WKA, masked_addr, &db)) != NULL)
+        name = resolv_db_string(db, RESOLV_DB_WKA, record, 0);
 
     return name;
 
@@ -1630,22 +1751,34 @@ initialize_ethers(void)
     if (g_pethers_path == NULL)
         g_pethers_path = get_persconffile_path(ENAME_ETHERS, FALSE);
 
-    /* Compute the pathname of the manuf file */
+    /* Compute the pathnames of the manuf and wka files */
     if (g_manuf_path == NULL)
         g_manuf_path = get_datafile_path(ENAME_MANUF);
+    if (g_wka_path == NULL)
+        g_wka_path = get_datafile_path(ENAME_WKA);
 
-    /* Read it and initialize the hash table */
+    /*
+     * Use their precompiled databases if both are up to date; the wka
+     * file overrides the manuf file, and we can't get that right with one
+     * of them a database and the other one in the hash tables.
+     */
+    manuf_db = resolv_db_open(g_manuf_path);
+    wka_db = resolv_db_open(g_wka_path);
+    if (manuf_db != NULL && wka_db != NULL)
+        return;
+    resolv_db_close(manuf_db);
+    manuf_db = NULL;
+    resolv_db_close(wka_db);
+    wka_db = NULL;
+
+    /* Read the manuf file and initialize the hash tables */
     set_ethent(g_manuf_path);
     while ((eth = get_ethent(&mask, TRUE))) {
         add_manuf_name(eth->addr, mask, eth->name, eth->longname);
     }
     end_ethent();
 
-    /* Compute the pathname of the wka file */
-    if (g_wka_path == NULL)
-        g_wka_path = get_datafile_path(ENAME_WKA);
-
-    /* Read it and initialize the hash table */
+    /* Read the wka file and add to the hash tables */
     set_ethent(g_wka_path);
     while ((eth = get_ethent(&mask, TRUE))) {
         add_manuf_name(eth->addr, mask, eth->name, eth->longname);
@@ -1657,6 +1790,10 @@ initialize_ethers(void)
 static void
 ethers_cleanup(void)
 {
+    resolv_db_close(manuf_db);
+    manuf_db = NULL;
+    resolv_db_close(wka_db);
+    wka_db = NULL;
     g_free(g_ethers_path);
     g_ethers_path = NULL;
     g_free(g_pethers_path);
@@ -1680,7 +1817,7 @@ eth_addr_resolve(hashether_t *tp) {
         return tp;
     } else {
         guint         mask;
-        gchar        *name;
+        const gchar  *name;
         address       ether_addr;
 
         /* Unknown name.  Try looking for it in the well-known-address
@@ -1779,6 +1916,9 @@ eth_hash_new_entry(const guint8 *addr, const gboolean resolve)
 {
     hashether_t *tp;
     char *endp;
+    const guint8 *record;
+    const char *name;
+    resolv_db_t *db;
 
     tp = wmem_new(wmem_epan_scope(), hashether_t);
     memcpy(tp->addr, addr, sizeof(tp->addr));
@@ -1788,8 +1928,14 @@ eth_hash_new_entry(const guint8 *addr, const gboolean resolve)
     *endp = '\0';
     tp->resolved_name[0] = '\0';
 
-    if (resolve)
+    /* The hash table doesn't have the well-known addresses in the databases */
+    if ((record = ether_db_find(RESOLV_DB_ETHER, addr, &db)) != NULL &&
+        (name = resolv_db_string(db, RESOLV_DB_ETHER, record, 0)) != NULL) {
+        g_strlcpy(tp->resolved_name, name, MAXNAMELEN);
+        tp->status = HASHETHER_STATUS_RESOLVED_NAME;
+    } else if (resolve) {
         eth_addr_resolve(tp);
+    }
 
     wmem_map_insert(eth_hashtable, tp->addr, tp);
 
@@ -2313,15 +2459,13 @@ get_addrinfo_list(void)
  * <line> = <comment> | <entry> | <whitespace>
  * <comment> = <whitespace>#<any>
  * <entry> = <subnet_definition> <whitespace> <subnet_name> [<comment>|<whitespace><any>]
- * <subnet_definition> = <ipv4_address> / <subnet_mask_length>
- * <ipv4_address> is a full address; it will be masked to get the subnet-ID.
- * <subnet_mask_length> is a decimal 1-31
+ * <subnet_definition> = <ip_address> / <subnet_mask_length>
+ * <ip_address> is a full IPv4 or IPv6 address; it will be masked to get the subnet-ID.
+ * <subnet_mask_length> is a decimal 1-32 for IPv4, 1-128 for IPv6
  * <subnet_name> is a string containing no whitespace.
  * <whitespace> = (space | tab)+
  * Any malformed entries are ignored.
  * Any trailing data after the subnet_name is ignored.
- *
- * XXX Support IPv6
  */
 static gboolean
 read_subnets_file (const char *subnetspath)
@@ -2329,8 +2473,11 @@ read_subnets_file (const char *subnetspath)
     FILE *hf;
     char line[MAX_LINELEN];
     gchar *cp, *cp2;
-    guint32 host_addr; /* IPv4 ONLY */
-    guint8 mask_length;
+    guint32 host_addr;
+    ws_in6_addr host_addr6;
+    const guint8 *subnet_addr;
+    ws_lpm_trie *subnets;
+    guint8 mask_length, max_mask_length;
 
     if ((hf = ws_fopen(subnetspath, "r")) == NULL)
         return FALSE;
@@ -2343,7 +2490,7 @@ read_subnets_file (const char *subnetspath)
             continue; /* no tokens in the line */
 
 
-        /* Expected format is <IP4 address>/<subnet length> */
+        /* Expected format is <IP address>/<subnet length> */
         cp2 = strchr(cp, '/');
         if (NULL == cp2) {
             /* No length */
@@ -2352,19 +2499,27 @@ read_subnets_file (const char *subnetspath)
         *cp2 = '\0'; /* Cut token */
         ++cp2    ;
 
-        /* Check if this is a valid IPv4 address */
-        if (!str_to_ip(cp, &host_addr)) {
+        /* Check if this is a valid IPv4 or IPv6 address */
+        if (str_to_ip(cp, &host_addr)) {
+            subnet_addr = (const guint8 *)&host_addr;
+            subnets = ipv4_subnets;
+            max_mask_length = 32;
+        } else if (str_to_ip6(cp, &host_addr6)) {
+            subnet_addr = host_addr6.bytes;
+            subnets = ipv6_subnets;
+            max_mask_length = 128;
+        } else {
             continue; /* no */
         }
 
-        if (!ws_strtou8(cp2, NULL, &mask_length) || mask_length == 0 || mask_length > 32) {
+        if (!ws_strtou8(cp2, NULL, &mask_length) || mask_length == 0 || mask_length > max_mask_length) {
             continue; /* invalid mask length */
         }
 
         if ((cp = strtok(NULL, " \t")) == NULL)
             continue; /* no subnet name */
 
-        subnet_entry_set(host_addr, mask_length, cp);
+        subnet_entry_set(subnets, subnet_addr, mask_length, cp);
     }
 
     fclose(hf);
@@ -2375,47 +2530,18 @@ static subnet_entry_t
 subnet_lookup(const guint32 addr)
 {
     subnet_entry_t subnet_entry;
-    guint32 i;
-
-    /* Search mask lengths linearly, longest first */
-
-    i = SUBNETLENGTHSIZE;
-    while(have_subnet_entry && i > 0) {
-        guint32 masked_addr;
-        subnet_length_entry_t* length_entry;
-
-        /* Note that we run from 31 (length 32)  to 0 (length 1)  */
-        --i;
-        g_assert(i < SUBNETLENGTHSIZE);
-
+    guint mask_length;
 
-        length_entry = &subnet_length_entries[i];
-
-        if (NULL != length_entry->subnet_addresses) {
-            sub_net_hashipv4_t * tp;
-            guint32 hash_idx;
-
-            masked_addr = addr & length_entry->mask;
-            hash_idx = HASH_IPV4_ADDRESS(masked_addr);
-
-            tp = length_entry->subnet_addresses[hash_idx];
-            while(tp != NULL && tp->addr != masked_addr) {
-                tp = tp->next;
-            }
-
-            if (NULL != tp) {
-                subnet_entry.mask = length_entry->mask;
-                subnet_entry.mask_length = i + 1; /* Length is offset + 1 */
-                subnet_entry.name = tp->name;
-                return subnet_entry;
-            }
-        }
+    /* One walk down the trie finds the longest subnet */
+    subnet_entry.name = (const gchar *)ws_lpm_trie_lookup(ipv4_subnets, (const guint8 *)&addr, &mask_length);
+    if (subnet_entry.name != NULL) {
+        subnet_entry.mask = g_htonl(ip_get_subnet_mask(mask_length));
+        subnet_entry.mask_length = mask_length;
+    } else {
+        subnet_entry.mask = 0;
+        subnet_entry.mask_length = 0;
     }
 
-    subnet_entry.mask = 0;
-    subnet_entry.mask_length = 0;
-    subnet_entry.name = NULL;
-
     return subnet_entry;
 }
 
@@ -2424,61 +2550,24 @@ subnet_lookup(const guint32 addr)
  * given length.
  */
 static void
-subnet_entry_set(guint32 subnet_addr, const guint8 mask_length, const gchar* name)
+subnet_entry_set(ws_lpm_trie *subnets, const guint8 *subnet_addr, const guint8 mask_length, const gchar* name)
 {
-    subnet_length_entry_t* entry;
-    sub_net_hashipv4_t * tp;
-    gsize hash_idx;
-
-    g_assert(mask_length > 0 && mask_length <= 32);
-
-    entry = &subnet_length_entries[mask_length - 1];
-
-    subnet_addr &= entry->mask;
-
-    hash_idx = HASH_IPV4_ADDRESS(subnet_addr);
-
-    if (NULL == entry->subnet_addresses) {
-        entry->subnet_addresses = (sub_net_hashipv4_t**)wmem_alloc0(wmem_epan_scope(), sizeof(sub_net_hashipv4_t*) * HASHHOSTSIZE);
-    }
-
-    if (NULL != (tp = entry->subnet_addresses[hash_idx])) {
-        sub_net_hashipv4_t * new_tp;
+    /* This is longer than subnet names can actually be */
+    gchar *subnet_name = g_strndup(name, MAXNAMELEN - 1);
 
-        while (tp->next) {
-            if (tp->addr == subnet_addr) {
-                return; /* XXX provide warning that an address was repeated? */
-            } else {
-                tp = tp->next;
-            }
-        }
-
-        new_tp = wmem_new(wmem_epan_scope(), sub_net_hashipv4_t);
-        tp->next = new_tp;
-        tp = new_tp;
-    } else {
-        tp = entry->subnet_addresses[hash_idx] = wmem_new(wmem_epan_scope(), sub_net_hashipv4_t);
+    if (!ws_lpm_trie_insert(subnets, subnet_addr, mask_length, subnet_name)) {
+        /* XXX provide warning that an address was repeated? */
+        g_free(subnet_name);
     }
-
-    tp->next = NULL;
-    tp->addr = subnet_addr;
-    g_strlcpy(tp->name, name, MAXNAMELEN); /* This is longer than subnet names can actually be */
-    have_subnet_entry = TRUE;
 }
 
 static void
 subnet_name_lookup_init(void)
 {
     gchar* subnetspath;
-    guint32 i;
 
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        guint32 length = i + 1;
-
-        subnet_length_entries[i].subnet_addresses  = NULL;
-        subnet_length_entries[i].mask_length  = length;
-        subnet_length_entries[i].mask = g_htonl(ip_get_subnet_mask(length));
-    }
+    ipv4_subnets = ws_lpm_trie_new(32, g_free);
+    ipv6_subnets = ws_lpm_trie_new(128, g_free);
 
     /* Check profile directory before personal configuration */
     subnetspath = get_persconffile_path(ENAME_SUBNETS, TRUE);
@@ -2857,6 +2946,21 @@ get_hostname6(const ws_in6_addr *addr)
     return tp->name;
 }
 
+/* -------------------------- */
+
+const gchar *
+get_subnet_name(const address *addr, guint *prefix_len)
+{
+    switch (addr->type) {
+    case AT_IPv4:
+        return (const gchar *)ws_lpm_trie_lookup(ipv4_subnets, (const guint8 *)addr->data, prefix_len);
+    case AT_IPv6:
+        return (const gchar *)ws_lpm_trie_lookup(ipv6_subnets, (const guint8 *)addr->data, prefix_len);
+    default:
+        return NULL;
+    }
+}
+
 /* -------------------------- */
 void
 add_ipv4_name(const guint addr, const gchar *name)
@@ -3014,9 +3118,6 @@ host_name_lookup_init(void)
 static void
 host_name_lookup_cleanup(void)
 {
-    guint32 i, j;
-    sub_net_hashipv4_t *entry, *next_entry;
-
     _host_name_lookup_cleanup();
 
     ipxnet_hash_table = NULL;
@@ -3024,21 +3125,10 @@ host_name_lookup_cleanup(void)
     ipv6_hash_table = NULL;
     ss7pc_hash_table = NULL;
 
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        if (subnet_length_entries[i].subnet_addresses != NULL) {
-            for (j = 0; j < HASHHOSTSIZE; j++) {
-                for (entry = subnet_length_entries[i].subnet_addresses[j];
-                     entry != NULL; entry = next_entry) {
-                    next_entry = entry->next;
-                    wmem_free(wmem_epan_scope(), entry);
-                }
-            }
-            wmem_free(wmem_epan_scope(), subnet_length_entries[i].subnet_addresses);
-            subnet_length_entries[i].subnet_addresses = NULL;
-        }
-    }
-
-    have_subnet_entry = FALSE;
+    ws_lpm_trie_free(ipv4_subnets);
+    ipv4_subnets = NULL;
+    ws_lpm_trie_free(ipv6_subnets);
+    ipv6_subnets = NULL;
     new_resolved_objects = FALSE;
 }
 
@@ -3275,7 +3365,7 @@ get_manuf_name_if_known(const guint8 *addr)
     oct = addr[2];
     manuf_key = manuf_key | oct;
 
-    manuf_value = (hashmanuf_t *)wmem_map_lookup(manuf_hashtable, GUINT_TO_POINTER(manuf_key));
+    manuf_value = manuf_hash_lookup(manuf_key);
     if ((manuf_value == NULL) || (manuf_value->status == HASHETHER_STATUS_UNRESOLVED)) {
         return NULL;
     }
@@ -3289,7 +3379,7 @@ uint_get_manuf_name_if_known(const guint manuf_key)
 {
     hashmanuf_t *manuf_value;
 
-    manuf_value = (hashmanuf_t *)wmem_map_lookup(manuf_hashtable, GUINT_TO_POINTER(manuf_key));
+    manuf_value = manuf_hash_lookup(manuf_key);
     if ((manuf_value == NULL) || (manuf_value->status == HASHETHER_STATUS_UNRESOLVED)) {
         return NULL;
     }
@@ -3474,27 +3564,74 @@ get_host_ipaddr6(const char *host, ws_in6_addr *addrp)
     return FALSE;
 }
 
+/*
+ * With the precompiled databases, the hash tables only have the entries
+ * that were looked up; copy the rest in for those who want to list them.
+ */
+static void
+copy_resolv_dbs(void)
+{
+    resolv_db_t *dbs[2];
+    const guint8 *record;
+    const char *name;
+    guint i, n;
+
+    if (resolv_dbs_copied)
+        return;
+    resolv_dbs_copied = TRUE;
+
+    /* wka first, so its entries win */
+    dbs[0] = wka_db;
+    dbs[1] = manuf_db;
+    for (i = 0; i < G_N_ELEMENTS(dbs); i++) {
+        for (n = 0; n < resolv_db_count(dbs[i], RESOLV_DB_MANUF); n++) {
+            record = resolv_db_record(dbs[i], RESOLV_DB_MANUF, n);
+            manuf_hash_lookup(pntoh24(record));
+        }
+        for (n = 0; n < resolv_db_count(dbs[i], RESOLV_DB_WKA); n++) {
+            record = resolv_db_record(dbs[i], RESOLV_DB_WKA, n);
+            name = resolv_db_string(dbs[i], RESOLV_DB_WKA, record, 0);
+            if (name != NULL && wmem_map_lookup(wka_hashtable, record) == NULL)
+                wka_hash_new_entry(record, name);
+        }
+        for (n = 0; n < resolv_db_count(dbs[i], RESOLV_DB_ETHER); n++) {
+            record = resolv_db_record(dbs[i], RESOLV_DB_ETHER, n);
+            if (wmem_map_lookup(eth_hashtable, record) == NULL)
+                eth_hash_new_entry(record, FALSE);
+        }
+    }
+
+    for (n = 0; n < resolv_db_count(services_db, RESOLV_DB_SERVICES); n++) {
+        record = resolv_db_record(services_db, RESOLV_DB_SERVICES, n);
+        serv_port_lookup(pntoh16(record));
+    }
+}
+
 wmem_map_t *
 get_manuf_hashtable(void)
 {
+    copy_resolv_dbs();
     return manuf_hashtable;
 }
 
 wmem_map_t *
 get_wka_hashtable(void)
 {
+    copy_resolv_dbs();
     return wka_hashtable;
 }
 
 wmem_map_t *
 get_eth_hashtable(void)
 {
+    copy_resolv_dbs();
     return eth_hashtable;
 }
 
 wmem_map_t *
 get_serv_port_hashtable(void)
 {
+    copy_resolv_dbs();
     return serv_port_hashtable;
 }
 
@@ -3543,6 +3680,7 @@ addr_resolv_cleanup(void)
     ipx_name_lookup_cleanup();
     enterprises_cleanup();
     host_name_lookup_cleanup();
+    resolv_dbs_copied = FALSE;
 }
 
 gboolean
@@ -195,6 +195,11 @@ WS_DLL_PUBLIC const gchar *get_hostname(const guint addr);
 /* get_hostname6 returns the host name, or numeric addr if not found */
 WS_DLL_PUBLIC const gchar *get_hostname6(const ws_in6_addr *ad);
 
+/* get_subnet_name returns the name of the longest subnet in the subnets
+   files containing an AT_IPv4 or AT_IPv6 address and, if prefix_len isn't
+   NULL, sets *prefix_len to its length; it returns NULL if there is none */
+WS_DLL_PUBLIC const gchar *get_subnet_name(const address *addr, guint *prefix_len);
+
 /* get_ether_name returns the logical name if found in ethers files else
    "<vendor>_%02x:%02x:%02x" if the vendor code is known else
    "%02x:%02x:%02x:%02x:%02x:%02x" */
@@ -51,6 +51,42 @@ static gboolean filters_enabled = TRUE;
  */
 static gboolean tmp_colors_set = FALSE;
 
+/* The compiled filters of the enabled entries of color_filter_list, merged
+ * so that fields and tests common to several filters are evaluated once
+ * per packet. color_filter_set_entries maps a set index back to its
+ * color_filter_t. Rebuilt on first use after the list has changed. */
+static dfilter_set_t *color_filter_set = NULL;
+static GPtrArray *color_filter_set_entries = NULL;
+static gboolean color_filter_set_stale = TRUE;
+
+static void
+color_filters_set_invalidate(void)
+{
+    color_filter_set_stale = TRUE;
+}
+
+static void
+color_filters_set_build(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+
+    dfilter_set_free(color_filter_set);
+    color_filter_set = dfilter_set_new();
+    if (color_filter_set_entries == NULL)
+        color_filter_set_entries = g_ptr_array_new();
+    g_ptr_array_set_size(color_filter_set_entries, 0);
+
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if (!colorf->disabled && colorf->c_colorfilter != NULL) {
+            dfilter_set_add(color_filter_set, colorf->c_colorfilter);
+            g_ptr_array_add(color_filter_set_entries, colorf);
+        }
+    }
+    color_filter_set_stale = FALSE;
+}
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const gchar *name,          /* The name of the filter to create */
@@ -131,6 +167,9 @@ color_filters_set_tmp(guint8 filt_nr, const gchar *filter, gboolean disabled, gc
     dfilter_t      *compiled_filter;
     guint8         i;
     gchar          *local_err_msg = NULL;
+
+    color_filters_set_invalidate();
+
     /* Go through the temporary filters and look for the same filter string.
      * If found, clear it so that a filter can be "moved" up and down the list
      */
@@ -322,6 +361,7 @@ gboolean
 color_filters_init(gchar** err_msg, color_filter_add_cb_func add_cb)
 {
     /* delete all currently existing filters */
+    color_filters_set_invalidate();
     color_filter_list_delete(&color_filter_list);
 
     /* now try to construct the filters list */
@@ -335,6 +375,7 @@ color_filters_reload(gchar** err_msg, color_filter_add_cb_func add_cb)
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
+    color_filters_set_invalidate();
 
     /* now try to construct the filters list */
     return color_filters_get(err_msg, add_cb);
@@ -345,6 +386,14 @@ color_filters_cleanup(void)
 {
     /* delete the previously deleted filters */
     color_filter_list_delete(&color_filter_deleted_list);
+
+    dfilter_set_free(color_filter_set);
+    color_filter_set = NULL;
+    if (color_filter_set_entries != NULL) {
+        g_ptr_array_free(color_filter_set_entries, TRUE);
+        color_filter_set_entries = NULL;
+    }
+    color_filter_set_stale = TRUE;
 }
 
 typedef struct _color_clone
@@ -429,6 +478,7 @@ color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl, gchar** err_msg)
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
+    color_filters_set_invalidate();
 
     /* clone all list entries from tmp/edit to normal list */
     color_filter_valid_list = NULL;
@@ -490,22 +540,16 @@ color_filters_prime_edt(epan_dissect_t *edt)
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    gint idx;
 
-    /* If we have color filters, "search" for the matching one. */
+    /* If we have color filters, "search" for the first matching one. */
     if ((edt->tree != NULL) && (color_filters_used())) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
-            }
-            curr = g_slist_next(curr);
-        }
+        if (color_filter_set_stale)
+            color_filters_set_build();
+
+        idx = dfilter_set_apply_edt_first(color_filter_set, edt);
+        if (idx >= 0)
+            return (const color_filter_t *)g_ptr_array_index(color_filter_set_entries, idx);
     }
 
     return NULL;
@@ -15,6 +15,7 @@
 #include "packet.h"
 #include "to_str.h"
 #include "conversation.h"
+#include "reassemble.h"
 
 /* define DEBUG_CONVERSATION for pretty debug printing */
 /* #define DEBUG_CONVERSATION */
@@ -70,6 +71,44 @@ static guint32 new_index;
  */
 static address null_address_ = ADDRESS_INIT_NONE;
 
+/*
+ * Streaming mode state; see conversation_set_aging().
+ *
+ * Conversations are kept on a list ordered from least to most recently
+ * found, so that both idle and over-limit eviction only ever look at the
+ * head of the list.
+ */
+static gboolean aging_enabled = FALSE;
+static guint aging_idle_timeout = 0;
+static guint aging_max_conversations = 0;
+static conversation_t *lru_head = NULL;
+static conversation_t *lru_tail = NULL;
+static nstime_t aging_now = NSTIME_INIT_ZERO;
+static conversation_aging_stats_t aging_stats;
+static GArray *evict_funcs = NULL;
+
+/*
+ * The first frame of each second of capture time within the idle timeout,
+ * used to translate the idle timeout into the oldest frame number whose
+ * fragments are still worth keeping.
+ */
+typedef struct {
+	time_t secs;
+	guint32 frame;
+} aging_checkpoint_t;
+
+static GQueue aging_checkpoints = G_QUEUE_INIT;
+static guint32 aging_prune_frame = 0;
+
+typedef struct {
+	int proto;
+	conversation_evict_func func;
+} evict_func_t;
+
+static void conversation_lru_remove(conversation_t *conv);
+static void conversation_lru_append(conversation_t *conv);
+static conversation_evict_func conversation_find_evict_func(const int proto);
+
 
 /*
  * Creates a new conversation with known endpoints based on a conversation
@@ -157,7 +196,10 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 		 * Set the protocol dissector used for the template conversation as
 		 * the handler of the new conversation as well.
 		 */
+		wmem_tree_destroy(new_conversation_from_template->dissector_tree, FALSE, FALSE);
 		new_conversation_from_template->dissector_tree = conversation->dissector_tree;
+		new_conversation_from_template->shared_dissector_tree = TRUE;
+		conversation->shared_dissector_tree = TRUE;
 
 		return new_conversation_from_template;
 	}
@@ -480,6 +522,38 @@ void conversation_epan_reset(void)
 	 * Start the conversation indices over at 0.
 	 */
 	new_index = 0;
+
+	/*
+	 * The conversations themselves went away with the file scope.
+	 */
+	lru_head = lru_tail = NULL;
+	aging_stats.active = 0;
+	nstime_set_zero(&aging_now);
+	while (!g_queue_is_empty(&aging_checkpoints))
+		g_free(g_queue_pop_head(&aging_checkpoints));
+	aging_prune_frame = 0;
+}
+
+/*
+ * Return the hash table in which a conversation with the given options
+ * belongs.
+ */
+static wmem_map_t *
+conversation_hashtable_for_options(const guint options)
+{
+	if (options & NO_ADDR2) {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return conversation_hashtable_no_addr2_or_port2;
+		} else {
+			return conversation_hashtable_no_addr2;
+		}
+	} else {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return conversation_hashtable_no_port2;
+		} else {
+			return conversation_hashtable_exact;
+		}
+	}
 }
 
 /*
@@ -570,6 +644,9 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 			else
 				chain_head->latest_found = conv->latest_found;
 
+			/* The map keeps the key of the entry it replaces, and
+			 * conv's key may be freed before the successor's. */
+			wmem_map_steal(hashtable, conv->key_ptr);
 			wmem_map_insert(hashtable, chain_head->key_ptr, chain_head);
 		}
 	}
@@ -708,19 +785,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	}
 #endif
 
-	if (options & NO_ADDR2) {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
-		} else {
-			hashtable = conversation_hashtable_no_addr2;
-		}
-	} else {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
-		} else {
-			hashtable = conversation_hashtable_exact;
-		}
-	}
+	hashtable = conversation_hashtable_for_options(options);
 
 	new_key = wmem_new(wmem_file_scope(), struct conversation_key);
 	if (addr1 != NULL) {
@@ -756,6 +821,9 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	conversation_insert_into_hashtable(hashtable, conversation);
 	DENDENT();
 
+	if (aging_enabled)
+		conversation_lru_append(conversation);
+
 	return conversation;
 }
 
@@ -885,9 +953,15 @@ conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, co
 		}
 	}
 
-	if (match)
+	if (match) {
 		chain_head->latest_found = match;
 
+		if (aging_enabled && !match->retained && match != lru_tail) {
+			conversation_lru_remove(match);
+			conversation_lru_append(match);
+		}
+	}
+
 	return match;
 }
 
@@ -1305,6 +1379,10 @@ conversation_add_proto_data(conversation_t *conv, const int proto, void *proto_d
 		conv->data_list = wmem_tree_new(wmem_file_scope());
 
 	wmem_tree_insert32(conv->data_list, proto, proto_data);
+
+	/* We couldn't release data that nobody knows how to release. */
+	if (aging_enabled && !conv->retained && conversation_find_evict_func(proto) == NULL)
+		conversation_retain(conv);
 }
 
 void *
@@ -1563,6 +1641,196 @@ guint32 conversation_get_endpoint_by_id(struct _packet_info *pinfo, endpoint_typ
 	return pinfo->conv_endpoint->port1;
 }
 
+/*
+ * Streaming mode.
+ */
+static void
+conversation_lru_remove(conversation_t *conv)
+{
+	if (conv->lru_prev)
+		conv->lru_prev->lru_next = conv->lru_next;
+	else
+		lru_head = conv->lru_next;
+
+	if (conv->lru_next)
+		conv->lru_next->lru_prev = conv->lru_prev;
+	else
+		lru_tail = conv->lru_prev;
+
+	conv->lru_prev = conv->lru_next = NULL;
+	aging_stats.active--;
+}
+
+static void
+conversation_lru_append(conversation_t *conv)
+{
+	conv->last_time = aging_now;
+	conv->lru_prev = lru_tail;
+	conv->lru_next = NULL;
+	if (lru_tail)
+		lru_tail->lru_next = conv;
+	else
+		lru_head = conv;
+	lru_tail = conv;
+
+	aging_stats.active++;
+	if (aging_stats.active > aging_stats.peak)
+		aging_stats.peak = aging_stats.active;
+}
+
+/*
+ * Remove a conversation from the tables, let the protocols that
+ * attached data to it release that data, and free it.
+ */
+static void
+conversation_evict(conversation_t *conv)
+{
+	guint i;
+
+	conversation_lru_remove(conv);
+	conversation_remove_from_hashtable(conversation_hashtable_for_options(conv->options), conv);
+
+	/* Only protocols with an evict function attached data to it, see
+	 * conversation_add_proto_data(). */
+	if (conv->data_list != NULL) {
+		for (i = 0; evict_funcs != NULL && i < evict_funcs->len; i++) {
+			evict_func_t *ef = &g_array_index(evict_funcs, evict_func_t, i);
+			void *proto_data = wmem_tree_lookup32(conv->data_list, ef->proto);
+
+			if (proto_data != NULL)
+				ef->func(conv, proto_data);
+		}
+		wmem_tree_destroy(conv->data_list, FALSE, FALSE);
+	}
+
+	if (!conv->shared_dissector_tree)
+		wmem_tree_destroy(conv->dissector_tree, FALSE, FALSE);
+
+	free_address_wmem(wmem_file_scope(), &conv->key_ptr->addr1);
+	free_address_wmem(wmem_file_scope(), &conv->key_ptr->addr2);
+	wmem_free(wmem_file_scope(), conv->key_ptr);
+	wmem_free(wmem_file_scope(), conv);
+}
+
+void
+conversation_set_aging(guint idle_timeout, guint max_conversations)
+{
+	aging_idle_timeout = idle_timeout;
+	aging_max_conversations = max_conversations;
+	aging_enabled = idle_timeout != 0 || max_conversations != 0;
+}
+
+gboolean
+conversation_aging_enabled(void)
+{
+	return aging_enabled;
+}
+
+void
+conversation_register_evict_func(const int proto, conversation_evict_func func)
+{
+	evict_func_t ef;
+
+	if (evict_funcs == NULL)
+		evict_funcs = g_array_new(FALSE, FALSE, sizeof(evict_func_t));
+
+	ef.proto = proto;
+	ef.func = func;
+	g_array_append_val(evict_funcs, ef);
+}
+
+static conversation_evict_func
+conversation_find_evict_func(const int proto)
+{
+	guint i;
+
+	for (i = 0; evict_funcs != NULL && i < evict_funcs->len; i++) {
+		evict_func_t *ef = &g_array_index(evict_funcs, evict_func_t, i);
+
+		if (ef->proto == proto)
+			return ef->func;
+	}
+	return NULL;
+}
+
+void
+conversation_retain(conversation_t *conv)
+{
+	if (conv->retained)
+		return;
+
+	conv->retained = TRUE;
+	if (aging_enabled) {
+		conversation_lru_remove(conv);
+		aging_stats.retained++;
+	}
+}
+
+void
+conversation_get_aging_stats(conversation_aging_stats_t *stats)
+{
+	*stats = aging_stats;
+}
+
+/*
+ * Work out the oldest frame that may still have been seen within the
+ * idle timeout and, once per second of capture time, drop reassemblies
+ * that have not progressed since then.
+ */
+static void
+conversation_aging_prune_fragments(const guint32 frame_num)
+{
+	aging_checkpoint_t *cp;
+	gboolean expired = FALSE;
+
+	cp = (aging_checkpoint_t *)g_queue_peek_tail(&aging_checkpoints);
+	if (cp == NULL || cp->secs != aging_now.secs) {
+		cp = g_new(aging_checkpoint_t, 1);
+		cp->secs = aging_now.secs;
+		cp->frame = frame_num;
+		g_queue_push_tail(&aging_checkpoints, cp);
+	}
+
+	while ((cp = (aging_checkpoint_t *)g_queue_peek_head(&aging_checkpoints)) != NULL &&
+	    aging_now.secs - cp->secs > (time_t)aging_idle_timeout) {
+		g_free(g_queue_pop_head(&aging_checkpoints));
+		expired = TRUE;
+	}
+
+	/*
+	 * The checkpoint for the current second is never popped, so cp is
+	 * the first frame that is still inside the timeout.
+	 */
+	if (expired && cp->frame > aging_prune_frame) {
+		aging_prune_frame = cp->frame;
+		aging_stats.pruned_fragments += reassembly_tables_prune(cp->frame);
+	}
+}
+
+void
+conversation_aging_new_frame(const guint32 frame_num, const nstime_t *abs_ts)
+{
+	if (abs_ts != NULL)
+		aging_now = *abs_ts;
+
+	if (aging_idle_timeout != 0 && abs_ts != NULL) {
+		while (lru_head != NULL &&
+		    aging_now.secs - lru_head->last_time.secs > (time_t)aging_idle_timeout) {
+			conversation_evict(lru_head);
+			aging_stats.evicted_idle++;
+		}
+
+		conversation_aging_prune_fragments(frame_num);
+	}
+
+	if (aging_max_conversations != 0) {
+		while (aging_stats.active > aging_max_conversations) {
+			conversation_evict(lru_head);
+			aging_stats.evicted_limit++;
+		}
+	}
+}
+
 wmem_map_t *
 get_conversation_hashtable_exact(void)
 {
@@ -100,6 +100,11 @@ typedef struct conversation {
 								/** tree containing protocol dissector client associated with conversation */
 	guint	options;			/** wildcard flags */
 	conversation_key_t key_ptr;	/** pointer to the key for this conversation */
+	gboolean shared_dissector_tree;	/** dissector_tree is shared with a template conversation */
+	nstime_t last_time;		/** time of the most recent packet that found this conversation (streaming mode only) */
+	struct conversation *lru_prev;	/** previous (less recently used) conversation (streaming mode only) */
+	struct conversation *lru_next;	/** next (more recently used) conversation (streaming mode only) */
+	gboolean retained;		/** never evicted, see conversation_retain() (streaming mode only) */
 } conversation_t;
 
 
@@ -255,6 +260,77 @@ wmem_map_t * get_conversation_hashtable_no_port2(void);
 WS_DLL_PUBLIC
 wmem_map_t *get_conversation_hashtable_no_addr2_or_port2(void);
 
+/*
+ * Streaming mode.
+ *
+ * When reading a capture in a single pass for an unbounded amount of time
+ * (e.g. "tshark -i" running for days), conversations and the state that
+ * dissectors attach to them would otherwise live until the capture file is
+ * closed. With aging enabled, the conversation table keeps conversations in
+ * least-recently-used order and evicts those that have not been seen for
+ * "idle_timeout" seconds of capture time, as well as the least recently used
+ * ones once there are more than "max_conversations" of them. Reassemblies
+ * that have not received a fragment within the idle timeout are dropped as
+ * well.
+ *
+ * This must only be enabled when every packet is dissected exactly once
+ * and in order; evicted conversations are freed. Only conversations that
+ * nothing can refer to afterwards are evicted: a conversation is retained
+ * for the life of the capture file once a protocol that registered no
+ * conversation_evict_func attaches data to it, or once a dissector that
+ * keeps pointers to it elsewhere calls conversation_retain().
+ */
+
+/** Called when a conversation is evicted, with the data that the protocol
+ *  attached to it using conversation_add_proto_data(). The function must
+ *  release that data, and anything else that refers to the conversation
+ *  or to that data.
+ */
+typedef void (*conversation_evict_func)(conversation_t *conv, void *proto_data);
+
+typedef struct _conversation_aging_stats_t {
+	guint64 evicted_idle;		/** conversations evicted for being idle */
+	guint64 evicted_limit;		/** conversations evicted to stay below the maximum */
+	guint64 pruned_fragments;	/** stale reassembly entries dropped */
+	guint64 retained;		/** conversations that can't be evicted */
+	guint   active;			/** conversations currently tracked */
+	guint   peak;			/** highest number of conversations tracked */
+} conversation_aging_stats_t;
+
+/** Enable streaming mode.
+ *
+ * @param idle_timeout Seconds of capture time after which an unused
+ *        conversation is evicted; 0 disables idle eviction.
+ * @param max_conversations Maximum number of conversations to keep;
+ *        0 means no limit.
+ */
+WS_DLL_PUBLIC void conversation_set_aging(guint idle_timeout, guint max_conversations);
+
+/** Returns TRUE if streaming mode is enabled. */
+WS_DLL_PUBLIC gboolean conversation_aging_enabled(void);
+
+/** Register the function that releases the data "proto" attaches to a
+ *  conversation when that conversation is evicted.
+ */
+WS_DLL_PUBLIC void conversation_register_evict_func(const int proto, conversation_evict_func func);
+
+/** Never evict "conv" in streaming mode. Dissectors that keep a pointer
+ *  to a conversation anywhere but in the data they attach to it, such as
+ *  in the key of a table of their own, must call this.
+ */
+WS_DLL_PUBLIC void conversation_retain(conversation_t *conv);
+
+/** Retrieve the eviction counters. */
+WS_DLL_PUBLIC void conversation_get_aging_stats(conversation_aging_stats_t *stats);
+
+/** Called for every dissected frame in streaming mode, before the frame
+ *  is dissected; evicts whatever has expired.
+ *
+ * @param frame_num The number of the frame about to be dissected.
+ * @param abs_ts Its time stamp, or NULL if it has none.
+ */
+extern void conversation_aging_new_frame(const guint32 frame_num, const nstime_t *abs_ts);
+
 /* Temporary function to handle port_type to endpoint_type conversion
    For now it's a 1-1 mapping, but the intention is to remove
    many of the port_type instances in favor of endpoint_type
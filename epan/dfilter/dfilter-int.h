@@ -21,12 +21,19 @@ struct epan_dfilter {
 	GPtrArray	*consts;
 	guint		num_registers;
 	guint		max_registers;
-	GList		**registers;
+	GPtrArray	**registers;	/* fvalue_t* per register, reset (not freed) per packet */
 	gboolean	*attempted_load;
 	gboolean	*owns_memory;
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+
+	/* Only used by the merged program of a dfilter_set_t */
+	int		*cse_slots;	/* per instruction, cached result slot or -1 */
+	guint8		*cse_results;	/* per slot, DFVM_CSE_xxx; reset per packet */
+	guint		num_cse_slots;
+	guint32		*set_matched;	/* bitmap of members that matched */
+	gboolean	set_stop_on_match;
 };
 
 typedef struct {
@@ -0,0 +1,474 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * A dfilter_set_t evaluates several compiled filters against the same
+ * packet, e.g. all color filters or all tap listener filters.
+ *
+ * The bytecode of the members is concatenated into one program:
+ *
+ *  - every READ_TREE of the same field, in any member, loads into one
+ *    shared register, so a field is read from the tree once per packet;
+ *  - tests that appear in more than one member (the same field tested
+ *    against the same constant, or the same existence check) are given a
+ *    result slot, so they are evaluated once per packet;
+ *  - the RETURN of each member is replaced by SET_RESULT, which records
+ *    the member's result in a bitmap and falls through to the next
+ *    member (or returns, when only the first match is wanted).
+ *
+ * The merged program borrows the constants, ranges and sets of the
+ * members' instructions, so the members must outlive the set.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfilter-int.h"
+#include "dfvm.h"
+
+#include <epan/epan_dissect.h>
+#include <ftypes/ftypes-int.h>
+
+struct epan_dfilter_set {
+	GPtrArray	*members;	/* dfilter_t*, not owned */
+	dfilter_t	*merged;	/* NULL until needed after a change */
+	guint32		*matched;
+	guint		matched_words;
+};
+
+dfilter_set_t *
+dfilter_set_new(void)
+{
+	dfilter_set_t *set;
+
+	set = g_new0(dfilter_set_t, 1);
+	set->members = g_ptr_array_new();
+	return set;
+}
+
+/* Frees a merged program. Only the instructions and values that were
+ * created while merging are freed; what they point to belongs to the
+ * member filters. */
+static void
+merged_free(dfilter_t *df)
+{
+	dfvm_insn_t	*insn;
+	guint		i;
+
+	if (!df)
+		return;
+
+	for (i = 0; i < df->insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+		g_free(insn->arg1);
+		g_free(insn->arg2);
+		g_free(insn->arg3);
+		g_free(insn->arg4);
+		g_free(insn);
+	}
+	g_ptr_array_free(df->insns, TRUE);
+
+	for (i = 0; i < df->consts->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, i);
+		g_free(insn->arg1);
+		g_free(insn->arg2);
+		g_free(insn);
+	}
+	g_ptr_array_free(df->consts, TRUE);
+
+	for (i = 0; i < df->max_registers; i++) {
+		g_ptr_array_free(df->registers[i], TRUE);
+	}
+	g_free(df->registers);
+	g_free(df->attempted_load);
+	g_free(df->owns_memory);
+	g_free(df->cse_slots);
+	g_free(df->cse_results);
+	g_free(df);
+}
+
+void
+dfilter_set_free(dfilter_set_t *set)
+{
+	if (!set)
+		return;
+
+	merged_free(set->merged);
+	g_ptr_array_free(set->members, TRUE);
+	g_free(set->matched);
+	g_free(set);
+}
+
+guint
+dfilter_set_add(dfilter_set_t *set, dfilter_t *df)
+{
+	g_assert(df);
+
+	merged_free(set->merged);
+	set->merged = NULL;
+	g_ptr_array_add(set->members, df);
+	return set->members->len - 1;
+}
+
+guint
+dfilter_set_count(const dfilter_set_t *set)
+{
+	return set->members->len;
+}
+
+static dfvm_value_t *
+value_copy(const dfvm_value_t *v)
+{
+	return v ? (dfvm_value_t *)g_memdup(v, sizeof(dfvm_value_t)) : NULL;
+}
+
+static void
+remap_register(dfvm_value_t *v, const int *map)
+{
+	if (v && v->type == REGISTER) {
+		v->value.numeric = map[v->value.numeric];
+	}
+}
+
+/* Describes an operand of a test for common-subexpression matching:
+ * shared field registers by number, constants by type and value.
+ * Returns NULL if the operand is a temporary (a range or function
+ * result), whose value is private to one member. */
+static gchar *
+operand_key(const dfvm_value_t *v, guint num_shared, GHashTable *const_values)
+{
+	fvalue_t	*fv;
+	char		*repr;
+	gchar		*key;
+
+	if (v->value.numeric < num_shared)
+		return g_strdup_printf("r%u", v->value.numeric);
+
+	fv = (fvalue_t *)g_hash_table_lookup(const_values, GUINT_TO_POINTER(v->value.numeric));
+	if (!fv)
+		return NULL;
+
+	repr = fvalue_to_string_repr(NULL, fv, FTREPR_DFILTER, BASE_NONE);
+	if (!repr)
+		return NULL;
+	key = g_strdup_printf("c%s:%s", fvalue_type_name(fv), repr);
+	wmem_free(NULL, repr);
+	return key;
+}
+
+/* Returns a key identifying what a (remapped) instruction computes, or
+ * NULL if its result cannot be shared with other members. */
+static gchar *
+insn_key(const dfvm_insn_t *insn, guint num_shared, GHashTable *const_values)
+{
+	gchar	*key1, *key2, *key = NULL;
+	char	*repr;
+
+	switch (insn->op) {
+		case CHECK_EXISTS:
+			return g_strdup_printf("%d:%d", insn->op, insn->arg1->value.hfinfo->id);
+
+		case ANY_UINT_CMP_IMM:
+			return g_strdup_printf("%d:%u:%u:%" G_GUINT64_FORMAT, insn->op,
+			    insn->arg1->value.numeric, insn->arg3->value.numeric,
+			    insn->arg2->value.uinteger64);
+
+		case ANY_SINT_CMP_IMM:
+			return g_strdup_printf("%d:%u:%u:%" G_GINT64_FORMAT, insn->op,
+			    insn->arg1->value.numeric, insn->arg3->value.numeric,
+			    insn->arg2->value.sinteger64);
+
+		case ANY_IPV4_EQ_IMM:
+		case ANY_IPV4_NE_IMM:
+			return g_strdup_printf("%d:%u:%08x/%08x", insn->op,
+			    insn->arg1->value.numeric,
+			    insn->arg2->value.ipv4.addr, insn->arg2->value.ipv4.nmask);
+
+		case ANY_BYTES_EQ_IMM:
+		case ANY_BYTES_NE_IMM:
+			repr = fvalue_to_string_repr(NULL, insn->arg2->value.fvalue,
+			    FTREPR_DFILTER, BASE_NONE);
+			if (repr) {
+				key = g_strdup_printf("%d:%u:%s", insn->op,
+				    insn->arg1->value.numeric, repr);
+				wmem_free(NULL, repr);
+			}
+			return key;
+
+		case ANY_EQ:
+		case ANY_NE:
+		case ANY_GT:
+		case ANY_GE:
+		case ANY_LT:
+		case ANY_LE:
+		case ANY_BITWISE_AND:
+		case ANY_CONTAINS:
+		case ANY_MATCHES:
+			key1 = operand_key(insn->arg1, num_shared, const_values);
+			key2 = operand_key(insn->arg2, num_shared, const_values);
+			if (key1 && key2)
+				key = g_strdup_printf("%d:%s:%s", insn->op, key1, key2);
+			g_free(key1);
+			g_free(key2);
+			return key;
+
+		default:
+			return NULL;
+	}
+}
+
+static dfilter_t *
+merge_members(dfilter_set_t *set)
+{
+	dfilter_t	*merged, *member;
+	dfvm_insn_t	*insn, *copy;
+	GHashTable	*field_regs;
+	GHashTable	*const_values;
+	GHashTable	*key_counts;
+	GHashTable	*key_slots;
+	GPtrArray	*keys;
+	int		**maps;
+	guint		num_shared = 0;
+	guint		num_temps = 0;
+	guint		next_temp, next_const, base;
+	guint		m, i;
+	gpointer	reg;
+	gchar		*key;
+
+	merged = g_new0(dfilter_t, 1);
+	merged->insns = g_ptr_array_new();
+	merged->consts = g_ptr_array_new();
+
+	/* Pass 1: give each field one shared register, and count the
+	 * temporary and constant registers of all members. */
+	field_regs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	maps = g_new(int *, set->members->len);
+	for (m = 0; m < set->members->len; m++) {
+		member = (dfilter_t *)g_ptr_array_index(set->members, m);
+		maps[m] = g_new(int, member->max_registers);
+		for (i = 0; i < member->max_registers; i++) {
+			maps[m][i] = -1;
+		}
+		for (i = 0; i < member->insns->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(member->insns, i);
+			if (insn->op != READ_TREE)
+				continue;
+			if (!g_hash_table_lookup_extended(field_regs, insn->arg1->value.hfinfo, NULL, &reg)) {
+				reg = GUINT_TO_POINTER(num_shared++);
+				g_hash_table_insert(field_regs, insn->arg1->value.hfinfo, reg);
+			}
+			maps[m][insn->arg2->value.numeric] = GPOINTER_TO_UINT(reg);
+		}
+		for (i = 0; i < member->num_registers; i++) {
+			if (maps[m][i] == -1)
+				num_temps++;
+		}
+	}
+	g_hash_table_destroy(field_regs);
+
+	/* Pass 2: assign the remaining registers; constants go last, as
+	 * dfvm_apply() expects. */
+	next_temp = num_shared;
+	next_const = num_shared + num_temps;
+	for (m = 0; m < set->members->len; m++) {
+		member = (dfilter_t *)g_ptr_array_index(set->members, m);
+		for (i = 0; i < member->num_registers; i++) {
+			if (maps[m][i] == -1)
+				maps[m][i] = next_temp++;
+		}
+		for (i = member->num_registers; i < member->max_registers; i++) {
+			maps[m][i] = next_const++;
+		}
+	}
+	merged->num_registers = num_shared + num_temps;
+	merged->max_registers = next_const;
+
+	/* Pass 3: copy the instructions, remapping registers and jump
+	 * targets, and replacing each RETURN by SET_RESULT. */
+	const_values = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (m = 0; m < set->members->len; m++) {
+		member = (dfilter_t *)g_ptr_array_index(set->members, m);
+
+		for (i = 0; i < member->consts->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(member->consts, i);
+			copy = dfvm_insn_new(insn->op);
+			copy->id = merged->consts->len;
+			copy->arg1 = value_copy(insn->arg1);
+			copy->arg2 = value_copy(insn->arg2);
+			remap_register(copy->arg2, maps[m]);
+			g_ptr_array_add(merged->consts, copy);
+			g_hash_table_insert(const_values,
+			    GUINT_TO_POINTER(copy->arg2->value.numeric),
+			    copy->arg1->value.fvalue);
+		}
+
+		base = merged->insns->len;
+		for (i = 0; i < member->insns->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(member->insns, i);
+			if (insn->op == RETURN) {
+				copy = dfvm_insn_new(SET_RESULT);
+				copy->arg1 = dfvm_value_new(INTEGER);
+				copy->arg1->value.numeric = m;
+			}
+			else {
+				copy = dfvm_insn_new(insn->op);
+				copy->arg1 = value_copy(insn->arg1);
+				copy->arg2 = value_copy(insn->arg2);
+				copy->arg3 = value_copy(insn->arg3);
+				copy->arg4 = value_copy(insn->arg4);
+				remap_register(copy->arg1, maps[m]);
+				remap_register(copy->arg2, maps[m]);
+				remap_register(copy->arg3, maps[m]);
+				remap_register(copy->arg4, maps[m]);
+				if (copy->op == IF_TRUE_GOTO || copy->op == IF_FALSE_GOTO) {
+					copy->arg1->value.numeric += base;
+				}
+			}
+			copy->id = merged->insns->len;
+			g_ptr_array_add(merged->insns, copy);
+		}
+	}
+	g_ptr_array_add(merged->insns, dfvm_insn_new(RETURN));
+
+	/* Pass 4: give a result slot to every test that more than one
+	 * instruction computes. */
+	keys = g_ptr_array_new_with_free_func(g_free);
+	key_counts = g_hash_table_new(g_str_hash, g_str_equal);
+	for (i = 0; i < merged->insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(merged->insns, i);
+		key = insn_key(insn, num_shared, const_values);
+		g_ptr_array_add(keys, key);
+		if (key) {
+			g_hash_table_insert(key_counts, key, GUINT_TO_POINTER(
+			    GPOINTER_TO_UINT(g_hash_table_lookup(key_counts, key)) + 1));
+		}
+	}
+
+	key_slots = g_hash_table_new(g_str_hash, g_str_equal);
+	merged->cse_slots = g_new(int, merged->insns->len);
+	for (i = 0; i < merged->insns->len; i++) {
+		key = (gchar *)g_ptr_array_index(keys, i);
+		merged->cse_slots[i] = -1;
+		if (!key || GPOINTER_TO_UINT(g_hash_table_lookup(key_counts, key)) < 2)
+			continue;
+		if (!g_hash_table_lookup_extended(key_slots, key, NULL, &reg)) {
+			reg = GUINT_TO_POINTER(merged->num_cse_slots++);
+			g_hash_table_insert(key_slots, key, reg);
+		}
+		merged->cse_slots[i] = GPOINTER_TO_INT(reg);
+	}
+	if (merged->num_cse_slots > 0) {
+		merged->cse_results = g_new0(guint8, merged->num_cse_slots);
+	}
+	else {
+		g_free(merged->cse_slots);
+		merged->cse_slots = NULL;
+	}
+
+	g_hash_table_destroy(key_slots);
+	g_hash_table_destroy(key_counts);
+	g_ptr_array_free(keys, TRUE);
+	g_hash_table_destroy(const_values);
+	for (m = 0; m < set->members->len; m++) {
+		g_free(maps[m]);
+	}
+	g_free(maps);
+
+	/* Initialize run-time space */
+	merged->registers = g_new(GPtrArray*, merged->max_registers);
+	for (i = 0; i < merged->max_registers; i++) {
+		merged->registers[i] = g_ptr_array_new();
+	}
+	merged->attempted_load = g_new0(gboolean, merged->max_registers);
+	merged->owns_memory = g_new0(gboolean, merged->max_registers);
+	dfvm_init_const(merged);
+
+	return merged;
+}
+
+static void
+set_prepare(dfilter_set_t *set, gboolean stop_on_match)
+{
+	guint words;
+
+	if (!set->merged) {
+		set->merged = merge_members(set);
+	}
+
+	words = (set->members->len + 31) / 32;
+	if (words > set->matched_words) {
+		set->matched = g_renew(guint32, set->matched, words);
+		set->matched_words = words;
+	}
+	memset(set->matched, 0, words * sizeof(guint32));
+
+	set->merged->set_matched = set->matched;
+	set->merged->set_stop_on_match = stop_on_match;
+}
+
+gboolean
+dfilter_set_apply_edt(dfilter_set_t *set, epan_dissect_t *edt, const guint32 **matched)
+{
+	guint	i;
+	gboolean any = FALSE;
+
+	*matched = NULL;
+	if (set->members->len == 0)
+		return FALSE;
+
+	set_prepare(set, FALSE);
+	dfvm_apply(set->merged, edt->tree);
+
+	for (i = 0; i < set->matched_words; i++) {
+		any |= (set->matched[i] != 0);
+	}
+	*matched = set->matched;
+	return any;
+}
+
+gint
+dfilter_set_apply_edt_first(dfilter_set_t *set, epan_dissect_t *edt)
+{
+	guint	i;
+
+	if (set->members->len == 0)
+		return -1;
+
+	set_prepare(set, TRUE);
+	if (!dfvm_apply(set->merged, edt->tree))
+		return -1;
+
+	for (i = 0; i < set->members->len; i++) {
+		if (DFILTER_SET_MATCHED(set->matched, i))
+			return i;
+	}
+	return -1;
+}
+
+void
+dfilter_set_dump(dfilter_set_t *set)
+{
+	if (!set->merged) {
+		set->merged = merge_members(set);
+	}
+	dfvm_dump(stdout, set->merged);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -133,10 +133,11 @@ dfilter_free(dfilter_t *df)
 
 	g_free(df->interesting_fields);
 
-	/* Clear registers with constant values (as set by dfvm_init_const).
-	 * Other registers were cleared on RETURN by free_register_overhead. */
-	for (i = df->num_registers; i < df->max_registers; i++) {
-		g_list_free(df->registers[i]);
+	/* The register arrays themselves live as long as the filter; their
+	 * contents were cleared on RETURN by free_register_overhead, and
+	 * constants (as set by dfvm_init_const) are owned by df->consts. */
+	for (i = 0; i < df->max_registers; i++) {
+		g_ptr_array_free(df->registers[i], TRUE);
 	}
 
 	if (df->deprecated) {
@@ -345,11 +346,18 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 		dfw->consts = NULL;
 		dfilter->interesting_fields = dfw_interesting_fields(dfw,
 			&dfilter->num_interesting_fields);
+		/* Give the fields their slots in the trees' tables now */
+		for (i = 0; i < (guint)dfilter->num_interesting_fields; i++) {
+			proto_reserve_interesting_hfid(dfilter->interesting_fields[i]);
+		}
 
 		/* Initialize run-time space */
 		dfilter->num_registers = dfw->first_constant;
 		dfilter->max_registers = dfw->next_register;
-		dfilter->registers = g_new0(GList*, dfilter->max_registers);
+		dfilter->registers = g_new(GPtrArray*, dfilter->max_registers);
+		for (i = 0; i < dfilter->max_registers; i++) {
+			dfilter->registers[i] = g_ptr_array_new();
+		}
 		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
 		dfilter->owns_memory = g_new0(gboolean, dfilter->max_registers);
 
@@ -427,6 +435,18 @@ dfilter_has_interesting_fields(const dfilter_t *df)
 	return (df->num_interesting_fields > 0);
 }
 
+gboolean
+dfilter_interested_in_field(const dfilter_t *df, int hfid)
+{
+	int i;
+
+	for (i = 0; i < df->num_interesting_fields; i++) {
+		if (df->interesting_fields[i] == hfid)
+			return TRUE;
+	}
+	return FALSE;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
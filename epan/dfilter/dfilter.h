@@ -72,6 +72,11 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 gboolean
 dfilter_has_interesting_fields(const dfilter_t *df);
 
+/* Check if dfilter refers to the field with the given hfid */
+WS_DLL_PUBLIC
+gboolean
+dfilter_interested_in_field(const dfilter_t *df, int hfid);
+
 WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
@@ -81,6 +86,52 @@ WS_DLL_PUBLIC
 void
 dfilter_dump(dfilter_t *df);
 
+/* A set of compiled dfilters that are applied to the same packets.
+ * The filters are merged into one program, so fields used by several
+ * filters are read from the tree once and identical tests are evaluated
+ * once per packet. The set does not own the filters; they must stay
+ * valid until the set is freed. */
+typedef struct epan_dfilter_set dfilter_set_t;
+
+/* Is filter "idx" set in the bitmap returned by dfilter_set_apply_edt()? */
+#define DFILTER_SET_MATCHED(bitmap, idx) \
+	(((bitmap)[(idx) / 32] & (1U << ((idx) % 32))) != 0)
+
+WS_DLL_PUBLIC
+dfilter_set_t *
+dfilter_set_new(void);
+
+WS_DLL_PUBLIC
+void
+dfilter_set_free(dfilter_set_t *set);
+
+/* Adds a (non-NULL) filter to the set and returns its index. */
+WS_DLL_PUBLIC
+guint
+dfilter_set_add(dfilter_set_t *set, dfilter_t *df);
+
+WS_DLL_PUBLIC
+guint
+dfilter_set_count(const dfilter_set_t *set);
+
+/* Applies every filter in the set. *matched is set to a bitmap, owned by
+ * the set and valid until the next call, of the filters that matched.
+ * Returns TRUE if any filter matched. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_set_apply_edt(dfilter_set_t *set, struct epan_dissect *edt, const guint32 **matched);
+
+/* Applies the filters in order and returns the index of the first one
+ * that matches, or -1 if none does. */
+WS_DLL_PUBLIC
+gint
+dfilter_set_apply_edt_first(dfilter_set_t *set, struct epan_dissect *edt);
+
+/* Print bytecode of the merged program to stdout */
+WS_DLL_PUBLIC
+void
+dfilter_set_dump(dfilter_set_t *set);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -13,8 +13,10 @@
 #include <ftypes/ftypes.h>
 #include "syntax-tree.h"
 
-/* The run-time logic of the dfilter function */
-typedef gboolean (*DFFuncType)(GList *arg1list, GList *arg2list, GList **retval);
+/* The run-time logic of the dfilter function. The arguments are the
+ * fvalue_t registers of the VM; the function appends the fvalue_t's it
+ * creates to "retval", which the VM then owns. */
+typedef gboolean (*DFFuncType)(GPtrArray *arg1list, GPtrArray *arg2list, GPtrArray *retval);
 
 /* The semantic check for the dfilter function */
 typedef void (*DFSemCheckType)(dfwork_t *dfw, int param_num, stnode_t *st_node);
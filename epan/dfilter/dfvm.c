@@ -10,7 +10,12 @@
 
 #include "dfvm.h"
 
+#include <string.h>
+
 #include <ftypes/ftypes-int.h>
+#include <epan/exceptions.h>
+#include <wsutil/bits_count_ones.h>
+#include <wsutil/pint.h>
 
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op)
@@ -36,6 +41,22 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case UINT_SET:
+		case SINT_SET:
+			g_array_free(v->value.int_set, TRUE);
+			break;
+		case IPV4_SET:
+			ws_lpm_trie_free(v->value.ipv4_set);
+			break;
+		case BYTES_SET:
+			g_ptr_array_free(v->value.bytes_set, TRUE);
+			break;
+		case SEARCH_SET:
+			ws_aho_corasick_free(v->value.search_set->strings);
+			if (v->value.search_set->regex)
+				g_regex_unref(v->value.search_set->regex);
+			g_free(v->value.search_set);
+			break;
 		default:
 			/* nothing */
 			;
@@ -73,6 +94,22 @@ dfvm_value_new(dfvm_value_type_t type)
 }
 
 
+static const char *
+relation_symbol(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:	return "==";
+		case ANY_NE:	return "!=";
+		case ANY_GT:	return ">";
+		case ANY_GE:	return ">=";
+		case ANY_LT:	return "<";
+		case ANY_LE:	return "<=";
+		default:
+			g_assert_not_reached();
+			return "?";
+	}
+}
+
 void
 dfvm_dump(FILE *f, dfilter_t *df)
 {
@@ -119,6 +156,18 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_UINT_CMP_IMM:
+			case ANY_SINT_CMP_IMM:
+			case ANY_IPV4_EQ_IMM:
+			case ANY_IPV4_NE_IMM:
+			case ANY_BYTES_EQ_IMM:
+			case ANY_BYTES_NE_IMM:
+			case ANY_IN_UINT_SET:
+			case ANY_IN_SINT_SET:
+			case ANY_IN_IPV4_SET:
+			case ANY_IN_BYTES_SET:
+			case ANY_SEARCH_SET:
+			case SET_RESULT:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -259,6 +308,67 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					arg3->value.numeric);
 				break;
 
+			case ANY_UINT_CMP_IMM:
+				fprintf(f, "%05d ANY_UINT_CMP_IMM\treg#%u %s %" G_GUINT64_FORMAT "\n",
+					id, arg1->value.numeric,
+					relation_symbol((dfvm_opcode_t)arg3->value.numeric),
+					arg2->value.uinteger64);
+				break;
+
+			case ANY_SINT_CMP_IMM:
+				fprintf(f, "%05d ANY_SINT_CMP_IMM\treg#%u %s %" G_GINT64_FORMAT "\n",
+					id, arg1->value.numeric,
+					relation_symbol((dfvm_opcode_t)arg3->value.numeric),
+					arg2->value.sinteger64);
+				break;
+
+			case ANY_IPV4_EQ_IMM:
+			case ANY_IPV4_NE_IMM:
+				fprintf(f, "%05d %s\treg#%u %s 0x%08x/0x%08x\n",
+					id, insn->op == ANY_IPV4_EQ_IMM ? "ANY_IPV4_EQ_IMM" : "ANY_IPV4_NE_IMM",
+					arg1->value.numeric,
+					insn->op == ANY_IPV4_EQ_IMM ? "==" : "!=",
+					arg2->value.ipv4.addr, arg2->value.ipv4.nmask);
+				break;
+
+			case ANY_BYTES_EQ_IMM:
+			case ANY_BYTES_NE_IMM:
+				value_str = fvalue_to_string_repr(NULL, arg2->value.fvalue,
+					FTREPR_DFILTER, BASE_NONE);
+				fprintf(f, "%05d %s\treg#%u %s %s\n",
+					id, insn->op == ANY_BYTES_EQ_IMM ? "ANY_BYTES_EQ_IMM" : "ANY_BYTES_NE_IMM",
+					arg1->value.numeric,
+					insn->op == ANY_BYTES_EQ_IMM ? "==" : "!=",
+					value_str);
+				wmem_free(NULL, value_str);
+				break;
+
+			case ANY_IN_UINT_SET:
+			case ANY_IN_SINT_SET:
+				fprintf(f, "%05d %s\treg#%u in {%u ranges}\n",
+					id, insn->op == ANY_IN_UINT_SET ? "ANY_IN_UINT_SET" : "ANY_IN_SINT_SET",
+					arg1->value.numeric, arg2->value.int_set->len);
+				break;
+
+			case ANY_IN_IPV4_SET:
+				fprintf(f, "%05d ANY_IN_IPV4_SET\treg#%u in {%u prefixes}\n",
+					id, arg1->value.numeric,
+					ws_lpm_trie_count(arg2->value.ipv4_set));
+				break;
+
+			case ANY_IN_BYTES_SET:
+				fprintf(f, "%05d ANY_IN_BYTES_SET\treg#%u in {%u values}\n",
+					id, arg1->value.numeric, arg2->value.bytes_set->len);
+				break;
+
+			case ANY_SEARCH_SET:
+				fprintf(f, "%05d ANY_SEARCH_SET\treg#%u contains {%u strings} or matches {%u patterns}\n",
+					id, arg1->value.numeric,
+					arg2->value.search_set->strings ?
+					    ws_aho_corasick_count(arg2->value.search_set->strings) : 0,
+					arg2->value.search_set->num_regexes);
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -267,6 +377,11 @@ dfvm_dump(FILE *f, dfilter_t *df)
 				fprintf(f, "%05d RETURN\n", id);
 				break;
 
+			case SET_RESULT:
+				fprintf(f, "%05d SET_RESULT\t#%u\n",
+						id, arg1->value.numeric);
+				break;
+
 			case IF_TRUE_GOTO:
 				fprintf(f, "%05d IF-TRUE-GOTO\t%u\n",
 						id, arg1->value.numeric);
@@ -285,55 +400,42 @@ dfvm_dump(FILE *f, dfilter_t *df)
 }
 
 /* Reads a field from the proto_tree and loads the fvalues into a register,
- * if that field has not already been read. */
+ * if that field has not already been read. The register's array was
+ * allocated when the filter was compiled and only grows to the largest
+ * number of occurrences seen, so loading a field does not allocate. */
 static gboolean
 read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 {
 	GPtrArray	*finfos;
+	GPtrArray	*fvalues;
 	field_info	*finfo;
 	int		i, len;
-	GList		*fvalues = NULL;
-	gboolean	found_something = FALSE;
+
+	fvalues = df->registers[reg];
 
 	/* Already loaded in this run of the dfilter? */
 	if (df->attempted_load[reg]) {
-		if (df->registers[reg]) {
-			return TRUE;
-		}
-		else {
-			return FALSE;
-		}
+		return fvalues->len > 0;
 	}
 
 	df->attempted_load[reg] = TRUE;
 
 	while (hfinfo) {
 		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
-		if ((finfos == NULL) || (g_ptr_array_len(finfos) == 0)) {
-			hfinfo = hfinfo->same_name_next;
-			continue;
-		}
-		else {
-			found_something = TRUE;
-		}
-
-		len = finfos->len;
-		for (i = 0; i < len; i++) {
-			finfo = (field_info *)g_ptr_array_index(finfos, i);
-			fvalues = g_list_prepend(fvalues, &finfo->value);
+		if (finfos != NULL) {
+			len = finfos->len;
+			for (i = 0; i < len; i++) {
+				finfo = (field_info *)g_ptr_array_index(finfos, i);
+				g_ptr_array_add(fvalues, &finfo->value);
+			}
 		}
 
 		hfinfo = hfinfo->same_name_next;
 	}
 
-	if (!found_something) {
-		return FALSE;
-	}
-
-	df->registers[reg] = fvalues;
 	// These values are referenced only, do not try to free it later.
 	df->owns_memory[reg] = FALSE;
-	return TRUE;
+	return fvalues->len > 0;
 }
 
 
@@ -342,7 +444,7 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 static gboolean
 put_fvalue(dfilter_t *df, fvalue_t *fv, int reg)
 {
-	df->registers[reg] = g_list_append(NULL, fv);
+	g_ptr_array_add(df->registers[reg], fv);
 	df->owns_memory[reg] = FALSE;
 	return TRUE;
 }
@@ -352,19 +454,19 @@ typedef gboolean (*FvalueCmpFunc)(const fvalue_t*, const fvalue_t*);
 static gboolean
 any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 {
-	GList	*list_a, *list_b;
+	GPtrArray	*regs_a, *regs_b;
+	guint		i, j;
 
-	list_a = df->registers[reg1];
+	regs_a = df->registers[reg1];
+	regs_b = df->registers[reg2];
 
-	while (list_a) {
-		list_b = df->registers[reg2];
-		while (list_b) {
-			if (cmp((fvalue_t *)list_a->data, (fvalue_t *)list_b->data)) {
+	for (i = 0; i < regs_a->len; i++) {
+		for (j = 0; j < regs_b->len; j++) {
+			if (cmp((fvalue_t *)g_ptr_array_index(regs_a, i),
+			    (fvalue_t *)g_ptr_array_index(regs_b, j))) {
 				return TRUE;
 			}
-			list_b = g_list_next(list_b);
 		}
-		list_a = g_list_next(list_a);
 	}
 	return FALSE;
 }
@@ -372,87 +474,370 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 static gboolean
 any_in_range(dfilter_t *df, int reg1, int reg2, int reg3)
 {
-	GList	*list1, *list_low, *list_high;
-	fvalue_t *low, *high;
+	GPtrArray	*regs, *regs_low, *regs_high;
+	fvalue_t	*low, *high;
+	guint		i;
 
-	list1 = df->registers[reg1];
-	list_low = df->registers[reg2];
-	list_high = df->registers[reg3];
+	regs = df->registers[reg1];
+	regs_low = df->registers[reg2];
+	regs_high = df->registers[reg3];
 
 	/* The first register contains the values associated with a field, the
 	 * second and third arguments are expected to be a single value for the
 	 * lower and upper bound respectively. These cannot be fields and thus
-	 * the list length MUST be one. This should have been enforced by
+	 * the array length MUST be one. This should have been enforced by
 	 * grammar.lemon.
 	 */
-	g_assert(list_low && !g_list_next(list_low));
-	g_assert(list_high && !g_list_next(list_high));
-	low = (fvalue_t *)list_low->data;
-	high = (fvalue_t *)list_high->data;
+	g_assert(regs_low->len == 1);
+	g_assert(regs_high->len == 1);
+	low = (fvalue_t *)g_ptr_array_index(regs_low, 0);
+	high = (fvalue_t *)g_ptr_array_index(regs_high, 0);
 
-	while (list1) {
-		fvalue_t *value = (fvalue_t *)list1->data;
+	for (i = 0; i < regs->len; i++) {
+		fvalue_t *value = (fvalue_t *)g_ptr_array_index(regs, i);
 		if (fvalue_ge(value, low) && fvalue_le(value, high)) {
 			return TRUE;
 		}
-		list1 = g_list_next(list1);
 	}
 	return FALSE;
 }
 
 
-static void
-free_owned_register(gpointer data, gpointer user_data _U_)
+/*
+ * Type-specialized tests. gencode.c only emits these when every field
+ * loaded into the register has the ftype of the constant, so the fvalue
+ * unions can be read directly instead of going through the ftype_t
+ * comparison functions.
+ */
+static inline guint64
+uint_value(const fvalue_t *fv)
+{
+	return IS_FT_UINT64(fv->ftype->ftype) ? fv->value.uinteger64 : fv->value.uinteger;
+}
+
+static inline gint64
+sint_value(const fvalue_t *fv)
+{
+	return IS_FT_INT64(fv->ftype->ftype) ? fv->value.sinteger64 : fv->value.sinteger;
+}
+
+#define RELATION_TEST(op, a, b) \
+	((op) == ANY_EQ ? (a) == (b) : \
+	 (op) == ANY_NE ? (a) != (b) : \
+	 (op) == ANY_GT ? (a) > (b) : \
+	 (op) == ANY_GE ? (a) >= (b) : \
+	 (op) == ANY_LT ? (a) < (b) : \
+	 (a) <= (b))
+
+static gboolean
+any_uint_cmp_imm(dfilter_t *df, int reg, guint64 imm, dfvm_opcode_t op)
+{
+	GPtrArray	*regs = df->registers[reg];
+	guint64		value;
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		value = uint_value((fvalue_t *)g_ptr_array_index(regs, i));
+		if (RELATION_TEST(op, value, imm)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+any_sint_cmp_imm(dfilter_t *df, int reg, gint64 imm, dfvm_opcode_t op)
+{
+	GPtrArray	*regs = df->registers[reg];
+	gint64		value;
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		value = sint_value((fvalue_t *)g_ptr_array_index(regs, i));
+		if (RELATION_TEST(op, value, imm)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* Same semantics as the FT_IPv4 cmp_eq(): compare under the shorter of
+ * the two netmasks. "imm->addr" was masked with "imm->nmask" at compile
+ * time. */
+static inline gboolean
+ipv4_eq_imm(const fvalue_t *fv, const ipv4_addr_and_mask *imm)
+{
+	guint32		nmask;
+
+	nmask = MIN(fv->value.ipv4.nmask, imm->nmask);
+	return (fv->value.ipv4.addr & nmask) == (imm->addr & nmask);
+}
+
+static gboolean
+any_ipv4_eq_imm(dfilter_t *df, int reg, const ipv4_addr_and_mask *imm, gboolean eq)
+{
+	GPtrArray	*regs = df->registers[reg];
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		if (ipv4_eq_imm((fvalue_t *)g_ptr_array_index(regs, i), imm) == eq) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+int
+dfvm_bytes_cmp(const GByteArray *a, const GByteArray *b)
 {
-	fvalue_t *value = (fvalue_t *)data;
-	FVALUE_FREE(value);
+	if (a->len != b->len) {
+		return a->len < b->len ? -1 : 1;
+	}
+	return memcmp(a->data, b->data, a->len);
+}
+
+static gboolean
+any_bytes_eq_imm(dfilter_t *df, int reg, const fvalue_t *imm, gboolean eq)
+{
+	GPtrArray	*regs = df->registers[reg];
+	const GByteArray *b = imm->value.bytes;
+	GByteArray	*a;
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		a = ((fvalue_t *)g_ptr_array_index(regs, i))->value.bytes;
+		if ((a->len == b->len && memcmp(a->data, b->data, a->len) == 0) == eq) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* Binary search of a sorted array of disjoint closed intervals. */
+#define INT_SET_CONTAINS(range_type, set, value, found) \
+	G_STMT_START { \
+		guint lo_idx = 0, hi_idx = (set)->len; \
+		(found) = FALSE; \
+		while (lo_idx < hi_idx) { \
+			guint mid = lo_idx + (hi_idx - lo_idx) / 2; \
+			const range_type *r = &g_array_index((set), range_type, mid); \
+			if ((value) < r->lo) { \
+				hi_idx = mid; \
+			} else if ((value) > r->hi) { \
+				lo_idx = mid + 1; \
+			} else { \
+				(found) = TRUE; \
+				break; \
+			} \
+		} \
+	} G_STMT_END
+
+static gboolean
+any_in_uint_set(dfilter_t *df, int reg, GArray *set)
+{
+	GPtrArray	*regs = df->registers[reg];
+	guint64		value;
+	gboolean	found;
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		value = uint_value((fvalue_t *)g_ptr_array_index(regs, i));
+		INT_SET_CONTAINS(dfvm_uint_range_t, set, value, found);
+		if (found) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+any_in_sint_set(dfilter_t *df, int reg, GArray *set)
+{
+	GPtrArray	*regs = df->registers[reg];
+	gint64		value;
+	gboolean	found;
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		value = sint_value((fvalue_t *)g_ptr_array_index(regs, i));
+		INT_SET_CONTAINS(dfvm_sint_range_t, set, value, found);
+		if (found) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* A constant matches if it is equal to "fv" under the shorter of the two
+ * netmasks, i.e. if one of the prefixes contains the other; a single walk
+ * down the trie of the constants' prefixes decides that. */
+static gboolean
+ipv4_set_contains(const ws_lpm_trie *set, const fvalue_t *fv)
+{
+	guint8	addr[4];
+
+	phton32(addr, fv->value.ipv4.addr);
+	return ws_lpm_trie_overlaps(set, addr, ws_count_ones(fv->value.ipv4.nmask));
+}
+
+static gboolean
+any_in_ipv4_set(dfilter_t *df, int reg, const ws_lpm_trie *set)
+{
+	GPtrArray	*regs = df->registers[reg];
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		if (ipv4_set_contains(set, (fvalue_t *)g_ptr_array_index(regs, i))) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+any_in_bytes_set(dfilter_t *df, int reg, GPtrArray *set)
+{
+	GPtrArray	*regs = df->registers[reg];
+	GByteArray	*value;
+	guint		i, lo_idx, hi_idx, mid;
+	int		cmp;
+
+	for (i = 0; i < regs->len; i++) {
+		value = ((fvalue_t *)g_ptr_array_index(regs, i))->value.bytes;
+		lo_idx = 0;
+		hi_idx = set->len;
+		while (lo_idx < hi_idx) {
+			mid = lo_idx + (hi_idx - lo_idx) / 2;
+			cmp = dfvm_bytes_cmp(value,
+			    ((fvalue_t *)g_ptr_array_index(set, mid))->value.bytes);
+			if (cmp == 0) {
+				return TRUE;
+			} else if (cmp < 0) {
+				hi_idx = mid;
+			} else {
+				lo_idx = mid + 1;
+			}
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+search_set_search(const dfvm_search_set_t *set, const guint8 *data, gsize len)
+{
+	if (set->strings && ws_aho_corasick_search(set->strings, data, len)) {
+		return TRUE;
+	}
+	return set->regex && g_regex_match_full(set->regex, (const char *)data,
+	    (gssize)len, 0, (GRegexMatchFlags)0, NULL, NULL);
+}
+
+/* Scans the bytes of a value once for all the strings and patterns, the
+ * way the cmp_contains and cmp_matches functions of its type would look
+ * at them one by one. */
+static gboolean
+search_set_contains(const dfvm_search_set_t *set, const fvalue_t *fv)
+{
+	volatile gboolean	found = FALSE;
+	tvbuff_t		*tvb;
+	const char		*str;
+	guint			len;
+
+	switch (fvalue_type_ftenum(fv)) {
+		case FT_PROTOCOL:
+			tvb = fv->value.protocol.tvb;
+			if (tvb == NULL) {
+				str = fv->value.protocol.proto_string;
+				return str && search_set_search(set, (const guint8 *)str, strlen(str));
+			}
+			TRY {
+				len = tvb_captured_length(tvb);
+				found = search_set_search(set, tvb_get_ptr(tvb, 0, len), len);
+			}
+			CATCH_ALL {
+				/* nothing */
+			}
+			ENDTRY;
+			return found;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			str = fv->value.string;
+			return search_set_search(set, (const guint8 *)str, strlen(str));
+
+		default:
+			return search_set_search(set, fv->value.bytes->data, fv->value.bytes->len);
+	}
+}
+
+static gboolean
+any_search_set(dfilter_t *df, int reg, const dfvm_search_set_t *set)
+{
+	GPtrArray	*regs = df->registers[reg];
+	guint		i;
+
+	for (i = 0; i < regs->len; i++) {
+		if (search_set_contains(set, (fvalue_t *)g_ptr_array_index(regs, i))) {
+			return TRUE;
+		}
+	}
+	return FALSE;
 }
 
 /* Clear registers that were populated during evaluation (leaving constants
- * intact). If we created the values, then these will be freed as well. */
+ * intact). If we created the values, then these will be freed as well.
+ * The register arrays keep their storage for the next packet. */
 static void
 free_register_overhead(dfilter_t* df)
 {
-	guint i;
+	GPtrArray	*reg;
+	guint		i, j;
 
 	for (i = 0; i < df->num_registers; i++) {
 		df->attempted_load[i] = FALSE;
-		if (df->registers[i]) {
-			if (df->owns_memory[i]) {
-				g_list_foreach(df->registers[i], free_owned_register, NULL);
-				df->owns_memory[i] = FALSE;
+		reg = df->registers[i];
+		if (reg->len == 0) {
+			continue;
+		}
+		if (df->owns_memory[i]) {
+			for (j = 0; j < reg->len; j++) {
+				FVALUE_FREE((fvalue_t *)g_ptr_array_index(reg, j));
 			}
-			g_list_free(df->registers[i]);
-			df->registers[i] = NULL;
+			df->owns_memory[i] = FALSE;
 		}
+		g_ptr_array_set_size(reg, 0);
+	}
+
+	if (df->cse_results) {
+		memset(df->cse_results, DFVM_CSE_UNKNOWN, df->num_cse_slots);
 	}
 }
 
-/* Takes the list of fvalue_t's in a register, uses fvalue_slice()
- * to make a new list of fvalue_t's (which are ranges, or byte-slices),
- * and puts the new list into a new register. */
+/* Takes the fvalue_t's in a register, uses fvalue_slice()
+ * to make new fvalue_t's (which are ranges, or byte-slices),
+ * and puts them into a new register. */
 static void
 mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 {
-	GList		*from_list, *to_list;
+	GPtrArray	*from_regs, *to_regs;
 	fvalue_t	*old_fv, *new_fv;
+	guint		i;
 
-	to_list = NULL;
-	from_list = df->registers[from_reg];
+	from_regs = df->registers[from_reg];
+	to_regs = df->registers[to_reg];
 
-	while (from_list) {
-		old_fv = (fvalue_t*)from_list->data;
+	for (i = 0; i < from_regs->len; i++) {
+		old_fv = (fvalue_t*)g_ptr_array_index(from_regs, i);
 		new_fv = fvalue_slice(old_fv, d_range);
 		/* Assert here because semcheck.c should have
 		 * already caught the cases in which a slice
 		 * cannot be made. */
 		g_assert(new_fv);
-		to_list = g_list_append(to_list, new_fv);
-
-		from_list = g_list_next(from_list);
+		g_ptr_array_add(to_regs, new_fv);
 	}
 
-	df->registers[to_reg] = to_list;
 	df->owns_memory[to_reg] = TRUE;
 }
 
@@ -469,8 +854,8 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	dfvm_value_t	*arg3 = NULL;
 	dfvm_value_t	*arg4 = NULL;
 	header_field_info	*hfinfo;
-	GList		*param1;
-	GList		*param2;
+	GPtrArray	*param1;
+	GPtrArray	*param2;
 
 	g_assert(tree);
 
@@ -483,6 +868,14 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 		arg1 = insn->arg1;
 		arg2 = insn->arg2;
 
+		/* A test shared by several members of a filter set that was
+		 * already evaluated for this packet. */
+		if (df->cse_slots && df->cse_slots[id] >= 0 &&
+		    df->cse_results[df->cse_slots[id]] != DFVM_CSE_UNKNOWN) {
+			accum = (df->cse_results[df->cse_slots[id]] == DFVM_CSE_TRUE);
+			continue;
+		}
+
 		switch (insn->op) {
 			case CHECK_EXISTS:
 				hfinfo = arg1->value.hfinfo;
@@ -515,7 +908,7 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 					param2 = df->registers[arg4->value.numeric];
 				}
 				accum = arg1->value.funcdef->function(param1, param2,
-						&df->registers[arg2->value.numeric]);
+						df->registers[arg2->value.numeric]);
 				// functions create a new value, so own it.
 				df->owns_memory[arg2->value.numeric] = TRUE;
 				break;
@@ -579,6 +972,57 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg3->value.numeric);
 				break;
 
+			case ANY_UINT_CMP_IMM:
+				accum = any_uint_cmp_imm(df, arg1->value.numeric,
+						arg2->value.uinteger64,
+						(dfvm_opcode_t)insn->arg3->value.numeric);
+				break;
+
+			case ANY_SINT_CMP_IMM:
+				accum = any_sint_cmp_imm(df, arg1->value.numeric,
+						arg2->value.sinteger64,
+						(dfvm_opcode_t)insn->arg3->value.numeric);
+				break;
+
+			case ANY_IPV4_EQ_IMM:
+			case ANY_IPV4_NE_IMM:
+				accum = any_ipv4_eq_imm(df, arg1->value.numeric,
+						&arg2->value.ipv4,
+						insn->op == ANY_IPV4_EQ_IMM);
+				break;
+
+			case ANY_BYTES_EQ_IMM:
+			case ANY_BYTES_NE_IMM:
+				accum = any_bytes_eq_imm(df, arg1->value.numeric,
+						arg2->value.fvalue,
+						insn->op == ANY_BYTES_EQ_IMM);
+				break;
+
+			case ANY_IN_UINT_SET:
+				accum = any_in_uint_set(df, arg1->value.numeric,
+						arg2->value.int_set);
+				break;
+
+			case ANY_IN_SINT_SET:
+				accum = any_in_sint_set(df, arg1->value.numeric,
+						arg2->value.int_set);
+				break;
+
+			case ANY_IN_IPV4_SET:
+				accum = any_in_ipv4_set(df, arg1->value.numeric,
+						arg2->value.ipv4_set);
+				break;
+
+			case ANY_IN_BYTES_SET:
+				accum = any_in_bytes_set(df, arg1->value.numeric,
+						arg2->value.bytes_set);
+				break;
+
+			case ANY_SEARCH_SET:
+				accum = any_search_set(df, arg1->value.numeric,
+						arg2->value.search_set);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -587,6 +1031,17 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				free_register_overhead(df);
 				return accum;
 
+			case SET_RESULT:
+				if (accum) {
+					df->set_matched[arg1->value.numeric / 32] |=
+						1U << (arg1->value.numeric % 32);
+					if (df->set_stop_on_match) {
+						free_register_overhead(df);
+						return TRUE;
+					}
+				}
+				break;
+
 			case IF_TRUE_GOTO:
 				if (accum) {
 					id = arg1->value.numeric;
@@ -613,6 +1068,11 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				g_assert_not_reached();
 				break;
 		}
+
+		if (df->cse_slots && df->cse_slots[id] >= 0) {
+			df->cse_results[df->cse_slots[id]] =
+				accum ? DFVM_CSE_TRUE : DFVM_CSE_FALSE;
+		}
 	}
 
 	g_assert_not_reached();
@@ -654,6 +1114,18 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_UINT_CMP_IMM:
+			case ANY_SINT_CMP_IMM:
+			case ANY_IPV4_EQ_IMM:
+			case ANY_IPV4_NE_IMM:
+			case ANY_BYTES_EQ_IMM:
+			case ANY_BYTES_NE_IMM:
+			case ANY_IN_UINT_SET:
+			case ANY_IN_SINT_SET:
+			case ANY_IN_IPV4_SET:
+			case ANY_IN_BYTES_SET:
+			case ANY_SEARCH_SET:
+			case SET_RESULT:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -10,6 +10,9 @@
 #define DFVM_H
 
 #include <epan/proto.h>
+#include <epan/ipv4.h>
+#include <wsutil/aho_corasick.h>
+#include <wsutil/lpm_trie.h>
 #include "dfilter-int.h"
 #include "syntax-tree.h"
 #include "drange.h"
@@ -23,9 +26,38 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	UINTEGER64,
+	SINTEGER64,
+	IPV4_ADDR,
+	UINT_SET,
+	SINT_SET,
+	IPV4_SET,
+	BYTES_SET,
+	SEARCH_SET
 } dfvm_value_type_t;
 
+/* Closed interval used by the integer set-membership instructions.
+ * Plain set elements are stored with lo == hi. */
+typedef struct {
+	guint64		lo;
+	guint64		hi;
+} dfvm_uint_range_t;
+
+typedef struct {
+	gint64		lo;
+	gint64		hi;
+} dfvm_sint_range_t;
+
+/* The constants of an OR-ed series of "contains" and "matches" tests of
+ * one field: the byte strings in a single automaton and the regular
+ * expressions as one alternation. Either may be NULL. */
+typedef struct {
+	ws_aho_corasick		*strings;
+	GRegex			*regex;
+	guint			num_regexes;
+} dfvm_search_set_t;
+
 typedef struct {
 	dfvm_value_type_t	type;
 
@@ -35,6 +67,13 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		guint64			uinteger64;
+		gint64			sinteger64;
+		ipv4_addr_and_mask	ipv4;
+		GArray			*int_set;	/* sorted dfvm_[us]int_range_t */
+		ws_lpm_trie		*ipv4_set;	/* prefixes of the constants */
+		GPtrArray		*bytes_set;	/* sorted fvalue_t* */
+		dfvm_search_set_t	*search_set;
 	} value;
 
 } dfvm_value_t;
@@ -60,10 +99,34 @@ typedef enum {
 	ANY_MATCHES,
 	MK_RANGE,
 	CALL_FUNCTION,
-	ANY_IN_RANGE
+	ANY_IN_RANGE,
+
+	/* Type-specialized forms of the above, selected by gencode.c when
+	 * a field is compared against a constant of a known type. The
+	 * constant is held in the instruction rather than a register. */
+	ANY_UINT_CMP_IMM,	/* arg3 is the ANY_EQ...ANY_LE opcode */
+	ANY_SINT_CMP_IMM,	/* arg3 is the ANY_EQ...ANY_LE opcode */
+	ANY_IPV4_EQ_IMM,
+	ANY_IPV4_NE_IMM,
+	ANY_BYTES_EQ_IMM,
+	ANY_BYTES_NE_IMM,
+	ANY_IN_UINT_SET,
+	ANY_IN_SINT_SET,
+	ANY_IN_IPV4_SET,
+	ANY_IN_BYTES_SET,
+	ANY_SEARCH_SET,		/* contains or matches any of a SEARCH_SET */
+
+	/* Replaces the RETURN of each member of a merged dfilter_set_t
+	 * program; arg1 is the index of the member. */
+	SET_RESULT
 
 } dfvm_opcode_t;
 
+/* States of a common-subexpression result slot */
+#define DFVM_CSE_UNKNOWN	0
+#define DFVM_CSE_FALSE		1
+#define DFVM_CSE_TRUE		2
+
 typedef struct {
 	int		id;
 	dfvm_opcode_t	op;
@@ -91,4 +154,9 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 void
 dfvm_init_const(dfilter_t *df);
 
+/* Total order on byte strings (by length, then contents) used to sort
+ * and search the constants of a BYTES_SET. */
+int
+dfvm_bytes_cmp(const GByteArray *a, const GByteArray *b);
+
 #endif
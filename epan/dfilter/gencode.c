@@ -8,6 +8,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "dfilter-int.h"
 #include "gencode.h"
 #include "dfvm.h"
@@ -17,6 +19,9 @@
 #include "sttype-set.h"
 #include "sttype-function.h"
 #include "ftypes/ftypes.h"
+#include "ftypes/ftypes-int.h"
+#include <wsutil/bits_count_ones.h>
+#include <wsutil/pint.h>
 
 static void
 gencode(dfwork_t *dfw, stnode_t *st_node);
@@ -252,12 +257,162 @@ gen_relation_regs(dfwork_t *dfw, dfvm_opcode_t op, int reg1, int reg2)
 	dfw_append_insn(dfw, insn);
 }
 
+/* Field types for which gencode emits type-specialized instructions. */
+typedef enum {
+	IMM_NONE,
+	IMM_UINT,
+	IMM_SINT,
+	IMM_IPV4,
+	IMM_BYTES
+} imm_kind_t;
+
+static imm_kind_t
+imm_kind(ftenum_t ftype)
+{
+	if (IS_FT_UINT(ftype))
+		return IMM_UINT;
+	if (IS_FT_INT(ftype))
+		return IMM_SINT;
+
+	switch (ftype) {
+		case FT_IPv4:
+			return IMM_IPV4;
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_ETHER:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return IMM_BYTES;
+		default:
+			return IMM_NONE;
+	}
+}
+
+/* A register loaded from a field holds the values of every field with
+ * that name, so a specialized instruction can only be used if they all
+ * have the type of the constant. */
+static gboolean
+same_name_fields_have_type(header_field_info *hfinfo, ftenum_t ftype)
+{
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+	for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (hfinfo->type != ftype)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Returns the kind of specialized instruction usable to test the field
+ * "st_field" against constants of type "ftype", or IMM_NONE. */
+static imm_kind_t
+field_imm_kind(stnode_t *st_field, ftenum_t ftype)
+{
+	imm_kind_t	kind;
+
+	if (stnode_type_id(st_field) != STTYPE_FIELD)
+		return IMM_NONE;
+
+	kind = imm_kind(ftype);
+	if (kind == IMM_NONE ||
+	    !same_name_fields_have_type((header_field_info *)stnode_data(st_field), ftype))
+		return IMM_NONE;
+
+	return kind;
+}
+
+/* Try to generate a single type-specialized instruction for a relation
+ * between a field and a constant. Returns FALSE, having generated
+ * nothing, if the generic ANY_xxx instruction is needed. */
+static gboolean
+gen_relation_imm(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2, *val3 = NULL;
+	dfvm_value_t	*jmp1 = NULL;
+	fvalue_t	*fv;
+	ftenum_t	ftype;
+	dfvm_opcode_t	imm_op;
+
+	if (stnode_type_id(st_arg2) != STTYPE_FVALUE)
+		return FALSE;
+
+	fv = (fvalue_t *)stnode_data(st_arg2);
+	ftype = fvalue_type_ftenum(fv);
+
+	switch (field_imm_kind(st_arg1, ftype)) {
+		case IMM_UINT:
+		case IMM_SINT:
+			if (op != ANY_EQ && op != ANY_NE && op != ANY_GT &&
+			    op != ANY_GE && op != ANY_LT && op != ANY_LE)
+				return FALSE;
+			if (IS_FT_UINT(ftype)) {
+				imm_op = ANY_UINT_CMP_IMM;
+				val2 = dfvm_value_new(UINTEGER64);
+				val2->value.uinteger64 = IS_FT_UINT64(ftype) ?
+				    fvalue_get_uinteger64(fv) : fvalue_get_uinteger(fv);
+			}
+			else {
+				imm_op = ANY_SINT_CMP_IMM;
+				val2 = dfvm_value_new(SINTEGER64);
+				val2->value.sinteger64 = IS_FT_INT64(ftype) ?
+				    fvalue_get_sinteger64(fv) : fvalue_get_sinteger(fv);
+			}
+			val3 = dfvm_value_new(INTEGER);
+			val3->value.numeric = op;
+			break;
+
+		case IMM_IPV4:
+			if (op != ANY_EQ && op != ANY_NE)
+				return FALSE;
+			imm_op = (op == ANY_EQ) ? ANY_IPV4_EQ_IMM : ANY_IPV4_NE_IMM;
+			val2 = dfvm_value_new(IPV4_ADDR);
+			val2->value.ipv4.nmask = fv->value.ipv4.nmask;
+			val2->value.ipv4.addr = fv->value.ipv4.addr & fv->value.ipv4.nmask;
+			break;
+
+		case IMM_BYTES:
+			if (op != ANY_EQ && op != ANY_NE)
+				return FALSE;
+			imm_op = (op == ANY_EQ) ? ANY_BYTES_EQ_IMM : ANY_BYTES_NE_IMM;
+			val2 = dfvm_value_new(FVALUE);
+			val2->value.fvalue = (fvalue_t *)stnode_steal_data(st_arg2);
+			break;
+
+		case IMM_NONE:
+		default:
+			return FALSE;
+	}
+
+	insn = dfvm_insn_new(imm_op);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = gen_entity(dfw, st_arg1, &jmp1);
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	insn->arg3 = val3;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp1) {
+		jmp1->value.numeric = dfw->next_insn_id;
+	}
+	return TRUE;
+}
+
 static void
 gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
 {
 	dfvm_value_t	*jmp1 = NULL, *jmp2 = NULL;
 	int		reg1 = -1, reg2 = -1;
 
+	/* Comparisons of a field against a constant of a known type */
+	if (gen_relation_imm(dfw, op, st_arg1, st_arg2))
+		return;
+
 	/* Create code for the LHS and RHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 	reg2 = gen_entity(dfw, st_arg2, &jmp2);
@@ -287,6 +442,226 @@ fixup_jumps(gpointer data, gpointer user_data)
 	}
 }
 
+static gint
+compare_uint_range(gconstpointer a, gconstpointer b)
+{
+	const dfvm_uint_range_t *ra = (const dfvm_uint_range_t *)a;
+	const dfvm_uint_range_t *rb = (const dfvm_uint_range_t *)b;
+
+	return (ra->lo > rb->lo) - (ra->lo < rb->lo);
+}
+
+static gint
+compare_sint_range(gconstpointer a, gconstpointer b)
+{
+	const dfvm_sint_range_t *ra = (const dfvm_sint_range_t *)a;
+	const dfvm_sint_range_t *rb = (const dfvm_sint_range_t *)b;
+
+	return (ra->lo > rb->lo) - (ra->lo < rb->lo);
+}
+
+/* Sort the intervals of an integer set and merge overlapping or
+ * adjacent ones so that a binary search finds at most one candidate. */
+#define NORMALIZE_INT_SET(range_type, compare_func, set) \
+	G_STMT_START { \
+		guint i_, n_ = 0; \
+		g_array_sort((set), compare_func); \
+		for (i_ = 0; i_ < (set)->len; i_++) { \
+			range_type *cur_ = &g_array_index((set), range_type, i_); \
+			range_type *last_ = n_ ? &g_array_index((set), range_type, n_ - 1) : NULL; \
+			if (last_ && (cur_->lo <= last_->hi || cur_->lo - 1 == last_->hi)) { \
+				if (cur_->hi > last_->hi) \
+					last_->hi = cur_->hi; \
+			} \
+			else { \
+				g_array_index((set), range_type, n_++) = *cur_; \
+			} \
+		} \
+		g_array_set_size((set), n_); \
+	} G_STMT_END
+
+static GArray *
+build_uint_set(GSList *nodelist)
+{
+	GArray		*set = g_array_new(FALSE, FALSE, sizeof(dfvm_uint_range_t));
+	dfvm_uint_range_t r;
+	fvalue_t	*fv;
+
+	while (nodelist) {
+		fv = (fvalue_t *)stnode_data((stnode_t *)nodelist->data);
+		r.lo = r.hi = IS_FT_UINT64(fvalue_type_ftenum(fv)) ?
+		    fvalue_get_uinteger64(fv) : fvalue_get_uinteger(fv);
+		nodelist = g_slist_next(nodelist);
+		if (nodelist->data) {
+			fv = (fvalue_t *)stnode_data((stnode_t *)nodelist->data);
+			r.hi = IS_FT_UINT64(fvalue_type_ftenum(fv)) ?
+			    fvalue_get_uinteger64(fv) : fvalue_get_uinteger(fv);
+		}
+		nodelist = g_slist_next(nodelist);
+		if (r.lo <= r.hi)
+			g_array_append_val(set, r);
+	}
+	NORMALIZE_INT_SET(dfvm_uint_range_t, compare_uint_range, set);
+	return set;
+}
+
+static GArray *
+build_sint_set(GSList *nodelist)
+{
+	GArray		*set = g_array_new(FALSE, FALSE, sizeof(dfvm_sint_range_t));
+	dfvm_sint_range_t r;
+	fvalue_t	*fv;
+
+	while (nodelist) {
+		fv = (fvalue_t *)stnode_data((stnode_t *)nodelist->data);
+		r.lo = r.hi = IS_FT_INT64(fvalue_type_ftenum(fv)) ?
+		    fvalue_get_sinteger64(fv) : fvalue_get_sinteger(fv);
+		nodelist = g_slist_next(nodelist);
+		if (nodelist->data) {
+			fv = (fvalue_t *)stnode_data((stnode_t *)nodelist->data);
+			r.hi = IS_FT_INT64(fvalue_type_ftenum(fv)) ?
+			    fvalue_get_sinteger64(fv) : fvalue_get_sinteger(fv);
+		}
+		nodelist = g_slist_next(nodelist);
+		if (r.lo <= r.hi)
+			g_array_append_val(set, r);
+	}
+	NORMALIZE_INT_SET(dfvm_sint_range_t, compare_sint_range, set);
+	return set;
+}
+
+static ws_lpm_trie *
+build_ipv4_set(GSList *nodelist)
+{
+	ws_lpm_trie	*set = ws_lpm_trie_new(32, NULL);
+	fvalue_t	*fv;
+	guint8		addr[4];
+
+	for (; nodelist; nodelist = g_slist_next(g_slist_next(nodelist))) {
+		fv = (fvalue_t *)stnode_data((stnode_t *)nodelist->data);
+		phton32(addr, fv->value.ipv4.addr);
+		/* Duplicates are simply not added again */
+		ws_lpm_trie_insert(set, addr, ws_count_ones(fv->value.ipv4.nmask),
+		    GINT_TO_POINTER(1));
+	}
+	return set;
+}
+
+static gint
+compare_bytes_fvalue(gconstpointer a, gconstpointer b)
+{
+	const fvalue_t *fa = *(const fvalue_t * const *)a;
+	const fvalue_t *fb = *(const fvalue_t * const *)b;
+
+	return dfvm_bytes_cmp(fa->value.bytes, fb->value.bytes);
+}
+
+static void
+free_fvalue_cb(gpointer data)
+{
+	fvalue_t *fv = (fvalue_t *)data;
+
+	FVALUE_FREE(fv);
+}
+
+static GPtrArray *
+build_bytes_set(GSList *nodelist)
+{
+	GPtrArray	*set = g_ptr_array_new_with_free_func(free_fvalue_cb);
+
+	for (; nodelist; nodelist = g_slist_next(g_slist_next(nodelist))) {
+		g_ptr_array_add(set, stnode_steal_data((stnode_t *)nodelist->data));
+	}
+	g_ptr_array_sort(set, compare_bytes_fvalue);
+	return set;
+}
+
+/* Try to generate a single set-membership instruction for "field in {...}"
+ * when every element is a constant of the field's type. Ranges are only
+ * supported for integers. Returns FALSE, having generated nothing, if the
+ * generic OR-ed series of tests is needed. */
+static gboolean
+gen_relation_in_set(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_value_t	*jmp1 = NULL;
+	GSList		*nodelist_head, *nodelist;
+	stnode_t	*node1, *node2;
+	ftenum_t	ftype;
+	imm_kind_t	kind;
+
+	nodelist_head = (GSList*)stnode_data(st_arg2);
+	if (nodelist_head == NULL)
+		return FALSE;
+
+	node1 = (stnode_t*)nodelist_head->data;
+	if (stnode_type_id(node1) != STTYPE_FVALUE)
+		return FALSE;
+	ftype = fvalue_type_ftenum((fvalue_t *)stnode_data(node1));
+	kind = field_imm_kind(st_arg1, ftype);
+	if (kind == IMM_NONE)
+		return FALSE;
+
+	for (nodelist = nodelist_head; nodelist; ) {
+		node1 = (stnode_t*)nodelist->data;
+		nodelist = g_slist_next(nodelist);
+		node2 = (stnode_t*)nodelist->data;
+		nodelist = g_slist_next(nodelist);
+
+		if (stnode_type_id(node1) != STTYPE_FVALUE ||
+		    fvalue_type_ftenum((fvalue_t *)stnode_data(node1)) != ftype)
+			return FALSE;
+		if (node2) {
+			if ((kind != IMM_UINT && kind != IMM_SINT) ||
+			    stnode_type_id(node2) != STTYPE_FVALUE ||
+			    fvalue_type_ftenum((fvalue_t *)stnode_data(node2)) != ftype)
+				return FALSE;
+		}
+	}
+
+	switch (kind) {
+		case IMM_UINT:
+			insn = dfvm_insn_new(ANY_IN_UINT_SET);
+			val2 = dfvm_value_new(UINT_SET);
+			val2->value.int_set = build_uint_set(nodelist_head);
+			break;
+		case IMM_SINT:
+			insn = dfvm_insn_new(ANY_IN_SINT_SET);
+			val2 = dfvm_value_new(SINT_SET);
+			val2->value.int_set = build_sint_set(nodelist_head);
+			break;
+		case IMM_IPV4:
+			insn = dfvm_insn_new(ANY_IN_IPV4_SET);
+			val2 = dfvm_value_new(IPV4_SET);
+			val2->value.ipv4_set = build_ipv4_set(nodelist_head);
+			break;
+		case IMM_BYTES:
+			insn = dfvm_insn_new(ANY_IN_BYTES_SET);
+			val2 = dfvm_value_new(BYTES_SET);
+			val2->value.bytes_set = build_bytes_set(nodelist_head);
+			break;
+		case IMM_NONE:
+		default:
+			g_assert_not_reached();
+			return FALSE;
+	}
+
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = gen_entity(dfw, st_arg1, &jmp1);
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	/* Jump here if the LHS entity was not present */
+	if (jmp1) {
+		jmp1->value.numeric = dfw->next_insn_id;
+	}
+
+	set_nodelist_free((GSList*)stnode_steal_data(st_arg2));
+	return TRUE;
+}
+
 /* Generate the code for the in operator.  It behaves much like an OR-ed
  * series of == tests, but without the redundant existence checks. */
 static void
@@ -300,6 +675,10 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 	GSList		*nodelist_head, *nodelist;
 	GSList		*jumplist = NULL;
 
+	/* Sets of constants of the field's own type */
+	if (gen_relation_in_set(dfw, st_arg1, st_arg2))
+		return;
+
 	/* Create code for the LHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 
@@ -408,6 +787,326 @@ gen_entity(dfwork_t *dfw, stnode_t *st_arg, dfvm_value_t **p_jmp)
 }
 
 
+/* Types whose values the ANY_SEARCH_SET instruction can scan */
+static gboolean
+search_set_ftype(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_PROTOCOL:
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return TRUE;
+		default:
+			return imm_kind(ftype) == IMM_BYTES;
+	}
+}
+
+/* The bytes a "contains" constant of one of those types looks for */
+static gboolean
+search_constant(fvalue_t *fv, const guint8 **data, guint *len)
+{
+	tvbuff_t	*tvb;
+
+	switch (fvalue_type_ftenum(fv)) {
+		case FT_PROTOCOL:
+			tvb = fv->value.protocol.tvb;
+			if (tvb == NULL)
+				return FALSE;
+			*len = tvb_captured_length(tvb);
+			*data = tvb_get_ptr(tvb, 0, *len);
+			return TRUE;
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			*data = (const guint8 *)fv->value.string;
+			*len = (guint)strlen(fv->value.string);
+			return TRUE;
+		default:
+			*data = fv->value.bytes->data;
+			*len = fv->value.bytes->len;
+			return TRUE;
+	}
+}
+
+/* A regular expression can be one branch of an alternation unless it
+ * refers to groups by number, which the other branches would shift, or
+ * recurses into the whole pattern. Escapes and comments aren't parsed
+ * here, so some harmless patterns are refused too. */
+static gboolean
+regex_combinable(const GRegex *re)
+{
+	const gchar	*p;
+
+	if (g_regex_get_max_backref(re) > 0)
+		return FALSE;
+
+	for (p = g_regex_get_pattern(re); *p; p++) {
+		if (*p == '\\') {
+			if (p[1] == 'g' || p[1] == 'k')
+				return FALSE;
+			if (p[1] != '\0')
+				p++;
+		}
+		else if (p[0] == '(' && p[1] == '?') {
+			if (p[2] == 'R' || p[2] == '&' || p[2] == '+' ||
+			    g_ascii_isdigit(p[2]) ||
+			    (p[2] == '-' && g_ascii_isdigit(p[3])) ||
+			    (p[2] == 'P' && (p[3] == '>' || p[3] == '=')))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* If "st_node" is "field contains constant" or "field matches constant"
+ * that can be part of a search set, returns the field. */
+static header_field_info *
+search_test_field(stnode_t *st_node)
+{
+	test_op_t		st_op;
+	stnode_t		*st_arg1, *st_arg2;
+	header_field_info	*hfinfo;
+	fvalue_t		*fv;
+	const guint8		*data;
+	guint			len;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST)
+		return NULL;
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if ((st_op != TEST_OP_CONTAINS && st_op != TEST_OP_MATCHES) ||
+	    stnode_type_id(st_arg1) != STTYPE_FIELD ||
+	    stnode_type_id(st_arg2) != STTYPE_FVALUE)
+		return NULL;
+
+	hfinfo = (header_field_info *)stnode_data(st_arg1);
+	fv = (fvalue_t *)stnode_data(st_arg2);
+	if (!search_set_ftype(hfinfo->type) ||
+	    !same_name_fields_have_type(hfinfo, hfinfo->type))
+		return NULL;
+
+	if (st_op == TEST_OP_CONTAINS) {
+		/* An empty constant is contained in nothing, leave that be */
+		if (fvalue_type_ftenum(fv) != hfinfo->type ||
+		    !search_constant(fv, &data, &len) || len == 0)
+			return NULL;
+	}
+	else {
+		if (fvalue_type_ftenum(fv) != FT_PCRE || fv->value.re == NULL ||
+		    !regex_combinable(fv->value.re))
+			return NULL;
+	}
+	return hfinfo;
+}
+
+/* Build the search set of "tests", two or more "contains" and "matches"
+ * tests of one field. The entries of the tests it can't take are set to
+ * NULL; those must be generated separately. Returns NULL if it takes
+ * none. */
+static dfvm_search_set_t *
+build_search_set(GPtrArray *tests)
+{
+	dfvm_search_set_t	*set = g_new0(dfvm_search_set_t, 1);
+	GString			*alternation = NULL;
+	GRegexCompileFlags	cflags = (GRegexCompileFlags)0;
+	gboolean		same_cflags = TRUE;
+	test_op_t		st_op;
+	stnode_t		*st_arg1, *st_arg2;
+	fvalue_t		*fv;
+	const guint8		*data;
+	guint			len, i;
+
+	for (i = 0; i < tests->len; i++) {
+		sttype_test_get((stnode_t *)g_ptr_array_index(tests, i), &st_op, &st_arg1, &st_arg2);
+		fv = (fvalue_t *)stnode_data(st_arg2);
+		if (st_op == TEST_OP_CONTAINS) {
+			if (set->strings == NULL)
+				set->strings = ws_aho_corasick_new();
+			search_constant(fv, &data, &len);
+			ws_aho_corasick_add(set->strings, data, len);
+		}
+		else {
+			if (alternation == NULL) {
+				alternation = g_string_new(NULL);
+				cflags = g_regex_get_compile_flags(fv->value.re);
+			}
+			else {
+				g_string_append_c(alternation, '|');
+				if (g_regex_get_compile_flags(fv->value.re) != cflags)
+					same_cflags = FALSE;
+			}
+			g_string_append_printf(alternation, "(?:%s)",
+			    g_regex_get_pattern(fv->value.re));
+			set->num_regexes++;
+		}
+	}
+
+	if (set->strings && !ws_aho_corasick_compile(set->strings)) {
+		ws_aho_corasick_free(set->strings);
+		set->strings = NULL;
+	}
+	if (alternation) {
+		/* A pattern that only worked on its own, say one ending in
+		 * an extended mode comment, breaks the alternation. */
+		if (same_cflags)
+			set->regex = g_regex_new(alternation->str, cflags,
+			    (GRegexMatchFlags)0, NULL);
+		if (set->regex == NULL)
+			set->num_regexes = 0;
+		g_string_free(alternation, TRUE);
+	}
+
+	for (i = 0; i < tests->len; i++) {
+		sttype_test_get((stnode_t *)g_ptr_array_index(tests, i), &st_op, &st_arg1, &st_arg2);
+		if ((st_op == TEST_OP_CONTAINS && set->strings == NULL) ||
+		    (st_op == TEST_OP_MATCHES && set->regex == NULL))
+			g_ptr_array_index(tests, i) = NULL;
+	}
+
+	if (set->strings == NULL && set->regex == NULL) {
+		g_free(set);
+		return NULL;
+	}
+	return set;
+}
+
+/* Test a field against a search set in one instruction */
+static void
+gen_search_set(dfwork_t *dfw, stnode_t *st_test, dfvm_search_set_t *set)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_value_t	*jmp1 = NULL;
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	sttype_test_get(st_test, &st_op, &st_arg1, &st_arg2);
+
+	insn = dfvm_insn_new(ANY_SEARCH_SET);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = gen_entity(dfw, st_arg1, &jmp1);
+	val2 = dfvm_value_new(SEARCH_SET);
+	val2->value.search_set = set;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	/* Jump here if the field was not present */
+	if (jmp1) {
+		jmp1->value.numeric = dfw->next_insn_id;
+	}
+}
+
+static void
+flatten_or(stnode_t *st_node, GPtrArray *tests)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	if (stnode_type_id(st_node) == STTYPE_TEST) {
+		sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+		if (st_op == TEST_OP_OR) {
+			flatten_or(st_arg1, tests);
+			flatten_or(st_arg2, tests);
+			return;
+		}
+	}
+	g_ptr_array_add(tests, st_node);
+}
+
+static void
+free_ptr_array_cb(gpointer data)
+{
+	g_ptr_array_free((GPtrArray *)data, TRUE);
+}
+
+/* Generate the code for a series of OR-ed tests, jumping to the end as
+ * soon as one is true. Two or more "contains" or "matches" tests of the
+ * same field become a single instruction that scans each value of the
+ * field once for all their constants, instead of once per constant; it
+ * takes the place of the first of them. */
+static void
+gen_or(dfwork_t *dfw, stnode_t *st_node)
+{
+	GPtrArray		*tests = g_ptr_array_new();
+	GHashTable		*by_field, *folded, *emitted;
+	GHashTableIter		iter;
+	GPtrArray		*group;
+	header_field_info	*hfinfo;
+	dfvm_search_set_t	*set;
+	stnode_t		*st_test;
+	dfvm_insn_t		*insn;
+	dfvm_value_t		*val1;
+	GSList			*jumplist = NULL;
+	gboolean		first = TRUE;
+	guint			i;
+
+	flatten_or(st_node, tests);
+
+	by_field = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_ptr_array_cb);
+	for (i = 0; i < tests->len; i++) {
+		st_test = (stnode_t *)g_ptr_array_index(tests, i);
+		hfinfo = search_test_field(st_test);
+		if (hfinfo == NULL)
+			continue;
+		group = (GPtrArray *)g_hash_table_lookup(by_field, hfinfo);
+		if (group == NULL) {
+			group = g_ptr_array_new();
+			g_hash_table_insert(by_field, hfinfo, group);
+		}
+		g_ptr_array_add(group, st_test);
+	}
+
+	/* Map the tests that went into a search set to it */
+	folded = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_iter_init(&iter, by_field);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&group)) {
+		if (group->len < 2)
+			continue;
+		set = build_search_set(group);
+		if (set == NULL)
+			continue;
+		for (i = 0; i < group->len; i++) {
+			if (g_ptr_array_index(group, i))
+				g_hash_table_insert(folded, g_ptr_array_index(group, i), set);
+		}
+	}
+
+	emitted = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < tests->len; i++) {
+		st_test = (stnode_t *)g_ptr_array_index(tests, i);
+		set = (dfvm_search_set_t *)g_hash_table_lookup(folded, st_test);
+		if (set && g_hash_table_contains(emitted, set))
+			continue;
+
+		if (!first) {
+			insn = dfvm_insn_new(IF_TRUE_GOTO);
+			val1 = dfvm_value_new(INSN_NUMBER);
+			insn->arg1 = val1;
+			dfw_append_insn(dfw, insn);
+			jumplist = g_slist_prepend(jumplist, val1);
+		}
+		first = FALSE;
+
+		if (set) {
+			gen_search_set(dfw, st_test, set);
+			g_hash_table_add(emitted, set);
+		}
+		else {
+			gencode(dfw, st_test);
+		}
+	}
+
+	g_slist_foreach(jumplist, fixup_jumps, dfw);
+	g_slist_free(jumplist);
+	g_hash_table_destroy(emitted);
+	g_hash_table_destroy(folded);
+	g_hash_table_destroy(by_field);
+	g_ptr_array_free(tests, TRUE);
+}
+
 static void
 gen_test(dfwork_t *dfw, stnode_t *st_node)
 {
@@ -467,15 +1166,7 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_OR:
-			gencode(dfw, st_arg1);
-
-			insn = dfvm_insn_new(IF_TRUE_GOTO);
-			val1 = dfvm_value_new(INSN_NUMBER);
-			insn->arg1 = val1;
-			dfw_append_insn(dfw, insn);
-
-			gencode(dfw, st_arg2);
-			val1->value.numeric = dfw->next_insn_id;
+			gen_or(dfw, st_node);
 			break;
 
 		case TEST_OP_EQ:
@@ -145,6 +145,10 @@ dissect_rnsap(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
 	proto_item	*rnsap_item = NULL;
 	proto_tree	*rnsap_tree = NULL;
 
+	/* Register the fields if no name starting with "rnsap." was looked up yet */
+	if (hf_rnsap_transportLayerAddress_ipv4 == -1)
+		proto_registrar_get_byname("rnsap.transportLayerAddress_ipv4");
+
 	/* make entry in the Protocol column on summary display */
 	col_set_str(pinfo->cinfo, COL_PROTOCOL, "RNSAP");
 
@@ -236,9 +240,13 @@ dissect_sccp_rnsap_heur(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, voi
 }
 
 
-/*--- proto_register_rnsap -------------------------------------------*/
-void proto_register_rnsap(void) {
-
+/*
+ * There are thousands of fields; register them only once a name starting
+ * with "rnsap." is looked up, or the first RNSAP message is dissected.
+ */
+static void
+register_rnsap_fields(const char *unused _U_)
+{
   /* List of fields */
   static hf_register_info hf[] = {
     { &hf_rnsap_transportLayerAddress_ipv4,
@@ -256,6 +264,12 @@ void proto_register_rnsap(void) {
 #include "packet-rnsap-hfarr.c"
   };
 
+  proto_register_field_array(proto_rnsap, hf, array_length(hf));
+}
+
+/*--- proto_register_rnsap -------------------------------------------*/
+void proto_register_rnsap(void) {
+
   /* List of subtrees */
   static gint *ett[] = {
     &ett_rnsap,
@@ -267,8 +281,8 @@ void proto_register_rnsap(void) {
 
   /* Register protocol */
   proto_rnsap = proto_register_protocol(PNAME, PSNAME, PFNAME);
-  /* Register fields and subtrees */
-  proto_register_field_array(proto_rnsap, hf, array_length(hf));
+  /* Register subtrees, and the fields on demand */
+  proto_register_prefix("rnsap", register_rnsap_fields);
   proto_register_subtree_array(ett, array_length(ett));
 
   /* Register dissector */
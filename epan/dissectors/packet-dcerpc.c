@@ -772,6 +772,8 @@ dcerpc_add_conv_to_bind_table(decode_dcerpc_bind_values_t *binding)
 
     key = (dcerpc_bind_key *)wmem_alloc(wmem_file_scope(), sizeof (dcerpc_bind_key));
     key->conv = conv;
+    /* the key outlives the frame, so the conversation must as well */
+    conversation_retain(conv);
     key->ctx_id = binding->ctx_id;
     key->transport_salt = binding->transport_salt;
 
@@ -4059,6 +4061,7 @@ dissect_dcerpc_cn_bind(tvbuff_t *tvb, gint offset, packet_info *pinfo,
 
             key = (dcerpc_bind_key *)wmem_alloc(wmem_file_scope(), sizeof (dcerpc_bind_key));
             key->conv = conv;
+            conversation_retain(conv);
             key->ctx_id = ctx_id;
             key->transport_salt = dcerpc_get_transport_salt(pinfo);
 
@@ -4550,6 +4553,7 @@ dissect_dcerpc_cn_rqst(tvbuff_t *tvb, gint offset, packet_info *pinfo,
                     */
                     call_key = (dcerpc_cn_call_key *)wmem_alloc(wmem_file_scope(), sizeof (dcerpc_cn_call_key));
                     call_key->conv = conv;
+                    conversation_retain(conv);
                     call_key->call_id = hdr->call_id;
                     call_key->transport_salt = dcerpc_get_transport_salt(pinfo);
 
@@ -6098,6 +6102,7 @@ dissect_dcerpc_dg_rqst(tvbuff_t *tvb, int offset, packet_info *pinfo,
 
         call_key = (dcerpc_dg_call_key *)wmem_alloc(wmem_file_scope(), sizeof (dcerpc_dg_call_key));
         call_key->conv = conv;
+        conversation_retain(conv);
         call_key->seqnum = hdr->seqnum;
         call_key->act_id = hdr->act_id;
 
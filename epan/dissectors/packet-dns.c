@@ -3676,6 +3676,19 @@ dissect_answer_records(tvbuff_t *tvb, int cur_off, int dns_data_offset,
   return cur_off - start_off;
 }
 
+/*
+ * Free the transactions of a conversation that was aged out in
+ * streaming mode.
+ */
+static void
+dns_conversation_evict(conversation_t *conv _U_, void *proto_data)
+{
+  dns_conv_info_t *dns_info = (dns_conv_info_t *)proto_data;
+
+  wmem_tree_destroy(dns_info->pdus, FALSE, TRUE);
+  wmem_free(wmem_file_scope(), dns_info);
+}
+
 static void
 dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
     enum DnsTransport transport, gboolean is_mdns, gboolean is_llmnr)
@@ -5813,6 +5826,8 @@ proto_register_dns(void)
 
   dns_handle = register_dissector("dns", dissect_dns, proto_dns);
 
+  conversation_register_evict_func(proto_dns, dns_conversation_evict);
+
   dns_tap = register_tap("dns");
 }
 
@@ -2001,6 +2001,7 @@ proto_register_dtls(void)
 
   register_init_routine(dtls_init);
   register_cleanup_routine(dtls_cleanup);
+  conversation_register_evict_func(proto_dtls, ssl_session_evict);
   reassembly_table_register (&dtls_reassembly_table, &addresses_ports_reassembly_table_functions);
   register_decode_as(&dtls_da);
 
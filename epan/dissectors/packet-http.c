@@ -944,6 +944,29 @@ dissect_http_kerberos(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 }
 
 
+/*
+ * Free the state of a conversation that was aged out in streaming mode.
+ */
+static void
+http_conversation_evict(conversation_t *conv _U_, void *proto_data)
+{
+	http_conv_t	*conv_data = (http_conv_t *)proto_data;
+	http_req_res_t	*req_res, *prev;
+
+	for (req_res = conv_data->req_res_tail; req_res; req_res = prev) {
+		prev = req_res->prev;
+		wmem_free(wmem_file_scope(), req_res);
+	}
+	wmem_free(wmem_file_scope(), conv_data->http_host);
+	wmem_free(wmem_file_scope(), conv_data->request_method);
+	wmem_free(wmem_file_scope(), conv_data->request_uri);
+	wmem_free(wmem_file_scope(), conv_data->full_uri);
+	wmem_free(wmem_file_scope(), conv_data->websocket_protocol);
+	wmem_free(wmem_file_scope(), conv_data->websocket_extensions);
+	free_address_wmem(wmem_file_scope(), &conv_data->server_addr);
+	wmem_free(wmem_file_scope(), conv_data);
+}
+
 static http_conv_t *
 get_http_conversation_data(packet_info *pinfo, conversation_t **conversation)
 {
@@ -4004,6 +4027,8 @@ proto_register_http(void)
 	http_tls_handle = register_dissector("http-over-tls", dissect_http_tls, proto_http); /* RFC 2818 */
 	http_sctp_handle = register_dissector("http-over-sctp", dissect_http_sctp, proto_http);
 
+	conversation_register_evict_func(proto_http, http_conversation_evict);
+
 	http_module = prefs_register_protocol(proto_http, reinit_http);
 	prefs_register_bool_preference(http_module, "desegment_headers",
 	    "Reassemble HTTP headers spanning multiple TCP segments",
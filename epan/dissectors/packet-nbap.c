@@ -55882,6 +55882,11 @@ dissect_nbap(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
 {
   proto_item *nbap_item = NULL;
   proto_tree *nbap_tree = NULL;
+
+  /* Register the fields if no name starting with "nbap." was looked up yet */
+  if (hf_nbap_transportLayerAddress_ipv4 == -1)
+    proto_registrar_get_byname("nbap.transportLayerAddress_ipv4");
+
   /* make entry in the Protocol column on summary display */
   col_set_str(pinfo->cinfo, COL_PROTOCOL, "NBAP");
 
@@ -55972,12 +55977,13 @@ dissect_nbap_heur(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *dat
   return TRUE;
 }
 
-/*--- proto_register_nbap -------------------------------------------*/
-void proto_register_nbap(void)
+/*
+ * There are thousands of fields; register them only once a name starting
+ * with "nbap." is looked up, or the first NBAP message is dissected.
+ */
+static void
+register_nbap_fields(const char *unused _U_)
 {
-  module_t *nbap_module;
-  guint8 i;
-
   /* List of fields */
   static hf_register_info hf[] = {
   { &hf_nbap_transportLayerAddress_ipv4,
@@ -69161,9 +69167,18 @@ void proto_register_nbap(void)
         NULL, HFILL }},
 
 /*--- End of included file: packet-nbap-hfarr.c ---*/
-#line 746 "./asn1/nbap/packet-nbap-template.c"
+#line 752 "./asn1/nbap/packet-nbap-template.c"
   };
 
+  proto_register_field_array(proto_nbap, hf, array_length(hf));
+}
+
+/*--- proto_register_nbap -------------------------------------------*/
+void proto_register_nbap(void)
+{
+  module_t *nbap_module;
+  guint8 i;
+
   /* List of subtrees */
   static gint *ett[] = {
     &ett_nbap,
@@ -70801,7 +70816,7 @@ void proto_register_nbap(void)
     &ett_nbap_Outcome,
 
 /*--- End of included file: packet-nbap-ettarr.c ---*/
-#line 755 "./asn1/nbap/packet-nbap-template.c"
+#line 770 "./asn1/nbap/packet-nbap-template.c"
   };
 
   static ei_register_info ei[] = {
@@ -70814,8 +70829,8 @@ void proto_register_nbap(void)
 
   /* Register protocol */
   proto_nbap = proto_register_protocol(PNAME, PSNAME, PFNAME);
-  /* Register fields and subtrees */
-  proto_register_field_array(proto_nbap, hf, array_length(hf));
+  /* Register subtrees, and the fields on demand */
+  proto_register_prefix("nbap", register_nbap_fields);
   proto_register_subtree_array(ett, array_length(ett));
   expert_nbap = expert_register_protocol(proto_nbap);
   expert_register_field_array(expert_nbap, ei, array_length(ei));
@@ -71956,6 +71971,6 @@ proto_reg_handoff_nbap(void)
 
 
 /*--- End of included file: packet-nbap-dis-tab.c ---*/
-#line 813 "./asn1/nbap/packet-nbap-template.c"
+#line 828 "./asn1/nbap/packet-nbap-template.c"
 }
 
@@ -873,6 +873,51 @@ quic_connection_destroy(gpointer data, gpointer user_data _U_)
         quic_cipher_reset(&conn->server_pp.cipher[i]);
     }
 }
+
+/* Forget a CID of "conn" if it is still the one that maps to it. */
+static void
+quic_cids_remove(wmem_map_t *connections, quic_cid_t *cid, quic_info_data_t *conn)
+{
+    if (cid->len > 0 && wmem_map_lookup(connections, cid) == conn) {
+        wmem_map_remove(connections, cid);
+    }
+}
+
+/**
+ * Release a connection whose conversation was aged out in streaming mode.
+ * Packets of the connection that still arrive, for example on a migrated
+ * path, are no longer linked to it.
+ */
+static void
+quic_connection_evict(conversation_t *conv _U_, void *proto_data)
+{
+    quic_info_data_t *conn = (quic_info_data_t *)proto_data;
+    quic_cid_item_t *item, *next;
+
+    quic_cids_remove(quic_initial_connections, &conn->client_dcid_initial, conn);
+    for (item = &conn->client_cids; item; item = item->next) {
+        quic_cids_remove(quic_client_connections, &item->data, conn);
+    }
+    for (item = &conn->server_cids; item; item = item->next) {
+        quic_cids_remove(quic_server_connections, &item->data, conn);
+    }
+    /* The first items are part of the connection. */
+    for (item = conn->client_cids.next; item; item = next) {
+        next = item->next;
+        wmem_free(wmem_file_scope(), item);
+    }
+    for (item = conn->server_cids.next; item; item = next) {
+        next = item->next;
+        wmem_free(wmem_file_scope(), item);
+    }
+
+    wmem_list_remove(quic_connections, conn);
+    quic_connection_destroy(conn, NULL);
+    wmem_free(wmem_file_scope(), conn->client_pp.next_secret);
+    wmem_free(wmem_file_scope(), conn->server_pp.next_secret);
+    free_address_wmem(wmem_file_scope(), &conn->server_address);
+    wmem_free(wmem_file_scope(), conn);
+}
 /* QUIC Connection tracking. }}} */
 
 
@@ -2816,6 +2861,7 @@ proto_register_quic(void)
 
     register_init_routine(quic_init);
     register_cleanup_routine(quic_cleanup);
+    conversation_register_evict_func(proto_quic, quic_connection_evict);
 }
 
 void
@@ -49162,6 +49162,10 @@ dissect_rnsap(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
 	proto_item	*rnsap_item = NULL;
 	proto_tree	*rnsap_tree = NULL;
 
+	/* Register the fields if no name starting with "rnsap." was looked up yet */
+	if (hf_rnsap_transportLayerAddress_ipv4 == -1)
+		proto_registrar_get_byname("rnsap.transportLayerAddress_ipv4");
+
 	/* make entry in the Protocol column on summary display */
 	col_set_str(pinfo->cinfo, COL_PROTOCOL, "RNSAP");
 
@@ -49253,9 +49257,13 @@ dissect_sccp_rnsap_heur(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, voi
 }
 
 
-/*--- proto_register_rnsap -------------------------------------------*/
-void proto_register_rnsap(void) {
-
+/*
+ * There are thousands of fields; register them only once a name starting
+ * with "rnsap." is looked up, or the first RNSAP message is dissected.
+ */
+static void
+register_rnsap_fields(const char *unused _U_)
+{
   /* List of fields */
   static hf_register_info hf[] = {
     { &hf_rnsap_transportLayerAddress_ipv4,
@@ -61691,9 +61699,15 @@ void proto_register_rnsap(void) {
         "Outcome_value", HFILL }},
 
 /*--- End of included file: packet-rnsap-hfarr.c ---*/
-#line 257 "./asn1/rnsap/packet-rnsap-template.c"
+#line 265 "./asn1/rnsap/packet-rnsap-template.c"
   };
 
+  proto_register_field_array(proto_rnsap, hf, array_length(hf));
+}
+
+/*--- proto_register_rnsap -------------------------------------------*/
+void proto_register_rnsap(void) {
+
   /* List of subtrees */
   static gint *ett[] = {
     &ett_rnsap,
@@ -63131,14 +63145,14 @@ void proto_register_rnsap(void) {
     &ett_rnsap_Outcome,
 
 /*--- End of included file: packet-rnsap-ettarr.c ---*/
-#line 265 "./asn1/rnsap/packet-rnsap-template.c"
+#line 279 "./asn1/rnsap/packet-rnsap-template.c"
   };
 
 
   /* Register protocol */
   proto_rnsap = proto_register_protocol(PNAME, PSNAME, PFNAME);
-  /* Register fields and subtrees */
-  proto_register_field_array(proto_rnsap, hf, array_length(hf));
+  /* Register subtrees, and the fields on demand */
+  proto_register_prefix("rnsap", register_rnsap_fields);
   proto_register_subtree_array(ett, array_length(ett));
 
   /* Register dissector */
@@ -64091,7 +64105,7 @@ proto_reg_handoff_rnsap(void)
 
 
 /*--- End of included file: packet-rnsap-dis-tab.c ---*/
-#line 299 "./asn1/rnsap/packet-rnsap-template.c"
+#line 313 "./asn1/rnsap/packet-rnsap-template.c"
 }
 
 
@@ -6767,6 +6767,81 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
     return tvb_captured_length(tvb);
 }
 
+static void
+tcp_flow_free(tcp_flow_t *flow)
+{
+    tcp_unacked_t *ual, *next_ual;
+
+    wmem_tree_destroy(flow->multisegment_pdus, FALSE, TRUE);
+
+    if (flow->mptcp_subflow) {
+        wmem_tree_destroy(flow->mptcp_subflow->dsn2packet_map, TRUE, TRUE);
+        wmem_tree_destroy(flow->mptcp_subflow->ssn2dsn_mappings, TRUE, TRUE);
+        wmem_free(wmem_file_scope(), flow->mptcp_subflow);
+    }
+
+    if (flow->tcp_analyze_seq_info) {
+        for (ual = flow->tcp_analyze_seq_info->segments; ual; ual = next_ual) {
+            next_ual = ual->next;
+            wmem_free(wmem_file_scope(), ual);
+        }
+        wmem_free(wmem_file_scope(), flow->tcp_analyze_seq_info);
+    }
+
+    if (flow->process_info) {
+        wmem_free(wmem_file_scope(), flow->process_info->username);
+        wmem_free(wmem_file_scope(), flow->process_info->command);
+        wmem_free(wmem_file_scope(), flow->process_info);
+    }
+}
+
+/*
+ * Detach an evicted subflow from its MPTCP connection, and free the
+ * connection along with its last subflow.
+ */
+static void
+mptcp_detach_subflow(struct mptcp_analysis *mptcpd, struct tcp_analysis *tcpd)
+{
+    int i;
+
+    wmem_list_remove(mptcpd->subflows, tcpd);
+    if (mptcpd->master == tcpd)
+        mptcpd->master = NULL;
+
+    if (wmem_list_count(mptcpd->subflows) != 0)
+        return;
+
+    for (i = 0; i < 2; i++) {
+        mptcp_meta_flow_t *meta = &mptcpd->meta_flow[i];
+
+        if ((meta->static_flags & MPTCP_META_HAS_TOKEN) &&
+            wmem_tree_lookup32(mptcp_tokens, meta->token) == mptcpd)
+            wmem_tree_remove32(mptcp_tokens, meta->token);
+        free_address_wmem(wmem_file_scope(), &meta->ip_src);
+        free_address_wmem(wmem_file_scope(), &meta->ip_dst);
+    }
+    wmem_destroy_list(mptcpd->subflows);
+    wmem_free(wmem_file_scope(), mptcpd);
+}
+
+/*
+ * Free the analysis state of a conversation that was aged out in
+ * streaming mode.
+ */
+static void
+tcp_conversation_evict(conversation_t *conv _U_, void *proto_data)
+{
+    struct tcp_analysis *tcpd = (struct tcp_analysis *)proto_data;
+
+    if (tcpd->mptcp_analysis)
+        mptcp_detach_subflow(tcpd->mptcp_analysis, tcpd);
+
+    tcp_flow_free(&tcpd->flow1);
+    tcp_flow_free(&tcpd->flow2);
+    wmem_tree_destroy(tcpd->acked_table, FALSE, TRUE);
+    wmem_free(wmem_file_scope(), tcpd);
+}
+
 static void
 tcp_init(void)
 {
@@ -7792,6 +7867,7 @@ proto_register_tcp(void)
         &tcp_display_process_info);
 
     register_init_routine(tcp_init);
+    conversation_register_evict_func(proto_tcp, tcp_conversation_evict);
     reassembly_table_register(&tcp_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
 
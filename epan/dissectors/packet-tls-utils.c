@@ -2921,7 +2921,7 @@ static gboolean
 ssl_decoder_destroy_cb(wmem_allocator_t *, wmem_cb_event_t, void *);
 
 static SslDecoder*
-ssl_create_decoder(const SslCipherSuite *cipher_suite, gint cipher_algo,
+ssl_create_decoder(SslDecryptSession *ssl_session, const SslCipherSuite *cipher_suite, gint cipher_algo,
         gint compression, guint8 *mk, guint8 *sk, guint8 *iv, guint iv_length)
 {
     SslDecoder *dec;
@@ -2947,7 +2947,9 @@ ssl_create_decoder(const SslCipherSuite *cipher_suite, gint cipher_algo,
     }
     dec->seq = 0;
     dec->decomp = ssl_create_decompressor(compression);
-    wmem_register_callback(wmem_file_scope(), ssl_decoder_destroy_cb, dec);
+    dec->destroy_cb_id = wmem_register_callback(wmem_file_scope(), ssl_decoder_destroy_cb, dec);
+    dec->next = ssl_session->decoders;
+    ssl_session->decoders = dec;
 
     if (ssl_cipher_init(&dec->evp,cipher_algo,sk,iv,cipher_suite->mode) < 0) {
         ssl_debug_printf("%s: can't create cipher id:%d mode:%d\n", G_STRFUNC,
@@ -3481,13 +3483,13 @@ ssl_generate_keyring_material(SslDecryptSession*ssl_session)
 create_decoders:
     /* create both client and server ciphers*/
     ssl_debug_printf("%s ssl_create_decoder(client)\n", G_STRFUNC);
-    ssl_session->client_new = ssl_create_decoder(cipher_suite, cipher_algo, ssl_session->session.compression, c_mk, c_wk, c_iv, write_iv_len);
+    ssl_session->client_new = ssl_create_decoder(ssl_session, cipher_suite, cipher_algo, ssl_session->session.compression, c_mk, c_wk, c_iv, write_iv_len);
     if (!ssl_session->client_new) {
         ssl_debug_printf("%s can't init client decoder\n", G_STRFUNC);
         goto fail;
     }
     ssl_debug_printf("%s ssl_create_decoder(server)\n", G_STRFUNC);
-    ssl_session->server_new = ssl_create_decoder(cipher_suite, cipher_algo, ssl_session->session.compression, s_mk, s_wk, s_iv, write_iv_len);
+    ssl_session->server_new = ssl_create_decoder(ssl_session, cipher_suite, cipher_algo, ssl_session->session.compression, s_mk, s_wk, s_iv, write_iv_len);
     if (!ssl_session->server_new) {
         ssl_debug_printf("%s can't init client decoder\n", G_STRFUNC);
         goto fail;
@@ -3571,7 +3573,7 @@ tls13_generate_keys(SslDecryptSession *ssl_session, const StringInfo *secret, gb
     ssl_print_data(is_from_server ? "Server Write IV" : "Client Write IV", write_iv, iv_length);
 
     ssl_debug_printf("%s ssl_create_decoder(%s)\n", G_STRFUNC, is_from_server ? "server" : "client");
-    decoder = ssl_create_decoder(cipher_suite, cipher_algo, 0, NULL, write_key, write_iv, iv_length);
+    decoder = ssl_create_decoder(ssl_session, cipher_suite, cipher_algo, 0, NULL, write_key, write_iv, iv_length);
     if (!decoder) {
         ssl_debug_printf("%s can't init %s decoder\n", G_STRFUNC, is_from_server ? "server" : "client");
         goto end;
@@ -4387,6 +4389,45 @@ ssl_get_session(conversation_t *conversation, dissector_handle_t tls_handle)
     return ssl_session;
 }
 
+void
+ssl_session_evict(conversation_t *conversation _U_, void *proto_data)
+{
+    SslDecryptSession *ssl = (SslDecryptSession *)proto_data;
+    SslDecoder *dec, *next;
+    GHashTable *flows;
+    GHashTableIter iter;
+    gpointer flow;
+
+    /* Successive decoders of one direction share their flow. */
+    flows = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (dec = ssl->decoders; dec; dec = next) {
+        next = dec->next;
+        if (dec->flow)
+            g_hash_table_add(flows, dec->flow);
+        wmem_unregister_callback(wmem_file_scope(), dec->destroy_cb_id);
+        ssl_decoder_destroy_cb(wmem_file_scope(), WMEM_CB_DESTROY_EVENT, dec);
+        wmem_free(wmem_file_scope(), dec->decomp);
+        wmem_free(wmem_file_scope(), dec->app_traffic_secret.data);
+        wmem_free(wmem_file_scope(), dec);
+    }
+    g_hash_table_iter_init(&iter, flows);
+    while (g_hash_table_iter_next(&iter, &flow, NULL)) {
+        wmem_tree_destroy(((SslFlow *)flow)->multisegment_pdus, FALSE, TRUE);
+        wmem_free(wmem_file_scope(), flow);
+    }
+    g_hash_table_destroy(flows);
+
+    wmem_free(wmem_file_scope(), ssl->session_ticket.data);
+    wmem_free(wmem_file_scope(), ssl->handshake_data.data);
+    wmem_free(wmem_file_scope(), ssl->pre_master_secret.data);
+    wmem_free(wmem_file_scope(), ssl->psk.data);
+#if defined(HAVE_LIBGNUTLS)
+    wmem_free(wmem_file_scope(), ssl->cert_key_id);
+#endif
+    free_address_wmem(wmem_file_scope(), &ssl->session.srv_addr);
+    wmem_free(wmem_file_scope(), ssl);
+}
+
 /* Resets the decryption parameters for the next decoder. */
 static void ssl_reset_session(SslSession *session, SslDecryptSession *ssl, gboolean is_client)
 {
@@ -306,6 +306,8 @@ typedef struct _SslDecoder {
     guint16 epoch;
     SslFlow *flow;
     StringInfo app_traffic_secret;  /**< TLS 1.3 application traffic secret (if applicable), wmem file scope. */
+    guint destroy_cb_id;    /**< Callback that releases the cipher state with the file scope. */
+    struct _SslDecoder *next;   /**< The decoder created before this one for the same session. */
 } SslDecoder;
 
 /*
@@ -454,6 +456,7 @@ typedef struct _SslDecryptSession {
     SslDecoder *client;
     SslDecoder *server_new;
     SslDecoder *client_new;
+    SslDecoder *decoders;   /**< All decoders created for this session, newest first. */
 #if defined(HAVE_LIBGNUTLS)
     struct cert_key_id *cert_key_id;   /**< SHA-1 Key ID of public key in certificate. */
 #endif
@@ -519,6 +522,12 @@ gchar* ssl_association_info(const char* dissector_table_name, const char* table_
 extern SslDecryptSession *
 ssl_get_session(conversation_t *conversation, dissector_handle_t ssl_handle);
 
+/** Release a SslDecryptSession when its conversation is evicted in
+ * streaming mode, see conversation_register_evict_func().
+ */
+extern void
+ssl_session_evict(conversation_t *conversation, void *proto_data);
+
 /** Set server address and port */
 extern void
 ssl_set_server(SslSession *session, address *addr, port_type ptype, guint32 port);
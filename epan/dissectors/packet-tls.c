@@ -4523,6 +4523,7 @@ proto_register_tls(void)
 
     register_init_routine(ssl_init);
     register_cleanup_routine(ssl_cleanup);
+    conversation_register_evict_func(proto_tls, ssl_session_evict);
     reassembly_table_register(&ssl_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
     reassembly_table_register(&tls_hs_reassembly_table,
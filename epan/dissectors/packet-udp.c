@@ -243,6 +243,21 @@ init_udp_conversation_data(packet_info *pinfo)
   return udpd;
 }
 
+/*
+ * Free the state of a conversation that was aged out in streaming mode.
+ */
+static void
+udp_conversation_evict(conversation_t *conv _U_, void *proto_data)
+{
+  struct udp_analysis *udpd = (struct udp_analysis *)proto_data;
+
+  wmem_free(wmem_file_scope(), udpd->flow1.username);
+  wmem_free(wmem_file_scope(), udpd->flow1.command);
+  wmem_free(wmem_file_scope(), udpd->flow2.username);
+  wmem_free(wmem_file_scope(), udpd->flow2.command);
+  wmem_free(wmem_file_scope(), udpd);
+}
+
 struct udp_analysis *
 get_udp_conversation_data(conversation_t *conv, packet_info *pinfo)
 {
@@ -1370,6 +1385,7 @@ proto_register_udp(void)
                          udp_port_to_display, follow_tvb_tap_listener);
 
   register_init_routine(udp_init);
+  conversation_register_evict_func(proto_udp, udp_conversation_evict);
 
 }
 
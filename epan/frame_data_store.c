@@ -0,0 +1,650 @@
+/* frame_data_store.c
+ * A compact, column-oriented store of per-frame data
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <wsutil/bits_count_ones.h>
+#include <wsutil/bits_ctz.h>
+
+#include "frame_data_store.h"
+
+/*
+ * Frames are kept in blocks of 1024, like the leaves of the radix tree
+ * of a frame_data_sequence. A block starts out with its frames' wide
+ * attributes in an array of wide_frame structures, and is packed into
+ * columns when it's full.
+ */
+#define LOG2_FRAMES_PER_BLOCK   10
+#define FRAMES_PER_BLOCK        (1<<LOG2_FRAMES_PER_BLOCK)
+#define BLOCK_INDEX(idx)        ((idx) >> LOG2_FRAMES_PER_BLOCK)
+#define FRAME_INDEX(idx)        ((idx) & (FRAMES_PER_BLOCK - 1))
+#define WORDS_PER_BITSET        (FRAMES_PER_BLOCK / 64)
+
+#define NSECS_PER_SEC           1000000000
+
+/* The attributes that are packed */
+typedef enum {
+  COL_PKT_LEN,
+  COL_CAP_TRUNC,        /* pkt_len - cap_len */
+  COL_FILE_OFF,
+  COL_TS,               /* abs_ts, in ts_unit ns since ts_base_secs */
+  COL_SHIFT_SECS,
+  COL_SHIFT_NSECS,
+  COL_SUBNUM,
+  COL_TSPREC,
+  NUM_COLUMNS
+} column_id;
+
+typedef struct {
+  gint64       file_off;
+  nstime_t     abs_ts;
+  nstime_t     shift_offset;
+  guint32      pkt_len;
+  guint32      cap_len;
+  guint16      subnum;
+  guint8       tsprec;
+} wide_frame;
+
+typedef struct {
+  gint64       base;            /* The smallest value in the block */
+  guint        width;           /* Bytes per value above base: 0, 1, 2, 4 or 8 */
+  void        *data;
+} packed_column;
+
+typedef struct {
+  wide_frame    *wide;          /* NULL once the block is packed */
+  packed_column  cols[NUM_COLUMNS];
+  time_t         ts_base_secs;
+  gint32         ts_unit;
+  guint64        flags[FRAME_DATA_NUM_FLAGS][WORDS_PER_BITSET];
+  guint32        cum_bytes[FRAMES_PER_BLOCK];
+  guint32        frame_ref_num[FRAMES_PER_BLOCK];
+  guint32        prev_dis_num[FRAMES_PER_BLOCK];
+  guint16        color[FRAMES_PER_BLOCK];
+} frame_block;
+
+struct _frame_data_store {
+  guint32      count;           /* Total number of frames */
+  GPtrArray   *blocks;          /* frame_block */
+  GPtrArray   *color_filters;   /* Color filters by index; 0 is none */
+  GHashTable  *color_index;     /* Color filter -> index */
+  GHashTable  *pfds;            /* Frame number -> per frame proto data */
+};
+
+static inline frame_block *
+get_block(const frame_data_store *fdst, guint32 idx)
+{
+  return (frame_block *)g_ptr_array_index(fdst->blocks, BLOCK_INDEX(idx));
+}
+
+static guint
+frames_in_block(const frame_data_store *fdst, guint block_idx)
+{
+  guint64 first = (guint64)block_idx << LOG2_FRAMES_PER_BLOCK;
+
+  return (guint)MIN(FRAMES_PER_BLOCK, fdst->count - first);
+}
+
+static inline gboolean
+block_flag(const frame_block *b, frame_data_flag flag, guint i)
+{
+  return (b->flags[flag][i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void
+block_set_flag(frame_block *b, frame_data_flag flag, guint i, gboolean value)
+{
+  guint64 bit = G_GUINT64_CONSTANT(1) << (i & 63);
+
+  if (value)
+    b->flags[flag][i >> 6] |= bit;
+  else
+    b->flags[flag][i >> 6] &= ~bit;
+}
+
+static inline gint64
+column_get(const packed_column *col, guint i)
+{
+  guint64 v;
+
+  switch (col->width) {
+  case 0:
+    return col->base;
+  case 1:
+    v = ((const guint8 *)col->data)[i];
+    break;
+  case 2:
+    v = ((const guint16 *)col->data)[i];
+    break;
+  case 4:
+    v = ((const guint32 *)col->data)[i];
+    break;
+  default:
+    v = ((const guint64 *)col->data)[i];
+    break;
+  }
+  return (gint64)((guint64)col->base + v);
+}
+
+static inline void
+packed_get_ts(const frame_block *b, guint i, nstime_t *ts)
+{
+  guint64 v = (guint64)column_get(&b->cols[COL_TS], i);
+  guint64 units_per_sec = NSECS_PER_SEC / b->ts_unit;
+
+  ts->secs = b->ts_base_secs + (time_t)(v / units_per_sec);
+  ts->nsecs = (int)(v % units_per_sec) * b->ts_unit;
+}
+
+/* Get the wide attributes of frame i of a packed block */
+static void
+unpack_frame(const frame_block *b, guint i, wide_frame *w)
+{
+  w->pkt_len = (guint32)column_get(&b->cols[COL_PKT_LEN], i);
+  w->cap_len = (guint32)(w->pkt_len - column_get(&b->cols[COL_CAP_TRUNC], i));
+  w->file_off = column_get(&b->cols[COL_FILE_OFF], i);
+  packed_get_ts(b, i, &w->abs_ts);
+  w->shift_offset.secs = (time_t)column_get(&b->cols[COL_SHIFT_SECS], i);
+  w->shift_offset.nsecs = (int)column_get(&b->cols[COL_SHIFT_NSECS], i);
+  w->subnum = (guint16)column_get(&b->cols[COL_SUBNUM], i);
+  w->tsprec = (guint8)column_get(&b->cols[COL_TSPREC], i);
+}
+
+/*
+ * The time stamps are compared field by field: nstime_cmp() truncates the
+ * difference of the seconds to an int, and treats unset times as equal.
+ */
+static gboolean
+wide_frame_equal(const wide_frame *a, const wide_frame *b)
+{
+  return a->pkt_len == b->pkt_len && a->cap_len == b->cap_len &&
+         a->file_off == b->file_off &&
+         a->abs_ts.secs == b->abs_ts.secs && a->abs_ts.nsecs == b->abs_ts.nsecs &&
+         a->shift_offset.secs == b->shift_offset.secs &&
+         a->shift_offset.nsecs == b->shift_offset.nsecs &&
+         a->subnum == b->subnum && a->tsprec == b->tsprec;
+}
+
+static gint64
+wide_value(const frame_block *b, column_id col, guint i)
+{
+  const wide_frame *w = &b->wide[i];
+
+  switch (col) {
+  case COL_PKT_LEN:
+    return w->pkt_len;
+  case COL_CAP_TRUNC:
+    return (gint64)w->pkt_len - w->cap_len;
+  case COL_FILE_OFF:
+    return w->file_off;
+  case COL_TS:
+    return (gint64)(w->abs_ts.secs - b->ts_base_secs) * (NSECS_PER_SEC / b->ts_unit) +
+           w->abs_ts.nsecs / b->ts_unit;
+  case COL_SHIFT_SECS:
+    return w->shift_offset.secs;
+  case COL_SHIFT_NSECS:
+    return w->shift_offset.nsecs;
+  case COL_SUBNUM:
+    return w->subnum;
+  default:
+    return w->tsprec;
+  }
+}
+
+/*
+ * Pack the first n frames of a block, unless their time stamps are too far
+ * apart or not normalized, in which case the block stays as it is.
+ */
+static void
+pack_block(frame_block *b, guint n)
+{
+  time_t min_secs, max_secs;
+  gint64 v, min, max;
+  guint64 span;
+  guint i, c, width;
+
+  if (b->wide == NULL || n == 0)
+    return;
+
+  /* Time stamps are counted in the coarsest unit they're all a multiple of */
+  min_secs = max_secs = b->wide[0].abs_ts.secs;
+  b->ts_unit = NSECS_PER_SEC;
+  for (i = 0; i < n; i++) {
+    const nstime_t *ts = &b->wide[i].abs_ts;
+
+    if (ts->nsecs < 0 || ts->nsecs >= NSECS_PER_SEC)
+      return;
+    min_secs = MIN(min_secs, ts->secs);
+    max_secs = MAX(max_secs, ts->secs);
+    while (ts->nsecs % b->ts_unit != 0)
+      b->ts_unit /= 1000;
+  }
+  if ((guint64)max_secs - (guint64)min_secs > G_MAXUINT32)
+    return;
+  b->ts_base_secs = min_secs;
+
+  for (c = 0; c < NUM_COLUMNS; c++) {
+    packed_column *col = &b->cols[c];
+
+    min = max = wide_value(b, (column_id)c, 0);
+    for (i = 1; i < n; i++) {
+      v = wide_value(b, (column_id)c, i);
+      min = MIN(min, v);
+      max = MAX(max, v);
+    }
+    span = (guint64)max - (guint64)min;
+    width = span == 0 ? 0 : span <= G_MAXUINT8 ? 1 : span <= G_MAXUINT16 ? 2 :
+            span <= G_MAXUINT32 ? 4 : 8;
+
+    col->base = min;
+    col->width = width;
+    col->data = width ? g_malloc(n * width) : NULL;
+    for (i = 0; i < n; i++) {
+      guint64 d = (guint64)wide_value(b, (column_id)c, i) - (guint64)min;
+
+      switch (width) {
+      case 0:
+        break;
+      case 1:
+        ((guint8 *)col->data)[i] = (guint8)d;
+        break;
+      case 2:
+        ((guint16 *)col->data)[i] = (guint16)d;
+        break;
+      case 4:
+        ((guint32 *)col->data)[i] = (guint32)d;
+        break;
+      default:
+        ((guint64 *)col->data)[i] = d;
+        break;
+      }
+    }
+  }
+
+  g_free(b->wide);
+  b->wide = NULL;
+}
+
+static void
+unpack_block(frame_data_store *fdst, guint block_idx)
+{
+  frame_block *b = (frame_block *)g_ptr_array_index(fdst->blocks, block_idx);
+  guint n = frames_in_block(fdst, block_idx);
+  guint i, c;
+
+  b->wide = g_new(wide_frame, FRAMES_PER_BLOCK);
+  for (i = 0; i < n; i++)
+    unpack_frame(b, i, &b->wide[i]);
+
+  for (c = 0; c < NUM_COLUMNS; c++) {
+    g_free(b->cols[c].data);
+    b->cols[c].data = NULL;
+    b->cols[c].width = 0;
+  }
+}
+
+static guint16
+get_color_index(frame_data_store *fdst, const struct _color_filter *color_filter)
+{
+  gpointer idx;
+
+  if (color_filter == NULL)
+    return 0;
+
+  if (g_hash_table_lookup_extended(fdst->color_index, color_filter, NULL, &idx))
+    return (guint16)GPOINTER_TO_UINT(idx);
+
+  g_assert(fdst->color_filters->len <= G_MAXUINT16);
+  idx = GUINT_TO_POINTER(fdst->color_filters->len);
+  g_ptr_array_add(fdst->color_filters, (gpointer)color_filter);
+  g_hash_table_insert(fdst->color_index, (gpointer)color_filter, idx);
+  return (guint16)GPOINTER_TO_UINT(idx);
+}
+
+/* Store all attributes of fdata as frame idx */
+static void
+store_frame(frame_data_store *fdst, guint32 idx, const frame_data *fdata)
+{
+  frame_block *b = get_block(fdst, idx);
+  guint i = FRAME_INDEX(idx);
+  wide_frame w, cur;
+
+  w.pkt_len = fdata->pkt_len;
+  w.cap_len = fdata->cap_len;
+  w.file_off = fdata->file_off;
+  w.abs_ts = fdata->abs_ts;
+  w.shift_offset = fdata->shift_offset;
+  w.subnum = fdata->subnum;
+  w.tsprec = fdata->tsprec;
+  if (b->wide == NULL) {
+    /* Most changes are to the other attributes */
+    unpack_frame(b, i, &cur);
+    if (!wide_frame_equal(&w, &cur))
+      unpack_block(fdst, BLOCK_INDEX(idx));
+  }
+  if (b->wide != NULL)
+    b->wide[i] = w;
+
+  block_set_flag(b, FRAME_DATA_PASSED_DFILTER, i, fdata->passed_dfilter);
+  block_set_flag(b, FRAME_DATA_DEPENDENT_OF_DISPLAYED, i, fdata->dependent_of_displayed);
+  block_set_flag(b, FRAME_DATA_ENCODING, i, fdata->encoding);
+  block_set_flag(b, FRAME_DATA_VISITED, i, fdata->visited);
+  block_set_flag(b, FRAME_DATA_MARKED, i, fdata->marked);
+  block_set_flag(b, FRAME_DATA_REF_TIME, i, fdata->ref_time);
+  block_set_flag(b, FRAME_DATA_IGNORED, i, fdata->ignored);
+  block_set_flag(b, FRAME_DATA_HAS_TS, i, fdata->has_ts);
+  block_set_flag(b, FRAME_DATA_HAS_PHDR_COMMENT, i, fdata->has_phdr_comment);
+  block_set_flag(b, FRAME_DATA_HAS_USER_COMMENT, i, fdata->has_user_comment);
+  block_set_flag(b, FRAME_DATA_NEED_COLORIZE, i, fdata->need_colorize);
+
+  b->cum_bytes[i] = fdata->cum_bytes;
+  b->frame_ref_num[i] = fdata->frame_ref_num;
+  b->prev_dis_num[i] = fdata->prev_dis_num;
+  b->color[i] = get_color_index(fdst, fdata->color_filter);
+
+  /* The lists are shared with fdata, so the old one isn't freed here */
+  if (fdata->pfd)
+    g_hash_table_insert(fdst->pfds, GUINT_TO_POINTER(idx + 1), fdata->pfd);
+  else
+    g_hash_table_remove(fdst->pfds, GUINT_TO_POINTER(idx + 1));
+}
+
+frame_data_store *
+frame_data_store_new(void)
+{
+  frame_data_store *fdst;
+
+  fdst = g_new(frame_data_store, 1);
+  fdst->count = 0;
+  fdst->blocks = g_ptr_array_new();
+  fdst->color_filters = g_ptr_array_new();
+  g_ptr_array_add(fdst->color_filters, NULL);
+  fdst->color_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+  fdst->pfds = g_hash_table_new(g_direct_hash, g_direct_equal);
+  return fdst;
+}
+
+void
+frame_data_store_free(frame_data_store *fdst)
+{
+  GHashTableIter iter;
+  gpointer pfd;
+  frame_block *b;
+  guint i, c;
+
+  for (i = 0; i < fdst->blocks->len; i++) {
+    b = (frame_block *)g_ptr_array_index(fdst->blocks, i);
+    g_free(b->wide);
+    for (c = 0; c < NUM_COLUMNS; c++)
+      g_free(b->cols[c].data);
+    g_free(b);
+  }
+  g_ptr_array_free(fdst->blocks, TRUE);
+
+  g_hash_table_iter_init(&iter, fdst->pfds);
+  while (g_hash_table_iter_next(&iter, NULL, &pfd))
+    g_slist_free((GSList *)pfd);
+  g_hash_table_destroy(fdst->pfds);
+
+  g_hash_table_destroy(fdst->color_index);
+  g_ptr_array_free(fdst->color_filters, TRUE);
+  g_free(fdst);
+}
+
+guint32
+frame_data_store_count(const frame_data_store *fdst)
+{
+  return fdst->count;
+}
+
+void
+frame_data_store_add(frame_data_store *fdst, const frame_data *fdata)
+{
+  guint32 idx = fdst->count;
+  frame_block *b;
+
+  g_assert(fdst->count < G_MAXUINT32);
+
+  if (FRAME_INDEX(idx) == 0) {
+    b = g_new0(frame_block, 1);
+    b->wide = g_new(wide_frame, FRAMES_PER_BLOCK);
+    g_ptr_array_add(fdst->blocks, b);
+  } else {
+    b = get_block(fdst, idx);
+    if (b->wide == NULL) {
+      /* The partial block was packed by frame_data_store_compact() */
+      unpack_block(fdst, BLOCK_INDEX(idx));
+    }
+  }
+
+  fdst->count++;
+  store_frame(fdst, idx, fdata);
+
+  if (FRAME_INDEX(idx) == FRAMES_PER_BLOCK - 1)
+    pack_block(b, FRAMES_PER_BLOCK);
+}
+
+gboolean
+frame_data_store_get(const frame_data_store *fdst, guint32 num, frame_data *fdata)
+{
+  const frame_block *b;
+  wide_frame w;
+  guint i;
+
+  if (num == 0 || num > fdst->count)
+    return FALSE;
+
+  b = get_block(fdst, num - 1);
+  i = FRAME_INDEX(num - 1);
+  if (b->wide)
+    w = b->wide[i];
+  else
+    unpack_frame(b, i, &w);
+
+  fdata->num = num;
+  fdata->pkt_len = w.pkt_len;
+  fdata->cap_len = w.cap_len;
+  fdata->cum_bytes = b->cum_bytes[i];
+  fdata->file_off = w.file_off;
+  fdata->pfd = (GSList *)g_hash_table_lookup(fdst->pfds, GUINT_TO_POINTER(num));
+  fdata->color_filter = (const struct _color_filter *)g_ptr_array_index(fdst->color_filters, b->color[i]);
+  fdata->subnum = w.subnum;
+  fdata->passed_dfilter = block_flag(b, FRAME_DATA_PASSED_DFILTER, i);
+  fdata->dependent_of_displayed = block_flag(b, FRAME_DATA_DEPENDENT_OF_DISPLAYED, i);
+  fdata->encoding = block_flag(b, FRAME_DATA_ENCODING, i);
+  fdata->visited = block_flag(b, FRAME_DATA_VISITED, i);
+  fdata->marked = block_flag(b, FRAME_DATA_MARKED, i);
+  fdata->ref_time = block_flag(b, FRAME_DATA_REF_TIME, i);
+  fdata->ignored = block_flag(b, FRAME_DATA_IGNORED, i);
+  fdata->has_ts = block_flag(b, FRAME_DATA_HAS_TS, i);
+  fdata->has_phdr_comment = block_flag(b, FRAME_DATA_HAS_PHDR_COMMENT, i);
+  fdata->has_user_comment = block_flag(b, FRAME_DATA_HAS_USER_COMMENT, i);
+  fdata->need_colorize = block_flag(b, FRAME_DATA_NEED_COLORIZE, i);
+  fdata->tsprec = w.tsprec;
+  fdata->abs_ts = w.abs_ts;
+  fdata->shift_offset = w.shift_offset;
+  fdata->frame_ref_num = b->frame_ref_num[i];
+  fdata->prev_dis_num = b->prev_dis_num[i];
+  return TRUE;
+}
+
+void
+frame_data_store_put(frame_data_store *fdst, const frame_data *fdata)
+{
+  g_assert(fdata->num != 0 && fdata->num <= fdst->count);
+
+  store_frame(fdst, fdata->num - 1, fdata);
+}
+
+guint32
+frame_data_store_get_pkt_len(const frame_data_store *fdst, guint32 num)
+{
+  const frame_block *b;
+  guint i;
+
+  g_assert(num != 0 && num <= fdst->count);
+
+  b = get_block(fdst, num - 1);
+  i = FRAME_INDEX(num - 1);
+  if (b->wide)
+    return b->wide[i].pkt_len;
+  return (guint32)column_get(&b->cols[COL_PKT_LEN], i);
+}
+
+guint32
+frame_data_store_get_cap_len(const frame_data_store *fdst, guint32 num)
+{
+  const frame_block *b;
+  guint i;
+
+  g_assert(num != 0 && num <= fdst->count);
+
+  b = get_block(fdst, num - 1);
+  i = FRAME_INDEX(num - 1);
+  if (b->wide)
+    return b->wide[i].cap_len;
+  return (guint32)(column_get(&b->cols[COL_PKT_LEN], i) - column_get(&b->cols[COL_CAP_TRUNC], i));
+}
+
+guint32
+frame_data_store_get_cum_bytes(const frame_data_store *fdst, guint32 num)
+{
+  g_assert(num != 0 && num <= fdst->count);
+
+  return get_block(fdst, num - 1)->cum_bytes[FRAME_INDEX(num - 1)];
+}
+
+gint64
+frame_data_store_get_file_off(const frame_data_store *fdst, guint32 num)
+{
+  const frame_block *b;
+  guint i;
+
+  g_assert(num != 0 && num <= fdst->count);
+
+  b = get_block(fdst, num - 1);
+  i = FRAME_INDEX(num - 1);
+  if (b->wide)
+    return b->wide[i].file_off;
+  return column_get(&b->cols[COL_FILE_OFF], i);
+}
+
+void
+frame_data_store_get_abs_ts(const frame_data_store *fdst, guint32 num, nstime_t *abs_ts)
+{
+  const frame_block *b;
+  guint i;
+
+  g_assert(num != 0 && num <= fdst->count);
+
+  b = get_block(fdst, num - 1);
+  i = FRAME_INDEX(num - 1);
+  if (b->wide)
+    *abs_ts = b->wide[i].abs_ts;
+  else
+    packed_get_ts(b, i, abs_ts);
+}
+
+gboolean
+frame_data_store_get_flag(const frame_data_store *fdst, guint32 num, frame_data_flag flag)
+{
+  g_assert(num != 0 && num <= fdst->count);
+
+  return block_flag(get_block(fdst, num - 1), flag, FRAME_INDEX(num - 1));
+}
+
+void
+frame_data_store_set_flag(frame_data_store *fdst, guint32 num, frame_data_flag flag, gboolean value)
+{
+  g_assert(num != 0 && num <= fdst->count);
+
+  block_set_flag(get_block(fdst, num - 1), flag, FRAME_INDEX(num - 1), value);
+}
+
+guint32
+frame_data_store_find_flag(const frame_data_store *fdst, guint32 num, frame_data_flag flag)
+{
+  const frame_block *b;
+  guint64 idx, word;
+  guint i;
+
+  for (idx = num ? num - 1 : 0; idx < fdst->count; idx = (idx | 63) + 1) {
+    b = get_block(fdst, (guint32)idx);
+    i = FRAME_INDEX((guint32)idx);
+    /* The bits of the frames before idx in the word are masked off */
+    word = b->flags[flag][i >> 6] & (G_MAXUINT64 << (i & 63));
+    if (word != 0) {
+      /* Bits past the last frame are never set */
+      return (guint32)((idx & ~G_GUINT64_CONSTANT(63)) + ws_ctz(word) + 1);
+    }
+  }
+  return 0;
+}
+
+guint32
+frame_data_store_count_flag(const frame_data_store *fdst, frame_data_flag flag)
+{
+  const frame_block *b;
+  guint32 count = 0;
+  guint i, w;
+
+  for (i = 0; i < fdst->blocks->len; i++) {
+    b = (const frame_block *)g_ptr_array_index(fdst->blocks, i);
+    for (w = 0; w < WORDS_PER_BITSET; w++)
+      count += ws_count_ones(b->flags[flag][w]);
+  }
+  return count;
+}
+
+void
+frame_data_store_compact(frame_data_store *fdst)
+{
+  guint i;
+
+  for (i = 0; i < fdst->blocks->len; i++)
+    pack_block((frame_block *)g_ptr_array_index(fdst->blocks, i), frames_in_block(fdst, i));
+}
+
+gsize
+frame_data_store_memory(const frame_data_store *fdst)
+{
+  const frame_block *b;
+  gsize size;
+  guint i, c;
+
+  size = sizeof *fdst + fdst->blocks->len * sizeof(gpointer);
+  for (i = 0; i < fdst->blocks->len; i++) {
+    b = (const frame_block *)g_ptr_array_index(fdst->blocks, i);
+    size += sizeof *b;
+    if (b->wide)
+      size += FRAMES_PER_BLOCK * sizeof(wide_frame);
+    for (c = 0; c < NUM_COLUMNS; c++)
+      size += (gsize)frames_in_block(fdst, i) * b->cols[c].width;
+  }
+  /* A hash table entry is a key, a value and a hash */
+  size += g_hash_table_size(fdst->pfds) * (2 * sizeof(gpointer) + sizeof(guint));
+  size += fdst->color_filters->len * (3 * sizeof(gpointer) + sizeof(guint));
+  return size;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,163 @@
+/* frame_data_store.h
+ * A compact, column-oriented store of per-frame data
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_DATA_STORE_H__
+#define __FRAME_DATA_STORE_H__
+
+#include <ws_symbol_export.h>
+#include <epan/frame_data.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ * An alternative to frame_data_sequence for very large captures.
+ *
+ * frame_data_sequence keeps a whole frame_data for every frame, about 90
+ * bytes each. A frame_data_store keeps the same information in arrays of
+ * 1024 frames per attribute instead:
+ *
+ * - the lengths, file offset, time stamp, time shift, subframe number and
+ *   time stamp precision of a full block are stored as the difference from
+ *   the smallest value in the block, in as few bytes as the largest
+ *   difference needs, or none if they are all the same;
+ * - the one-bit attributes are bitsets;
+ * - the color filter is an index into a table of the color filters seen;
+ * - per frame proto data lists are kept in a hash table by frame number,
+ *   for the frames that have one.
+ *
+ * That takes a frame down to about a third of a frame_data, and a scan
+ * over one attribute reads only that attribute's array.
+ *
+ * As the frames are not stored as frame_data structures, there are no
+ * pointers to them. Frames are copied into a frame_data with
+ * frame_data_store_get() and changes are written back with
+ * frame_data_store_put(), or single attributes are read and written with
+ * the other accessors.
+ */
+
+typedef struct _frame_data_store frame_data_store;
+
+/** The one-bit attributes of a frame. */
+typedef enum {
+  FRAME_DATA_PASSED_DFILTER,
+  FRAME_DATA_DEPENDENT_OF_DISPLAYED,
+  FRAME_DATA_ENCODING,
+  FRAME_DATA_VISITED,
+  FRAME_DATA_MARKED,
+  FRAME_DATA_REF_TIME,
+  FRAME_DATA_IGNORED,
+  FRAME_DATA_HAS_TS,
+  FRAME_DATA_HAS_PHDR_COMMENT,
+  FRAME_DATA_HAS_USER_COMMENT,
+  FRAME_DATA_NEED_COLORIZE,
+  FRAME_DATA_NUM_FLAGS
+} frame_data_flag;
+
+WS_DLL_PUBLIC frame_data_store *frame_data_store_new(void);
+
+/*
+ * Free a frame_data_store, including the per frame proto data lists of
+ * its frames.
+ */
+WS_DLL_PUBLIC void frame_data_store_free(frame_data_store *fdst);
+
+WS_DLL_PUBLIC guint32 frame_data_store_count(const frame_data_store *fdst);
+
+/*
+ * Add a copy of fdata as the next frame; frames are numbered from 1 in
+ * the order they're added, like in a frame_data_sequence. The store takes
+ * over fdata's per frame proto data list.
+ */
+WS_DLL_PUBLIC void frame_data_store_add(frame_data_store *fdst,
+    const frame_data *fdata);
+
+/*
+ * Copy frame num into fdata. Returns FALSE if there is no such frame.
+ */
+WS_DLL_PUBLIC gboolean frame_data_store_get(const frame_data_store *fdst,
+    guint32 num, frame_data *fdata);
+
+/*
+ * Write back a frame got with frame_data_store_get(), which may have been
+ * changed, e.g. by dissecting it.
+ */
+WS_DLL_PUBLIC void frame_data_store_put(frame_data_store *fdst,
+    const frame_data *fdata);
+
+/*
+ * Accessors for single attributes of frame num, which must exist.
+ */
+WS_DLL_PUBLIC guint32 frame_data_store_get_pkt_len(const frame_data_store *fdst,
+    guint32 num);
+
+WS_DLL_PUBLIC guint32 frame_data_store_get_cap_len(const frame_data_store *fdst,
+    guint32 num);
+
+WS_DLL_PUBLIC guint32 frame_data_store_get_cum_bytes(const frame_data_store *fdst,
+    guint32 num);
+
+WS_DLL_PUBLIC gint64 frame_data_store_get_file_off(const frame_data_store *fdst,
+    guint32 num);
+
+WS_DLL_PUBLIC void frame_data_store_get_abs_ts(const frame_data_store *fdst,
+    guint32 num, nstime_t *abs_ts);
+
+WS_DLL_PUBLIC gboolean frame_data_store_get_flag(const frame_data_store *fdst,
+    guint32 num, frame_data_flag flag);
+
+WS_DLL_PUBLIC void frame_data_store_set_flag(frame_data_store *fdst,
+    guint32 num, frame_data_flag flag, gboolean value);
+
+/*
+ * Find the first frame, starting at frame num, that has flag set, e.g. the
+ * next displayed or marked frame. Returns 0 if there is none.
+ */
+WS_DLL_PUBLIC guint32 frame_data_store_find_flag(const frame_data_store *fdst,
+    guint32 num, frame_data_flag flag);
+
+/*
+ * Count the frames that have flag set.
+ */
+WS_DLL_PUBLIC guint32 frame_data_store_count_flag(const frame_data_store *fdst,
+    frame_data_flag flag);
+
+/*
+ * Blocks of frames whose attributes no longer fit their packed arrays
+ * after frame_data_store_put(), e.g. after shifting the time stamps, and
+ * the last block of frames, if it isn't full, are kept unpacked. Pack them
+ * again, e.g. when all frames have been read or shifted.
+ */
+WS_DLL_PUBLIC void frame_data_store_compact(frame_data_store *fdst);
+
+/*
+ * The approximate number of bytes used by the store.
+ */
+WS_DLL_PUBLIC gsize frame_data_store_memory(const frame_data_store *fdst);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_DATA_STORE_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
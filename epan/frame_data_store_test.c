@@ -0,0 +1,391 @@
+/* frame_data_store_test.c
+ * Tests for the compact frame_data store
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "frame_data_store.h"
+
+/* Two full blocks and part of a third. */
+#define TEST_FRAMES     (2 * 1024 + 100)
+
+/* Stand-ins for color filters; the store only compares the pointers. */
+static int test_colors[3];
+
+/*
+ * Fills in frame num so that, within a block, each packed attribute spans
+ * about as many bytes as width.
+ */
+static void
+test_frame(frame_data *fdata, guint32 num, guint width)
+{
+    guint64 span, v;
+
+    switch (width) {
+    case 0:
+        span = 0;
+        break;
+    case 1:
+        span = 200;
+        break;
+    case 2:
+        span = 60000;
+        break;
+    case 4:
+        span = 4000000000U;
+        break;
+    default:
+        span = G_GUINT64_CONSTANT(1000000000000000);
+        break;
+    }
+    v = span ? (num * G_GUINT64_CONSTANT(2654435761)) % (span + 1) : 0;
+
+    memset(fdata, 0, sizeof *fdata);
+    fdata->num = num;
+    fdata->pkt_len = 60 + (guint32)MIN(v, G_MAXUINT32 - 60);
+    fdata->cap_len = fdata->pkt_len - (guint32)(v % 3);
+    fdata->cum_bytes = num * 100;
+    fdata->file_off = 24 + (gint64)v;
+    fdata->color_filter = num % 3 ? (const struct _color_filter *)&test_colors[num % 3] : NULL;
+    fdata->subnum = width >= 2 ? (guint16)v : (guint16)(width * 7);
+    fdata->passed_dfilter = num % 3 == 0;
+    fdata->dependent_of_displayed = num % 5 == 0;
+    fdata->visited = num & 1;
+    fdata->marked = num % 97 == 0;
+    fdata->ref_time = num == 1;
+    fdata->has_ts = 1;
+    fdata->need_colorize = num % 7 == 0;
+    fdata->tsprec = width == 8 ? WTAP_TSPREC_NSEC : WTAP_TSPREC_USEC;
+    /* Up to 27 hours apart, in whole seconds, ms, us, or ns. */
+    fdata->abs_ts.secs = 1500000000 + (time_t)(v % 100000);
+    switch (width) {
+    case 0:
+        fdata->abs_ts.nsecs = 0;
+        break;
+    case 1:
+        fdata->abs_ts.nsecs = (int)(num % 1000) * 1000000;
+        break;
+    case 2:
+    case 4:
+        fdata->abs_ts.nsecs = (int)(v % 1000000) * 1000;
+        break;
+    default:
+        fdata->abs_ts.nsecs = (int)(v % 1000000000);
+        break;
+    }
+    fdata->frame_ref_num = 1;
+    fdata->prev_dis_num = num - 1;
+}
+
+static void
+test_frame_equal(const frame_data *a, const frame_data *b)
+{
+    g_assert(a->num == b->num);
+    g_assert(a->pkt_len == b->pkt_len);
+    g_assert(a->cap_len == b->cap_len);
+    g_assert(a->cum_bytes == b->cum_bytes);
+    g_assert(a->file_off == b->file_off);
+    g_assert(a->pfd == b->pfd);
+    g_assert(a->color_filter == b->color_filter);
+    g_assert(a->subnum == b->subnum);
+    g_assert(a->passed_dfilter == b->passed_dfilter);
+    g_assert(a->dependent_of_displayed == b->dependent_of_displayed);
+    g_assert(a->encoding == b->encoding);
+    g_assert(a->visited == b->visited);
+    g_assert(a->marked == b->marked);
+    g_assert(a->ref_time == b->ref_time);
+    g_assert(a->ignored == b->ignored);
+    g_assert(a->has_ts == b->has_ts);
+    g_assert(a->has_phdr_comment == b->has_phdr_comment);
+    g_assert(a->has_user_comment == b->has_user_comment);
+    g_assert(a->need_colorize == b->need_colorize);
+    g_assert(a->tsprec == b->tsprec);
+    g_assert(a->abs_ts.secs == b->abs_ts.secs);
+    g_assert(a->abs_ts.nsecs == b->abs_ts.nsecs);
+    g_assert(a->shift_offset.secs == b->shift_offset.secs);
+    g_assert(a->shift_offset.nsecs == b->shift_offset.nsecs);
+    g_assert(a->frame_ref_num == b->frame_ref_num);
+    g_assert(a->prev_dis_num == b->prev_dis_num);
+}
+
+/* Checks every frame of fdst against test_frame(), also with the accessors. */
+static void
+test_store_check(const frame_data_store *fdst, guint width)
+{
+    frame_data expected, got;
+    nstime_t ts;
+    guint32 num;
+
+    g_assert(frame_data_store_count(fdst) == TEST_FRAMES);
+    for (num = 1; num <= TEST_FRAMES; num++) {
+        test_frame(&expected, num, width);
+        memset(&got, 0xa5, sizeof got);
+        g_assert(frame_data_store_get(fdst, num, &got));
+        test_frame_equal(&expected, &got);
+
+        g_assert(frame_data_store_get_pkt_len(fdst, num) == expected.pkt_len);
+        g_assert(frame_data_store_get_cap_len(fdst, num) == expected.cap_len);
+        g_assert(frame_data_store_get_cum_bytes(fdst, num) == expected.cum_bytes);
+        g_assert(frame_data_store_get_file_off(fdst, num) == expected.file_off);
+        frame_data_store_get_abs_ts(fdst, num, &ts);
+        g_assert(ts.secs == expected.abs_ts.secs && ts.nsecs == expected.abs_ts.nsecs);
+        g_assert(frame_data_store_get_flag(fdst, num, FRAME_DATA_VISITED) == expected.visited);
+    }
+    g_assert(!frame_data_store_get(fdst, 0, &got));
+    g_assert(!frame_data_store_get(fdst, TEST_FRAMES + 1, &got));
+}
+
+static frame_data_store *
+test_store_new(guint width)
+{
+    frame_data_store *fdst = frame_data_store_new();
+    frame_data fdata;
+    guint32 num;
+
+    for (num = 1; num <= TEST_FRAMES; num++) {
+        test_frame(&fdata, num, width);
+        frame_data_store_add(fdst, &fdata);
+    }
+    return fdst;
+}
+
+static void
+frame_data_store_test_widths(void)
+{
+    static const guint widths[] = { 0, 1, 2, 4, 8 };
+    frame_data_store *fdst;
+    frame_data fdata;
+    gsize unpacked;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(widths); i++) {
+        fdst = test_store_new(widths[i]);
+        test_store_check(fdst, widths[i]);
+
+        /* The partial block is packed too, and unpacked to add more. */
+        unpacked = frame_data_store_memory(fdst);
+        frame_data_store_compact(fdst);
+        g_assert(frame_data_store_memory(fdst) < unpacked);
+        test_store_check(fdst, widths[i]);
+
+        test_frame(&fdata, TEST_FRAMES + 1, widths[i]);
+        frame_data_store_add(fdst, &fdata);
+        g_assert(frame_data_store_count(fdst) == TEST_FRAMES + 1);
+        g_assert(frame_data_store_get_file_off(fdst, TEST_FRAMES + 1) == fdata.file_off);
+        test_frame(&fdata, TEST_FRAMES, widths[i]);
+        g_assert(frame_data_store_get_file_off(fdst, TEST_FRAMES) == fdata.file_off);
+
+        frame_data_store_free(fdst);
+    }
+}
+
+/* The odd frames shifted back by 1.5 s, and all visited. */
+static void
+test_shifted_frame(frame_data *fdata)
+{
+    if (fdata->num & 1) {
+        fdata->shift_offset.secs = -2;
+        fdata->shift_offset.nsecs = 500000000;
+        nstime_add(&fdata->abs_ts, &fdata->shift_offset);
+    }
+    fdata->visited = 1;
+}
+
+/* Frames written back with new time stamps, as by a time shift. */
+static void
+frame_data_store_test_time_shift(void)
+{
+    frame_data_store *fdst = test_store_new(2);
+    frame_data fdata, expected;
+    guint32 num;
+
+    frame_data_store_compact(fdst);
+
+    for (num = 1; num <= TEST_FRAMES; num++) {
+        g_assert(frame_data_store_get(fdst, num, &fdata));
+        test_shifted_frame(&fdata);
+        frame_data_store_put(fdst, &fdata);
+    }
+
+    for (num = 1; num <= TEST_FRAMES; num++) {
+        test_frame(&expected, num, 2);
+        test_shifted_frame(&expected);
+        g_assert(frame_data_store_get(fdst, num, &fdata));
+        test_frame_equal(&expected, &fdata);
+        if (num == TEST_FRAMES / 2)
+            frame_data_store_compact(fdst);
+    }
+
+    /* A frame moved too far from the rest of its block to pack it. */
+    g_assert(frame_data_store_get(fdst, 10, &fdata));
+    fdata.abs_ts.secs -= (time_t)G_MAXUINT32 + 1;
+    frame_data_store_put(fdst, &fdata);
+    frame_data_store_compact(fdst);
+    g_assert(frame_data_store_get(fdst, 10, &expected));
+    test_frame_equal(&fdata, &expected);
+    for (num = 1; num <= 1024; num++) {
+        if (num == 10)
+            continue;
+        test_frame(&expected, num, 2);
+        test_shifted_frame(&expected);
+        g_assert(frame_data_store_get(fdst, num, &fdata));
+        test_frame_equal(&expected, &fdata);
+    }
+
+    frame_data_store_free(fdst);
+}
+
+/* Time stamps that are negative, not normalized, or not a multiple of 1 us. */
+static void
+frame_data_store_test_nsecs(void)
+{
+    static const nstime_t stamps[] = {
+        { 1500000000, 123456789 },
+        { -10, 5 },
+        { -1, 999999999 },
+        { 0, 1 },
+        { 1500000000, -1 },          /* not normalized */
+        { 1500000000, 1000000000 },  /* nor this */
+    };
+    frame_data_store *fdst;
+    frame_data fdata, got;
+    nstime_t ts;
+    guint i, j;
+    guint32 num;
+
+    /* Each stamp alone in a block, and with odd and negative neighbours. */
+    for (i = 0; i < G_N_ELEMENTS(stamps); i++) {
+        fdst = frame_data_store_new();
+        for (num = 1; num <= TEST_FRAMES; num++) {
+            test_frame(&fdata, num, 1);
+            j = num % 3 == 0 ? i : (num + i) % G_N_ELEMENTS(stamps);
+            fdata.abs_ts = num < 1024 ? stamps[i] : stamps[j];
+            fdata.shift_offset.secs = -(time_t)(num % 4);
+            fdata.shift_offset.nsecs = -(int)(num % 4) * 250000000;
+            frame_data_store_add(fdst, &fdata);
+        }
+        frame_data_store_compact(fdst);
+
+        for (num = 1; num <= TEST_FRAMES; num++) {
+            test_frame(&fdata, num, 1);
+            j = num % 3 == 0 ? i : (num + i) % G_N_ELEMENTS(stamps);
+            fdata.abs_ts = num < 1024 ? stamps[i] : stamps[j];
+            fdata.shift_offset.secs = -(time_t)(num % 4);
+            fdata.shift_offset.nsecs = -(int)(num % 4) * 250000000;
+            g_assert(frame_data_store_get(fdst, num, &got));
+            test_frame_equal(&fdata, &got);
+            frame_data_store_get_abs_ts(fdst, num, &ts);
+            g_assert(ts.secs == fdata.abs_ts.secs && ts.nsecs == fdata.abs_ts.nsecs);
+        }
+        frame_data_store_free(fdst);
+    }
+}
+
+static void
+frame_data_store_test_flags(void)
+{
+    static const guint32 marked[] = { 1, 63, 64, 65, 128, 1023, 1024, 1025, 2000, TEST_FRAMES };
+    frame_data_store *fdst = test_store_new(1);
+    guint32 num, next;
+    guint i;
+
+    g_assert(frame_data_store_find_flag(fdst, 1, FRAME_DATA_IGNORED) == 0);
+    g_assert(frame_data_store_count_flag(fdst, FRAME_DATA_IGNORED) == 0);
+    g_assert(frame_data_store_count_flag(fdst, FRAME_DATA_HAS_TS) == TEST_FRAMES);
+    g_assert(frame_data_store_count_flag(fdst, FRAME_DATA_VISITED) == (TEST_FRAMES + 1) / 2);
+    g_assert(frame_data_store_find_flag(fdst, 2, FRAME_DATA_VISITED) == 3);
+
+    for (num = 1; num <= TEST_FRAMES; num++)
+        frame_data_store_set_flag(fdst, num, FRAME_DATA_MARKED, FALSE);
+    g_assert(frame_data_store_count_flag(fdst, FRAME_DATA_MARKED) == 0);
+    for (i = 0; i < G_N_ELEMENTS(marked); i++)
+        frame_data_store_set_flag(fdst, marked[i], FRAME_DATA_MARKED, TRUE);
+    g_assert(frame_data_store_count_flag(fdst, FRAME_DATA_MARKED) == G_N_ELEMENTS(marked));
+
+    /* Frame 0 is taken as frame 1. */
+    g_assert(frame_data_store_find_flag(fdst, 0, FRAME_DATA_MARKED) == 1);
+    for (num = 1, i = 0; num <= TEST_FRAMES; num++) {
+        if (num > marked[i])
+            i++;
+        g_assert(frame_data_store_find_flag(fdst, num, FRAME_DATA_MARKED) == marked[i]);
+    }
+    g_assert(frame_data_store_find_flag(fdst, TEST_FRAMES + 1, FRAME_DATA_MARKED) == 0);
+
+    /* Walk the marked frames the way "next marked packet" does. */
+    frame_data_store_set_flag(fdst, TEST_FRAMES, FRAME_DATA_MARKED, FALSE);
+    i = 0;
+    for (num = frame_data_store_find_flag(fdst, 1, FRAME_DATA_MARKED); num != 0; num = next) {
+        g_assert(num == marked[i++]);
+        g_assert(frame_data_store_get_flag(fdst, num, FRAME_DATA_MARKED));
+        next = frame_data_store_find_flag(fdst, num + 1, FRAME_DATA_MARKED);
+    }
+    g_assert(i == G_N_ELEMENTS(marked) - 1);
+    g_assert(frame_data_store_count_flag(fdst, FRAME_DATA_MARKED) == G_N_ELEMENTS(marked) - 1);
+
+    frame_data_store_free(fdst);
+}
+
+/* Per frame proto data and color filters survive packing. */
+static void
+frame_data_store_test_pointers(void)
+{
+    frame_data_store *fdst = test_store_new(4);
+    frame_data fdata;
+    GSList *pfd = g_slist_prepend(NULL, &test_colors[0]);
+
+    g_assert(frame_data_store_get(fdst, 1500, &fdata));
+    fdata.pfd = pfd;
+    fdata.color_filter = (const struct _color_filter *)&test_colors[0];
+    frame_data_store_put(fdst, &fdata);
+    frame_data_store_compact(fdst);
+
+    g_assert(frame_data_store_get(fdst, 1500, &fdata));
+    g_assert(fdata.pfd == pfd);
+    g_assert(fdata.color_filter == (const struct _color_filter *)&test_colors[0]);
+    g_assert(frame_data_store_get(fdst, 1501, &fdata));
+    g_assert(fdata.pfd == NULL);
+    g_assert(fdata.color_filter == (const struct _color_filter *)&test_colors[1501 % 3]);
+
+    /* The store frees the list. */
+    frame_data_store_free(fdst);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/frame_data_store/widths",     frame_data_store_test_widths);
+    g_test_add_func("/frame_data_store/time_shift", frame_data_store_test_time_shift);
+    g_test_add_func("/frame_data_store/nsecs",      frame_data_store_test_nsecs);
+    g_test_add_func("/frame_data_store/flags",      frame_data_store_test_flags);
+    g_test_add_func("/frame_data_store/pointers",   frame_data_store_test_pointers);
+
+    ret = g_test_run();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
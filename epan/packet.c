@@ -32,6 +32,7 @@
 #include "wmem/wmem.h"
 
 #include <epan/exceptions.h>
+#include <epan/conversation.h>
 #include <epan/reassemble.h>
 #include <epan/stream.h>
 #include <epan/expert.h>
@@ -157,10 +158,25 @@ destroy_depend_dissector_list(void *data)
 struct heur_dissector_list {
 	protocol_t	*protocol;
 	GSList		*dissectors;
+	wmem_map_t	*last_accepted;	/* conversation -> entry that last accepted one of its packets */
 };
 
 static GHashTable *heur_dissector_lists = NULL;
 
+/* Registration order of heuristic dissectors */
+static guint heur_dtbl_entry_seq = 0;
+
+/*
+ * With adaptive ordering, the lists are sorted by how many packets each
+ * dissector accepted after this many heuristic calls; TRUE if they aren't
+ * in registration order.
+ */
+#define HEUR_REORDER_INTERVAL	4096
+static guint heur_calls_since_reorder = 0;
+static gboolean heur_lists_reordered = FALSE;
+
+static void heur_dissector_lists_update_order(void);
+
 /* Name hashtables for fast detection of duplicate names */
 static GHashTable* heuristic_short_names  = NULL;
 
@@ -524,6 +540,9 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 		edt->pi.presence_flags |= PINFO_HAS_TS;
 		edt->pi.abs_ts = fd->abs_ts;
 	}
+	if (conversation_aging_enabled())
+		conversation_aging_new_frame(fd->num, fd->has_ts ? &fd->abs_ts : NULL);
+	heur_dissector_lists_update_order();
 	switch (rec->rec_type) {
 
 	case REC_TYPE_PACKET:
@@ -2635,6 +2654,9 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->short_name = g_strdup(short_name);
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
+	hdtbl_entry->seq       = heur_dtbl_entry_seq++;
+	hdtbl_entry->attempts  = 0;
+	hdtbl_entry->accepts   = 0;
 
 	/* do the table insertion */
 	g_hash_table_insert(heuristic_short_names, (gpointer)hdtbl_entry->short_name, hdtbl_entry);
@@ -2663,11 +2685,27 @@ find_matching_heur_dissector(gconstpointer a, gconstpointer b) {
 		(hdtbl_entry_a->protocol == hdtbl_entry_b->protocol) ? 0 : 1;
 }
 
+typedef struct {
+	heur_dtbl_entry_t *hdtbl_entry;
+	GSList            *conversations;
+} last_accepted_search_t;
+
+static void
+find_last_accepted_by_entry(gpointer key, gpointer value, gpointer user_data)
+{
+	last_accepted_search_t *search = (last_accepted_search_t *)user_data;
+
+	if (value == search->hdtbl_entry)
+		search->conversations = g_slist_prepend(search->conversations, key);
+}
+
 void
 heur_dissector_delete(const char *name, heur_dissector_t dissector, const int proto) {
 	heur_dissector_list_t  sub_dissectors = find_heur_dissector_list(name);
 	heur_dtbl_entry_t      hdtbl_entry;
 	GSList                *found_entry;
+	last_accepted_search_t search;
+	GSList                *conv_entry;
 
 	/* sanity check */
 	g_assert(sub_dissectors != NULL);
@@ -2680,6 +2718,19 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 
 	if (found_entry) {
 		heur_dtbl_entry_t *found_hdtbl_entry = (heur_dtbl_entry_t *)(found_entry->data);
+
+		/* Forget the conversations it was remembered for */
+		if (sub_dissectors->last_accepted != NULL) {
+			search.hdtbl_entry = found_hdtbl_entry;
+			search.conversations = NULL;
+			wmem_map_foreach(sub_dissectors->last_accepted,
+			    find_last_accepted_by_entry, &search);
+			for (conv_entry = search.conversations; conv_entry != NULL;
+			    conv_entry = conv_entry->next)
+				wmem_map_remove(sub_dissectors->last_accepted, conv_entry->data);
+			g_slist_free(search.conversations);
+		}
+
 		g_free(found_hdtbl_entry->list_name);
 		g_hash_table_remove(heuristic_short_names, found_hdtbl_entry->short_name);
 		g_free(found_hdtbl_entry->short_name);
@@ -2689,6 +2740,74 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 	}
 }
 
+/*
+ * Call one heuristic dissector on behalf of dissector_try_heuristic();
+ * returns what it returned, or 0 if it's disabled.
+ */
+static int
+try_heur_dtbl_entry(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+		    packet_info *pinfo, proto_tree *tree, void *data,
+		    guint16 saved_can_desegment, guint saved_layers_len,
+		    int saved_tree_count)
+{
+	int proto_id;
+	int len;
+
+	/* XXX - why set this now and above? */
+	pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+
+	if (hdtbl_entry->protocol != NULL &&
+		(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
+		/*
+		 * No - don't try this dissector.
+		 */
+		return 0;
+	}
+
+	if (hdtbl_entry->protocol != NULL) {
+		proto_id = proto_get_id(hdtbl_entry->protocol);
+		/* do NOT change this behavior - wslua uses the protocol short name set here in order
+		   to determine which Lua-based heurisitc dissector to call */
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		pinfo->curr_layer_num++;
+		wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	}
+
+	pinfo->heur_list_name = hdtbl_entry->list_name;
+
+	hdtbl_entry->attempts++;
+	len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+	if (hdtbl_entry->protocol != NULL &&
+		(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
+		/*
+		 * We added a protocol layer above. The dissector
+		 * didn't accept the packet or it didn't add any
+		 * items to the tree so remove it from the list.
+		 */
+		while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+			if (len == 0) {
+				/*
+				 * Only reduce the layer number if the dissector
+				 * rejected the data. Since tree can be NULL on
+				 * the first pass, we cannot check it or it will
+				 * break dissectors that rely on a stable value.
+				 */
+				pinfo->curr_layer_num--;
+			}
+			wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+		}
+	}
+	if (len)
+		hdtbl_entry->accepts++;
+	return len;
+}
+
 gboolean
 dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **heur_dtbl_entry, void *data)
@@ -2700,8 +2819,8 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	guint16            saved_can_desegment;
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
-	int                proto_id;
-	int                len;
+	heur_dtbl_entry_t *last_accepted = NULL;
+	conversation_t    *conv = NULL;
 	int                saved_tree_count = tree ? tree->tree_data->count : 0;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
@@ -2724,63 +2843,45 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	saved_layers_len = wmem_list_count(pinfo->layers);
 	*heur_dtbl_entry = NULL;
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
-	    entry = g_slist_next(entry)) {
-		/* XXX - why set this now and above? */
-		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
-		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
-
-		if (hdtbl_entry->protocol != NULL &&
-			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
-			/*
-			 * No - don't try this dissector.
-			 */
-			continue;
+	/*
+	 * With adaptive ordering, first try the dissector that accepted
+	 * the last packet of this conversation we were asked about.
+	 */
+	if (prefs.adaptive_heuristic_order) {
+		heur_calls_since_reorder++;
+		conv = find_conversation_pinfo(pinfo, 0);
+		if (conv != NULL && sub_dissectors->last_accepted != NULL)
+			last_accepted = (heur_dtbl_entry_t *)wmem_map_lookup(sub_dissectors->last_accepted, conv);
+		if (last_accepted != NULL &&
+		    try_heur_dtbl_entry(last_accepted, tvb, pinfo, tree, data,
+					saved_can_desegment, saved_layers_len, saved_tree_count)) {
+			*heur_dtbl_entry = last_accepted;
+			status = TRUE;
 		}
+	}
 
-		if (hdtbl_entry->protocol != NULL) {
-			proto_id = proto_get_id(hdtbl_entry->protocol);
-			/* do NOT change this behavior - wslua uses the protocol short name set here in order
-			   to determine which Lua-based heurisitc dissector to call */
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
-
-			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
-			 */
-			pinfo->curr_layer_num++;
-			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
-		}
+	for (entry = sub_dissectors->dissectors; entry != NULL && !status;
+	    entry = g_slist_next(entry)) {
+		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+		if (hdtbl_entry == last_accepted)
+			continue;	/* already tried */
 
-		pinfo->heur_list_name = hdtbl_entry->list_name;
+		if (try_heur_dtbl_entry(hdtbl_entry, tvb, pinfo, tree, data,
+					saved_can_desegment, saved_layers_len, saved_tree_count)) {
+			*heur_dtbl_entry = hdtbl_entry;
+			status = TRUE;
 
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
-		if (hdtbl_entry->protocol != NULL &&
-			(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
-			/*
-			 * We added a protocol layer above. The dissector
-			 * didn't accept the packet or it didn't add any
-			 * items to the tree so remove it from the list.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				if (len == 0) {
-					/*
-					 * Only reduce the layer number if the dissector
-					 * rejected the data. Since tree can be NULL on
-					 * the first pass, we cannot check it or it will
-					 * break dissectors that rely on a stable value.
-					 */
-					pinfo->curr_layer_num--;
+			if (prefs.adaptive_heuristic_order) {
+				/* The dissector may have just set up the conversation */
+				if (conv == NULL)
+					conv = find_conversation_pinfo(pinfo, 0);
+				if (conv != NULL) {
+					if (sub_dissectors->last_accepted == NULL)
+						sub_dissectors->last_accepted = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), g_direct_hash, g_direct_equal);
+					wmem_map_insert(sub_dissectors->last_accepted, conv, hdtbl_entry);
 				}
-				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
 			}
 		}
-		if (len) {
-			*heur_dtbl_entry = hdtbl_entry;
-			status = TRUE;
-			break;
-		}
 	}
 
 	pinfo->current_proto = saved_curr_proto;
@@ -2789,6 +2890,63 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	return status;
 }
 
+/* Most packets accepted first */
+static gint
+heur_dtbl_entry_compare_accepts(gconstpointer a, gconstpointer b)
+{
+	const heur_dtbl_entry_t *hdtbl_entry_a = (const heur_dtbl_entry_t *) a;
+	const heur_dtbl_entry_t *hdtbl_entry_b = (const heur_dtbl_entry_t *) b;
+
+	if (hdtbl_entry_a->accepts != hdtbl_entry_b->accepts)
+		return hdtbl_entry_a->accepts > hdtbl_entry_b->accepts ? -1 : 1;
+	/* heur_dissector_add() puts the latest registration first */
+	return hdtbl_entry_a->seq > hdtbl_entry_b->seq ? -1 : 1;
+}
+
+/* Registration order, as heur_dissector_add() builds the lists */
+static gint
+heur_dtbl_entry_compare_seq(gconstpointer a, gconstpointer b)
+{
+	const heur_dtbl_entry_t *hdtbl_entry_a = (const heur_dtbl_entry_t *) a;
+	const heur_dtbl_entry_t *hdtbl_entry_b = (const heur_dtbl_entry_t *) b;
+
+	return hdtbl_entry_a->seq > hdtbl_entry_b->seq ? -1 : 1;
+}
+
+static void
+heur_dissector_list_sort(gpointer key _U_, gpointer value, gpointer user_data)
+{
+	heur_dissector_list_t sub_dissectors = (heur_dissector_list_t)value;
+
+	sub_dissectors->dissectors = g_slist_sort(sub_dissectors->dissectors,
+	    (GCompareFunc)user_data);
+}
+
+/*
+ * With adaptive ordering, sort the heuristic dissector lists by the number
+ * of packets each dissector accepted every so often; put them back in
+ * registration order once it's turned off.
+ *
+ * This is called between records, as a list mustn't change while
+ * dissector_try_heuristic() is walking it.
+ */
+static void
+heur_dissector_lists_update_order(void)
+{
+	if (prefs.adaptive_heuristic_order) {
+		if (heur_calls_since_reorder < HEUR_REORDER_INTERVAL)
+			return;
+		g_hash_table_foreach(heur_dissector_lists, heur_dissector_list_sort,
+		    (gpointer)heur_dtbl_entry_compare_accepts);
+		heur_calls_since_reorder = 0;
+		heur_lists_reordered = TRUE;
+	} else if (heur_lists_reordered) {
+		g_hash_table_foreach(heur_dissector_lists, heur_dissector_list_sort,
+		    (gpointer)heur_dtbl_entry_compare_seq);
+		heur_lists_reordered = FALSE;
+	}
+}
+
 typedef struct heur_dissector_foreach_info {
 	gpointer      caller_data;
 	DATFunc_heur  caller_func;
@@ -2937,6 +3095,7 @@ register_heur_dissector_list(const char *name, const int proto)
 	sub_dissectors = g_slice_new(struct heur_dissector_list);
 	sub_dissectors->protocol  = find_protocol_by_id(proto);
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->last_accepted = NULL;
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
 	return sub_dissectors;
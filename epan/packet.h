@@ -433,6 +433,9 @@ typedef struct heur_dtbl_entry {
 	const gchar *display_name;     /* the string used to present heuristic to user */
 	gchar *short_name;     /* string used for "internal" use to uniquely identify heuristic */
 	gboolean enabled;
+	guint seq;            /* registration order */
+	guint64 attempts;     /* times dissector_try_heuristic() called it */
+	guint64 accepts;      /* times it accepted the packet when called that way */
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
@@ -3659,6 +3659,13 @@ prefs_register_modules(void)
                                    "Currently only ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_bool_preference(protocols_module, "adaptive_heuristic_order",
+                                   "Try heuristic dissectors in adaptive order",
+                                   "Try the heuristic dissector that accepted the last packet of a conversation first, "
+                                   "and the others in order of how many packets they accepted. This is faster, but "
+                                   "if more than one would accept a packet, which one gets it may change.",
+                                   &prefs.adaptive_heuristic_order);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -4168,6 +4175,7 @@ pre_init_prefs(void)
     prefs.st_sort_showfullname = FALSE;
     prefs.display_hidden_proto_items = FALSE;
     prefs.display_byte_fields_with_spaces = FALSE;
+    prefs.adaptive_heuristic_order = FALSE;
 }
 
 /*
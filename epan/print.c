@@ -100,14 +100,41 @@ static void write_specified_fields(fields_format format,
 static void print_escaped_xml(FILE *fh, const char *unescaped_string);
 static void print_escaped_csv(FILE *fh, const char *unescaped_string);
 
+/*
+ * A group of values of a proto tree node sharing the same json key, kept in
+ * json_scratch. The key is "prefix_key", or just "key" if prefix is NULL.
+ */
+typedef struct {
+    const char *prefix;
+    const char *key;
+    guint       hash;
+    guint       offset;     /* Index of the first value in json_scratch.nodes */
+    guint       count;      /* Number of values */
+} json_node_group;
+
+/*
+ * Scratch space for grouping nodes by json key without allocating per node
+ * or per packet. The arrays are used as stacks: grouping the children of a
+ * nested node pushes entries above those of its parent and pops them when
+ * done. They keep the size needed by the largest tree seen so far.
+ */
+static struct {
+    GArray  *nodes;     /* proto_node * */
+    GArray  *groups;    /* json_node_group */
+    GArray  *work;      /* guint, hash buckets and group ids */
+    GString *name;      /* Member name being written */
+} json_scratch;
+
+typedef void (*json_node_key_func)(proto_node *node, const char **prefix, const char **key);
+
 typedef void (*proto_node_value_writer)(proto_node *, write_json_data *);
 static void write_json_index(json_dumper *dumper, epan_dissect_t *edt);
-static void write_json_proto_node_list(GSList *proto_node_list_head, write_json_data *data);
-static void write_json_proto_node(GSList *node_values_head,
+static void write_json_proto_node_list(guint group_base, write_json_data *data);
+static void write_json_proto_node(const json_node_group *group,
                                   const char *suffix,
                                   proto_node_value_writer value_writer,
                                   write_json_data *data);
-static void write_json_proto_node_value_list(GSList *node_values_head,
+static void write_json_proto_node_value_list(const json_node_group *group,
                                              proto_node_value_writer value_writer,
                                              write_json_data *data);
 static void write_json_proto_node_filtered(proto_node *node, write_json_data *data);
@@ -762,29 +789,189 @@ write_json_proto_tree(output_fields_t* fields,
     json_dumper_end_object(dumper);
 }
 
+static void
+json_scratch_init(void)
+{
+    if (json_scratch.nodes == NULL) {
+        json_scratch.nodes = g_array_new(FALSE, FALSE, sizeof(proto_node *));
+        json_scratch.groups = g_array_new(FALSE, FALSE, sizeof(json_node_group));
+        json_scratch.work = g_array_new(FALSE, FALSE, sizeof(guint));
+        json_scratch.name = g_string_new(NULL);
+    }
+}
+
+/* Returns the next character of "prefix_key", or 0 at its end. */
+static inline char
+json_key_next_char(const char **pos, int *part, const char *key)
+{
+    if (**pos != '\0') {
+        return *(*pos)++;
+    }
+    if (*part == 0) {
+        /* End of the prefix */
+        *part = 1;
+        *pos = key;
+        return '_';
+    }
+    return '\0';
+}
+
+static guint
+json_key_hash(const char *prefix, const char *key)
+{
+    const char *pos = prefix ? prefix : key;
+    int part = prefix ? 0 : 1;
+    guint hash = 5381;
+    char c;
+
+    while ((c = json_key_next_char(&pos, &part, key)) != '\0') {
+        hash = (hash << 5) + hash + (guchar) c;
+    }
+    return hash;
+}
+
+static gboolean
+json_key_equal(const char *prefix1, const char *key1, const char *prefix2, const char *key2)
+{
+    if (prefix1 == prefix2 && key1 == key2) {
+        return TRUE;
+    }
+
+    const char *pos1 = prefix1 ? prefix1 : key1;
+    const char *pos2 = prefix2 ? prefix2 : key2;
+    int part1 = prefix1 ? 0 : 1;
+    int part2 = prefix2 ? 0 : 1;
+    char c1, c2;
+
+    do {
+        c1 = json_key_next_char(&pos1, &part1, key1);
+        c2 = json_key_next_char(&pos2, &part2, key2);
+        if (c1 != c2) {
+            return FALSE;
+        }
+    } while (c1 != '\0');
+    return TRUE;
+}
+
+static void
+json_node_key(proto_node *node, const char **prefix, const char **key)
+{
+    *prefix = NULL;
+    *key = proto_node_to_json_key(node);
+}
+
+/**
+ * Groups the nodes pushed on json_scratch.nodes from node_base on, and pushes
+ * the groups on json_scratch.groups. Groups keep the order in which their
+ * key was first seen and the nodes keep their order within a group; the
+ * nodes are reordered so that each group is contiguous. If key_func is NULL
+ * every node is a group of its own.
+ */
+static void
+json_scratch_group_nodes(guint node_base, json_node_key_func key_func)
+{
+    guint n_nodes = json_scratch.nodes->len - node_base;
+    guint group_base = json_scratch.groups->len;
+    json_node_group group = { NULL, NULL, 0, 0, 0 };
+
+    if (key_func == NULL || n_nodes <= 1) {
+        for (guint i = 0; i < n_nodes; i++) {
+            group.offset = node_base + i;
+            group.count = 1;
+            (key_func ? key_func : json_node_key)(g_array_index(json_scratch.nodes, proto_node *, node_base + i),
+                                                  &group.prefix, &group.key);
+            g_array_append_val(json_scratch.groups, group);
+        }
+        return;
+    }
+
+    /* Open-addressed table of group ids, followed by the group id of each node. */
+    guint n_buckets = 16;
+    while (n_buckets < 2 * n_nodes) {
+        n_buckets *= 2;
+    }
+    guint work_base = json_scratch.work->len;
+    g_array_set_size(json_scratch.work, work_base + n_buckets + n_nodes);
+    guint *buckets = &g_array_index(json_scratch.work, guint, work_base);
+    guint *group_ids = buckets + n_buckets;
+    memset(buckets, 0xff, n_buckets * sizeof(guint));
+
+    for (guint i = 0; i < n_nodes; i++) {
+        const char *prefix, *key;
+        key_func(g_array_index(json_scratch.nodes, proto_node *, node_base + i), &prefix, &key);
+        guint hash = json_key_hash(prefix, key);
+        guint bucket = hash & (n_buckets - 1);
+        json_node_group *found;
+
+        for (;;) {
+            guint group_id = buckets[bucket];
+            if (group_id == G_MAXUINT) {
+                group.prefix = prefix;
+                group.key = key;
+                group.hash = hash;
+                g_array_append_val(json_scratch.groups, group);
+                group_id = json_scratch.groups->len - 1 - group_base;
+                buckets[bucket] = group_id;
+            }
+            found = &g_array_index(json_scratch.groups, json_node_group, group_base + group_id);
+            if (found->hash == hash && json_key_equal(found->prefix, found->key, prefix, key)) {
+                group_ids[i] = group_id;
+                found->count++;
+                break;
+            }
+            bucket = (bucket + 1) & (n_buckets - 1);
+        }
+    }
+
+    /* Place the nodes of each group after each other behind the input, then move them down. */
+    guint offset = node_base + n_nodes;
+    for (guint g = group_base; g < json_scratch.groups->len; g++) {
+        json_node_group *cur = &g_array_index(json_scratch.groups, json_node_group, g);
+        cur->offset = offset;
+        offset += cur->count;
+        cur->count = 0;
+    }
+    g_array_set_size(json_scratch.nodes, node_base + 2 * n_nodes);
+    for (guint i = 0; i < n_nodes; i++) {
+        json_node_group *cur = &g_array_index(json_scratch.groups, json_node_group, group_base + group_ids[i]);
+        g_array_index(json_scratch.nodes, proto_node *, cur->offset + cur->count) =
+            g_array_index(json_scratch.nodes, proto_node *, node_base + i);
+        cur->count++;
+    }
+    memmove(&g_array_index(json_scratch.nodes, proto_node *, node_base),
+            &g_array_index(json_scratch.nodes, proto_node *, node_base + n_nodes),
+            n_nodes * sizeof(proto_node *));
+    g_array_set_size(json_scratch.nodes, node_base + n_nodes);
+    for (guint g = group_base; g < json_scratch.groups->len; g++) {
+        g_array_index(json_scratch.groups, json_node_group, g).offset -= n_nodes;
+    }
+
+    g_array_set_size(json_scratch.work, work_base);
+}
+
 /**
  * Write a json object containing a list of key:value pairs where each key:value pair corresponds to a different json
  * key and its associated nodes in the proto_tree.
- * @param proto_node_list_head A 2-dimensional list containing a list of values for each different node json key. The
- * elements themselves are a linked list of values associated with the same json key.
+ * @param group_base Index of the first group in json_scratch.groups. All groups from there on are written, each one
+ * being the list of values associated with the same json key.
  * @param pdata json writing metadata
  */
 static void
-write_json_proto_node_list(GSList *proto_node_list_head, write_json_data *pdata)
+write_json_proto_node_list(guint group_base, write_json_data *pdata)
 {
-    GSList *current_node = proto_node_list_head;
+    guint group_end = json_scratch.groups->len;
 
     json_dumper_begin_object(pdata->dumper);
 
     // Loop over each list of nodes (differentiated by json key) and write the associated json key:value pair in the
     // output.
-    while (current_node != NULL) {
-        // Get the list of values for the current json key.
-        GSList *node_values_list = (GSList *) current_node->data;
+    for (guint group_idx = group_base; group_idx < group_end; group_idx++) {
+        // Copy the group, the scratch arrays may be reallocated while writing children.
+        json_node_group group = g_array_index(json_scratch.groups, json_node_group, group_idx);
 
         // Retrieve the json key from the first value.
-        proto_node *first_value = (proto_node *) node_values_list->data;
-        const char *json_key = proto_node_to_json_key(first_value);
+        proto_node *first_value = g_array_index(json_scratch.nodes, proto_node *, group.offset);
+        const char *json_key = group.key;
         // Check if the current json key is filtered from the output with the "-j" cli option.
         gboolean is_filtered = pdata->filter != NULL && !check_protocolfilter(pdata->filter, json_key);
 
@@ -804,11 +991,11 @@ write_json_proto_node_list(GSList *proto_node_list_head, write_json_data *pdata)
         // length is equal to 0 is not written to the output. If the field is a special text pseudo field no raw
         // information is written either.
         if (pdata->print_hex && (!pdata->print_text || fi->length > 0) && !is_pseudo_text_field) {
-            write_json_proto_node(node_values_list, "_raw", write_json_proto_node_hex_dump, pdata);
+            write_json_proto_node(&group, "_raw", write_json_proto_node_hex_dump, pdata);
         }
 
         if (pdata->print_text && has_value) {
-            write_json_proto_node(node_values_list, "", write_json_proto_node_value, pdata);
+            write_json_proto_node(&group, "", write_json_proto_node_value, pdata);
         }
 
         if (has_children) {
@@ -818,7 +1005,7 @@ write_json_proto_node_list(GSList *proto_node_list_head, write_json_data *pdata)
             char *suffix = has_value ? "_tree": "";
 
             if (is_filtered) {
-                write_json_proto_node(node_values_list, suffix, write_json_proto_node_filtered, pdata);
+                write_json_proto_node(&group, suffix, write_json_proto_node_filtered, pdata);
             } else {
                 // Remove protocol filter for children, if children should be included. This functionality is enabled
                 // with the "-J" command line option. We save the filter so it can be reenabled when we are done with
@@ -829,7 +1016,7 @@ write_json_proto_node_list(GSList *proto_node_list_head, write_json_data *pdata)
                     pdata->filter = NULL;
                 }
 
-                write_json_proto_node(node_values_list, suffix, write_json_proto_node_children, pdata);
+                write_json_proto_node(&group, suffix, write_json_proto_node_children, pdata);
 
                 // Put protocol filter back
                 if ((pdata->filter_flags&PF_INCLUDE_CHILDREN) == PF_INCLUDE_CHILDREN) {
@@ -839,10 +1026,8 @@ write_json_proto_node_list(GSList *proto_node_list_head, write_json_data *pdata)
         }
 
         if (!has_value && !has_children && (pdata->print_text || (pdata->print_hex && is_pseudo_text_field))) {
-            write_json_proto_node(node_values_list, "", write_json_proto_node_no_value, pdata);
+            write_json_proto_node(&group, "", write_json_proto_node_no_value, pdata);
         }
-
-        current_node = current_node->next;
     }
     json_dumper_end_object(pdata->dumper);
 }
@@ -850,46 +1035,40 @@ write_json_proto_node_list(GSList *proto_node_list_head, write_json_data *pdata)
 /**
  * Writes a single node as a key:value pair. The value_writer param can be used to specify how the node's value should
  * be written.
- * @param node_values_head Linked list containing all nodes associated with the same json key in this object.
+ * @param group All nodes associated with the same json key in this object.
  * @param suffix Suffix that should be added to the json key.
  * @param value_writer A function which writes the actual values of the node json key.
  * @param pdata json writing metadata
  */
 static void
-write_json_proto_node(GSList *node_values_head,
+write_json_proto_node(const json_node_group *group,
                       const char *suffix,
                       proto_node_value_writer value_writer,
                       write_json_data *pdata)
 {
-    // Retrieve json key from first value.
-    proto_node *first_value = (proto_node *) node_values_head->data;
-    const char *json_key = proto_node_to_json_key(first_value);
-    gchar* json_key_suffix = g_strdup_printf("%s%s", json_key, suffix);
-    json_dumper_set_member_name(pdata->dumper, json_key_suffix);
-    g_free(json_key_suffix);
-    write_json_proto_node_value_list(node_values_head, value_writer, pdata);
+    g_string_assign(json_scratch.name, group->key);
+    g_string_append(json_scratch.name, suffix);
+    json_dumper_set_member_name(pdata->dumper, json_scratch.name->str);
+    write_json_proto_node_value_list(group, value_writer, pdata);
 }
 
 /**
  * Writes a list of values of a single json key. If multiple values are passed they are wrapped in a json array.
- * @param node_values_head Linked list containing all values that should be written.
+ * @param group The values that should be written.
  * @param value_writer Function which writes the separate values.
  * @param pdata json writing metadata
  */
 static void
-write_json_proto_node_value_list(GSList *node_values_head, proto_node_value_writer value_writer, write_json_data *pdata)
+write_json_proto_node_value_list(const json_node_group *group, proto_node_value_writer value_writer, write_json_data *pdata)
 {
-    GSList *current_value = node_values_head;
-
     // Write directly if only a single value is passed. Wrap in json array otherwise.
-    if (current_value->next == NULL) {
-        value_writer((proto_node *) current_value->data, pdata);
+    if (group->count == 1) {
+        value_writer(g_array_index(json_scratch.nodes, proto_node *, group->offset), pdata);
     } else {
         json_dumper_begin_array(pdata->dumper);
 
-        while (current_value != NULL) {
-            value_writer((proto_node *) current_value->data, pdata);
-            current_value = current_value->next;
+        for (guint i = 0; i < group->count; i++) {
+            value_writer(g_array_index(json_scratch.nodes, proto_node *, group->offset + i), pdata);
         }
         json_dumper_end_array(pdata->dumper);
     }
@@ -971,9 +1150,38 @@ write_json_proto_node_hex_dump(proto_node *node, write_json_data *pdata)
 static void
 write_json_proto_node_children(proto_node *node, write_json_data *data)
 {
-    GSList *grouped_children_list = data->node_children_grouper(node);
-    write_json_proto_node_list(grouped_children_list, data);
-    g_slist_free_full(grouped_children_list, (GDestroyNotify) g_slist_free);
+    guint node_base, group_base;
+
+    json_scratch_init();
+    node_base = json_scratch.nodes->len;
+    group_base = json_scratch.groups->len;
+
+    if (data->node_children_grouper == proto_node_group_children_by_json_key ||
+            data->node_children_grouper == proto_node_group_children_by_unique) {
+        // The built-in groupers are done in the scratch arrays, without building lists.
+        for (proto_node *child = node->first_child; child != NULL; child = child->next) {
+            g_array_append_val(json_scratch.nodes, child);
+        }
+        json_scratch_group_nodes(node_base,
+                data->node_children_grouper == proto_node_group_children_by_json_key ? json_node_key : NULL);
+    } else {
+        GSList *grouped_children_list = data->node_children_grouper(node);
+        for (GSList *group_list = grouped_children_list; group_list != NULL; group_list = group_list->next) {
+            json_node_group group = { NULL, NULL, 0, json_scratch.nodes->len, 0 };
+            for (GSList *value = (GSList *) group_list->data; value != NULL; value = value->next) {
+                g_array_append_val(json_scratch.nodes, value->data);
+                group.count++;
+            }
+            group.key = proto_node_to_json_key((proto_node *) ((GSList *) group_list->data)->data);
+            g_array_append_val(json_scratch.groups, group);
+        }
+        g_slist_free_full(grouped_children_list, (GDestroyNotify) g_slist_free);
+    }
+
+    write_json_proto_node_list(group_base, data);
+
+    g_array_set_size(json_scratch.groups, group_base);
+    g_array_set_size(json_scratch.nodes, node_base);
 }
 
 /**
@@ -1138,42 +1346,29 @@ write_ek_summary(column_info *cinfo, write_json_data* pdata)
     }
 }
 
-/* Write out a tree's data, and any child nodes, as JSON for EK */
 static void
-ek_fill_attr(proto_node *node, GSList **attr_list, GHashTable *attr_table, write_json_data *pdata)
+ek_node_key(proto_node *node, const char **prefix, const char **key)
+{
+    field_info *fi_parent = PNODE_FINFO(node->parent);
+
+    *prefix = fi_parent ? fi_parent->hfinfo->abbrev : NULL;
+    *key = PNODE_FINFO(node)->hfinfo->abbrev;
+}
+
+/* Pushes a node's descendants that are written as EK attributes on json_scratch.nodes */
+static void
+ek_fill_attr(proto_node *node, write_json_data *pdata)
 {
     field_info *fi         = NULL;
-    field_info *fi_parent  = NULL;
-    gchar *node_name       = NULL;
-    GSList *attr_instances = NULL;
 
     proto_node *current_node = node->first_child;
     while (current_node != NULL) {
         fi        = PNODE_FINFO(current_node);
-        fi_parent = PNODE_FINFO(current_node->parent);
 
         /* dissection with an invisible proto tree? */
         g_assert(fi);
 
-        if (fi_parent == NULL) {
-            node_name = g_strdup(fi->hfinfo->abbrev);
-        }
-        else {
-            node_name = g_strconcat(fi_parent->hfinfo->abbrev, "_", fi->hfinfo->abbrev, NULL);
-        }
-
-        attr_instances = (GSList *) g_hash_table_lookup(attr_table, node_name);
-        // First time we encounter this attr
-        if (attr_instances == NULL) {
-            attr_instances = g_slist_append(attr_instances, current_node);
-            *attr_list = g_slist_prepend(*attr_list, attr_instances);
-        }
-        else {
-            attr_instances = g_slist_append(attr_instances, current_node);
-        }
-
-        // Update instance list for this attr in hash table
-        g_hash_table_insert(attr_table, node_name, attr_instances);
+        g_array_append_val(json_scratch.nodes, current_node);
 
         /* Field, recurse through children*/
         if (fi->hfinfo->type != FT_PROTOCOL && current_node->first_child != NULL) {
@@ -1186,7 +1381,7 @@ ek_fill_attr(proto_node *node, GSList **attr_list, GHashTable *attr_table, write
                         pdata->filter = NULL;
                     }
 
-                    ek_fill_attr(current_node, attr_list, attr_table, pdata);
+                    ek_fill_attr(current_node, pdata);
 
                     /* Put protocol filter back */
                     if ((pdata->filter_flags&PF_INCLUDE_CHILDREN) == PF_INCLUDE_CHILDREN) {
@@ -1198,7 +1393,7 @@ ek_fill_attr(proto_node *node, GSList **attr_list, GHashTable *attr_table, write
                 }
             }
             else {
-                ek_fill_attr(current_node, attr_list, attr_table, pdata);
+                ek_fill_attr(current_node, pdata);
             }
         }
         else {
@@ -1214,16 +1409,19 @@ ek_write_name(proto_node *pnode, gchar* suffix, write_json_data* pdata)
 {
     field_info *fi        = PNODE_FINFO(pnode);
     field_info *fi_parent = PNODE_FINFO(pnode->parent);
-    gchar      *str;
+    GString    *str       = json_scratch.name;
 
     if (fi_parent != NULL) {
-        str = g_strdup_printf("%s_%s%s", fi_parent->hfinfo->abbrev, fi->hfinfo->abbrev, suffix ? suffix : "");
-        json_dumper_set_member_name(pdata->dumper, str);
+        g_string_assign(str, fi_parent->hfinfo->abbrev);
+        g_string_append_c(str, '_');
+        g_string_append(str, fi->hfinfo->abbrev);
     } else {
-        str = g_strdup_printf("%s%s", fi->hfinfo->abbrev, suffix ? suffix : "");
-        json_dumper_set_member_name(pdata->dumper, str);
+        g_string_assign(str, fi->hfinfo->abbrev);
     }
-    g_free(str);
+    if (suffix) {
+        g_string_append(str, suffix);
+    }
+    json_dumper_set_member_name(pdata->dumper, str->str);
 }
 
 static void
@@ -1303,39 +1501,35 @@ ek_write_field_value(field_info *fi, write_json_data* pdata)
 }
 
 static void
-ek_write_attr_hex(GSList *attr_instances, write_json_data *pdata)
+ek_write_attr_hex(const json_node_group *attr_instances, write_json_data *pdata)
 {
-    GSList *current_node = attr_instances;
-    proto_node *pnode    = (proto_node *) current_node->data;
+    proto_node *pnode    = g_array_index(json_scratch.nodes, proto_node *, attr_instances->offset);
     field_info *fi       = NULL;
 
     // Raw name
     ek_write_name(pnode, "_raw", pdata);
 
-    if (g_slist_length(attr_instances) > 1) {
+    if (attr_instances->count > 1) {
         json_dumper_begin_array(pdata->dumper);
     }
 
     // Raw value(s)
-    while (current_node != NULL) {
-        pnode = (proto_node *) current_node->data;
+    for (guint i = 0; i < attr_instances->count; i++) {
+        pnode = g_array_index(json_scratch.nodes, proto_node *, attr_instances->offset + i);
         fi    = PNODE_FINFO(pnode);
 
         ek_write_hex(fi, pdata);
-
-        current_node = current_node->next;
     }
 
-    if (g_slist_length(attr_instances) > 1) {
+    if (attr_instances->count > 1) {
         json_dumper_end_array(pdata->dumper);
     }
 }
 
 static void
-ek_write_attr(GSList *attr_instances, write_json_data *pdata)
+ek_write_attr(const json_node_group *attr_instances, write_json_data *pdata)
 {
-    GSList *current_node = attr_instances;
-    proto_node *pnode    = (proto_node *) current_node->data;
+    proto_node *pnode    = g_array_index(json_scratch.nodes, proto_node *, attr_instances->offset);
     field_info *fi       = PNODE_FINFO(pnode);
 
     // Hex dump -x
@@ -1346,12 +1540,13 @@ ek_write_attr(GSList *attr_instances, write_json_data *pdata)
     // Print attr name
     ek_write_name(pnode, NULL, pdata);
 
-    if (g_slist_length(attr_instances) > 1) {
+    if (attr_instances->count > 1) {
         json_dumper_begin_array(pdata->dumper);
     }
 
-    while (current_node != NULL) {
-        pnode = (proto_node *) current_node->data;
+    for (guint i = 0; i < attr_instances->count; i++) {
+        // Fetch every time, writing child objects may reallocate json_scratch.nodes.
+        pnode = g_array_index(json_scratch.nodes, proto_node *, attr_instances->offset + i);
         fi    = PNODE_FINFO(pnode);
 
         /* Field */
@@ -1398,11 +1593,9 @@ ek_write_attr(GSList *attr_instances, write_json_data *pdata)
 
             json_dumper_end_object(pdata->dumper);
         }
-
-        current_node = current_node->next;
     }
 
-    if (g_slist_length(attr_instances) > 1) {
+    if (attr_instances->count > 1) {
         json_dumper_end_array(pdata->dumper);
     }
 }
@@ -1411,25 +1604,26 @@ ek_write_attr(GSList *attr_instances, write_json_data *pdata)
 static void
 proto_tree_write_node_ek(proto_node *node, write_json_data *pdata)
 {
-    GSList *attr_list  = NULL;
-    GHashTable *attr_table  = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    guint node_base, group_base, group_end;
 
-    ek_fill_attr(node, &attr_list, attr_table, pdata);
+    json_scratch_init();
+    node_base = json_scratch.nodes->len;
+    group_base = json_scratch.groups->len;
 
-    g_hash_table_destroy(attr_table);
+    ek_fill_attr(node, pdata);
+    json_scratch_group_nodes(node_base, ek_node_key);
+    group_end = json_scratch.groups->len;
 
     // Print attributes
-    attr_list = g_slist_reverse(attr_list);
-    GSList *current_attr = attr_list;
-    while (current_attr != NULL) {
-        GSList *attr_instances = (GSList *) current_attr->data;
-
-        ek_write_attr(attr_instances, pdata);
+    for (guint group_idx = group_base; group_idx < group_end; group_idx++) {
+        // Copy the group, the scratch arrays may be reallocated while writing children.
+        json_node_group attr_instances = g_array_index(json_scratch.groups, json_node_group, group_idx);
 
-        current_attr = current_attr->next;
+        ek_write_attr(&attr_instances, pdata);
     }
 
-    g_slist_free_full(attr_list, (GDestroyNotify) g_slist_free);
+    g_array_set_size(json_scratch.groups, group_base);
+    g_array_set_size(json_scratch.nodes, node_base);
 }
 
 /* Print info for a 'geninfo' pseudo-protocol. This is required by
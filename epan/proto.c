@@ -308,6 +308,13 @@ static expert_field ei_string_trailing_characters = EI_INIT;
 static void register_string_errors(void);
 
 static int proto_register_field_init(header_field_info *hfinfo, const int parent);
+static guint prefix_hash(gconstpointer key);
+static gboolean prefix_equal(gconstpointer ap, gconstpointer bp);
+static void name_prefix_free(gpointer data);
+static void field_names_index_all(void);
+#ifdef ENABLE_CHECK_FILTER
+static enum ftenum _ftype_common(enum ftenum type);
+#endif
 
 /* special-case header field used within proto.c */
 static header_field_info hfi_text_only =
@@ -382,9 +389,37 @@ static gpa_hfinfo_t gpa_hfinfo;
 static GHashTable *gpa_name_map = NULL;
 static header_field_info *same_name_hfinfo;
 
+/*
+ * Registering a field doesn't enter its abbreviation in gpa_name_map
+ * right away. Hashing the names of all fields is a good part of the
+ * startup time, and most runs only ever look up the names of a few
+ * protocols' fields. The fields are instead queued by the prefix of their
+ * abbreviation, the part before the first dot, and entered in the map in
+ * the order they were registered the first time a name with that prefix
+ * is looked up, or when all fields are listed.
+ */
+typedef struct {
+	gchar  *prefix;
+	GArray *hfids;		/* Fields not in gpa_name_map yet; NULL once they all are */
+} name_prefix_t;
+
+static GHashTable *name_prefixes = NULL;	/* prefix -> name_prefix_t */
+static name_prefix_t *last_name_prefix = NULL;
+static guint num_unindexed_fields = 0;
+
 /* Hash table protocol aliases. const char * -> const char * */
 static GHashTable *gpa_protocol_aliases = NULL;
 
+/*
+ * Slots of the fields that filters and taps are interested in, indexed by
+ * hfid; 0 means none, otherwise it's the slot + 1. The slots are small
+ * dense integers, so a tree keeps the field_infos of the interesting
+ * fields in an array indexed by slot. A field keeps its slot until
+ * proto_cleanup().
+ */
+static GArray *interesting_hfid_slots = NULL;
+static guint num_interesting_hfid_slots = 0;
+
 /*
  * We're called repeatedly with the same field name when sorting a column.
  * Cache our last gpa_name_map hit for faster lookups.
@@ -470,6 +505,7 @@ proto_init(GSList *register_all_plugin_protocols_list,
 	gpa_hfinfo.allocated_len = 0;
 	gpa_hfinfo.hfi           = NULL;
 	gpa_name_map             = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, save_same_name_hfinfo);
+	name_prefixes            = g_hash_table_new_full(prefix_hash, prefix_equal, NULL, name_prefix_free);
 	gpa_protocol_aliases     = g_hash_table_new(g_str_hash, g_str_equal);
 	deregistered_fields      = g_ptr_array_new();
 	deregistered_data        = g_ptr_array_new();
@@ -546,6 +582,12 @@ proto_cleanup_base(void)
 		g_hash_table_destroy(gpa_name_map);
 		gpa_name_map = NULL;
 	}
+	if (name_prefixes) {
+		g_hash_table_destroy(name_prefixes);
+		name_prefixes = NULL;
+	}
+	last_name_prefix = NULL;
+	num_unindexed_fields = 0;
 	if (gpa_protocol_aliases) {
 		g_hash_table_destroy(gpa_protocol_aliases);
 		gpa_protocol_aliases = NULL;
@@ -553,6 +595,12 @@ proto_cleanup_base(void)
 	g_free(last_field_name);
 	last_field_name = NULL;
 
+	if (interesting_hfid_slots) {
+		g_array_free(interesting_hfid_slots, TRUE);
+		interesting_hfid_slots = NULL;
+		num_interesting_hfid_slots = 0;
+	}
+
 	while (protocols) {
 		protocol = (protocol_t *)protocols->data;
 		PROTO_REGISTRAR_GET_NTH(protocol->proto_id, hfinfo);
@@ -613,8 +661,10 @@ proto_cleanup_base(void)
 	g_free(tree_is_expanded);
 	tree_is_expanded = NULL;
 
-	if (prefixes)
+	if (prefixes) {
 		g_hash_table_destroy(prefixes);
+		prefixes = NULL;
+	}
 }
 
 void
@@ -701,13 +751,8 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+unreference_interesting_field(header_field_info *hfinfo)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	gint               hfid = GPOINTER_TO_UINT(key);
-	header_field_info *hfinfo;
-
-	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
 	if (hfinfo->ref_type != HF_REF_TYPE_NONE) {
 		/* when a field is referenced by a filter this also
 		   affects the refcount for the parent protocol so we need
@@ -720,8 +765,22 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		}
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
+}
 
-	g_ptr_array_free(ptrs, TRUE);
+/* Empty the field_info lists of the interesting fields found in the tree,
+ * keeping them for the next dissection. */
+static void
+tree_data_reset_interesting_fields(tree_data_t *tree_data)
+{
+	GPtrArray *ptrs;
+	guint      i;
+
+	for (i = 0; i < tree_data->num_interesting_slots_used; i++) {
+		ptrs = tree_data->interesting_finfos[tree_data->interesting_slots_used[i]];
+		unreference_interesting_field(((field_info *)g_ptr_array_index(ptrs, 0))->hfinfo);
+		g_ptr_array_set_size(ptrs, 0);
+	}
+	tree_data->num_interesting_slots_used = 0;
 }
 
 static void
@@ -742,14 +801,7 @@ proto_tree_reset(proto_tree *tree)
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then remove all values. */
-		g_hash_table_remove_all(tree_data->interesting_hfids);
-	}
+	tree_data_reset_interesting_fields(tree_data);
 
 	/* Reset track of the number of children */
 	tree_data->count = 0;
@@ -762,18 +814,18 @@ void
 proto_tree_free(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
+	guint i;
 
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
+	tree_data_reset_interesting_fields(tree_data);
+	for (i = 0; i < tree_data->num_interesting_finfos; i++) {
+		if (tree_data->interesting_finfos[i])
+			g_ptr_array_free(tree_data->interesting_finfos[i], TRUE);
 	}
+	g_free(tree_data->interesting_finfos);
+	g_free(tree_data->interesting_slots_used);
 
 	g_slice_free(tree_data_t, tree_data);
 
@@ -850,21 +902,14 @@ proto_registrar_get_nth(guint hfindex)
 /* compute a hash for the part before the dot of a display filter */
 static guint
 prefix_hash (gconstpointer key) {
-	/* end the string at the dot and compute its hash */
-	gchar* copy = g_strdup((const gchar *)key);
-	gchar* c    = copy;
-	guint tmp;
+	/* g_str_hash() of the string up to the dot, without copying it */
+	const signed char *p = (const signed char *)key;
+	guint32 h = 5381;
 
-	for (; *c; c++) {
-		if (*c == '.') {
-			*c = 0;
-			break;
-		}
-	}
+	for (; *p != '\0' && *p != '.'; p++)
+		h = (h << 5) + h + *p;
 
-	tmp = g_str_hash(copy);
-	g_free(copy);
-	return tmp;
+	return h;
 }
 
 /* are both strings equal up to the end or the dot? */
@@ -888,6 +933,156 @@ prefix_equal (gconstpointer ap, gconstpointer bp) {
 	return FALSE;
 }
 
+static void
+name_prefix_free(gpointer data)
+{
+	name_prefix_t *np = (name_prefix_t *)data;
+
+	if (np->hfids)
+		g_array_free(np->hfids, TRUE);
+	g_free(np->prefix);
+	g_free(np);
+}
+
+/* Enter a field in the name map */
+static void
+field_name_index(header_field_info *hfinfo)
+{
+	header_field_info *same_name_next_hfinfo;
+
+	/* We allow multiple hfinfo's to be registered under the same
+	 * abbreviation. This was done for X.25, as, depending
+	 * on whether it's modulo-8 or modulo-128 operation,
+	 * some bitfield fields may be in different bits of
+	 * a byte, and we want to be able to refer to that field
+	 * with one name regardless of whether the packets
+	 * are modulo-8 or modulo-128 packets. */
+
+	same_name_hfinfo = NULL;
+
+	g_hash_table_insert(gpa_name_map, (gpointer) (hfinfo->abbrev), hfinfo);
+	/* GLIB 2.x - if it is already present
+	 * the previous hfinfo with the same name is saved
+	 * to same_name_hfinfo by value destroy callback */
+	if (same_name_hfinfo) {
+		/* There's already a field with this name.
+		 * Put the current field *before* that field
+		 * in the list of fields with this name, Thus,
+		 * we end up with an effectively
+		 * doubly-linked-list of same-named hfinfo's,
+		 * with the head of the list (stored in the
+		 * hash) being the last seen hfinfo.
+		 */
+		same_name_next_hfinfo =
+			same_name_hfinfo->same_name_next;
+
+		hfinfo->same_name_next = same_name_next_hfinfo;
+		if (same_name_next_hfinfo)
+			same_name_next_hfinfo->same_name_prev_id = hfinfo->id;
+
+		same_name_hfinfo->same_name_next = hfinfo;
+		hfinfo->same_name_prev_id = same_name_hfinfo->id;
+#ifdef ENABLE_CHECK_FILTER
+		while (same_name_hfinfo) {
+			if (_ftype_common(hfinfo->type) != _ftype_common(same_name_hfinfo->type))
+				fprintf(stderr, "'%s' exists multiple times with NOT compatible types: %s and %s\n", hfinfo->abbrev, ftype_name(hfinfo->type), ftype_name(same_name_hfinfo->type));
+			same_name_hfinfo = same_name_hfinfo->same_name_next;
+		}
+#endif
+	}
+}
+
+/* Queue a newly registered field for the name map, or enter it right away
+ * if names with its prefix have been looked up already. */
+static void
+field_name_defer(header_field_info *hfinfo)
+{
+	name_prefix_t *np = last_name_prefix;
+	guchar c;
+
+	/* Check that the filter name (abbreviation) is legal;
+	 * it must contain only alphanumerics, '-', "_", and ".".
+	 * This is cheap, so it isn't deferred: a bad name should
+	 * stop every run, not only those that look it up. */
+	c = proto_check_field_name(hfinfo->abbrev);
+	if (c) {
+		if (c == '.') {
+			fprintf(stderr, "Invalid leading, duplicated or trailing '.' found in filter name '%s'\n", hfinfo->abbrev);
+		} else if (g_ascii_isprint(c)) {
+			fprintf(stderr, "Invalid character '%c' in filter name '%s'\n", c, hfinfo->abbrev);
+		} else {
+			fprintf(stderr, "Invalid byte \\%03o in filter name '%s'\n", c, hfinfo->abbrev);
+		}
+		DISSECTOR_ASSERT_NOT_REACHED();
+	}
+
+	/* Fields are mostly registered an array of one protocol at a time */
+	if (np == NULL || !prefix_equal(np->prefix, hfinfo->abbrev)) {
+		np = (name_prefix_t *)g_hash_table_lookup(name_prefixes, hfinfo->abbrev);
+		if (np == NULL) {
+			np = g_new(name_prefix_t, 1);
+			np->prefix = g_strndup(hfinfo->abbrev, strcspn(hfinfo->abbrev, "."));
+			np->hfids = g_array_new(FALSE, FALSE, sizeof(int));
+			g_hash_table_insert(name_prefixes, np->prefix, np);
+		}
+		last_name_prefix = np;
+	}
+
+	if (np->hfids == NULL) {
+		field_name_index(hfinfo);
+		return;
+	}
+	g_array_append_val(np->hfids, hfinfo->id);
+	num_unindexed_fields++;
+}
+
+static void
+field_names_index_prefix(name_prefix_t *np)
+{
+	guint i;
+
+	if (np->hfids == NULL)
+		return;
+
+	for (i = 0; i < np->hfids->len; i++) {
+		field_name_index(gpa_hfinfo.hfi[g_array_index(np->hfids, int, i)]);
+	}
+	num_unindexed_fields -= np->hfids->len;
+	g_array_free(np->hfids, TRUE);
+	np->hfids = NULL;
+}
+
+/* Make sure the fields with the prefix of field_name are in the name map */
+static void
+field_names_index_for(const char *field_name)
+{
+	name_prefix_t *np;
+
+	if (num_unindexed_fields == 0)
+		return;
+
+	np = (name_prefix_t *)g_hash_table_lookup(name_prefixes, field_name);
+	if (np)
+		field_names_index_prefix(np);
+}
+
+/* Make sure all fields are in the name map and their same-name links are
+ * complete, before listing them or removing any. */
+static void
+field_names_index_all(void)
+{
+	GHashTableIter iter;
+	gpointer np;
+
+	if (num_unindexed_fields == 0)
+		return;
+
+	g_hash_table_iter_init(&iter, name_prefixes);
+	while (g_hash_table_iter_next(&iter, NULL, &np)) {
+		field_names_index_prefix((name_prefix_t *)np);
+	}
+}
+
 /* Register a new prefix for "delayed" initialization of field arrays */
 void
 proto_register_prefix(const char *prefix, prefix_initializer_t pi ) {
@@ -908,7 +1103,9 @@ initialize_prefix(gpointer k, gpointer v, gpointer u _U_) {
 /** Initialize every remaining uninitialized prefix. */
 void
 proto_initialize_all_prefixes(void) {
-	g_hash_table_foreach_remove(prefixes, initialize_prefix, NULL);
+	if (prefixes)
+		g_hash_table_foreach_remove(prefixes, initialize_prefix, NULL);
+	field_names_index_all();
 }
 
 /* Finds a record in the hfinfo array by name.
@@ -930,6 +1127,7 @@ proto_registrar_get_byname(const char *field_name)
 		return last_hfinfo;
 	}
 
+	field_names_index_for(field_name);
 	hfinfo = (header_field_info *)g_hash_table_lookup(gpa_name_map, field_name);
 
 	if (hfinfo) {
@@ -949,6 +1147,8 @@ proto_registrar_get_byname(const char *field_name)
 		return NULL;
 	}
 
+	/* The initializer may have registered the prefix's first fields */
+	field_names_index_for(field_name);
 	hfinfo = (header_field_info *)g_hash_table_lookup(gpa_name_map, field_name);
 
 	if (hfinfo) {
@@ -2201,29 +2401,49 @@ get_time_value(proto_tree *tree, tvbuff_t *tvb, const gint start,
 	}
 }
 
+/* The slot + 1 of an interesting field, 0 if it has none */
+static inline guint
+interesting_hfid_slot(const int hfid)
+{
+	if (interesting_hfid_slots == NULL || (guint)hfid >= interesting_hfid_slots->len)
+		return 0;
+	return g_array_index(interesting_hfid_slots, guint, hfid);
+}
+
 static void
 tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 {
 	const header_field_info *hfinfo = fi->hfinfo;
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		GPtrArray *ptrs = NULL;
-
-		if (tree_data->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			tree_data->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
-		} else if (g_hash_table_size(tree_data->interesting_hfids)) {
-			ptrs = (GPtrArray *)g_hash_table_lookup(tree_data->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
+		GPtrArray *ptrs;
+		guint slot, old_num;
+
+		slot = interesting_hfid_slot(hfinfo->id);
+		if (slot == 0)
+			slot = proto_reserve_interesting_hfid(hfinfo->id);
+		slot--;
+
+		if (slot >= tree_data->num_interesting_finfos) {
+			/* A field got a slot since the tree was last used */
+			old_num = tree_data->num_interesting_finfos;
+			tree_data->num_interesting_finfos = num_interesting_hfid_slots;
+			tree_data->interesting_finfos = g_renew(GPtrArray *,
+			    tree_data->interesting_finfos, tree_data->num_interesting_finfos);
+			memset(tree_data->interesting_finfos + old_num, 0,
+			    (tree_data->num_interesting_finfos - old_num) * sizeof(GPtrArray *));
+			tree_data->interesting_slots_used = g_renew(guint,
+			    tree_data->interesting_slots_used, tree_data->num_interesting_finfos);
 		}
 
-		if (!ptrs) {
-			/* First element triggers the creation of pointer array */
+		ptrs = tree_data->interesting_finfos[slot];
+		if (ptrs == NULL) {
+			/* Kept for the trees of the following packets */
 			ptrs = g_ptr_array_new();
-			g_hash_table_insert(tree_data->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+			tree_data->interesting_finfos[slot] = ptrs;
 		}
+		if (ptrs->len == 0)
+			tree_data->interesting_slots_used[tree_data->num_interesting_slots_used++] = slot;
 
 		g_ptr_array_add(ptrs, fi);
 	}
@@ -6469,8 +6689,11 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Make sure we can access pinfo everywhere */
 	pnode->tree_data->pinfo = pinfo;
 
-	/* Don't initialize the tree_data_t. Wait until we know we need it */
-	pnode->tree_data->interesting_hfids = NULL;
+	/* The interesting fields' lists are allocated when a field is found */
+	pnode->tree_data->interesting_finfos = NULL;
+	pnode->tree_data->num_interesting_finfos = 0;
+	pnode->tree_data->interesting_slots_used = NULL;
+	pnode->tree_data->num_interesting_slots_used = 0;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -6488,6 +6711,24 @@ proto_tree_create_root(packet_info *pinfo)
 }
 
 
+guint
+proto_reserve_interesting_hfid(const int hfid)
+{
+	guint *slot;
+
+	DISSECTOR_ASSERT((guint)hfid < gpa_hfinfo.len);
+
+	if (interesting_hfid_slots == NULL)
+		interesting_hfid_slots = g_array_new(FALSE, TRUE, sizeof(guint));
+	if ((guint)hfid >= interesting_hfid_slots->len)
+		g_array_set_size(interesting_hfid_slots, MAX((guint)hfid + 1, gpa_hfinfo.len));
+
+	slot = &g_array_index(interesting_hfid_slots, guint, hfid);
+	if (*slot == 0)
+		*slot = ++num_interesting_hfid_slots;
+	return *slot;
+}
+
 /* "prime" a proto_tree with a single hfid that a dfilter
  * is interested in. */
 void
@@ -6496,6 +6737,7 @@ proto_tree_prime_with_hfid(proto_tree *tree _U_, const gint hfid)
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
+	proto_reserve_interesting_hfid(hfid);
 	/* this field is referenced by a filter so increase the refcount.
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
@@ -6832,6 +7074,9 @@ proto_deregister_protocol(const char *short_name)
 	if (protocol == NULL)
 		return FALSE;
 
+	/* Unlink the fields from complete same-name lists */
+	field_names_index_all();
+
 	g_hash_table_remove(proto_names, protocol->name);
 	g_hash_table_remove(proto_short_names, (gpointer)short_name);
 	g_hash_table_remove(proto_filter_names, (gpointer)protocol->filter_name);
@@ -6926,6 +7171,9 @@ proto_get_first_protocol_field(const int proto_id, void **cookie)
 {
 	protocol_t *protocol = find_protocol_by_id(proto_id);
 
+	/* Callers skip the fields with same_name_prev_id set */
+	field_names_index_all();
+
 	if ((protocol == NULL) || (protocol->fields == NULL) || (protocol->fields->len == 0))
 		return NULL;
 
@@ -7344,6 +7592,9 @@ proto_deregister_field (const int parent, gint hf_id)
 		return;
 	}
 
+	/* Don't leave the field queued for the name map */
+	field_names_index_all();
+
 	for (i = 0; i < proto->fields->len; i++) {
 		hfi = (header_field_info *)g_ptr_array_index(proto->fields, i);
 		if (hfi->id == hf_id) {
@@ -8142,64 +8393,7 @@ proto_register_field_init(header_field_info *hfinfo, const int parent)
 
 	/* if we have real names, enter this field in the name tree */
 	if ((hfinfo->name[0] != 0) && (hfinfo->abbrev[0] != 0 )) {
-
-		header_field_info *same_name_next_hfinfo;
-		guchar c;
-
-		/* Check that the filter name (abbreviation) is legal;
-		 * it must contain only alphanumerics, '-', "_", and ".". */
-		c = proto_check_field_name(hfinfo->abbrev);
-		if (c) {
-			if (c == '.') {
-				fprintf(stderr, "Invalid leading, duplicated or trailing '.' found in filter name '%s'\n", hfinfo->abbrev);
-			} else if (g_ascii_isprint(c)) {
-				fprintf(stderr, "Invalid character '%c' in filter name '%s'\n", c, hfinfo->abbrev);
-			} else {
-				fprintf(stderr, "Invalid byte \\%03o in filter name '%s'\n", c, hfinfo->abbrev);
-			}
-			DISSECTOR_ASSERT_NOT_REACHED();
-		}
-
-		/* We allow multiple hfinfo's to be registered under the same
-		 * abbreviation. This was done for X.25, as, depending
-		 * on whether it's modulo-8 or modulo-128 operation,
-		 * some bitfield fields may be in different bits of
-		 * a byte, and we want to be able to refer to that field
-		 * with one name regardless of whether the packets
-		 * are modulo-8 or modulo-128 packets. */
-
-		same_name_hfinfo = NULL;
-
-		g_hash_table_insert(gpa_name_map, (gpointer) (hfinfo->abbrev), hfinfo);
-		/* GLIB 2.x - if it is already present
-		 * the previous hfinfo with the same name is saved
-		 * to same_name_hfinfo by value destroy callback */
-		if (same_name_hfinfo) {
-			/* There's already a field with this name.
-			 * Put the current field *before* that field
-			 * in the list of fields with this name, Thus,
-			 * we end up with an effectively
-			 * doubly-linked-list of same-named hfinfo's,
-			 * with the head of the list (stored in the
-			 * hash) being the last seen hfinfo.
-			 */
-			same_name_next_hfinfo =
-				same_name_hfinfo->same_name_next;
-
-			hfinfo->same_name_next = same_name_next_hfinfo;
-			if (same_name_next_hfinfo)
-				same_name_next_hfinfo->same_name_prev_id = hfinfo->id;
-
-			same_name_hfinfo->same_name_next = hfinfo;
-			hfinfo->same_name_prev_id = same_name_hfinfo->id;
-#ifdef ENABLE_CHECK_FILTER
-			while (same_name_hfinfo) {
-				if (_ftype_common(hfinfo->type) != _ftype_common(same_name_hfinfo->type))
-					fprintf(stderr, "'%s' exists multiple times with NOT compatible types: %s and %s\n", hfinfo->abbrev, ftype_name(hfinfo->type), ftype_name(same_name_hfinfo->type));
-				same_name_hfinfo = same_name_hfinfo->same_name_next;
-			}
-#endif
-		}
+		field_name_defer(hfinfo);
 	}
 
 	return hfinfo->id;
@@ -9728,27 +9922,29 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	const tree_data_t *tree_data;
+	GPtrArray *ptrs;
+	guint slot;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
+	tree_data = PTREE_DATA(tree);
+	slot = interesting_hfid_slot(id);
+	if (slot == 0 || slot > tree_data->num_interesting_finfos)
 		return NULL;
+
+	ptrs = tree_data->interesting_finfos[slot - 1];
+	return (ptrs != NULL && ptrs->len != 0) ? ptrs : NULL;
 }
 
 gboolean
 proto_tracking_interesting_fields(const proto_tree *tree)
 {
-	GHashTable *interesting_hfids;
-
 	if (!tree)
 		return FALSE;
 
-	interesting_hfids = PTREE_DATA(tree)->interesting_hfids;
-
-	return (interesting_hfids != NULL) && g_hash_table_size(interesting_hfids);
+	return PTREE_DATA(tree)->num_interesting_slots_used != 0;
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
@@ -10018,6 +10214,8 @@ proto_registrar_dump_values(void)
 	const true_false_string	*tfs;
 	const unit_name_string	*units;
 
+	field_names_index_all();
+
 	len = gpa_hfinfo.len;
 	for (i = 0; i < len ; i++) {
 		if (gpa_hfinfo.hfi[i] == NULL)
@@ -10231,6 +10429,8 @@ proto_registrar_dump_fieldcount(void)
 	guint32			same_name_count = 0;
 	guint32			protocol_count = 0;
 
+	field_names_index_all();
+
 	for (i = 0; i < gpa_hfinfo.len; i++) {
 		if (gpa_hfinfo.hfi[i] == NULL) {
 			deregistered_count++;
@@ -10502,6 +10702,8 @@ proto_registrar_dump_fields(void)
 	const char	  *blurb;
 	char		   width[5];
 
+	field_names_index_all();
+
 	len = gpa_hfinfo.len;
 	for (i = 0; i < len ; i++) {
 		if (gpa_hfinfo.hfi[i] == NULL)
@@ -757,7 +757,10 @@ typedef struct
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable          *interesting_hfids;
+    GPtrArray          **interesting_finfos;    /**< field_info pointers of the interesting fields, by slot */
+    guint                num_interesting_finfos;
+    guint               *interesting_slots_used; /**< slots of the fields found in this tree */
+    guint                num_interesting_slots_used;
     gboolean             visible;
     gboolean             fake_protocols;
     gint                 count;
@@ -1070,6 +1073,14 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 extern void
 proto_tree_prime_with_hfid(proto_tree *tree, const int hfid);
 
+/** Give a field/protocol ID a slot in the trees' table of interesting
+ fields, if it doesn't have one yet. Filters do this when they are
+ compiled; priming a tree with the field does it otherwise.
+ @param hfid the field id
+ @return the field's slot + 1 */
+extern guint
+proto_reserve_interesting_hfid(const int hfid);
+
 /** Get a parent item of a subtree.
  @param tree the tree to get the parent from
  @return parent item */
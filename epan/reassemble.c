@@ -315,6 +315,28 @@ reassembled_key_free(gpointer ptr)
 	g_slice_free(reassembled_key, (reassembled_key *)ptr);
 }
 
+/*
+ * While fragments are being added by byte offset, the head of the
+ * reassembly keeps them in a tree by offset, so that a new fragment can be
+ * linked into the sorted list without walking it, together with the amount
+ * of contiguous data from offset 0, so that checking whether all the data
+ * is there doesn't walk the list either.
+ */
+typedef struct _fragment_index {
+	wmem_tree_t *by_offset;		/* the last fragment at each offset */
+	guint32 contiguous;
+} fragment_index;
+
+static void
+fragment_index_free(fragment_head *fd_head)
+{
+	if (fd_head->frag_index) {
+		wmem_tree_destroy(fd_head->frag_index->by_offset, FALSE, FALSE);
+		g_slice_free(fragment_index, fd_head->frag_index);
+		fd_head->frag_index = NULL;
+	}
+}
+
 /*
  * For a fragment hash table entry, free the associated fragments.
  * The entry value (fd_chain) is freed herein and the entry is freed
@@ -330,6 +352,7 @@ free_all_fragments(gpointer key_arg _U_, gpointer value, gpointer user_data _U_)
 	/* g_hash_table_new_full() was used to supply a function
 	 * to free the key and anything to which it points
 	 */
+	fragment_index_free((fragment_head *)value);
 	for (fd_head = (fragment_head *)value; fd_head != NULL; fd_head = tmp_fd) {
 		tmp_fd=fd_head->next;
 
@@ -392,6 +415,7 @@ free_fragments(gpointer data, gpointer user_data _U_)
 {
 	fragment_item *fd_head = (fragment_item *) data;
 
+	fragment_index_free(fd_head);
 	if (fd_head->tvb_data)
 		tvb_free(fd_head->tvb_data);
 	g_slice_free(fragment_item, fd_head);
@@ -614,6 +638,7 @@ fragment_delete(reassembly_table *table, const packet_info *pinfo,
 		g_slice_free(fragment_item, fd);
 		fd=tmp_fd;
 	}
+	fragment_index_free(fd_head);
 	g_slice_free(fragment_head, fd_head);
 	g_hash_table_remove(table->fragment_table, key);
 
@@ -968,6 +993,108 @@ MERGE_FRAG(fragment_head *fd_head, fragment_item *fd)
 	fd_i->next = fd;
 }
 
+/*
+ * Index the fragments already in the list, e.g. after the reassembly has
+ * been reset with fragment_reset_defragmentation().
+ */
+static void
+fragment_index_new(fragment_head *fd_head)
+{
+	fragment_index *fi;
+	fragment_item *fd_i;
+
+	fi = g_slice_new(fragment_index);
+	fi->by_offset = wmem_tree_new(NULL);
+	fi->contiguous = 0;
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		wmem_tree_insert32(fi->by_offset, fd_i->offset, fd_i);
+		if ( ((fd_i->offset)<=fi->contiguous) &&
+			((fd_i->offset+fd_i->len)>fi->contiguous) ){
+			fi->contiguous = fd_i->offset+fd_i->len;
+		}
+	}
+	fd_head->frag_index = fi;
+}
+
+/*
+ * Like LINK_FRAG(), but find where the fragment goes with the index, and
+ * add the data that it and the fragments after it join up to the
+ * contiguous data.
+ */
+static void
+LINK_FRAG_INDEXED(fragment_head *fd_head, fragment_item *fd)
+{
+	fragment_index *fi = fd_head->frag_index;
+	fragment_item *fd_i;
+
+	/* after the last fragment that doesn't start after this one */
+	fd_i = (fragment_item *)wmem_tree_lookup32_le(fi->by_offset, fd->offset);
+	if (fd_i == NULL)
+		fd_i = fd_head;
+	fd->next=fd_i->next;
+	fd_i->next=fd;
+	wmem_tree_insert32(fi->by_offset, fd->offset, fd);
+
+	if ( ((fd->offset)<=fi->contiguous) &&
+		((fd->offset+fd->len)>fi->contiguous) ){
+		/*
+		 * All the fragments that start at or before the end of the
+		 * contiguous data end there too; the ones after them might
+		 * now join up.
+		 */
+		fd_i = (fragment_item *)wmem_tree_lookup32_le(fi->by_offset, fi->contiguous);
+		fi->contiguous = fd->offset+fd->len;
+		for (fd_i = fd_i->next; fd_i && fd_i->offset <= fi->contiguous; fd_i = fd_i->next) {
+			if ((fd_i->offset+fd_i->len)>fi->contiguous)
+				fi->contiguous = fd_i->offset+fd_i->len;
+		}
+	}
+}
+
+typedef struct {
+	tvbuff_t *tvb;
+	guint32 offset;			/* in the reassembled data */
+} fragment_member;
+
+/*
+ * PDUs at least this long are reassembled into a composite of the
+ * fragments' data; shorter ones are copied into one buffer.
+ */
+#define REASSEMBLE_COMPOSITE_MIN_LEN	(256*1024)
+
+/*
+ * Compare len bytes of data with the reassembled data at offset, which is
+ * covered by the members collected so far. Returns TRUE if they differ.
+ */
+static gboolean
+fragment_members_differ(const GArray *members, guint32 offset,
+			const guint8 *data, guint32 len)
+{
+	const fragment_member *m;
+	guint i = members->len;
+	guint32 m_offset, m_len;
+
+	/* find the member in which offset is */
+	do {
+		DISSECTOR_ASSERT(i > 0);
+		m = &g_array_index(members, fragment_member, --i);
+	} while (m->offset > offset);
+
+	for (; len > 0; i++) {
+		DISSECTOR_ASSERT(i < members->len);
+		m = &g_array_index(members, fragment_member, i);
+		m_offset = offset - m->offset;
+		m_len = MIN(len, tvb_captured_length(m->tvb) - m_offset);
+		if (tvb_memeql(m->tvb, m_offset, data, m_len))
+			return TRUE;
+		offset += m_len;
+		data += m_len;
+		len -= m_len;
+	}
+
+	return FALSE;
+}
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -996,9 +1123,11 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 {
 	fragment_item *fd;
 	fragment_item *fd_i;
-	guint32 max, dfpos, fraglen;
+	guint32 dfpos, fraglen;
 	tvbuff_t *old_tvb_data;
-	guint8 *data;
+	GArray *members;
+	fragment_member member;
+	guint i;
 
 	/* create new fd describing this fragment */
 	fd = g_slice_new(fragment_item);
@@ -1009,6 +1138,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->fragment_nr_offset = 0; /* will only be used with sequence */
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
+	fd->frag_index = NULL;
 	fd->error = NULL;
 
 	/*
@@ -1121,10 +1251,20 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 			fd_head->flags |= FD_TOOLONGFRAGMENT;
 		}
 		/* make sure it doesn't conflict with previous data */
-		else if ( tvb_memeql(fd_head->tvb_data, fd->offset,
-			tvb_get_ptr(tvb,offset,fd->len),fd->len) ){
-			fd->flags	   |= FD_OVERLAPCONFLICT;
-			fd_head->flags |= FD_OVERLAPCONFLICT;
+		else if (fd->len) {
+			/*
+			 * Copy the previous data rather than compare it in
+			 * place, so that a composite of several fragments
+			 * isn't made contiguous just for that.
+			 */
+			const guint8 *frag_data = tvb_get_ptr(tvb,offset,fd->len);
+			guint8 *prev_data = (guint8 *)tvb_memdup(NULL, fd_head->tvb_data, fd->offset, fd->len);
+
+			if ( memcmp(prev_data, frag_data, fd->len) ){
+				fd->flags	   |= FD_OVERLAPCONFLICT;
+				fd_head->flags |= FD_OVERLAPCONFLICT;
+			}
+			g_free(prev_data);
 		}
 		/* it was just an overlap, link it and return */
 		LINK_FRAG(fd_head,fd);
@@ -1141,7 +1281,9 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		THROW(BoundsError);
 	}
 	fd->tvb_data = tvb_clone_offset_len(tvb, offset, fd->len);
-	LINK_FRAG(fd_head,fd);
+	if (!fd_head->frag_index)
+		fragment_index_new(fd_head);
+	LINK_FRAG_INDEXED(fd_head,fd);
 
 
 	if( !(fd_head->flags & FD_DATALEN_SET) ){
@@ -1154,23 +1296,12 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 	/*
 	 * Check if we have received the entire fragment.
-	 * This is easy since the list is sorted and the head is faked.
 	 *
-	 * First, we compute the amount of contiguous data that's
-	 * available.  (The check for fd_i->offset <= max rules out
-	 * fragments that don't start before or at the end of the
-	 * previous fragment, i.e. fragments that have a gap between
-	 * them and the previous fragment.)
+	 * The index keeps the amount of contiguous data that's
+	 * available, i.e. up to the first gap between a fragment
+	 * and the fragments before it.
 	 */
-	max = 0;
-	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if ( ((fd_i->offset)<=max) &&
-			((fd_i->offset+fd_i->len)>max) ){
-			max = fd_i->offset+fd_i->len;
-		}
-	}
-
-	if (max < (fd_head->datalen)) {
+	if (fd_head->frag_index->contiguous < (fd_head->datalen)) {
 		/*
 		 * The amount of contiguous data we have is less than the
 		 * amount of data we're trying to reassemble, so we haven't
@@ -1182,18 +1313,24 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	/* we have received an entire packet, defragment it and
 	 * free all fragments
 	 */
+	fragment_index_free(fd_head);
+
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
-	data = (guint8 *) g_malloc(fd_head->datalen);
-	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+
+	/*
+	 * The reassembled data is a composite of the data of the
+	 * fragments, without the parts that overlap the fragments
+	 * before them, rather than a copy of it.
+	 */
+	members = g_array_new(FALSE, FALSE, sizeof(fragment_member));
 
 	/* add all data fragments */
 	for (dfpos=0,fd_i=fd_head;fd_i;fd_i=fd_i->next) {
 		if (fd_i->len) {
 			/*
-			 * The loop above that calculates max also
-			 * ensures that the only gaps that exist here
+			 * The amount of contiguous data in the index
+			 * also ensures that the only gaps that exist here
 			 * are ones where a fragment starts past the
 			 * end of the reassembled datagram, and there's
 			 * a gap between the previous fragment and
@@ -1206,7 +1343,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 			 *
 			 * Note that the "overlap" compare must only be
 			 * done for fragments with (offset+len) <= fd_head->datalen
-			 * and thus within the newly g_malloc'd buffer.
+			 * and thus within the members collected so far.
 			 */
 			if (fd_i->offset + fd_i->len > dfpos) {
 				if (fd_i->offset >= fd_head->datalen) {
@@ -1234,7 +1371,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					 * already rejected fragments that
 					 * start past the end of the
 					 * reassembled datagram, and
-					 * the loop that calculated max
+					 * the amount of contiguous data
 					 * should have ruled out gaps,
 					 * but could fd_i->offset +
 					 * fd_i->len overflow?
@@ -1242,8 +1379,6 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					fd_head->error = "dfpos < offset";
 				} else if (dfpos - fd_i->offset > fd_i->len)
 					fd_head->error = "dfpos - offset > len";
-				else if (!fd_head->tvb_data)
-					fd_head->error = "no data";
 				else {
 					fraglen = fd_i->len;
 					if (fd_i->offset + fraglen > fd_head->datalen) {
@@ -1258,7 +1393,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 						 * added to the reassembly.
 						 *
 						 * Mark it as such, and only
-						 * copy from it what fits in
+						 * use from it what fits in
 						 * the packet.
 						 */
 						fd_i->flags    |= FD_TOOLONGFRAGMENT;
@@ -1270,7 +1405,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 						fd_i->flags    |= FD_OVERLAP;
 						fd_head->flags |= FD_OVERLAP;
-						if ( memcmp(data + fd_i->offset,
+						if ( fragment_members_differ(members, fd_i->offset,
 								tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
 								cmp_len)
 								 ) {
@@ -1283,10 +1418,24 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 						 * XXX - can this happen?
 						 */
 						fd_head->error = "fraglen < dfpos - offset";
-					} else {
-						memcpy(data+dfpos,
-							tvb_get_ptr(fd_i->tvb_data, (dfpos-fd_i->offset), fraglen-(dfpos-fd_i->offset)),
-							fraglen-(dfpos-fd_i->offset));
+					} else if (fraglen > dfpos - fd_i->offset) {
+						member.offset = dfpos;
+						if (fd_i->offset == dfpos &&
+						    fraglen == tvb_captured_length(fd_i->tvb_data) &&
+						    !(fd_i->flags & FD_SUBSET_TVB)) {
+							/*
+							 * All of the fragment's own
+							 * data is used; the
+							 * reassembled data takes
+							 * it over.
+							 */
+							member.tvb = fd_i->tvb_data;
+							fd_i->tvb_data = NULL;
+						} else {
+							member.tvb = tvb_clone_offset_len(fd_i->tvb_data,
+								(dfpos-fd_i->offset), fraglen-(dfpos-fd_i->offset));
+						}
+						g_array_append_val(members, member);
 						dfpos=MAX(dfpos, (fd_i->offset + fraglen));
 					}
 				}
@@ -1306,6 +1455,49 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		}
 	}
 
+	if (dfpos < fd_head->datalen) {
+		/*
+		 * There was an error above; keep the reassembled data
+		 * as long as the packet anyway.
+		 */
+		guint8 *data = (guint8 *)g_malloc0(fd_head->datalen - dfpos);
+
+		member.tvb = tvb_new_real_data(data, fd_head->datalen - dfpos, fd_head->datalen - dfpos);
+		tvb_set_free_cb(member.tvb, g_free);
+		member.offset = dfpos;
+		g_array_append_val(members, member);
+	}
+
+	if (members->len == 0) {
+		fd_head->tvb_data = tvb_new_real_data(NULL, 0, 0);
+	} else if (members->len == 1) {
+		fd_head->tvb_data = g_array_index(members, fragment_member, 0).tvb;
+	} else if (fd_head->datalen < REASSEMBLE_COMPOSITE_MIN_LEN) {
+		/*
+		 * A pointer into a composite that spans members makes it
+		 * copy all of its data into one buffer anyway. Most PDUs
+		 * are small and get parsed that way, so copy them once
+		 * here instead.
+		 */
+		guint8 *data = (guint8 *)g_malloc(fd_head->datalen);
+
+		for (i = 0; i < members->len; i++) {
+			member = g_array_index(members, fragment_member, i);
+			tvb_memcpy(member.tvb, data + member.offset, 0,
+			    tvb_captured_length(member.tvb));
+			tvb_free(member.tvb);
+		}
+		fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	} else {
+		fd_head->tvb_data = tvb_new_composite();
+		for (i = 0; i < members->len; i++)
+			tvb_composite_append(fd_head->tvb_data,
+			    g_array_index(members, fragment_member, i).tvb);
+		tvb_composite_finalize_owning(fd_head->tvb_data);
+	}
+	g_array_free(members, TRUE);
+
 	if (old_tvb_data)
 		tvb_add_to_chain(tvb, old_tvb_data);
 	/* mark this packet as defragmented.
@@ -1740,6 +1932,7 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->offset = frag_number_work;
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
+	fd->frag_index = NULL;
 	fd->error = NULL;
 
 	/* fd_head->frame is the maximum of the frame numbers of all the
@@ -2497,6 +2690,7 @@ fragment_start_seq_check(reassembly_table *table, const packet_info *pinfo,
 		fd_head->reas_in_layer_num = 0;
 		fd_head->flags = FD_BLOCKSEQUENCE|FD_DATALEN_SET;
 		fd_head->tvb_data = NULL;
+		fd_head->frag_index = NULL;
 		fd_head->error = NULL;
 
 		insert_fd_head(table, fd_head, pinfo, id, data);
@@ -2873,6 +3067,106 @@ reassembly_table_cleanup_reg_tables(void)
 	g_list_foreach(reassembly_table_list, reassembly_table_cleanup_reg_table, NULL);
 }
 
+/*
+ * For a fragment hash table entry, free the fragments if none of them
+ * arrived in or after the frame passed in user_data.  Heads without any
+ * fragments yet are kept, as they carry no frame number to go by.
+ */
+static gboolean
+prune_stale_fragments(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	guint32 oldest_frame = GPOINTER_TO_UINT(user_data);
+	fragment_head *fd_head = (fragment_head *)value;
+	fragment_item *fd_i;
+
+	if (fd_head->next == NULL)
+		return FALSE;
+
+	for (fd_i = fd_head->next; fd_i != NULL; fd_i = fd_i->next) {
+		if (fd_i->frame >= oldest_frame)
+			return FALSE;
+	}
+
+	return free_all_fragments(key_arg, value, NULL);
+}
+
+typedef struct {
+	guint32 oldest_frame;
+	GHashTable *keep;		/* reassembled heads still referenced by newer frames */
+	GPtrArray *allocated_fragments;
+} prune_reassembled_t;
+
+static void
+find_live_reassembled(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	const reassembled_key *key = (const reassembled_key *)key_arg;
+	fragment_head *fd_head = (fragment_head *)value;
+	prune_reassembled_t *prune = (prune_reassembled_t *)user_data;
+
+	if (key->frame >= prune->oldest_frame ||
+	    fd_head->reassembled_in >= prune->oldest_frame)
+		g_hash_table_add(prune->keep, fd_head);
+}
+
+static gboolean
+prune_stale_reassembled(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	prune_reassembled_t *prune = (prune_reassembled_t *)user_data;
+
+	if (g_hash_table_contains(prune->keep, value))
+		return FALSE;
+
+	return free_all_reassembled_fragments(key_arg, value, prune->allocated_fragments);
+}
+
+/*
+ * Drop reassemblies that have not received a fragment since before
+ * oldest_frame, and reassembled packets that were completed before it.
+ * Only valid when frames are dissected once and in order.
+ */
+guint
+reassembly_table_prune(reassembly_table *table, const guint32 oldest_frame)
+{
+	guint pruned = 0;
+
+	if (table->fragment_table != NULL) {
+		pruned += g_hash_table_foreach_remove(table->fragment_table,
+		    prune_stale_fragments, GUINT_TO_POINTER(oldest_frame));
+	}
+	if (table->reassembled_table != NULL) {
+		prune_reassembled_t prune;
+
+		prune.oldest_frame = oldest_frame;
+		prune.keep = g_hash_table_new(g_direct_hash, g_direct_equal);
+		prune.allocated_fragments = g_ptr_array_new();
+
+		g_hash_table_foreach(table->reassembled_table,
+		    find_live_reassembled, &prune);
+		pruned += g_hash_table_foreach_remove(table->reassembled_table,
+		    prune_stale_reassembled, &prune);
+
+		g_ptr_array_foreach(prune.allocated_fragments, free_fragments, NULL);
+		g_ptr_array_free(prune.allocated_fragments, TRUE);
+		g_hash_table_destroy(prune.keep);
+	}
+
+	return pruned;
+}
+
+guint
+reassembly_tables_prune(const guint32 oldest_frame)
+{
+	GList *l;
+	guint pruned = 0;
+
+	for (l = reassembly_table_list; l != NULL; l = l->next) {
+		register_reassembly_table_t* reg_table = (register_reassembly_table_t*)l->data;
+		pruned += reassembly_table_prune(reg_table->table, oldest_frame);
+	}
+
+	return pruned;
+}
+
 void reassembly_tables_init(void)
 {
 	register_init_routine(&reassembly_table_init_reg_tables);
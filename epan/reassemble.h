@@ -74,6 +74,10 @@ typedef struct _fragment_item {
 					 * heads and others only to fragments within
 					 * a reassembly? */
 	tvbuff_t *tvb_data;
+	struct _fragment_index *frag_index;	/**< only in the first item, while
+					 * fragments are added by byte offset:
+					 * the fragments by offset and the
+					 * amount of contiguous data */
 	/**
 	 * Null if the reassembly had no error; non-null if it had
 	 * an error, in which case it's the string for the error.
@@ -175,6 +179,14 @@ reassembly_table_init(reassembly_table *table,
 WS_DLL_PUBLIC void
 reassembly_table_destroy(reassembly_table *table);
 
+/*
+ * Drop reassemblies whose most recent fragment, and reassembled packets
+ * completed, before oldest_frame; returns the number of entries removed.
+ * Used in streaming mode, where every frame is dissected once and in order.
+ */
+WS_DLL_PUBLIC guint
+reassembly_table_prune(reassembly_table *table, const guint32 oldest_frame);
+
 /*
  * This function adds a new fragment to the reassembly table
  * If this is the first fragment seen for this datagram, a new entry
@@ -466,6 +478,10 @@ show_fragment_seq_tree(fragment_head *ipfd_head, const fragment_items *fit,
  */
 extern void reassembly_tables_init(void);
 
+/* Prune all registered tables; see reassembly_table_prune()
+ */
+extern guint reassembly_tables_prune(const guint32 oldest_frame);
+
 /* Cleanup internal structures
  */
 extern void
@@ -2,7 +2,7 @@
  * Standalone program to test functionality of reassemble.h API
  *
  * These aren't particularly complete - they just test a few corners of
- * functionality which I was interested in. In particular, they only test the
+ * functionality which I was interested in. In particular, they mostly test the
  * fragment_add_seq_* (ie, FD_BLOCKSEQUENCE) family of routines. However,
  * hopefully they will inspire people to write additional tests, and provide a
  * useful basis on which to do so.
@@ -1250,6 +1250,177 @@ test_fragment_add_seq_check_multiple(void) {
 }
 #endif
 
+/**********************************************************************************
+ *
+ * fragment_add
+ *
+ *********************************************************************************/
+
+/* Adds overlapping fragments out of order, and checks that they are
+ * reassembled correctly and that the overlaps are flagged.
+ */
+/*   visit  id  frame  frag_offset  len  more  tvb_offset
+       0    12     1        90       50   F       0
+       0    12     2        45       20   T      55
+       0    12     3        40       60   T      50
+       0    12     4         0       50   T      10
+*/
+static void
+test_fragment_add_overlap(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+
+    printf("Starting test test_fragment_add_overlap\n");
+
+    pinfo.num = 1;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
+                         90, 50, FALSE);
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 2;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 55, &pinfo, 12, NULL,
+                         45, 20, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 3;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 50, &pinfo, 12, NULL,
+                         40, 60, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    /* fills the gap at the start */
+    pinfo.num = 4;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                         0, 50, TRUE);
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    /* check the contents of the structure */
+    ASSERT_EQ(4,fd_head->frame);  /* max frame number of fragment in assembly */
+    ASSERT_EQ(140,fd_head->datalen);
+    ASSERT_EQ(4,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP|FD_OVERLAPCONFLICT,fd_head->flags);
+    ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+    ASSERT_EQ(140,tvb_captured_length(fd_head->tvb_data));
+
+    fd = fd_head->next;
+    ASSERT_NE_POINTER(NULL,fd);
+    ASSERT_EQ(4,fd->frame);
+    ASSERT_EQ(0,fd->offset);
+    ASSERT_EQ(0,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+
+    /* agrees with the first fragment where they overlap */
+    fd = fd->next;
+    ASSERT_NE_POINTER(NULL,fd);
+    ASSERT_EQ(3,fd->frame);
+    ASSERT_EQ(40,fd->offset);
+    ASSERT_EQ(FD_OVERLAP,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+
+    /* agrees with both fragments before it */
+    fd = fd->next;
+    ASSERT_NE_POINTER(NULL,fd);
+    ASSERT_EQ(2,fd->frame);
+    ASSERT_EQ(45,fd->offset);
+    ASSERT_EQ(FD_OVERLAP,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+
+    /* disagrees with the data of frame 3 */
+    fd = fd->next;
+    ASSERT_NE_POINTER(NULL,fd);
+    ASSERT_EQ(1,fd->frame);
+    ASSERT_EQ(90,fd->offset);
+    ASSERT_EQ(FD_OVERLAP|FD_OVERLAPCONFLICT,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    ASSERT_EQ_POINTER(NULL,fd->next);
+
+    /* test the actual reassembly */
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data+10,50));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,50,data+60,50));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,100,data+10,40));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,40,data+50,20));
+}
+
+#define LARGE_PDU_FRAGMENTS 10000
+#define LARGE_PDU_FRAGMENT_LEN 100
+
+/* Reassembles a PDU of many fragments, once in order and once out of
+ * order, and reports how long adding the fragments and reading the
+ * reassembled data back across the fragment boundaries take.
+ */
+static void
+test_fragment_add_large_pdu(void)
+{
+    const guint32 pdu_len = LARGE_PDU_FRAGMENTS * LARGE_PDU_FRAGMENT_LEN;
+    guint8 *pdu;
+    guint8 buf[LARGE_PDU_FRAGMENT_LEN];
+    tvbuff_t *pdu_tvb;
+    fragment_head *fd_head = NULL;
+    fragment_item *fd;
+    guint32 i, nr, pass, count, offset;
+    gint64 start, added;
+
+    printf("Starting test test_fragment_add_large_pdu\n");
+
+    pdu = (guint8 *)g_malloc(pdu_len);
+    for (i = 0; i < pdu_len; i++) {
+        pdu[i] = (guint8)(i * 7 + (i >> 8));
+    }
+    pdu_tvb = tvb_new_real_data(pdu, pdu_len, pdu_len);
+
+    for (pass = 0; pass < 2; pass++) {
+        start = g_get_monotonic_time();
+        for (i = 0; i < LARGE_PDU_FRAGMENTS; i++) {
+            /* the second time, jump around the PDU */
+            nr = pass == 0 ? i : (i * 7919) % LARGE_PDU_FRAGMENTS;
+            pinfo.num = pass * LARGE_PDU_FRAGMENTS + i + 1;
+            fd_head=fragment_add(&test_reassembly_table, pdu_tvb,
+                                 nr * LARGE_PDU_FRAGMENT_LEN, &pinfo, 20 + pass, NULL,
+                                 nr * LARGE_PDU_FRAGMENT_LEN, LARGE_PDU_FRAGMENT_LEN,
+                                 nr != LARGE_PDU_FRAGMENTS - 1);
+            if (i != LARGE_PDU_FRAGMENTS - 1) {
+                ASSERT_EQ_POINTER(NULL,fd_head);
+            }
+        }
+        added = g_get_monotonic_time();
+
+        ASSERT_NE_POINTER(NULL,fd_head);
+        ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+        ASSERT_EQ(pdu_len,fd_head->datalen);
+        ASSERT_EQ(pdu_len,tvb_captured_length(fd_head->tvb_data));
+
+        for (offset = LARGE_PDU_FRAGMENT_LEN / 2;
+             offset + LARGE_PDU_FRAGMENT_LEN <= pdu_len;
+             offset += LARGE_PDU_FRAGMENT_LEN) {
+            tvb_memcpy(fd_head->tvb_data, buf, offset, LARGE_PDU_FRAGMENT_LEN);
+            ASSERT(!memcmp(buf, pdu + offset, LARGE_PDU_FRAGMENT_LEN));
+        }
+
+        printf("    %u fragments of %u bytes %s: added in %.1f ms, read back in %.1f ms\n",
+               LARGE_PDU_FRAGMENTS, LARGE_PDU_FRAGMENT_LEN,
+               pass == 0 ? "in order" : "out of order",
+               (added - start) / 1000.0, (g_get_monotonic_time() - added) / 1000.0);
+
+        /* the fragments are sorted by offset */
+        count = 0;
+        for (fd = fd_head->next; fd; fd = fd->next) {
+            ASSERT_EQ(count * LARGE_PDU_FRAGMENT_LEN,fd->offset);
+            ASSERT_EQ(LARGE_PDU_FRAGMENT_LEN,fd->len);
+            ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+            count++;
+        }
+        ASSERT_EQ(LARGE_PDU_FRAGMENTS,count);
+
+        ASSERT(!tvb_memeql(fd_head->tvb_data,0,pdu,pdu_len));
+    }
+    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
+
+    tvb_free(pdu_tvb);
+    g_free(pdu);
+}
+
 /**********************************************************************************
  *
  * fragment_add_seq_next
@@ -1534,6 +1705,8 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_seq_check_1,
         test_fragment_add_seq_802_11_0,
         test_fragment_add_seq_802_11_1,
+        test_fragment_add_overlap,                 /* frag table only   */
+        test_fragment_add_large_pdu,
         test_simple_fragment_add_seq_next,
 #if 0
         test_missing_data_fragment_add_seq_next,
@@ -0,0 +1,248 @@
+/* resolv_db.c
+ * Routines for the precompiled name resolution databases
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/crc32.h>
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#include "resolv_db.h"
+
+#define RESOLV_DB_MAGIC         "WSRESDB"       /* and a NUL */
+#define RESOLV_DB_MAGIC_LEN     8
+#define RESOLV_DB_VERSION       2
+
+#define RESOLV_DB_HEADER_LEN    48
+#define RESOLV_DB_SECTION_LEN   20
+
+typedef struct {
+    const guint8 *records;
+    guint         count;
+    guint         key_len;
+    guint         n_strings;
+    guint         record_len;
+} resolv_db_section_t;
+
+struct resolv_db {
+    GMappedFile        *mapped;
+    const char         *strings;
+    guint32             strings_len;
+    resolv_db_section_t sections[RESOLV_DB_NUM_SECTIONS];
+};
+
+/* The key length and number of strings of each section type */
+static const struct {
+    guint key_len;
+    guint n_strings;
+} section_layout[RESOLV_DB_NUM_SECTIONS] = {
+    { 0, 0 },
+    { 3, 2 },   /* RESOLV_DB_MANUF */
+    { 6, 1 },   /* RESOLV_DB_WKA */
+    { 6, 1 },   /* RESOLV_DB_ETHER */
+    { 2, 4 },   /* RESOLV_DB_SERVICES */
+    { 4, 1 },   /* RESOLV_DB_ENTERPRISES */
+};
+
+/*
+ * Was the database compiled from the text file as it is now? The sizes
+ * must match. If the modification times match too, that's enough;
+ * otherwise, as after the file has been copied, compare the CRC of the
+ * file with the one recorded.
+ */
+static gboolean
+resolv_db_source_matches(const guint8 *data, const char *source_path,
+                         const ws_statb64 *source_stat)
+{
+    GMappedFile *source;
+    guint32 crc;
+
+    if (pletoh64(data + 16) != (guint64)source_stat->st_size)
+        return FALSE;
+    if ((gint64)pletoh64(data + 32) == (gint64)source_stat->st_mtime)
+        return TRUE;
+
+    source = g_mapped_file_new(source_path, FALSE, NULL);
+    if (source == NULL)
+        return FALSE;
+    crc = crc32_ccitt((const guint8 *)g_mapped_file_get_contents(source),
+                      (guint)g_mapped_file_get_length(source));
+    g_mapped_file_unref(source);
+    return crc == pletoh32(data + 40);
+}
+
+static gboolean
+resolv_db_check(resolv_db_t *db, const guint8 *data, gsize len,
+                const char *source_path, const ws_statb64 *source_stat)
+{
+    guint32 n_sections, strings_offset, strings_len;
+    guint32 type, key_len, n_strings, count, offset;
+    guint32 i;
+
+    if (len < RESOLV_DB_HEADER_LEN ||
+        memcmp(data, RESOLV_DB_MAGIC, RESOLV_DB_MAGIC_LEN) != 0 ||
+        pletoh32(data + 8) != RESOLV_DB_VERSION ||
+        !resolv_db_source_matches(data, source_path, source_stat))
+        return FALSE;
+
+    n_sections = pletoh32(data + 12);
+    strings_offset = pletoh32(data + 24);
+    strings_len = pletoh32(data + 28);
+    /* The string area must end with a NUL, so every string in it does */
+    if (strings_len == 0 || (guint64)strings_offset + strings_len > len ||
+        data[strings_offset + strings_len - 1] != '\0')
+        return FALSE;
+    if ((guint64)RESOLV_DB_HEADER_LEN + (guint64)n_sections * RESOLV_DB_SECTION_LEN > len)
+        return FALSE;
+    db->strings = (const char *)data + strings_offset;
+    db->strings_len = strings_len;
+
+    for (i = 0; i < n_sections; i++) {
+        const guint8 *section = data + RESOLV_DB_HEADER_LEN + i * RESOLV_DB_SECTION_LEN;
+        guint record_len;
+
+        type = pletoh32(section);
+        key_len = pletoh32(section + 4);
+        n_strings = pletoh32(section + 8);
+        count = pletoh32(section + 12);
+        offset = pletoh32(section + 16);
+
+        /* Skip section types we don't know about */
+        if (type == 0 || type >= RESOLV_DB_NUM_SECTIONS)
+            continue;
+        if (key_len != section_layout[type].key_len ||
+            n_strings != section_layout[type].n_strings)
+            return FALSE;
+        record_len = key_len + 4 * n_strings;
+        if ((guint64)offset + (guint64)count * record_len > len)
+            return FALSE;
+
+        db->sections[type].records = data + offset;
+        db->sections[type].count = count;
+        db->sections[type].key_len = key_len;
+        db->sections[type].n_strings = n_strings;
+        db->sections[type].record_len = record_len;
+    }
+    return TRUE;
+}
+
+resolv_db_t *
+resolv_db_open(const char *source_path)
+{
+    ws_statb64   source_stat;
+    char        *db_path;
+    GMappedFile *mapped;
+    resolv_db_t *db;
+
+    /* Don't use a database that doesn't match the text file */
+    if (source_path == NULL || ws_stat64(source_path, &source_stat) != 0)
+        return NULL;
+
+    db_path = g_strconcat(source_path, ".db", NULL);
+    mapped = g_mapped_file_new(db_path, FALSE, NULL);
+    g_free(db_path);
+    if (mapped == NULL)
+        return NULL;
+
+    db = g_new0(resolv_db_t, 1);
+    db->mapped = mapped;
+    if (!resolv_db_check(db, (const guint8 *)g_mapped_file_get_contents(mapped),
+                         g_mapped_file_get_length(mapped), source_path, &source_stat)) {
+        resolv_db_close(db);
+        return NULL;
+    }
+    return db;
+}
+
+void
+resolv_db_close(resolv_db_t *db)
+{
+    if (db == NULL)
+        return;
+
+    g_mapped_file_unref(db->mapped);
+    g_free(db);
+}
+
+guint
+resolv_db_count(const resolv_db_t *db, resolv_db_section_e section)
+{
+    if (db == NULL)
+        return 0;
+
+    return db->sections[section].count;
+}
+
+const guint8 *
+resolv_db_record(const resolv_db_t *db, resolv_db_section_e section, guint idx)
+{
+    const resolv_db_section_t *sec = &db->sections[section];
+
+    g_assert(idx < sec->count);
+    return sec->records + (gsize)idx * sec->record_len;
+}
+
+const guint8 *
+resolv_db_find(const resolv_db_t *db, resolv_db_section_e section, const guint8 *key)
+{
+    const resolv_db_section_t *sec;
+    guint low, high, mid;
+    const guint8 *record;
+    int cmp;
+
+    if (db == NULL)
+        return NULL;
+
+    sec = &db->sections[section];
+    low = 0;
+    high = sec->count;
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        record = sec->records + (gsize)mid * sec->record_len;
+        cmp = memcmp(key, record, sec->key_len);
+        if (cmp == 0)
+            return record;
+        if (cmp < 0)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    return NULL;
+}
+
+const char *
+resolv_db_string(const resolv_db_t *db, resolv_db_section_e section, const guint8 *record, guint idx)
+{
+    const resolv_db_section_t *sec = &db->sections[section];
+    guint32 offset;
+
+    g_assert(idx < sec->n_strings);
+    offset = pletoh32(record + sec->key_len + 4 * idx);
+    if (offset == 0 || offset >= db->strings_len)
+        return NULL;
+    return db->strings + offset;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,100 @@
+/* resolv_db.h
+ * Definitions for the precompiled name resolution databases
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __RESOLV_DB_H__
+#define __RESOLV_DB_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * tools/make-resolv-db.py compiles the global manuf, wka, services and
+ * enterprises.tsv files into "<file>.db" next to them. addr_resolv.c maps
+ * those read-only instead of parsing the text files, so the tables cost
+ * next to nothing at startup and the pages are shared between processes.
+ *
+ * The file starts with a header:
+ *
+ *     "WSRESDB\0", version, number of sections, size of the text file it
+ *     was compiled from, offset and size of the string area, modification
+ *     time (seconds since the Epoch) and CRC-32 of the text file, padding
+ *
+ * followed by a table of sections:
+ *
+ *     type, key length, strings per record, number of records, offset
+ *
+ * A section is an array of fixed-size records sorted by key, so lookups
+ * are a binary search. A record is the key (numbers big-endian, so they
+ * sort the same with memcmp()) followed by the offsets of its strings in
+ * the string area. The strings are NUL-terminated; offset 0 means "none".
+ * All other numbers are little-endian.
+ *
+ * A database is only used if the text file next to it has the size
+ * recorded in it, and either the modification time or, if that differs,
+ * as when the file was copied, the CRC-32; otherwise the text file is
+ * parsed as before.
+ */
+
+typedef enum {
+    RESOLV_DB_MANUF = 1,        /* OUI -> short name, long name */
+    RESOLV_DB_WKA,              /* masked address -> name */
+    RESOLV_DB_ETHER,            /* full address -> name */
+    RESOLV_DB_SERVICES,         /* port -> TCP, UDP, SCTP, DCCP name */
+    RESOLV_DB_ENTERPRISES,      /* enterprise number -> name */
+    RESOLV_DB_NUM_SECTIONS
+} resolv_db_section_e;
+
+typedef struct resolv_db resolv_db_t;
+
+/**
+ * Map the database compiled from source_path. Returns NULL if there is
+ * none, or if it's out of date or unusable.
+ */
+resolv_db_t *resolv_db_open(const char *source_path);
+
+/** Unmap a database; db may be NULL. */
+void resolv_db_close(resolv_db_t *db);
+
+/** Number of records in a section; 0 if db is NULL. */
+guint resolv_db_count(const resolv_db_t *db, resolv_db_section_e section);
+
+/** The idx'th record of a section, in key order. */
+const guint8 *resolv_db_record(const resolv_db_t *db, resolv_db_section_e section, guint idx);
+
+/**
+ * Find the record with the given key, which has the section's key length.
+ * Returns NULL if there is none or db is NULL.
+ */
+const guint8 *resolv_db_find(const resolv_db_t *db, resolv_db_section_e section, const guint8 *key);
+
+/** The idx'th string of a record, or NULL if it has none. */
+const char *resolv_db_string(const resolv_db_t *db, resolv_db_section_e section, const guint8 *record, guint idx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __RESOLV_DB_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
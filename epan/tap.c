@@ -33,6 +33,7 @@ typedef struct _tap_dissector_t {
 	char *name;
 } tap_dissector_t;
 static tap_dissector_t *tap_dissector_list=NULL;
+static int tap_dissector_count=0;
 
 /*
  * This is the list of free and used packets queued for a tap.
@@ -72,8 +73,10 @@ typedef struct _tap_packet_t {
 
 #define TAP_PACKET_IS_ERROR_PACKET	0x00000001	/* packet being queued is an error packet */
 
-#define TAP_PACKET_QUEUE_LEN 5000
-static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
+/* The queue grows as needed and keeps its size for the following packets. */
+#define TAP_PACKET_QUEUE_INITIAL_LEN 64
+static tap_packet_t *tap_packet_array=NULL;
+static guint tap_packet_array_len=0;
 static guint tap_packet_index;
 
 typedef struct _tap_listener_t {
@@ -84,6 +87,7 @@ typedef struct _tap_listener_t {
 	guint flags;
 	gchar *fstring;
 	dfilter_t *code;
+	gint set_index;		/* index of code in tap_filter_set, or -1 */
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -93,6 +97,59 @@ typedef struct _tap_listener_t {
 
 static tap_listener_t *tap_listener_queue=NULL;
 
+/* Indexes built from tap_listener_queue on first use after a listener or
+ * filter has changed:
+ * tap_listeners_by_id[tap_id] holds the listeners of that tap, in queue
+ * order, so a queued packet is only offered to the listeners of its tap.
+ * tap_filter_set holds the filters of all listeners, merged so that fields
+ * and tests common to several listeners are evaluated once per packet. */
+static GPtrArray **tap_listeners_by_id=NULL;
+static int tap_listeners_by_id_len=0;
+static dfilter_set_t *tap_filter_set=NULL;
+static gboolean tap_listeners_stale=TRUE;
+
+static void
+tap_listeners_index_free(void)
+{
+	int i;
+
+	for(i=0;i<tap_listeners_by_id_len;i++){
+		if(tap_listeners_by_id[i]){
+			g_ptr_array_free(tap_listeners_by_id[i], TRUE);
+		}
+	}
+	g_free(tap_listeners_by_id);
+	tap_listeners_by_id=NULL;
+	tap_listeners_by_id_len=0;
+	dfilter_set_free(tap_filter_set);
+	tap_filter_set=NULL;
+}
+
+static void
+tap_listeners_index_build(void)
+{
+	tap_listener_t *tl;
+
+	tap_listeners_index_free();
+
+	tap_listeners_by_id_len=tap_dissector_count+1;
+	tap_listeners_by_id=g_new0(GPtrArray *, tap_listeners_by_id_len);
+	tap_filter_set=dfilter_set_new();
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(!tap_listeners_by_id[tl->tap_id]){
+			tap_listeners_by_id[tl->tap_id]=g_ptr_array_new();
+		}
+		g_ptr_array_add(tap_listeners_by_id[tl->tap_id], tl);
+
+		if(tl->code){
+			tl->set_index=dfilter_set_add(tap_filter_set, tl->code);
+		} else {
+			tl->set_index=-1;
+		}
+	}
+	tap_listeners_stale=FALSE;
+}
+
 #ifdef HAVE_PLUGINS
 static GSList *tap_plugins = NULL;
 
@@ -182,6 +239,7 @@ register_tap(const char *name)
 	} else {
 		tdl->next=td;
 	}
+	tap_dissector_count=i;
 	return i;
 }
 
@@ -214,13 +272,9 @@ tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
 	if(!tapping_is_active){
 		return;
 	}
-	/*
-	 * XXX - should we allocate this with an ep_allocator,
-	 * rather than having a fixed maximum number of entries?
-	 */
-	if(tap_packet_index >= TAP_PACKET_QUEUE_LEN){
-		g_warning("Too many taps queued");
-		return;
+	if(tap_packet_index >= tap_packet_array_len){
+		tap_packet_array_len = tap_packet_array_len ? 2*tap_packet_array_len : TAP_PACKET_QUEUE_INITIAL_LEN;
+		tap_packet_array=(tap_packet_t *)g_realloc(tap_packet_array, tap_packet_array_len*sizeof(tap_packet_t));
 	}
 
 	tpt=&tap_packet_array[tap_packet_index];
@@ -286,7 +340,9 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 {
 	tap_packet_t *tp;
 	tap_listener_t *tl;
-	guint i;
+	GPtrArray *listeners;
+	guint i, j;
+	const guint32 *matched=NULL;
 
 	/* nothing to do, just return */
 	if(!tapping_is_active){
@@ -300,61 +356,79 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 		return;
 	}
 
-	/* loop over all tap listeners and call the listener callback
-	   for all packets that match the filter. */
+	if(tap_listeners_stale){
+		tap_listeners_index_build();
+	}
+
+	/* loop over all tap listeners of each queued packet's tap and call
+	   the listener callback if the packet matches the filter. */
 	for(i=0;i<tap_packet_index;i++){
-		for(tl=tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
+		tp=&tap_packet_array[i];
+		if(tp->tap_id<=0 || tp->tap_id>=tap_listeners_by_id_len){
+			continue;
+		}
+		listeners=tap_listeners_by_id[tp->tap_id];
+		if(!listeners){
+			continue;
+		}
+		for(j=0;j<listeners->len;j++){
+			tl=(tap_listener_t *)g_ptr_array_index(listeners, j);
 			/* Don't tap the packet if it's an "error packet"
 			 * unless the listener has requested that we do so.
 			 */
 			if (!(tp->flags & TAP_PACKET_IS_ERROR_PACKET) || (tl->flags & TL_REQUIRES_ERROR_PACKETS))
 			{
-				if(tp->tap_id==tl->tap_id){
-					if(!tl->packet){
-						/* There isn't a per-packet
-						 * routine for this tap.
-						 */
-						continue;
+				if(!tl->packet){
+					/* There isn't a per-packet
+					 * routine for this tap.
+					 */
+					continue;
+				}
+				if(tl->failed){
+					/* A previous call failed,
+					 * meaning "stop running this
+					 * tap", so don't call the
+					 * packet routine.
+					 */
+					continue;
+				}
+
+				/* If we have a filter, see if the
+				 * packet passes. The filters can't
+				 * give a different result for
+				 * another packet queued from the same
+				 * edt, so all the listener filters
+				 * are applied together the first time
+				 * one is needed.
+				 */
+				if(tl->code){
+					if(!matched){
+						dfilter_set_apply_edt(tap_filter_set, edt, &matched);
 					}
-					if(tl->failed){
-						/* A previous call failed,
-						 * meaning "stop running this
-						 * tap", so don't call the
-						 * packet routine.
-						 */
+					if (!DFILTER_SET_MATCHED(matched, tl->set_index)){
+						/* The packet didn't
+						 * pass the filter. */
 						continue;
 					}
+				}
 
-					/* If we have a filter, see if the
-					 * packet passes.
-					 */
-					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
-							/* The packet didn't
-							 * pass the filter. */
-							continue;
-						}
-					}
-
-					/* So call the per-packet routine. */
-					tap_packet_status status;
+				/* So call the per-packet routine. */
+				tap_packet_status status;
 
-					status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+				status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
 
-					switch (status) {
+				switch (status) {
 
-					case TAP_PACKET_DONT_REDRAW:
-						break;
+				case TAP_PACKET_DONT_REDRAW:
+					break;
 
-					case TAP_PACKET_REDRAW:
-						tl->needs_redraw=TRUE;
-						break;
+				case TAP_PACKET_REDRAW:
+					tl->needs_redraw=TRUE;
+					break;
 
-					case TAP_PACKET_FAILED:
-						tl->failed=TRUE;
-						break;
-					}
+				case TAP_PACKET_FAILED:
+					tl->failed=TRUE;
+					break;
 				}
 			}
 		}
@@ -544,6 +618,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	}
 	tl->fstring=g_strdup(fstring);
 	tl->code=code;
+	tl->set_index=-1;
 
 	tl->tap_id=tap_id;
 	tl->tapdata=tapdata;
@@ -554,6 +629,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	tap_listeners_stale=TRUE;
 
 	return NULL;
 }
@@ -585,6 +661,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
+		tap_listeners_stale=TRUE;
 		if(tl->code){
 			dfilter_free(tl->code);
 			tl->code=NULL;
@@ -618,6 +695,7 @@ tap_listeners_dfilter_recompile(void)
 	dfilter_t *code;
 	gchar *err_msg;
 
+	tap_listeners_stale=TRUE;
 	for(tl=tap_listener_queue;tl;tl=tl->next){
 		if(tl->code){
 			dfilter_free(tl->code);
@@ -666,6 +744,7 @@ remove_tap_listener(void *tapdata)
 			return;
 		}
 	}
+	tap_listeners_stale=TRUE;
 	free_tap_listener(tl);
 }
 
@@ -693,16 +772,12 @@ tap_listeners_require_dissection(void)
 gboolean
 have_tap_listener(int tap_id)
 {
-	tap_listener_t *tap_queue = tap_listener_queue;
-
-	while(tap_queue) {
-		if(tap_queue->tap_id == tap_id)
-			return TRUE;
-
-		tap_queue = tap_queue->next;
+	if(tap_listeners_stale){
+		tap_listeners_index_build();
 	}
 
-	return FALSE;
+	return tap_id > 0 && tap_id < tap_listeners_by_id_len &&
+	    tap_listeners_by_id[tap_id] != NULL;
 }
 
 /*
@@ -749,6 +824,9 @@ void tap_cleanup(void)
 		head_lq = head_lq->next;
 		free_tap_listener(elem_lq);
 	}
+	tap_listener_queue=NULL;
+	tap_listeners_index_free();
+	tap_listeners_stale=TRUE;
 
 	while(head_dl){
 		elem_dl = head_dl;
@@ -756,6 +834,13 @@ void tap_cleanup(void)
 		g_free(elem_dl->name);
 		g_free((gpointer)elem_dl);
 	}
+	tap_dissector_list=NULL;
+	tap_dissector_count=0;
+
+	g_free(tap_packet_array);
+	tap_packet_array=NULL;
+	tap_packet_array_len=0;
+	tap_packet_index=0;
 
 #ifdef HAVE_PLUGINS
 	g_slist_free(tap_plugins);
@@ -16,6 +16,7 @@
 #include <string.h>
 
 #include "tvbuff.h"
+#include "tvbuff-int.h"
 #include "exceptions.h"
 #include "wsutil/pint.h"
 
@@ -295,10 +296,12 @@ run_tests(void)
 	guint		subset_length[6];
 	guint		subset_reported_length[6];
 	guint8		temp;
-	guint8		*comp[6];
-	tvbuff_t	*tvb_comp[6];
-	guint		comp_length[6];
-	guint		comp_reported_length[6];
+	guint8		*comp[7];
+	tvbuff_t	*tvb_comp[7];
+	guint		comp_length[7];
+	guint		comp_reported_length[7];
+	tvbuff_t	*tvb_member;
+	const guint8	*member_ptr;
 	int		len;
 
 	tvb_parent = tvb_new_real_data("", 0, 0);
@@ -474,6 +477,30 @@ run_tests(void)
 	test(tvb_comp[4], "Composite 4", comp[4], comp_length[4], comp_reported_length[4]);
 	test(tvb_comp[5], "Composite 5", comp[5], comp_length[5], comp_reported_length[5]);
 
+	/* Three reals that it owns */
+	printf("Making Composite 6\n");
+	tvb_comp[6]		= tvb_new_composite();
+	comp_length[6]		= 3 * large_length[0];
+	comp_reported_length[6]	= 3 * large_reported_length[0];
+	comp[6]			= (guint8*)g_malloc(comp_length[6]);
+	for (i = 0; i < 3; i++) {
+		memcpy(&comp[6][i * large_length[0]], large[i], large_length[0]);
+		tvb_member		= tvb_new_real_data(g_memdup(large[i], large_length[0]),
+						large_length[0], large_reported_length[0]);
+		tvb_set_free_cb(tvb_member, g_free);
+		tvb_composite_append(tvb_comp[6], tvb_member);
+	}
+	tvb_composite_finalize_owning(tvb_comp[6]);
+	/* A pointer spanning members flattens the composite, which frees
+	 * the members except the second one, which a pointer is into. */
+	member_ptr = tvb_get_ptr(tvb_comp[6], large_length[0] + 1, 2);
+	if (memcmp(tvb_get_ptr(tvb_comp[6], 0, comp_length[6]), comp[6], comp_length[6]) != 0 ||
+	    memcmp(member_ptr, &comp[6][large_length[0] + 1], 2) != 0) {
+		printf("13: Failed TVB=Composite 6 Bad data after flattening\n");
+		failed = TRUE;
+	}
+	test(tvb_comp[6], "Composite 6", comp[6], comp_length[6], comp_reported_length[6]);
+
 	/* free memory. */
 	/* Don't free: comp[0] */
 	g_free(comp[1]);
@@ -481,7 +508,9 @@ run_tests(void)
 	g_free(comp[3]);
 	g_free(comp[4]);
 	g_free(comp[5]);
+	g_free(comp[6]);
 
+	tvb_free(tvb_comp[6]);  /* not in the chain; frees the members it kept */
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
@@ -92,6 +92,10 @@ tvbuff_t *tvb_new_proxy(tvbuff_t *backing);
 
 void tvb_add_to_chain(tvbuff_t *parent, tvbuff_t *child);
 
+/* Like tvb_composite_finalize(), but the composite tvbuff owns its
+ * members, which must not be part of a chain, and frees them. */
+void tvb_composite_finalize_owning(tvbuff_t *tvb);
+
 guint tvb_offset_from_real_beginning_counter(const tvbuff_t *tvb, const guint counter);
 
 void tvb_check_offset_length(const tvbuff_t *tvb, const gint offset, gint const length_val, guint *offset_ptr, guint *length_ptr);
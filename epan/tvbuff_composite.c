@@ -16,7 +16,12 @@
 #include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
 
 typedef struct {
-	GSList		*tvbs;
+	/* The members as they're appended and prepended,
+	 * until the composite is finalized. */
+	GQueue		tvbs;
+
+	tvbuff_t	**members;
+	guint		num_members;
 
 	/* Used for quick testing to see if this
 	 * is the tvbuff that a COMPOSITE is
@@ -24,6 +29,10 @@ typedef struct {
 	guint		*start_offsets;
 	guint		*end_offsets;
 
+	/* If the composite owns its members, whether a pointer into
+	 * each one has been handed out; NULL otherwise. */
+	gboolean	*ptr_taken;
+
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -37,9 +46,18 @@ composite_free(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
 
-	g_slist_free(composite->tvbs);
+	g_queue_clear(&composite->tvbs);
 
+	if (composite->ptr_taken) {
+		for (i = 0; i < composite->num_members; i++) {
+			if (composite->members[i])
+				tvb_free(composite->members[i]);
+		}
+		g_free(composite->ptr_taken);
+	}
+	g_free(composite->members);
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
 	if (tvb->real_data) {
@@ -56,37 +74,50 @@ composite_offset(const tvbuff_t *tvb _U_, const guint counter)
 	return counter;
 }
 
+/*
+ * Find the member that abs_offset is in, by a binary search of the end
+ * offsets; returns num_members if abs_offset is the end of the composite.
+ */
+static guint
+composite_find_member(const tvb_comp_t *composite, guint abs_offset)
+{
+	guint low = 0, high = composite->num_members, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (abs_offset <= composite->end_offsets[mid])
+			high = mid;
+		else
+			low = mid + 1;
+	}
+
+	return low;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
+
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -94,13 +125,28 @@ composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 		 * The range is, in fact, contiguous within member_tvb.
 		 */
 		DISSECTOR_ASSERT(!tvb->real_data);
+		if (composite->ptr_taken)
+			composite->ptr_taken[i] = TRUE;
 		return tvb_get_ptr(member_tvb, member_offset, abs_length);
 	}
 	else {
-		/* Use a temporary variable as tvb_memcpy is also checking tvb->real_data pointer */
+		/*
+		 * Flatten the whole composite. From here on all access
+		 * goes to the copy, so the members that it owns can go,
+		 * except those that pointers have been handed out into.
+		 *
+		 * Use a temporary variable as tvb_memcpy is also checking tvb->real_data pointer */
 		void *real_data = g_malloc(tvb->length);
 		tvb_memcpy(tvb, real_data, 0, tvb->length);
 		tvb->real_data = (const guint8 *)real_data;
+		if (composite->ptr_taken) {
+			for (i = 0; i < composite->num_members; i++) {
+				if (!composite->ptr_taken[i]) {
+					tvb_free(composite->members[i]);
+					composite->members[i] = NULL;
+				}
+			}
+		}
 		return tvb->real_data + abs_offset;
 	}
 
@@ -113,33 +159,26 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	guint8 *target = (guint8 *) _target;
 
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
+	member_tvb = composite->members[i];
+
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -152,18 +191,22 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 		 * then iterate across the other member tvb's, copying their portions
 		 * until we have copied all data.
 		 */
-		member_length = tvb_captured_length_remaining(member_tvb, member_offset);
-
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
-
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
-
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
+		guint8 *dest = target;
+
+		while (abs_length > 0) {
+			DISSECTOR_ASSERT(i < composite->num_members);
+			member_tvb = composite->members[i];
+			member_length = tvb_captured_length_remaining(member_tvb, member_offset);
+
+			/* composite_memcpy() can't handle a member_length of zero. */
+			DISSECTOR_ASSERT(member_length > 0);
+
+			member_length = MIN(member_length, abs_length);
+			tvb_memcpy(member_tvb, dest, member_offset, member_length);
+			dest		+= member_length;
+			abs_length	-= member_length;
+			member_offset	 = 0;
+			i++;
 		}
 
 		return target;
@@ -191,6 +234,10 @@ static const struct tvb_ops tvb_composite_ops = {
  *      tvb is finalized.
  *      This means that composite tvb members must all be in the same chain.
  *      ToDo: enforce this: By searching the chain?
+ *
+ *   2. Unless it's finalized with tvb_composite_finalize_owning(), in
+ *      which case it owns its members and frees them, or those it no
+ *      longer needs once it's flattened.
  */
 tvbuff_t *
 tvb_new_composite(void)
@@ -199,9 +246,12 @@ tvb_new_composite(void)
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
-	composite->tvbs		 = NULL;
+	g_queue_init(&composite->tvbs);
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->ptr_taken	 = NULL;
 
 	return tvb;
 }
@@ -221,7 +271,7 @@ tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 	DISSECTOR_ASSERT(member->length);
 
 	composite       = &composite_tvb->composite;
-	composite->tvbs = g_slist_append(composite->tvbs, member);
+	g_queue_push_tail(&composite->tvbs, member);
 }
 
 void
@@ -239,18 +289,18 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	DISSECTOR_ASSERT(member->length);
 
 	composite       = &composite_tvb->composite;
-	composite->tvbs = g_slist_prepend(composite->tvbs, member);
+	g_queue_push_head(&composite->tvbs, member);
 }
 
-void
-tvb_composite_finalize(tvbuff_t *tvb)
+static void
+composite_finalize_members(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	GSList	   *slist;
+	GList	   *list;
 	guint	    num_members;
 	tvbuff_t   *member_tvb;
 	tvb_comp_t *composite;
-	int	    i = 0;
+	guint	    i = 0;
 
 	DISSECTOR_ASSERT(tvb && !tvb->initialized);
 	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
@@ -259,7 +309,7 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	DISSECTOR_ASSERT(tvb->contained_length == 0);
 
 	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
+	num_members = g_queue_get_length(&composite->tvbs);
 
 	/* Dissectors should not create composite TVBs if they're not going to
 	 * put at least one TVB in them.
@@ -267,12 +317,15 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
 
-	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
-		DISSECTOR_ASSERT((guint) i < num_members);
-		member_tvb = (tvbuff_t *)slist->data;
+	for (list = composite->tvbs.head; list != NULL; list = list->next) {
+		DISSECTOR_ASSERT(i < num_members);
+		member_tvb = (tvbuff_t *)list->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
@@ -281,13 +334,34 @@ tvb_composite_finalize(tvbuff_t *tvb)
 		i++;
 	}
 
-	DISSECTOR_ASSERT(composite->tvbs);
+	g_queue_clear(&composite->tvbs);
 
-	tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
 	tvb->initialized = TRUE;
 	tvb->ds_tvb = tvb;
 }
 
+void
+tvb_composite_finalize(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+
+	composite_finalize_members(tvb);
+
+	tvb_add_to_chain(composite_tvb->composite.members[0], tvb); /* chain composite tvb to first member */
+}
+
+void
+tvb_composite_finalize_owning(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite;
+
+	composite_finalize_members(tvb);
+
+	composite = &composite_tvb->composite;
+	composite->ptr_taken = g_new0(gboolean, composite->num_members);
+}
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
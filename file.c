@@ -1348,8 +1348,10 @@ merge_callback(merge_event event, int num _U_,
             float  progbar_val;
             gint64 file_pos = 0;
             /* Get the sum of the seek positions in all of the files. */
-            for (i = 0; i < in_file_count; i++)
-              file_pos += wtap_read_so_far(in_files[i].wth);
+            for (i = 0; i < in_file_count; i++) {
+              if (in_files[i].wth)
+                file_pos += wtap_read_so_far(in_files[i].wth);
+            }
 
             progbar_val = (gfloat) file_pos / (gfloat) cb_data->f_len;
             if (progbar_val > 1.0f) {
@@ -1409,8 +1411,8 @@ cf_merge_files_to_tempfile(gpointer pd_window, char **out_filenamep,
                                    (const char *const *) in_filenames,
                                    in_file_count, do_append,
                                    IDB_MERGE_MODE_ALL_SAME, 0 /* snaplen */,
-                                   "Wireshark", &cb, &err, &err_info,
-                                   &err_fileno, &err_framenum);
+                                   "Wireshark", &cb, 0 /* max_open_files */,
+                                   &err, &err_info, &err_fileno, &err_framenum);
 
   g_free(cb.data);
 
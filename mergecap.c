@@ -72,6 +72,8 @@ print_usage(FILE *output)
   fprintf(output, "                    an empty \"-F\" option will list the file types.\n");
   fprintf(output, "  -I <IDB merge mode> set the merge mode for Interface Description Blocks; default is 'all'.\n");
   fprintf(output, "                    an empty \"-I\" option will list the merge modes.\n");
+  fprintf(output, "  -M <max open>     keep at most <max open> input files open at a time.\n");
+  fprintf(output, "                    fails if more input files overlap in time.\n");
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                display this help and exit.\n");
@@ -173,7 +175,7 @@ merge_callback(merge_event event, int num,
     case MERGE_EVENT_INPUT_FILES_OPENED:
       for (i = 0; i < in_file_count; i++) {
         fprintf(stderr, "mergecap: %s is type %s.\n", in_files[i].filename,
-                wtap_file_type_subtype_string(wtap_file_type_subtype(in_files[i].wth)));
+                wtap_file_type_subtype_string(in_files[i].file_type_subtype));
       }
       break;
 
@@ -185,9 +187,9 @@ merge_callback(merge_event event, int num,
          */
         int first_frame_type, this_frame_type;
 
-        first_frame_type = wtap_file_encap(in_files[0].wth);
+        first_frame_type = in_files[0].encap;
         for (i = 1; i < in_file_count; i++) {
-          this_frame_type = wtap_file_encap(in_files[i].wth);
+          this_frame_type = in_files[i].encap;
           if (first_frame_type != this_frame_type) {
             fprintf(stderr, "mergecap: multiple frame encapsulation types detected\n");
             fprintf(stderr, "          defaulting to WTAP_ENCAP_PER_PACKET\n");
@@ -240,6 +242,7 @@ main(int argc, char *argv[])
   gboolean            verbose            = FALSE;
   int                 in_file_count      = 0;
   guint32             snaplen            = 0;
+  guint32             max_open_files     = 0;
 #ifdef PCAP_NG_DEFAULT
   int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_PCAPNG; /* default to pcapng format */
 #else
@@ -286,7 +289,7 @@ main(int argc, char *argv[])
   wtap_init(TRUE);
 
   /* Process the options first */
-  while ((opt = getopt_long(argc, argv, "aF:hI:s:vVw:", long_options, NULL)) != -1) {
+  while ((opt = getopt_long(argc, argv, "aF:hI:M:s:vVw:", long_options, NULL)) != -1) {
 
     switch (opt) {
     case 'a':
@@ -321,6 +324,10 @@ main(int argc, char *argv[])
       }
       break;
 
+    case 'M':
+      max_open_files = get_nonzero_guint32(optarg, "maximum number of open files");
+      break;
+
     case 's':
       snaplen = get_nonzero_guint32(optarg, "snapshot length");
       break;
@@ -392,14 +399,14 @@ main(int argc, char *argv[])
                                    (const char *const *) &argv[optind],
                                    in_file_count, do_append, mode, snaplen,
                                    get_appname_and_version(),
-                                   verbose ? &cb : NULL,
+                                   verbose ? &cb : NULL, max_open_files,
                                    &err, &err_info, &err_fileno, &err_framenum);
   } else {
     /* merge the files to the outfile */
     status = merge_files(out_filename, file_type,
                          (const char *const *) &argv[optind], in_file_count,
                          do_append, mode, snaplen, get_appname_and_version(),
-                         verbose ? &cb : NULL,
+                         verbose ? &cb : NULL, max_open_files,
                          &err, &err_info, &err_fileno, &err_framenum);
   }
 
@@ -441,6 +448,11 @@ main(int argc, char *argv[])
         cfile_close_failure_message(out_filename, err);
         break;
 
+    case MERGE_ERR_TOO_MANY_OVERLAPPING_FILES:
+      cmdarg_err("\"%s\" starts before the %u input files open at that point end, so they can't be merged in chronological order with \"-M %u\".",
+                 argv[optind + err_fileno], max_open_files, max_open_files);
+      break;
+
     default:
       cmdarg_err("Unknown merge_files error %d", status);
       break;
@@ -43,6 +43,7 @@
 
 #include "ringbuffer.h"
 #include <wsutil/file_util.h>
+#include "writecap/compressed_output.h"
 
 
 /* Ringbuffer file structure */
@@ -63,6 +64,10 @@ typedef struct _ringbuf_data {
   FILE         *pdh;
   char         *io_buffer;              /**< The IO buffer used to write to the file */
   gboolean      group_read_access;   /**< TRUE if files need to be opened with group read access */
+
+  output_compression_t compression;
+  compressed_output *co;             /**< Compressor of the current file, if any */
+  compressed_output *co_closing;     /**< Compressor still finishing the previous file */
 } ringbuf_data;
 
 static ringbuf_data rb_data;
@@ -120,7 +125,8 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
  * Initialize the ringbuffer data structures
  */
 int
-ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access)
+ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access,
+             output_compression_t compression)
 {
   unsigned int i;
   char        *pfx, *last_pathsep;
@@ -135,6 +141,9 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.pdh = NULL;
   rb_data.io_buffer = NULL;
   rb_data.group_read_access = group_read_access;
+  rb_data.compression = compression;
+  rb_data.co = NULL;
+  rb_data.co_closing = NULL;
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -178,6 +187,15 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   g_free(save_file);
   save_file = NULL;
 
+  if (compression != OUTPUT_UNCOMPRESSED) {
+    /* Say how the files are compressed at the end of their names. */
+    gchar *fsuffix = g_strconcat(rb_data.fsuffix ? rb_data.fsuffix : "", ".",
+                                 compressed_output_extension(compression), NULL);
+
+    g_free(rb_data.fsuffix);
+    rb_data.fsuffix = fsuffix;
+  }
+
   /* allocate rb_file structures (only one if unlimited since there is no
      need to save all file names in that case) */
 
@@ -226,11 +244,34 @@ const gchar *ringbuf_current_filename(void)
 FILE *
 ringbuf_init_libpcap_fdopen(int *err)
 {
-  rb_data.pdh = ws_fdopen(rb_data.fd, "wb");
+  int fd = rb_data.fd;
+
+  if (rb_data.compression != OUTPUT_UNCOMPRESSED) {
+    /* Write to the compressor; it owns the file from now on. */
+    int co_err;
+
+    rb_data.co = compressed_output_open(rb_data.fd, rb_data.compression, &fd, &co_err);
+    if (rb_data.co == NULL) {
+      if (err != NULL) {
+        *err = co_err;
+      }
+      return NULL;
+    }
+  }
+
+  rb_data.pdh = ws_fdopen(fd, "wb");
   if (rb_data.pdh == NULL) {
     if (err != NULL) {
       *err = errno;
     }
+    if (rb_data.co != NULL) {
+      int co_err;
+
+      ws_close(fd);
+      compressed_output_close(rb_data.co, &co_err);
+      rb_data.co = NULL;
+      rb_data.fd = -1;
+    }
   } else {
     size_t buffsize = IO_BUF_SIZE;
 #ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
@@ -250,6 +291,28 @@ ringbuf_init_libpcap_fdopen(int *err)
   return rb_data.pdh;
 }
 
+/*
+ * Waits for a compressor to finish its file
+ */
+static gboolean
+ringbuf_close_compressed(compressed_output **co, int *err)
+{
+  int co_err;
+
+  if (*co == NULL)
+    return TRUE;
+
+  if (!compressed_output_close(*co, &co_err)) {
+    *co = NULL;
+    if (err != NULL) {
+      *err = co_err;
+    }
+    return FALSE;
+  }
+  *co = NULL;
+  return TRUE;
+}
+
 /*
  * Switches to the next ringbuffer file
  */
@@ -259,13 +322,23 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
   int     next_file_index;
   rb_file *next_rfile = NULL;
 
+  /* The compression of the file before the current one is done by now;
+     pick up its result. */
+  if (!ringbuf_close_compressed(&rb_data.co_closing, err)) {
+    return FALSE;
+  }
+
   /* close current file */
 
   if (fclose(rb_data.pdh) == EOF) {
     if (err != NULL) {
       *err = errno;
     }
-    ws_close(rb_data.fd);  /* XXX - the above should have closed this already */
+    if (rb_data.co != NULL) {
+      ringbuf_close_compressed(&rb_data.co, NULL);
+    } else {
+      ws_close(rb_data.fd);  /* XXX - the above should have closed this already */
+    }
     rb_data.pdh = NULL;    /* it's still closed, we just got an error while closing */
     rb_data.fd = -1;
     g_free(rb_data.io_buffer);
@@ -276,6 +349,16 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
   rb_data.pdh = NULL;
   rb_data.fd  = -1;
 
+  /* Let the compressor finish the file while we go on capturing, unless
+     the next file replaces it. */
+  rb_data.co_closing = rb_data.co;
+  rb_data.co = NULL;
+  if (!rb_data.unlimited && rb_data.num_files == 1) {
+    if (!ringbuf_close_compressed(&rb_data.co_closing, err)) {
+      return FALSE;
+    }
+  }
+
   /* get the next file number and open it */
 
   rb_data.curr_file_num++ /* = next_file_num*/;
@@ -312,7 +395,9 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
       if (err != NULL) {
         *err = errno;
       }
-      ws_close(rb_data.fd);
+      if (rb_data.co == NULL) {
+        ws_close(rb_data.fd);
+      }
       ret_val = FALSE;
     }
     rb_data.pdh = NULL;
@@ -322,6 +407,14 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
 
   }
 
+  /* wait for the compressed files to be complete */
+  if (!ringbuf_close_compressed(&rb_data.co_closing, ret_val ? err : NULL)) {
+    ret_val = FALSE;
+  }
+  if (!ringbuf_close_compressed(&rb_data.co, ret_val ? err : NULL)) {
+    ret_val = FALSE;
+  }
+
   /* set the save file name to the current file */
   *save_file = rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
   return ret_val;
@@ -371,6 +464,13 @@ ringbuf_error_cleanup(void)
     rb_data.pdh = NULL;
   }
 
+  /* the compressors close their files themselves */
+  ringbuf_close_compressed(&rb_data.co_closing, NULL);
+  if (rb_data.co != NULL) {
+    ringbuf_close_compressed(&rb_data.co, NULL);
+    rb_data.fd = -1;
+  }
+
   /* close directly if still open */
   if (rb_data.fd != -1) {
     ws_close(rb_data.fd);
@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include "wiretap/wtap.h"
+#include "writecap/compressed_output.h"
 
 #define RINGBUFFER_UNLIMITED_FILES 0
 /* Minimum number of ringbuffer files */
@@ -23,7 +24,8 @@
 /* Maximum number for FAT filesystems */
 #define RINGBUFFER_WARN_NUM_FILES 65535
 
-int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access);
+int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access,
+                 output_compression_t compression);
 gboolean ringbuf_is_initialized(void);
 const gchar *ringbuf_current_filename(void);
 FILE *ringbuf_init_libpcap_fdopen(int *err);
@@ -18,6 +18,12 @@
 #include <errno.h>
 #include <signal.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include <glib.h>
 
 #include <epan/exceptions.h>
@@ -32,6 +38,7 @@
 #include <version_info.h>
 #include <wiretap/wtap_opttypes.h>
 #include <wiretap/pcapng.h>
+#include <wiretap/frame_index.h>
 
 #include <epan/decode_as.h>
 #include <epan/timestamp.h>
@@ -314,6 +321,101 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
 }
 
 
+/*
+ * Frame index: if SHARKD_FRAME_INDEX is set, a complete load writes a
+ * frame index next to the capture file (see wiretap/frame_index.h), and
+ * later loads of the unchanged file fill in the frames from it without
+ * reading or dissecting the capture.
+ *
+ * Dissectors build their state in the first pass, and that depends on the
+ * order the frames are dissected in, so the first pass is deferred rather
+ * than skipped: before a frame is dissected for a request, every frame up
+ * to it that hasn't had its first pass yet gets it, in order (see
+ * sharkd_first_pass()). The results are the same as after a sequential
+ * load; what the index saves is the time until the first response.
+ */
+static guint32 first_pass_count;    /* frames that have had their first pass */
+static gboolean
+sharkd_frame_index_enabled(void)
+{
+  const char *env = g_getenv("SHARKD_FRAME_INDEX");
+
+  return env != NULL && *env != '\0' && strcmp(env, "0") != 0;
+}
+
+static void
+load_cap_file_from_index(capture_file *cf, wtap_frame_index_t *idx)
+{
+  guint32      i, count = wtap_frame_index_count(idx);
+  gint64       data_offset;
+  wtap_rec     rec;
+  frame_data   fdlocal;
+
+  wtap_rec_init(&rec);
+  for (i = 0; i < count; i++) {
+    wtap_frame_index_get(idx, i, &rec, &data_offset);
+    frame_data_init(&fdlocal, cf->count + 1, &rec, data_offset, cum_bytes);
+
+    frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
+                                  &cf->provider.ref, cf->provider.prev_dis);
+    if (cf->provider.ref == &fdlocal) {
+      ref_frame = fdlocal;
+      cf->provider.ref = &ref_frame;
+    }
+    frame_data_set_after_dissect(&fdlocal, &cum_bytes);
+    cf->provider.prev_cap = cf->provider.prev_dis = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+    cf->count++;
+  }
+  wtap_rec_cleanup(&rec);
+}
+
+/*
+ * Give the frames up to framenum that have been loaded from a frame index
+ * the first-pass dissection that process_packet() gives them in a
+ * sequential load.
+ */
+static void
+sharkd_first_pass(guint32 framenum)
+{
+  epan_dissect_t *edt;
+  frame_data     *fdata;
+  wtap_rec        rec;
+  Buffer          buf;
+  int             err;
+  gchar          *err_info = NULL;
+
+  if (framenum > cfile.count)
+    framenum = cfile.count;
+  if (framenum <= first_pass_count)
+    return;
+
+  edt = epan_dissect_new(cfile.epan, postdissectors_want_hfids(), FALSE);
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+
+  while (first_pass_count < framenum) {
+    fdata = sharkd_get_frame(first_pass_count + 1);
+    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info)) {
+      g_free(err_info);
+      break;
+    }
+
+    prime_epan_dissect_with_postdissector_wanted_hfids(edt);
+    epan_dissect_run(edt, cfile.cd_t, &rec,
+                     frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
+                     fdata, NULL);
+    epan_dissect_reset(edt);
+    first_pass_count++;
+  }
+
+  epan_dissect_free(edt);
+  wtap_rec_cleanup(&rec);
+  ws_buffer_free(&buf);
+
+  if (first_pass_count == cfile.count)
+    postseq_cleanup_all_protocols();
+}
+
 static int
 load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
 {
@@ -323,11 +425,28 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
   wtap_rec     rec;
   Buffer       buf;
   epan_dissect_t *edt = NULL;
+  wtap_frame_index_t *idx = NULL;
 
   {
     /* Allocate a frame_data_sequence for all the frames. */
     cf->provider.frames = new_frame_data_sequence();
 
+    if (cf->rfcode == NULL && max_packet_count == 0 && max_byte_count == 0 &&
+        sharkd_frame_index_enabled()) {
+      idx = wtap_frame_index_read(cf->provider.wth, cf->filename);
+      if (idx) {
+        load_cap_file_from_index(cf, idx);
+        wtap_frame_index_free(idx);
+        first_pass_count = 0;
+
+        wtap_sequential_close(cf->provider.wth);
+        cf->provider.prev_dis = NULL;
+        cf->provider.prev_cap = NULL;
+        return 0;
+      }
+      idx = wtap_frame_index_new();
+    }
+
     {
       gboolean create_proto_tree;
 
@@ -355,6 +474,9 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
 
     while (wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset)) {
       if (process_packet(cf, edt, data_offset, &rec, &buf)) {
+        if (idx)
+          wtap_frame_index_add(idx, &rec, data_offset);
+
         /* Stop reading if we have the maximum number of packets;
          * When the -c option has not been used, max_packet_count
          * starts at 0, which practically means, never stop reading.
@@ -375,12 +497,19 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
     wtap_rec_cleanup(&rec);
     ws_buffer_free(&buf);
 
+    if (idx) {
+      if (err == 0)
+        wtap_frame_index_write(idx, cf->provider.wth, cf->filename);
+      wtap_frame_index_free(idx);
+    }
+
     /* Close the sequential I/O side, to free up memory it requires. */
     wtap_sequential_close(cf->provider.wth);
 
     /* Allow the protocol dissectors to free up memory that they
      * don't need after the sequential run-through of the packets. */
     postseq_cleanup_all_protocols();
+    first_pass_count = cf->count;
 
     cf->provider.prev_dis = NULL;
     cf->provider.prev_cap = NULL;
@@ -535,6 +664,8 @@ sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num, guint32 prev_dis
   if (fdata == NULL)
     return -1;
 
+  sharkd_first_pass(framenum);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
@@ -595,6 +726,8 @@ sharkd_dissect_columns(frame_data *fdata, guint32 frame_ref_num, guint32 prev_di
   int err;
   char *err_info = NULL;
 
+  sharkd_first_pass(fdata->num);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
@@ -671,6 +804,8 @@ sharkd_retap(void)
   create_proto_tree =
     (have_filtering_tap_listeners() || (tap_flags & TL_REQUIRES_PROTO_TREE));
 
+  sharkd_first_pass(cfile.count);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
   epan_dissect_init(&edt, cfile.epan, create_proto_tree, FALSE);
@@ -701,6 +836,143 @@ sharkd_retap(void)
   return 0;
 }
 
+#ifndef _WIN32
+/*
+ * Parallel filtering, enabled by setting SHARKD_FILTER_WORKERS to the
+ * number of worker processes.
+ *
+ * The frames are split into one contiguous range per worker, aligned to
+ * whole bytes of the result bitmap, and each range is dissected by a
+ * forked child with its own wtap handle and epan_dissect_t. The children
+ * set their bits directly in a shared mapping of the bitmap. A child
+ * starts from the dissector state the parent had when the filter was
+ * requested and does not know which frames before its range passed, so
+ * filters that use the previous displayed frame are run sequentially.
+ */
+#define SHARKD_FILTER_MAX_WORKERS           64
+#define SHARKD_FILTER_MIN_FRAMES_PER_WORKER 8192
+
+static int
+sharkd_filter_workers(void)
+{
+  static int workers = -1;
+
+  if (workers == -1) {
+    const char *env = g_getenv("SHARKD_FILTER_WORKERS");
+
+    workers = env ? (int) strtol(env, NULL, 10) : 0;
+    if (workers < 0)
+      workers = 0;
+    if (workers > SHARKD_FILTER_MAX_WORKERS)
+      workers = SHARKD_FILTER_MAX_WORKERS;
+  }
+  return workers;
+}
+
+static void G_GNUC_NORETURN
+sharkd_filter_worker(dfilter_t *dfcode, guint32 first, guint32 last, guint8 *result_bits)
+{
+  guint32 framenum;
+  Buffer buf;
+  wtap_rec rec;
+  int err;
+  char *err_info = NULL;
+
+  epan_dissect_t edt;
+
+  /* The inherited handle shares its file offset with the parent. */
+  cfile.provider.wth = wtap_open_offline(cfile.filename, cfile.open_type, &err, &err_info, TRUE);
+  if (cfile.provider.wth == NULL)
+    _exit(1);
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+  epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
+
+  for (framenum = first; framenum <= last; framenum++) {
+    frame_data *fdata = sharkd_get_frame(framenum);
+
+    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
+      _exit(1);
+
+    epan_dissect_prime_with_dfilter(&edt, dfcode);
+
+    fdata->ref_time = FALSE;
+    fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
+    fdata->prev_dis_num = 0;
+    epan_dissect_run(&edt, cfile.cd_t, &rec,
+                     frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
+                     fdata, NULL);
+
+    if (dfilter_apply_edt(dfcode, &edt))
+      result_bits[framenum / 8] |= (1 << (framenum % 8));
+
+    epan_dissect_reset(&edt);
+  }
+
+  _exit(0);
+}
+
+/*
+ * Fills in result_bits (of result_size bytes) using the given number of
+ * workers. Returns FALSE if any worker failed, in which case the caller
+ * filters sequentially, which also reports the failing frame.
+ */
+static gboolean
+sharkd_filter_parallel(dfilter_t *dfcode, guint32 frames_count, int workers,
+                       guint8 *result_bits, size_t result_size)
+{
+  guint8 *shared_bits;
+  pid_t *pids;
+  guint32 nbytes = frames_count / 8 + 1;
+  gboolean ok = TRUE;
+  int i, status;
+
+  shared_bits = (guint8 *) mmap(NULL, result_size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared_bits == MAP_FAILED)
+    return FALSE;
+
+  pids = g_new(pid_t, workers);
+  for (i = 0; i < workers; i++) {
+    guint32 byte_lo = (guint32) ((guint64) nbytes * i / workers);
+    guint32 byte_hi = (guint32) ((guint64) nbytes * (i + 1) / workers);
+    guint32 first = MAX(byte_lo * 8, 1);
+    guint32 last = MIN(byte_hi * 8 - 1, frames_count);
+
+    pids[i] = -1;
+    if (!ok || byte_lo == byte_hi)
+      continue;
+
+    pids[i] = fork();
+    if (pids[i] == 0)
+      sharkd_filter_worker(dfcode, first, last, shared_bits);
+    if (pids[i] < 0)
+      ok = FALSE;
+  }
+
+  for (i = 0; i < workers; i++) {
+    if (pids[i] <= 0)
+      continue;
+    while (waitpid(pids[i], &status, 0) < 0) {
+      if (errno != EINTR) {
+        status = -1;
+        break;
+      }
+    }
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      ok = FALSE;
+  }
+
+  if (ok)
+    memcpy(result_bits, shared_bits, result_size);
+
+  g_free(pids);
+  munmap(shared_bits, result_size);
+  return ok;
+}
+#endif
+
 int
 sharkd_filter(const char *dftext, guint8 **result)
 {
@@ -715,6 +987,7 @@ sharkd_filter(const char *dftext, guint8 **result)
 
   guint8 *result_bits;
   guint8  passed_bits;
+  size_t  result_size;
 
   epan_dissect_t edt;
 
@@ -731,12 +1004,45 @@ sharkd_filter(const char *dftext, guint8 **result)
 
   frames_count = cfile.count;
 
+  sharkd_first_pass(frames_count);
+
+  result_size = 2 + (frames_count / 8);
+  result_bits = (guint8 *) g_malloc(result_size);
+
+#ifndef _WIN32
+  {
+    int workers = sharkd_filter_workers();
+
+    if (workers > 1 &&
+        frames_count >= (guint32) workers * SHARKD_FILTER_MIN_FRAMES_PER_WORKER &&
+        !dfilter_interested_in_field(dfcode, proto_registrar_get_id_byname("frame.time_delta_displayed")) &&
+        sharkd_filter_parallel(dfcode, frames_count, workers, result_bits, result_size)) {
+      /* Leave the frames as the sequential pass below would. */
+      for (framenum = 1; framenum <= frames_count; framenum++) {
+        frame_data *fdata = sharkd_get_frame(framenum);
+
+        fdata->ref_time = FALSE;
+        fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
+        fdata->prev_dis_num = prev_dis_num;
+        if (result_bits[framenum / 8] & (1 << (framenum % 8)))
+          prev_dis_num = framenum;
+      }
+
+      if ((framenum & 7) == 0)
+        framenum--;
+
+      dfilter_free(dfcode);
+      *result = result_bits;
+      return framenum;
+    }
+  }
+#endif
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
   epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
 
   passed_bits = 0;
-  result_bits = (guint8 *) g_malloc(2 + (frames_count / 8));
 
   for (framenum = 1; framenum <= frames_count; framenum++) {
     frame_data *fdata = sharkd_get_frame(framenum);
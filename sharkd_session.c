@@ -80,6 +80,30 @@ struct sharkd_filter_item
 
 static GHashTable *filter_table = NULL;
 
+/*
+ * Column cache: the column text of frames returned by the frames request,
+ * so that paging back and forth does not dissect them again. It is
+ * enabled by setting SHARKD_COLUMN_CACHE to a size limit in MiB, beyond
+ * which the least recently used frames are dropped. Only the default
+ * columns are cached, and only for the reference and previous displayed
+ * frame they were made with. The cache is emptied on load and setconf,
+ * as either can change the text.
+ */
+struct sharkd_column_cache_item
+{
+	guint32 framenum;
+	guint32 ref_frame;
+	guint32 prev_dis_num;
+	gsize size;
+	gchar **cols;
+	GList link;       /* in column_cache_lru, most recently used first */
+};
+
+static GHashTable *column_cache = NULL;
+static GQueue column_cache_lru = G_QUEUE_INIT;
+static gsize column_cache_size = 0;
+static gsize column_cache_limit = 0;
+
 static json_dumper dumper = {0};
 
 static const char *
@@ -213,6 +237,91 @@ sharkd_session_filter_data(const char *filter)
 	return l;
 }
 
+static void
+sharkd_session_column_cache_free(gpointer data)
+{
+	struct sharkd_column_cache_item *item = (struct sharkd_column_cache_item *) data;
+
+	g_queue_unlink(&column_cache_lru, &item->link);
+	column_cache_size -= item->size;
+	g_strfreev(item->cols);
+	g_free(item);
+}
+
+static void
+sharkd_session_column_cache_init(void)
+{
+	const char *env = g_getenv("SHARKD_COLUMN_CACHE");
+	guint32 mib;
+
+	if (!env || !ws_strtou32(env, NULL, &mib) || mib == 0)
+		return;
+
+	column_cache_limit = (gsize) mib * 1024 * 1024;
+	column_cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, sharkd_session_column_cache_free);
+}
+
+static void
+sharkd_session_column_cache_clear(void)
+{
+	if (column_cache)
+		g_hash_table_remove_all(column_cache);
+}
+
+static const struct sharkd_column_cache_item *
+sharkd_session_column_cache_lookup(guint32 framenum, guint32 ref_frame, guint32 prev_dis_num)
+{
+	struct sharkd_column_cache_item *item;
+
+	if (!column_cache)
+		return NULL;
+
+	item = (struct sharkd_column_cache_item *) g_hash_table_lookup(column_cache, GUINT_TO_POINTER(framenum));
+	if (!item || item->ref_frame != ref_frame || item->prev_dis_num != prev_dis_num)
+		return NULL;
+
+	g_queue_unlink(&column_cache_lru, &item->link);
+	g_queue_push_head_link(&column_cache_lru, &item->link);
+	return item;
+}
+
+static void
+sharkd_session_column_cache_store(guint32 framenum, guint32 ref_frame, guint32 prev_dis_num, const column_info *cinfo)
+{
+	struct sharkd_column_cache_item *item;
+	int col;
+
+	if (!column_cache)
+		return;
+
+	item = g_new(struct sharkd_column_cache_item, 1);
+	item->framenum = framenum;
+	item->ref_frame = ref_frame;
+	item->prev_dis_num = prev_dis_num;
+	item->size = sizeof(*item) + (cinfo->num_cols + 1) * sizeof(gchar *);
+	item->cols = g_new(gchar *, cinfo->num_cols + 1);
+	for (col = 0; col < cinfo->num_cols; ++col)
+	{
+		item->cols[col] = g_strdup(cinfo->columns[col].col_data);
+		item->size += strlen(item->cols[col]) + 1;
+	}
+	item->cols[cinfo->num_cols] = NULL;
+	item->link.data = item;
+	item->link.prev = item->link.next = NULL;
+
+	/* replaces (and unlinks) an entry made for another reference frame */
+	g_hash_table_insert(column_cache, GUINT_TO_POINTER(framenum), item);
+	g_queue_push_head_link(&column_cache_lru, &item->link);
+	column_cache_size += item->size;
+
+	while (column_cache_size > column_cache_limit && column_cache_lru.tail != &item->link)
+	{
+		struct sharkd_column_cache_item *lru = (struct sharkd_column_cache_item *) column_cache_lru.tail->data;
+
+		g_hash_table_remove(column_cache, GUINT_TO_POINTER(lru->framenum));
+	}
+}
+
 static gboolean
 sharkd_rtp_match_init(rtpstream_id_t *id, const char *init_str)
 {
@@ -546,6 +655,8 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 	if (!tok_file)
 		return;
 
+	sharkd_session_column_cache_clear();
+
 	if (sharkd_cf_open(tok_file, WTAP_TYPE_AUTO, FALSE, &err) != CF_OK)
 	{
 		sharkd_json_simple_reply(err, NULL);
@@ -793,6 +904,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 	const char *tok_refs   = json_find_attr(buf, tokens, count, "refs");
 
 	const guint8 *filter_data = NULL;
+	const struct sharkd_column_cache_item *cached;
 
 	int col;
 
@@ -890,7 +1002,16 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 		}
 
 		fdata = sharkd_get_frame(framenum);
-		sharkd_dissect_columns(fdata, ref_frame, prev_dis_num, cinfo, (fdata->color_filter == NULL));
+		cached = NULL;
+		if (cinfo == &cfile.cinfo)
+			cached = sharkd_session_column_cache_lookup(framenum, ref_frame, prev_dis_num);
+
+		if (!cached)
+		{
+			sharkd_dissect_columns(fdata, ref_frame, prev_dis_num, cinfo, (fdata->color_filter == NULL));
+			if (cinfo == &cfile.cinfo)
+				sharkd_session_column_cache_store(framenum, ref_frame, prev_dis_num, cinfo);
+		}
 
 		json_dumper_begin_object(&dumper);
 
@@ -899,7 +1020,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 		{
 			const col_item_t *col_item = &cinfo->columns[col];
 
-			sharkd_json_value_string(NULL, col_item->col_data);
+			sharkd_json_value_string(NULL, cached ? cached->cols[col] : col_item->col_data);
 		}
 		sharkd_json_array_close();
 
@@ -3586,6 +3707,10 @@ sharkd_session_process_setcomment(char *buf, const jsmntok_t *tokens, int count)
 
 	ret = sharkd_set_user_comment(fdata, tok_comment);
 
+	/* a comment column may show it */
+	if (column_cache)
+		g_hash_table_remove(column_cache, GUINT_TO_POINTER(framenum));
+
 	sharkd_json_simple_reply(ret, NULL);
 }
 
@@ -3618,6 +3743,8 @@ sharkd_session_process_setconf(char *buf, const jsmntok_t *tokens, int count)
 
 	ret = prefs_set_pref(pref, &errmsg);
 
+	sharkd_session_column_cache_clear();
+
 	sharkd_json_simple_reply(ret, errmsg);
 	g_free(errmsg);
 }
@@ -4261,6 +4388,7 @@ sharkd_session_main(void)
 	dumper.output_file = stdout;
 
 	filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sharkd_session_filter_free);
+	sharkd_session_column_cache_init();
 
 #ifdef HAVE_MAXMINDDB
 	/* mmdbresolve was stopped before fork(), force starting it */
@@ -4305,6 +4433,8 @@ sharkd_session_main(void)
 	}
 
 	g_hash_table_destroy(filter_table);
+	if (column_cache)
+		g_hash_table_destroy(column_cache);
 	g_free(tokens);
 
 	return 0;
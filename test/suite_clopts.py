@@ -10,6 +10,8 @@
 '''Command line option tests'''
 
 import json
+import re
+import struct
 import sys
 import os.path
 import subprocess
@@ -22,6 +24,63 @@ import shutil
 glossaries = ('decodes', 'values')
 testout_pcap = 'testout.pcap'
 
+# Runs a command, then reports its peak resident set size on stderr.
+maxrss_wrapper = '''
+import resource, subprocess, sys
+ret = subprocess.call(sys.argv[1:])
+sys.stderr.write('maxrss: %d\\n' % resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss)
+sys.exit(ret)
+'''
+
+
+def udp_packet(src, dst, sport, dport, payload):
+    '''An Ethernet frame with an IPv4 UDP datagram.'''
+    udp = struct.pack('!HHHH', sport, dport, 8 + len(payload), 0) + payload
+    ip = bytearray(struct.pack('!BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), 0, 0x4000, 64, 17, 0, src, dst))
+    checksum = sum(struct.unpack('!10H', ip))
+    while checksum > 0xffff:
+        checksum = (checksum & 0xffff) + (checksum >> 16)
+    struct.pack_into('!H', ip, 10, ~checksum & 0xffff)
+    return b'\x00\x00\x5e\x00\x53\x02\x00\x00\x5e\x00\x53\x01\x08\x00' + bytes(ip) + udp
+
+
+def write_conversations_capture(path, tls_pcap, copies):
+    '''Write a pcap that repeats a DNS query and response, followed by the
+    TCP connections of tls_pcap, "copies" times, each time from new client
+    ports so that every copy adds new conversations.'''
+    with open(tls_pcap, 'rb') as tls_file:
+        tls_data = tls_file.read()
+    tls_packets = []
+    offset = 24
+    while offset < len(tls_data):
+        ts_sec, ts_usec, caplen, _ = struct.unpack('<IIII', tls_data[offset:offset + 16])
+        tls_packets.append((ts_sec, ts_usec, tls_data[offset + 16:offset + 16 + caplen]))
+        offset += 16 + caplen
+    # Ethernet and IPv4 without options, with the server on port 443.
+    tls_ports = sorted({struct.unpack('!H', pkt[34:36])[0] for _, _, pkt in tls_packets} - {443})
+    first_sec = tls_packets[0][0]
+    span = tls_packets[-1][0] - first_sec + 1
+    client, server = b'\x0a\x00\x00\x01', b'\x0a\x00\x00\x02'
+    question = b'\x07example\x03com\x00\x00\x01\x00\x01'
+    answer = b'\xc0\x0c\x00\x01\x00\x01\x00\x00\x00\x3c\x00\x04\x0a\x00\x00\x03'
+    with open(path, 'wb') as out_file:
+        out_file.write(tls_data[:24])
+        for copy in range(copies):
+            sec = first_sec + copy * span
+            port = 20000 + copy * (len(tls_ports) + 1)
+            query = struct.pack('!6H', copy, 0x0100, 1, 0, 0, 0) + question
+            response = struct.pack('!6H', copy, 0x8180, 1, 1, 0, 0) + question + answer
+            for pkt in (udp_packet(client, server, port, 53, query),
+                        udp_packet(server, client, 53, port, response)):
+                out_file.write(struct.pack('<IIII', sec, 0, len(pkt), len(pkt)) + pkt)
+            for ts_sec, ts_usec, pkt in tls_packets:
+                pkt = bytearray(pkt)
+                for port_offset in (34, 36):
+                    tls_port = struct.unpack('!H', pkt[port_offset:port_offset + 2])[0]
+                    if tls_port in tls_ports:
+                        struct.pack_into('!H', pkt, port_offset, port + 1 + tls_ports.index(tls_port))
+                out_file.write(struct.pack('<IIII', sec + ts_sec - first_sec, ts_usec, len(pkt), len(pkt)) + pkt)
+
 
 @fixtures.uses_fixtures
 class case_dumpcap_options(subprocesstest.SubprocessTestCase):
@@ -111,6 +170,92 @@ class case_tshark_options(subprocesstest.SubprocessTestCase):
             process = self.runProcess((cmd_tshark, '-' + char_arg))
             self.assertIn(process.returncode, valid_returns)
 
+    def test_tshark_conversation_aging(self, cmd_tshark, capture_file):
+        '''Evicting conversations must not change the packets printed'''
+        self.assertRun((cmd_tshark, '-r', capture_file('dns+icmp.pcapng.gz')))
+        num_lines = self.countOutput()
+        self.assertRun((cmd_tshark,
+            '--max-conversations', '1',
+            '--conversation-timeout', '1',
+            '-r', capture_file('dns+icmp.pcapng.gz')))
+        self.assertEqual(self.countOutput(), num_lines)
+        self.assertTrue(self.grepOutput('Conversations evicted'))
+
+    def test_tshark_conversation_aging_freed(self, cmd_tshark, capture_file, test_env):
+        '''Evicted conversations and TCP, TLS and HTTP state must not be used once freed'''
+        # The strict allocator overwrites freed memory, so anything still
+        # pointing at an evicted conversation changes the output or crashes.
+        # The test configuration has the key to decrypt the TLS sessions.
+        args = (cmd_tshark, '-V',
+            '--max-conversations', '1',
+            '-r', capture_file('rsasnakeoil2.pcap'))
+        self.assertRun(args, env=test_env)
+        expected = self.processes[-1].stdout_str
+        strict_env = dict(test_env)
+        strict_env['WIRESHARK_DEBUG_WMEM_OVERRIDE'] = 'strict'
+        self.assertRun(args, env=strict_env)
+        self.assertEqual(self.processes[-1].stdout_str, expected)
+        self.assertTrue(self.grepOutput(r'Conversations evicted: \d+ idle, [1-9]\d* over limit \(peak \d+\), 0 retained'))
+
+    def test_tshark_conversation_aging_bounded(self, cmd_tshark, capture_file, base_env):
+        '''Streaming UDP and TLS traffic keeps conversations and memory bounded'''
+        if sys.platform == 'win32':
+            self.skipTest('Measuring the peak memory use requires the resource module')
+        # Without keys TLS keeps no per-packet data, nor do TCP and UDP
+        # without timestamps, so conversations hold the memory that grows.
+        # Each copy in the capture takes 14 seconds.
+        tshark_args = (cmd_tshark, '-q',
+            '-o', 'tcp.calculate_timestamps:FALSE',
+            '-o', 'udp.calculate_timestamps:FALSE')
+        aging_args = ('--max-conversations', '30', '--conversation-timeout', '30')
+        maxrss = {}
+        for copies in (200, 2000):
+            capture = self.filename_from_id('{}.pcap'.format(copies))
+            write_conversations_capture(capture, capture_file('rsasnakeoil2.pcap'), copies)
+            for extra_args in ((), aging_args):
+                self.assertRun((sys.executable, '-c', maxrss_wrapper) +
+                    tshark_args + extra_args + ('-r', capture), env=base_env)
+                maxrss[copies, extra_args] = int(re.search(r'maxrss: (\d+)',
+                    self.processes[-1].stderr_str).group(1))
+            # A DNS conversation and two TCP ones for each copy, none of
+            # them retained.
+            stats = re.search(r'Conversations evicted: (\d+) idle, (\d+) over limit \(peak (\d+)\), (\d+) retained',
+                self.processes[-1].stderr_str)
+            self.assertIsNotNone(stats)
+            self.assertGreaterEqual(int(stats.group(1)) + int(stats.group(2)), copies * 3 - 31)
+            self.assertLessEqual(int(stats.group(3)), 31)
+            self.assertEqual(int(stats.group(4)), 0)
+        unlimited_growth = maxrss[2000, ()] - maxrss[200, ()]
+        aging_growth = maxrss[2000, aging_args] - maxrss[200, aging_args]
+        self.assertGreater(unlimited_growth, 0)
+        self.assertLess(aging_growth, unlimited_growth / 4)
+
+    def test_tshark_conversation_aging_two_pass(self, cmd_tshark, capture_file):
+        self.assertRun((cmd_tshark, '-2',
+            '--max-conversations', '1',
+            '-r', capture_file('dns+icmp.pcapng.gz')),
+            expected_return=self.exit_command_line)
+
+    def test_tshark_workers(self, cmd_tshark, capture_file):
+        '''Dissecting with workers must give the same output as without'''
+        if sys.platform == 'win32':
+            self.skipTest('--workers is not supported on Windows')
+        for extra_args in ((), ('-T', 'fields', '-e', 'frame.number',
+                '-e', 'frame.time_relative', '-e', 'frame.time_delta',
+                '-e', 'ip.src', '-e', 'dns.time', '-e', 'icmp.resp_to')):
+            single = self.assertRun((cmd_tshark,
+                '-r', capture_file('dns+icmp.pcapng.gz')) + extra_args)
+            sharded = self.assertRun((cmd_tshark, '--workers', '3',
+                '-r', capture_file('dns+icmp.pcapng.gz')) + extra_args)
+            self.assertEqual(single.stdout_str, sharded.stdout_str)
+
+    def test_tshark_workers_two_pass(self, cmd_tshark, capture_file):
+        if sys.platform == 'win32':
+            self.skipTest('--workers is not supported on Windows')
+        self.assertRun((cmd_tshark, '-2', '--workers', '2',
+            '-r', capture_file('dns+icmp.pcapng.gz')),
+            expected_return=self.exit_command_line)
+
 
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
@@ -282,6 +427,15 @@ class case_tshark_z_expert(subprocesstest.SubprocessTestCase):
         self.assertFalse(self.grepOutput('Warns'))
         self.assertFalse(self.grepOutput('Chats'))
 
+    def test_tshark_z_expert_shared_filters(self, cmd_tshark, capture_file):
+        # Listener filters testing the same fields are evaluated together.
+        self.assertRun((cmd_tshark, '-q',
+            '-z', 'expert,error,udp',
+            '-z', 'expert,error,tcp.port == 80',
+            '-z', 'expert,error,tcp.port == 80 && udp',
+            '-r', capture_file('http-ooo.pcap')))
+        self.assertEqual(self.countOutput('Errors'), 1)
+
 
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
@@ -58,3 +58,23 @@ class case_membership(unittest.TestCase):
         dfilter = 'frame.number in {1 "foo"}'
         error = '"foo" cannot be converted to Unsigned integer, 4 bytes.'
         checkDFilterFail(dfilter, error)
+
+    def test_membership_12_ip_subnet_match(self, checkDFilterCount):
+        dfilter = 'ip.addr in {192.168.0.0/16 10.0.0.0/8 1.2.3.4}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_13_ip_subnet_no_match(self, checkDFilterCount):
+        dfilter = 'ip.addr in {192.168.0.0/16 10.0.1.0/24 10.0.0.6}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_14_overlapping_ranges(self, checkDFilterCount):
+        dfilter = 'tcp.dstport in {90 .. 100 1 .. 70 60 .. 79 71}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_15_adjacent_ranges_match(self, checkDFilterCount):
+        dfilter = 'tcp.dstport in {1 .. 79 80 .. 80 81 .. 90}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_16_ether(self, checkDFilterCount):
+        dfilter = 'eth.src in {00:00:00:00:00:01 00:09:6b:88:f5:c9}'
+        checkDFilterCount(dfilter, 1)
@@ -132,6 +132,22 @@ class case_string(unittest.TestCase):
         dfilter = 'http.request.method contains 48:45:41:44' # "HEAD"
         checkDFilterCount(dfilter, 1)
 
+    def test_contains_or_1(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "POST" or http.request.method contains "EA"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_or_2(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "POST" or http.request.method contains "PUT"'
+        checkDFilterCount(dfilter, 0)
+
+    def test_contains_or_matches_1(self, checkDFilterCount):
+        dfilter = 'http.request.method contains "POST" or http.request.method matches "^he"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_or_matches_2(self, checkDFilterCount):
+        dfilter = 'http.request.method matches "^post" or frame.number == 0 or http.request.method matches "ad$"'
+        checkDFilterCount(dfilter, 1)
+
     def test_contains_fail_0(self, checkDFilterCount):
         dfilter = 'http.user_agent contains "update"'
         checkDFilterCount(dfilter, 0)
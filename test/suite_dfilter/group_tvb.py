@@ -60,4 +60,16 @@ class case_tvb(unittest.TestCase):
         dfilter = 'http contains "HEAD"'
         checkDFilterCount(dfilter, 1)
 
+    def test_contains_or_1(self, checkDFilterCount):
+        dfilter = 'http contains "POST" or http contains "HEAD" or http contains "PUT"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_or_2(self, checkDFilterCount):
+        dfilter = 'eth contains ff:ff:ff or eth contains 09:6b:88'
+        checkDFilterCount(dfilter, 1)
+
+    def test_contains_or_3(self, checkDFilterCount):
+        dfilter = 'eth contains ff:ff:ff or eth contains 01:02:03'
+        checkDFilterCount(dfilter, 0)
+
 
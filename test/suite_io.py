@@ -85,3 +85,21 @@ class case_rawshark_io(subprocesstest.SubprocessTestCase):
         rawshark_cmd = '{0} | "{1}" -r - -n -dencap:1 -R "udp.port==68"'.format(raw_dhcp_cmd, cmd_rawshark)
         rawshark_proc = self.assertRun(rawshark_cmd, shell=True)
         self.assertTrue(self.diffOutput(rawshark_proc.stdout_str, io_baseline_str, 'rawshark', baseline_file))
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_compressed_io(subprocesstest.SubprocessTestCase):
+    def test_tshark_io_lz4(self, cmd_tshark, capture_file):
+        '''Read an LZ4 compressed file using TShark'''
+        # rsasnakeoil2.pcap.lz4 was written with "lz4 -B4096 -BX", so it
+        # has several independent blocks, each with a checksum.
+        for args in (('-V', '-x'), ('-2', '-R', 'tls', '-x')):
+            outputs = []
+            for filename in ('rsasnakeoil2.pcap', 'rsasnakeoil2.pcap.lz4'):
+                tshark_proc = self.assertRun((cmd_tshark,
+                    '-r', capture_file(filename),
+                ) + args)
+                outputs.append(tshark_proc.stdout_str)
+            self.assertNotEqual(outputs[0], '')
+            self.assertEqual(outputs[0], outputs[1])
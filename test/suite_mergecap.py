@@ -122,6 +122,66 @@ class case_mergecap_pcap(subprocesstest.SubprocessTestCase):
         ))
         check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', 62, 1, 62)
 
+    def test_mergecap_max_open_3_empty_pcap_pcap(self, cmd_mergecap, capture_file):
+        '''Merge three pcap files to pcap, two empty, one file open at a time'''
+        testout_file = self.filename_from_id(testout_pcap)
+        mergecap_proc = self.assertRun((cmd_mergecap,
+            '-v',
+            '-F', 'pcap',
+            '-M', '1',
+            '-w', testout_file,
+            capture_file('empty.pcap'), capture_file('dhcp.pcap'), capture_file('empty.pcap'),
+        ))
+        check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', 4, 1, 4)
+
+    def test_mergecap_max_open_2_nano_pcap_pcap(self, cmd_mergecap, capture_file):
+        '''Merge two pcap files to pcap, one file open at a time'''
+        testout_file = self.filename_from_id(testout_pcap)
+        mergecap_proc = self.assertRun((cmd_mergecap,
+            '-v',
+            '-F', 'pcap',
+            '-M', '1',
+            '-w', testout_file,
+            capture_file('dhcp-nanosecond.pcap'), capture_file('rsasnakeoil2.pcap'),
+        ))
+        check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', 62, 1, 62)
+
+    def test_mergecap_max_open_2_gz_pcapng_pcap(self, cmd_mergecap, capture_file):
+        '''Merge a compressed pcapng file and a pcap file that starts earlier to pcap, one file open at a time'''
+        testout_file = self.filename_from_id(testout_pcap)
+        mergecap_proc = self.assertRun((cmd_mergecap,
+            '-v',
+            '-F', 'pcap',
+            '-M', '1',
+            '-w', testout_file,
+            capture_file('dhe1.pcapng.gz'), capture_file('dhcp.pcap'),
+        ))
+        check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', 20, 1, 20)
+
+    def test_mergecap_max_open_2_append_pcap_pcap(self, cmd_mergecap, capture_file):
+        '''Concatenate two pcap files to pcap, one file open at a time'''
+        testout_file = self.filename_from_id(testout_pcap)
+        mergecap_proc = self.assertRun((cmd_mergecap,
+            '-v',
+            '-a',
+            '-F', 'pcap',
+            '-M', '1',
+            '-w', testout_file,
+            capture_file('rsasnakeoil2.pcap'), capture_file('dhcp.pcap'),
+        ))
+        check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', 62, 1, 62)
+
+    def test_mergecap_max_open_2_overlapping_pcap_pcap(self, cmd_mergecap, capture_file):
+        '''Refuse to merge two pcap files that overlap in time with one file open at a time'''
+        testout_file = self.filename_from_id(testout_pcap)
+        self.assertRun((cmd_mergecap,
+            '-F', 'pcap',
+            '-M', '1',
+            '-w', testout_file,
+            capture_file('dhcp.pcap'), capture_file('dhcp-nanosecond.pcap'),
+        ), expected_return=2)
+        self.assertTrue(self.grepOutput("can't be merged in chronological order"))
+
 
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
@@ -233,6 +293,19 @@ class case_mergecap_pcapng(subprocesstest.SubprocessTestCase):
         ))
         check_mergecap(self, mergecap_proc, 'pcapng', 'Per packet', 88, 33, 62)
 
+    def test_mergecap_max_open_3_pcapng_pcapng(self, cmd_mergecap, capture_file):
+        '''Merge multiple pcapng files with many interfaces to pcapng, two files open at a time'''
+        testout_file = self.filename_from_id(testout_pcapng)
+        mergecap_proc = self.assertRun((cmd_mergecap,
+            '-v',
+            '-M', '2',
+            '-w', testout_file,
+            capture_file('many_interfaces.pcapng.1'),
+            capture_file('many_interfaces.pcapng.2'),
+            capture_file('many_interfaces.pcapng.3'),
+        ))
+        check_mergecap(self, mergecap_proc, 'pcapng', 'Per packet', 88, 11, 86)
+
     def test_mergecap_3_pcapng_all_pcapng(self, cmd_mergecap, capture_file):
         '''Merge multiple pcapng files to pcapng in "none" mode, then merge that to "all" mode.'''
         # build a pcapng of all the interfaces repeated by using mode 'none'
@@ -9,9 +9,12 @@
 #
 '''Name resolution tests'''
 
+import os
 import os.path
 import shutil
 import subprocesstest
+import sys
+import unittest
 import fixtures
 
 tf_str = { True: 'TRUE', False: 'FALSE' }
@@ -54,6 +57,27 @@ def check_name_resolution(cmd_tshark, capture_file, nameres_env):
     return check_name_resolution_real
 
 
+@fixtures.fixture
+def resolv_db_env(test_env, program_path, dirs, request):
+    '''A data directory whose manuf, wka, services and enterprises.tsv files
+    are compiled with tools/make-resolv-db.py, and everything else links to
+    the global data files.'''
+    data_dir = request.instance.filename_from_id('datadir')
+    os.makedirs(data_dir)
+    resolv_files = ('manuf', 'wka', 'services', 'enterprises.tsv')
+    for name in os.listdir(program_path):
+        if name not in resolv_files and not name.endswith('.db'):
+            os.symlink(os.path.join(program_path, name), os.path.join(data_dir, name))
+    for name, kind in zip(resolv_files, ('ethers', 'ethers', 'services', 'enterprises')):
+        path = os.path.join(data_dir, name)
+        shutil.copyfile(os.path.join(program_path, name), path)
+        request.instance.assertRun((sys.executable,
+            os.path.join(dirs.tools_dir, 'make-resolv-db.py'), kind, path, path + '.db'))
+    env = test_env
+    env['WIRESHARK_DATA_DIR'] = data_dir
+    return env
+
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_name_resolution(subprocesstest.SubprocessTestCase):
@@ -129,3 +153,59 @@ class case_name_resolution(subprocesstest.SubprocessTestCase):
                 ))
         self.assertTrue(self.grepOutput('fe80::6233:4bff:fe13:c558\tCrunch.local'))
         self.assertFalse(self.grepOutput('174.137.42.65\twww.wireshark.org'))
+
+    @unittest.skipIf(sys.platform.startswith('win32'), 'WIRESHARK_DATA_DIR is not used on Windows')
+    def test_resolv_db(self, cmd_tshark, capture_file, resolv_db_env):
+        '''Names are the same with and without the compiled databases.'''
+        data_dir = resolv_db_env['WIRESHARK_DATA_DIR']
+        outputs = []
+        def run_tshark():
+            output = ''
+            for filename in ('dhcp.pcap', 'rsasnakeoil2.pcap', 'sample_control4_2012-03-24.pcap'):
+                tshark_proc = self.assertRun((cmd_tshark,
+                    '-r', capture_file(filename),
+                    '-N', 'mt',
+                    '-V',
+                ), env=resolv_db_env)
+                output += tshark_proc.stdout_str
+            return output
+
+        # The databases, found current by the modification times.
+        outputs.append(run_tshark())
+        self.assertIn('Grandstr_01:fc:42', outputs[0])
+
+        # Copied files get new modification times; the CRC still matches.
+        for name in ('manuf', 'wka', 'services', 'enterprises.tsv'):
+            path = os.path.join(data_dir, name)
+            stat = os.stat(path)
+            os.utime(path, (stat.st_atime, stat.st_mtime - 3600))
+        outputs.append(run_tshark())
+
+        # The text files only.
+        for name in ('manuf', 'wka', 'services', 'enterprises.tsv'):
+            os.remove(os.path.join(data_dir, name + '.db'))
+        outputs.append(run_tshark())
+
+        self.assertEqual(outputs[0], outputs[1])
+        self.assertEqual(outputs[0], outputs[2])
+
+    @unittest.skipIf(sys.platform.startswith('win32'), 'WIRESHARK_DATA_DIR is not used on Windows')
+    def test_resolv_db_stale(self, cmd_tshark, capture_file, resolv_db_env):
+        '''A database is not used once its text file has changed.'''
+        data_dir = resolv_db_env['WIRESHARK_DATA_DIR']
+        manuf_path = os.path.join(data_dir, 'manuf')
+        # Change a name without changing the size of the file.
+        with open(manuf_path, 'rb') as f:
+            manuf_contents = f.read()
+        self.assertIn(b'00:0B:82\tGrandstr\t', manuf_contents)
+        with open(manuf_path, 'wb') as f:
+            f.write(manuf_contents.replace(b'00:0B:82\tGrandstr\t', b'00:0B:82\tGrandstx\t'))
+        stat = os.stat(manuf_path)
+        os.utime(manuf_path, (stat.st_atime, stat.st_mtime + 3600))
+        self.assertRun((cmd_tshark,
+            '-r', capture_file('dhcp.pcap'),
+            '-N', 'm',
+            '-V',
+        ), env=resolv_db_env)
+        self.assertTrue(self.grepOutput('Grandstx_01:fc:42'))
+        self.assertFalse(self.grepOutput('Grandstr_01:fc:42'))
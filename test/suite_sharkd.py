@@ -10,6 +10,8 @@
 '''sharkd tests'''
 
 import json
+import os
+import shutil
 import subprocess
 import unittest
 import subprocesstest
@@ -86,6 +88,103 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
                 "filename": "dhcp.pcap", "filesize": 1400},
         ))
 
+    def test_sharkd_frame_index(self, cmd_sharkd, capture_file, base_env):
+        '''Reload a capture from the frame index written by the first load.'''
+        capture = self.filename_from_id('dhcp.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), capture)
+        env = dict(base_env, SHARKD_FRAME_INDEX='1')
+        commands = '\n'.join(json.dumps(x) for x in (
+            {"req": "load", "file": capture},
+            {"req": "status"},
+            {"req": "frames"},
+        ))
+        outputs = []
+        for _ in range(2):
+            sharkd_proc = self.startProcess(
+                (cmd_sharkd, '-'), stdin=subprocess.PIPE, env=env)
+            sharkd_proc.stdin.write(commands.encode('utf8'))
+            self.waitProcess(sharkd_proc)
+            self.assertTrue(os.path.isfile(capture + '.wsidx'))
+            outputs.append(sharkd_proc.stdout_str)
+        self.assertEqual(outputs[0], outputs[1])
+
+    def test_sharkd_frame_index_corrupt(self, cmd_sharkd, capture_file, base_env):
+        '''A truncated index, or one claiming more frames than it holds, is
+        ignored.'''
+        capture = self.filename_from_id('dhcp.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), capture)
+        env = dict(base_env, SHARKD_FRAME_INDEX='1')
+        commands = '\n'.join(json.dumps(x) for x in (
+            {"req": "load", "file": capture},
+            {"req": "status"},
+            {"req": "frames"},
+        ))
+
+        def run_sharkd():
+            sharkd_proc = self.startProcess(
+                (cmd_sharkd, '-'), stdin=subprocess.PIPE, env=env)
+            sharkd_proc.stdin.write(commands.encode('utf8'))
+            self.waitProcess(sharkd_proc)
+            self.assertEqual(sharkd_proc.returncode, 0)
+            return sharkd_proc.stdout_str
+
+        expected = run_sharkd()
+        with open(capture + '.wsidx', 'rb') as f:
+            index = f.read()
+        # The frame count is at offset 68 of the header, after the
+        # interface count.
+        huge_count = index[:68] + b'\xff\xff\xff\xff' + index[72:]
+        for corrupt in (index[:-1], index[:100], huge_count):
+            with open(capture + '.wsidx', 'wb') as f:
+                f.write(corrupt)
+            self.assertEqual(run_sharkd(), expected)
+
+    def test_sharkd_frame_index_out_of_order(self, cmd_sharkd, capture_file, base_env):
+        '''Requesting frames out of order after loading from the frame index
+        gives the same results as after a sequential load.'''
+        # TCP analysis depends on the order of the first pass.
+        for capture_name in ('rsasnakeoil2.pcap', 'dhcp.pcapng'):
+            capture = self.filename_from_id(capture_name)
+            shutil.copyfile(capture_file(capture_name), capture)
+            commands = '\n'.join(json.dumps(x) for x in (
+                {"req": "load", "file": capture},
+                {"req": "frame", "frame": 4, "proto": True},
+                {"req": "frame", "frame": 2, "proto": True},
+                {"req": "frames", "filter": "tcp.analysis.flags || udp"},
+                {"req": "frame", "frame": 1, "proto": True, "bytes": True},
+            ))
+            outputs = []
+            for frame_index in ('0', '1', '1'):
+                env = dict(base_env, SHARKD_FRAME_INDEX=frame_index)
+                sharkd_proc = self.startProcess(
+                    (cmd_sharkd, '-'), stdin=subprocess.PIPE, env=env)
+                sharkd_proc.stdin.write(commands.encode('utf8'))
+                self.waitProcess(sharkd_proc)
+                outputs.append(sharkd_proc.stdout_str)
+            # The last run is the one that used the index.
+            self.assertTrue(os.path.isfile(capture + '.wsidx'))
+            self.assertEqual(outputs[0], outputs[2])
+
+    def test_sharkd_column_cache(self, cmd_sharkd, capture_file, base_env):
+        '''Frames served from the column cache match freshly dissected ones.'''
+        env = dict(base_env, SHARKD_COLUMN_CACHE='1')
+        commands = '\n'.join(json.dumps(x) for x in (
+            {"req": "load", "file": capture_file('dhcp.pcap')},
+            {"req": "frames"},
+            {"req": "frames", "skip": 1},
+            {"req": "frames"},
+            {"req": "frames", "refs": "2"},
+        ))
+        sharkd_proc = self.startProcess(
+            (cmd_sharkd, '-'), stdin=subprocess.PIPE, env=env)
+        sharkd_proc.stdin.write(commands.encode('utf8'))
+        self.waitProcess(sharkd_proc)
+        outputs = [json.loads(line) for line in sharkd_proc.stdout_str.splitlines() if line.strip()]
+        self.assertEqual(len(outputs), 5)
+        self.assertEqual(outputs[1], outputs[3])
+        self.assertEqual(outputs[1][1:], outputs[2])
+        self.assertNotEqual(outputs[1], outputs[4])
+
     def test_sharkd_req_analyse(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"req": "load", "file": capture_file('dhcp.pcap')},
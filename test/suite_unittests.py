@@ -24,6 +24,14 @@ class case_unittests(subprocesstest.SubprocessTestCase):
         '''exntest'''
         self.assertRun(program('exntest'), env=base_env)
 
+    def test_unit_file_wrappers_test(self, program, base_env):
+        '''file_wrappers_test'''
+        self.assertRun(program('file_wrappers_test'), env=base_env)
+
+    def test_unit_frame_data_store_test(self, program, base_env):
+        '''frame_data_store_test'''
+        self.assertRun(program('frame_data_store_test'), env=base_env)
+
     def test_unit_oids_test(self, program, base_env):
         '''oids_test'''
         self.assertRun(program('oids_test'), env=base_env)
@@ -32,6 +40,10 @@ class case_unittests(subprocesstest.SubprocessTestCase):
         '''reassemble_test'''
         self.assertRun(program('reassemble_test'), env=base_env)
 
+    def test_unit_test_wsutil(self, program, base_env):
+        '''test_wsutil'''
+        self.assertRun(program('test_wsutil'), env=base_env)
+
     def test_unit_tvbtest(self, program, base_env):
         '''tvbtest'''
         self.assertRun(program('tvbtest'), env=base_env)
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+#
+# Times display filters made of many "contains" tests of one field.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Benchmark an OR-ed list of indicators against "tshark -Y".
+
+Usage: dfilter-contains-bench.py [--tshark PATH] [--runs N] [--field FIELD]
+                                 [--count N ...] [--ioc-file FILE]
+                                 [--regexes N] CAPTURE
+
+Builds filters of the form
+
+    FIELD contains "ioc1" or FIELD contains "ioc2" or ...
+
+from the first --count lines of --ioc-file, or from random host names if
+there is none, and times "tshark -Y" with each. Up to --regexes of the
+indicators are tested with "matches" instead of "contains". Such filters
+are compiled into a single scan of each value of the field; the same
+filter on FIELD[0:] is evaluated one test at a time, so it is timed as the
+baseline and must pass the same frames. The time to read and dissect the
+capture without a filter is subtracted from both. The best of --runs is
+reported.
+
+On Linux a single command line argument can be at most 128 KiB, which
+is enough for about 4000 indicators of 30 characters.
+'''
+
+import argparse
+import random
+import re
+import string
+import subprocess
+import sys
+import time
+
+
+def run(tshark, capture, dfilter):
+    cmd = [tshark, '-n', '-r', capture, '-T', 'fields', '-e', 'frame.number']
+    if dfilter:
+        cmd += ['-Y', dfilter]
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stderr.decode('utf-8', 'replace'))
+        return None, None
+    return elapsed, proc.stdout.split()
+
+
+def best_of(runs, tshark, capture, dfilter):
+    best = None
+    frames = None
+    for _ in range(runs):
+        elapsed, frames = run(tshark, capture, dfilter)
+        if elapsed is None:
+            return None, None
+        if best is None or elapsed < best:
+            best = elapsed
+    return best, frames
+
+
+def random_iocs(count):
+    rng = random.Random(count)
+    tlds = ['com', 'net', 'org', 'info', 'ru', 'cn', 'xyz']
+    iocs = []
+    for _ in range(count):
+        label = ''.join(rng.choice(string.ascii_lowercase + string.digits)
+                        for _ in range(rng.randint(6, 16)))
+        iocs.append('{}.{}'.format(label, rng.choice(tlds)))
+    return iocs
+
+
+def quote(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def build_filter(field, iocs, regexes):
+    tests = []
+    for i, ioc in enumerate(iocs):
+        if i < regexes:
+            # Escaped for the regular expression, then for the string
+            tests.append('{} matches {}'.format(field, quote(re.escape(ioc))))
+        else:
+            tests.append('{} contains {}'.format(field, quote(ioc)))
+    return ' or '.join(tests)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--tshark', default='tshark')
+    parser.add_argument('--runs', type=int, default=3)
+    parser.add_argument('--field', default='frame')
+    parser.add_argument('--count', type=int, nargs='+', default=[10, 100, 500, 2000])
+    parser.add_argument('--ioc-file', help='one indicator per line')
+    parser.add_argument('--regexes', type=int, default=0)
+    parser.add_argument('capture')
+    args = parser.parse_args()
+
+    if args.ioc_file:
+        with open(args.ioc_file, encoding='utf-8') as f:
+            iocs = [l.strip() for l in f if l.strip() and not l.startswith('#')]
+    else:
+        iocs = random_iocs(max(args.count))
+
+    base_time, _ = best_of(args.runs, args.tshark, args.capture, None)
+    if base_time is None:
+        sys.exit('reading {} failed'.format(args.capture))
+    print('no filter: {:8.3f} s'.format(base_time))
+
+    for count in args.count:
+        subset = iocs[:count]
+        folded = build_filter(args.field, subset, args.regexes)
+        baseline = build_filter(args.field + '[0:]', subset, args.regexes)
+        if len(baseline) >= 128 * 1024:
+            print('{:6d} indicators: filter too long for the command line'.format(len(subset)))
+            continue
+
+        folded_time, folded_frames = best_of(args.runs, args.tshark, args.capture, folded)
+        baseline_time, baseline_frames = best_of(args.runs, args.tshark, args.capture, baseline)
+        if folded_time is None or baseline_time is None:
+            print('{:6d} indicators: failed'.format(len(subset)))
+            continue
+
+        folded_time = max(folded_time - base_time, 0.0)
+        baseline_time = max(baseline_time - base_time, 0.0)
+        status = 'ok' if folded_frames == baseline_frames else 'MISMATCH'
+        print('{:6d} indicators: {:8.3f} s one scan, {:8.3f} s one test at a time '
+              '({:6.1f}x), {:8d} frames passed, {}'.format(
+                  len(subset), folded_time, baseline_time,
+                  baseline_time / folded_time if folded_time > 0 else float('inf'),
+                  len(folded_frames), status))
+
+
+if __name__ == '__main__':
+    main()
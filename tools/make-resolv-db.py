@@ -0,0 +1,365 @@
+#!/usr/bin/env python3
+#
+# Compiles the manuf, wka, services and enterprises.tsv files into the
+# binary databases epan/addr_resolv.c maps instead of parsing the text
+# files at startup.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+'''\
+Usage: make-resolv-db.py ethers|services|enterprises <text file> <database>
+
+"ethers" is the format of the manuf and wka files. The text file is read
+the way epan/addr_resolv.c reads it; entries later in the file replace
+earlier ones.
+
+The database layout (all numbers little-endian) is described in
+epan/resolv_db.h:
+
+    header       "WSRESDB\\0", version, section count, size of the text
+                 file, offset and size of the string area, modification
+                 time and CRC-32 of the text file, padding
+    sections     type, key length, strings per record, record count,
+                 offset of the records
+    records      the key (numbers big-endian, so the records sort by
+                 memcmp()) followed by the offsets of its strings
+    strings      NUL-terminated; offset 0 is the empty string, meaning
+                 "none"
+'''
+
+import os
+import struct
+import sys
+import zlib
+
+RESOLV_DB_MAGIC = b'WSRESDB\0'
+RESOLV_DB_VERSION = 2
+
+# Section types, key lengths and strings per record; these must match
+# resolv_db_section_e in epan/resolv_db.h.
+SECTION_MANUF = (1, 3, 2)
+SECTION_WKA = (2, 6, 1)
+SECTION_ETHER = (3, 6, 1)
+SECTION_SERVICES = (4, 2, 4)
+SECTION_ENTERPRISES = (5, 4, 1)
+
+# From epan/addr_resolv.[ch]
+MAX_LINELEN = 1024
+MAXNAMELEN = 64
+
+
+def read_lines(path):
+    '''Yield the lines of a file as fgetline() returns them.'''
+    with open(path, 'rb') as f:
+        for line in f:
+            # fgets() with a MAX_LINELEN buffer
+            while len(line) > MAX_LINELEN - 1:
+                yield line[:MAX_LINELEN - 1].split(b'\r')[0].split(b'\n')[0]
+                line = line[MAX_LINELEN - 1:]
+            yield line.split(b'\r')[0].split(b'\n')[0]
+
+
+class Strtok:
+    '''strtok(), for byte strings.'''
+    def __init__(self, s):
+        self.s = s
+        self.pos = 0
+
+    def next(self, delims):
+        s = self.s
+        pos = self.pos
+        while pos < len(s) and s[pos] in delims:
+            pos += 1
+        if pos >= len(s):
+            self.pos = pos
+            return None
+        end = pos
+        while end < len(s) and s[end] not in delims:
+            end += 1
+        self.pos = end + 1
+        return s[pos:end]
+
+
+def truncate_name(name):
+    '''g_strlcpy() into a MAXNAMELEN buffer.'''
+    return name[:MAXNAMELEN - 1]
+
+
+def gstrip(s):
+    return s.strip(b' \t\n\r\f\v')
+
+
+def parse_ether_address(cp):
+    '''parse_ether_address() with accept_mask; returns (addr, mask) or None.'''
+    hexdigits = b'0123456789abcdefABCDEF'
+    addr = [0] * 6
+    sep = None
+    pos = 0
+    for i in range(6):
+        if pos >= len(cp) or cp[pos] not in hexdigits:
+            return None
+        end = pos
+        while end < len(cp) and cp[end] in hexdigits:
+            end += 1
+        num = int(cp[pos:end], 16)
+        if num > 0xff:
+            return None
+        addr[i] = num
+        pos = end
+        c = cp[pos:pos + 1]
+        if c == b'/':
+            pos += 1
+            end = pos
+            while end < len(cp) and cp[end:end + 1].isdigit():
+                end += 1
+            if end == pos or end != len(cp):
+                return None
+            mask = int(cp[pos:end])
+            if mask == 0 or mask >= 48:
+                return None
+            # Mask out the bits not covered by the mask
+            j, num = 0, mask
+            while num >= 8:
+                j += 1
+                num -= 8
+            addr[j] &= (0xff << (8 - num)) & 0xff
+            for j in range(j + 1, 6):
+                addr[j] = 0
+            return (bytes(addr), mask)
+        if c == b'':
+            if i == 2:
+                # A manufacturer ID
+                return (bytes(addr), 0)
+            if i == 5:
+                return (bytes(addr), 48)
+            return None
+        if sep is None:
+            if c not in (b':', b'-', b'.'):
+                return None
+            sep = c
+        elif c != sep:
+            return None
+        pos += 1
+    return (bytes(addr), 48)
+
+
+def parse_ethers(path, sections):
+    '''The manuf and wka files, as initialize_ethers() reads them.'''
+    for line in read_lines(path):
+        line = gstrip(line)
+        if not line or line.startswith(b'#'):
+            continue
+        cp = line.find(b'#')
+        if cp >= 0:
+            line = line[:cp].rstrip(b' \t\n\r\f\v')
+        tok = Strtok(line)
+        cp = tok.next(b' \t')
+        if cp is None:
+            continue
+        parsed = parse_ether_address(cp)
+        if parsed is None:
+            continue
+        addr, mask = parsed
+        name = tok.next(b' \t')
+        if name is None:
+            continue
+        name = truncate_name(name)
+        longname = tok.next(b'\t')
+        longname = truncate_name(longname) if longname is not None else name
+
+        if mask == 0:
+            sections[SECTION_MANUF][addr[:3]] = (name, longname)
+        elif mask == 48:
+            sections[SECTION_ETHER][addr] = (name,)
+        else:
+            sections[SECTION_WKA][addr] = (name,)
+
+
+def strtou32_base0(s, pos):
+    '''ws_basestrtou32(..., 0); returns (value, end) or None.'''
+    hexdigit = s[pos + 2:pos + 3]
+    if s[pos:pos + 2] in (b'0x', b'0X') and hexdigit and hexdigit in b'0123456789abcdefABCDEF':
+        base, digits, pos = 16, b'0123456789abcdefABCDEF', pos + 2
+    elif s[pos:pos + 1] == b'0':
+        base, digits = 8, b'01234567'
+    else:
+        base, digits = 10, b'0123456789'
+    end = pos
+    while end < len(s) and s[end] in digits:
+        end += 1
+    if end == pos:
+        return None
+    return (int(s[pos:end], base), end)
+
+
+def parse_range(s, max_value):
+    '''range_convert_str(); returns a list of (low, high) or None.'''
+    ranges = []
+    pos = 0
+    while True:
+        while s[pos:pos + 1] in (b' ', b'\t'):
+            pos += 1
+        if pos >= len(s):
+            break
+        c = s[pos:pos + 1]
+        if c == b'-':
+            low = 1
+        elif c.isdigit():
+            r = strtou32_base0(s, pos)
+            if r is None or r[0] > max_value:
+                return None
+            low, pos = r
+            while s[pos:pos + 1] in (b' ', b'\t'):
+                pos += 1
+        else:
+            return None
+        c = s[pos:pos + 1]
+        if c == b'-':
+            pos += 1
+            while s[pos:pos + 1] in (b' ', b'\t'):
+                pos += 1
+            c = s[pos:pos + 1]
+            if c in (b',', b''):
+                high = max_value
+            elif c.isdigit():
+                r = strtou32_base0(s, pos)
+                if r is None or r[0] > max_value:
+                    return None
+                high, pos = r
+                while s[pos:pos + 1] in (b' ', b'\t'):
+                    pos += 1
+                c = s[pos:pos + 1]
+            else:
+                return None
+        elif c in (b',', b''):
+            high = low
+        else:
+            return None
+        ranges.append((min(low, high), max(low, high)))
+        if c == b',':
+            pos += 1
+    return ranges
+
+
+def parse_services(path, sections):
+    '''The services file, as parse_service_line() reads it.'''
+    protos = {b'tcp': 0, b'udp': 1, b'sctp': 2, b'dccp': 3}
+    services = sections[SECTION_SERVICES]
+    for line in read_lines(path):
+        cp = line.find(b'#')
+        if cp >= 0:
+            line = line[:cp]
+        tok = Strtok(line)
+        service = tok.next(b' \t')
+        if service is None:
+            continue
+        port = tok.next(b' \t')
+        if port is None:
+            continue
+        tok = Strtok(port)
+        port = tok.next(b'/')
+        if port is None:
+            continue
+        ranges = parse_range(port, 0xffff)
+        if ranges is None:
+            continue
+        while True:
+            proto = tok.next(b'/')
+            if proto not in protos:
+                break
+            for low, high in ranges:
+                for p in range(max(low, 1), high + 1):
+                    key = struct.pack('>H', p)
+                    names = list(services.get(key, (b'', b'', b'', b'')))
+                    names[protos[proto]] = service
+                    services[key] = tuple(names)
+
+
+def parse_enterprises(path, sections):
+    '''The enterprises.tsv file, as parse_enterprises_line() reads it.'''
+    enterprises = sections[SECTION_ENTERPRISES]
+    for line in read_lines(path):
+        cp = line.find(b'#')
+        if cp >= 0:
+            line = line[:cp]
+        tok = Strtok(line)
+        dec_str = tok.next(b' \t')
+        if dec_str is None:
+            continue
+        org_str = tok.next(b'')
+        if org_str is None:
+            continue
+        org_str = gstrip(org_str)
+        # ws_strtou32(): a decimal number that fits in 32 bits
+        if not dec_str.isdigit() or int(dec_str) > 0xffffffff:
+            continue
+        enterprises[struct.pack('>I', int(dec_str))] = (org_str,)
+
+
+def write_db(path, source, sections):
+    strings = bytearray(b'\0')
+    string_offsets = {b'': 0}
+
+    def add_string(s):
+        if s not in string_offsets:
+            string_offsets[s] = len(strings)
+            strings.extend(s + b'\0')
+        return string_offsets[s]
+
+    used = [(section, records) for section, records in sections.items() if records]
+    header_len = 48 + 20 * len(used)
+    section_table = bytearray()
+    record_data = bytearray()
+    for (sec_type, key_len, n_strings), records in used:
+        section_table += struct.pack('<IIIII', sec_type, key_len, n_strings,
+                                     len(records), header_len + len(record_data))
+        for key in sorted(records):
+            record_data += key
+            for s in records[key]:
+                record_data += struct.pack('<I', add_string(s))
+
+    source_stat = os.stat(source)
+    with open(source, 'rb') as f:
+        source_crc = zlib.crc32(f.read()) & 0xffffffff
+    header = RESOLV_DB_MAGIC + struct.pack('<IIQIIqII', RESOLV_DB_VERSION, len(used),
+                                           source_stat.st_size,
+                                           header_len + len(record_data), len(strings),
+                                           source_stat.st_mtime_ns // 1000000000,
+                                           source_crc, 0)
+    tmp_path = path + '.tmp'
+    with open(tmp_path, 'wb') as f:
+        f.write(header)
+        f.write(section_table)
+        f.write(record_data)
+        f.write(strings)
+    os.replace(tmp_path, path)
+
+
+def main():
+    parsers = {
+        'ethers': parse_ethers,
+        'services': parse_services,
+        'enterprises': parse_enterprises,
+    }
+    if len(sys.argv) != 4 or sys.argv[1] not in parsers:
+        sys.stderr.write(__doc__)
+        sys.exit(1)
+    kind, source, output = sys.argv[1:]
+
+    sections = {
+        SECTION_MANUF: {},
+        SECTION_WKA: {},
+        SECTION_ETHER: {},
+        SECTION_SERVICES: {},
+        SECTION_ENTERPRISES: {},
+    }
+    parsers[kind](source, sections)
+    write_db(output, source, sections)
+
+
+if __name__ == '__main__':
+    main()
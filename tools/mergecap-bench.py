@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+#
+# Times mergecap over many small capture files, such as those written by
+# "dumpcap -b".
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Benchmark mergecap over 1k/10k input files.
+
+Usage: mergecap-bench.py [--mergecap PATH] [--files N ...] [--packets N]
+                         [--max-open N] [--overlap]
+
+Writes N pcap files of --packets Ethernet frames each to a temporary
+directory and merges them, once with all files open and once with at most
+--max-open files open. Without --overlap the files cover consecutive time
+ranges, like ring buffer files; with it the time stamps are interleaved,
+which is the worst case for the merge.
+'''
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+PCAP_HEADER = struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1)
+FRAME = bytes(60)
+
+
+def write_inputs(directory, nfiles, npackets, overlap):
+    names = []
+    for f in range(nfiles):
+        name = os.path.join(directory, 'ring_{:05d}.pcap'.format(f))
+        with open(name, 'wb') as fp:
+            fp.write(PCAP_HEADER)
+            for p in range(npackets):
+                if overlap:
+                    usecs = p * nfiles + f
+                else:
+                    usecs = f * npackets + p
+                fp.write(struct.pack('<IIII', 1000000000 + usecs // 1000000,
+                                     usecs % 1000000, len(FRAME), len(FRAME)))
+                fp.write(FRAME)
+        names.append(name)
+    return names
+
+
+def run(mergecap, names, outfile, extra):
+    cmd = [mergecap, '-F', 'pcap', '-w', outfile] + extra + names
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stderr.decode('utf-8', 'replace'))
+        return None
+    return elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--mergecap', default='mergecap')
+    parser.add_argument('--files', type=int, nargs='+', default=[1000, 10000])
+    parser.add_argument('--packets', type=int, default=100)
+    parser.add_argument('--max-open', type=int, default=64)
+    parser.add_argument('--overlap', action='store_true')
+    args = parser.parse_args()
+
+    for nfiles in args.files:
+        directory = tempfile.mkdtemp(prefix='mergecap-bench-')
+        try:
+            names = write_inputs(directory, nfiles, args.packets, args.overlap)
+            outfile = os.path.join(directory, 'merged.pcap')
+            total = nfiles * args.packets
+            for label, extra in (('all open', []),
+                                 ('-M {}'.format(args.max_open), ['-M', str(args.max_open)])):
+                elapsed = run(args.mergecap, names, outfile, extra)
+                if elapsed is None:
+                    print('{:6d} files, {:10s}: failed'.format(nfiles, label))
+                else:
+                    print('{:6d} files, {:10s}: {:8.3f} s, {:10.0f} packets/s'.format(
+                        nfiles, label, elapsed, total / elapsed))
+        finally:
+            shutil.rmtree(directory)
+
+
+if __name__ == '__main__':
+    main()
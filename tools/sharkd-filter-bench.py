@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# Times sharkd display filtering with and without SHARKD_FILTER_WORKERS.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Benchmark sequential and parallel refiltering in sharkd.
+
+Usage: sharkd-filter-bench.py [--sharkd PATH] [--workers N ...]
+                              [--filter FILTER ...] CAPTURE
+
+Loads CAPTURE in sharkd, then applies each filter with the "frames"
+request, once sequentially and once for each --workers count. The time
+to load the file is measured separately and subtracted. The frames that
+pass are compared against the sequential run, so the script also checks
+that the parallel filter gives the same result. Use a capture of a few
+GB with well over 8192 frames per worker, smaller ones are always
+filtered sequentially.
+'''
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+
+def run(sharkd, capture, requests, workers):
+    env = dict(os.environ)
+    env['SHARKD_FILTER_WORKERS'] = str(workers)
+    session = [{'req': 'load', 'file': capture}] + requests
+    stdin = '\n'.join(json.dumps(r) for r in session) + '\n'
+    start = time.perf_counter()
+    proc = subprocess.run([sharkd, '-'], input=stdin.encode('utf-8'),
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stderr.decode('utf-8', 'replace'))
+        return None, None
+    lines = [l for l in proc.stdout.decode('utf-8').splitlines() if l.strip()]
+    return elapsed, lines
+
+
+def passed_frames(line):
+    return [frame['num'] for frame in json.loads(line)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--sharkd', default='sharkd')
+    parser.add_argument('--workers', type=int, nargs='+', default=[2, 4, 8])
+    parser.add_argument('--filter', nargs='+', default=['tcp.port == 443', 'dns', 'http.request'])
+    parser.add_argument('capture')
+    args = parser.parse_args()
+    capture = os.path.abspath(args.capture)
+
+    load_time, _ = run(args.sharkd, capture, [{'req': 'status'}], 0)
+    if load_time is None:
+        sys.exit('loading {} failed'.format(capture))
+    print('load: {:8.3f} s'.format(load_time))
+
+    for dfilter in args.filter:
+        request = [{'req': 'frames', 'filter': dfilter}]
+        baseline = None
+        for workers in [0] + args.workers:
+            elapsed, lines = run(args.sharkd, capture, request, workers)
+            label = 'sequential' if workers == 0 else '{} workers'.format(workers)
+            if elapsed is None:
+                print('{:20s} {:12s}: failed'.format(dfilter, label))
+                continue
+            frames = passed_frames(lines[-1])
+            if baseline is None:
+                baseline = frames
+            status = 'ok' if frames == baseline else 'MISMATCH'
+            print('{:20s} {:12s}: {:8.3f} s, {:8d} frames passed, {}'.format(
+                dfilter, label, max(elapsed - load_time, 0.0), len(frames), status))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+#
+# Times tshark's JSON and EK output.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Benchmark "tshark -T json" and "tshark -T ek" on a reference capture.
+
+Usage: tshark-json-bench.py [--tshark PATH] [--runs N] [--format FMT ...]
+                            [--extra-args ARGS] CAPTURE
+
+Reads CAPTURE once with "-T fields -e frame.number" to measure the time
+spent on reading and dissecting, then once per --format. The output goes to
+a pipe that is drained and counted, so disk speed does not matter. The best
+of --runs is reported, together with the time over the dissection-only run
+which is what the JSON writer costs.
+'''
+
+import argparse
+import shlex
+import subprocess
+import sys
+import time
+
+
+def run(tshark, capture, args):
+    cmd = [tshark, '-n', '-r', capture] + args
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    nbytes = 0
+    while True:
+        chunk = proc.stdout.read(1 << 20)
+        if not chunk:
+            break
+        nbytes += len(chunk)
+    stderr = proc.stderr.read()
+    proc.wait()
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.stderr.write(stderr.decode('utf-8', 'replace'))
+        return None, 0
+    return elapsed, nbytes
+
+
+def best_of(runs, tshark, capture, args):
+    best = None
+    nbytes = 0
+    for _ in range(runs):
+        elapsed, nbytes = run(tshark, capture, args)
+        if elapsed is None:
+            return None, 0
+        if best is None or elapsed < best:
+            best = elapsed
+    return best, nbytes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--tshark', default='tshark')
+    parser.add_argument('--runs', type=int, default=3)
+    parser.add_argument('--format', nargs='+', default=['json', 'ek'])
+    parser.add_argument('--extra-args', default='',
+        help='additional tshark arguments, e.g. "-x" or "--no-duplicate-keys"')
+    parser.add_argument('capture')
+    args = parser.parse_args()
+
+    extra = shlex.split(args.extra_args)
+    base, _ = best_of(args.runs, args.tshark, args.capture,
+                      ['-T', 'fields', '-e', 'frame.number'] + extra)
+    if base is None:
+        return 1
+    print('{:8s}: {:8.3f} s'.format('fields', base))
+
+    for fmt in args.format:
+        elapsed, nbytes = best_of(args.runs, args.tshark, args.capture,
+                                  ['-T', fmt] + extra)
+        if elapsed is None:
+            print('{:8s}: failed'.format(fmt))
+            continue
+        writer = elapsed - base
+        rate = nbytes / writer / 1e6 if writer > 0 else float('inf')
+        print('{:8s}: {:8.3f} s, writer {:8.3f} s, {:10d} bytes, {:8.1f} MB/s written'.format(
+            fmt, elapsed, writer, nbytes, rate))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
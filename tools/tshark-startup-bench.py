@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+#
+# Times how long tshark takes to start up.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Benchmark the time to the first packet of "tshark -r".
+
+Usage: tshark-startup-bench.py [--tshark PATH] [--runs N]
+                               [--filter FILTER ...] [--target SECONDS]
+                               CAPTURE
+
+Reads CAPTURE, which should be a capture of a few packets so that
+registering the dissectors and loading the configuration is what takes the
+time, once without a display filter and once with each --filter. Filters
+look up field names, which makes tshark index the fields with the same
+prefix. The minimum and median of --runs are reported. With --target, the
+exit status is 1 if the minimum of any of them is above that many seconds.
+'''
+
+import argparse
+import statistics
+import subprocess
+import sys
+import time
+
+
+def run(tshark, capture, dfilter):
+    cmd = [tshark, '-n', '-r', capture]
+    if dfilter:
+        cmd += ['-Y', dfilter]
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stderr.decode('utf-8', 'replace'))
+        return None
+    return elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--tshark', default='tshark')
+    parser.add_argument('--runs', type=int, default=10)
+    parser.add_argument('--filter', nargs='+', default=['ip.src', 'tcp.port == 80 || dns'])
+    parser.add_argument('--target', type=float,
+        help='fail if the minimum time is above this many seconds')
+    parser.add_argument('capture')
+    args = parser.parse_args()
+
+    status = 0
+    for dfilter in [None] + args.filter:
+        times = []
+        for _ in range(args.runs):
+            elapsed = run(args.tshark, args.capture, dfilter)
+            if elapsed is None:
+                return 1
+            times.append(elapsed)
+
+        best = min(times)
+        verdict = ''
+        if args.target is not None:
+            verdict = 'ok' if best <= args.target else 'OVER TARGET'
+            if best > args.target:
+                status = 1
+        print('{:30s}: min {:7.3f} s, median {:7.3f} s {}'.format(
+            dfilter or '(no filter)', best, statistics.median(times), verdict))
+
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
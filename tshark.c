@@ -30,6 +30,10 @@
 
 #ifndef _WIN32
 #include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #endif
 
 #ifdef HAVE_LIBCAP
@@ -44,6 +48,8 @@
 
 #include <epan/exceptions.h>
 #include <epan/epan.h>
+#include <epan/etypes.h>
+#include <epan/ipproto.h>
 
 #include <ui/clopts_common.h>
 #include <ui/cmdarg_err.h>
@@ -91,6 +97,7 @@
 #include <epan/epan_dissect.h>
 #include <epan/tap.h>
 #include <epan/stat_tap_ui.h>
+#include <epan/conversation.h>
 #include <epan/conversation_table.h>
 #include <epan/srt_table.h>
 #include <epan/rtd_table.h>
@@ -116,6 +123,7 @@
 
 #include <wsutil/str_util.h>
 #include <wsutil/utf8_entities.h>
+#include <wsutil/pint.h>
 #include <wsutil/json_dumper.h>
 
 #include "extcap.h"
@@ -144,6 +152,9 @@
 #define LONGOPT_COLOR (65536+1000)
 #define LONGOPT_NO_DUPLICATE_KEYS (65536+1001)
 #define LONGOPT_ELASTIC_MAPPING_FILTER (65536+1002)
+#define LONGOPT_CONVERSATION_TIMEOUT (65536+1003)
+#define LONGOPT_MAX_CONVERSATIONS (65536+1004)
+#define LONGOPT_WORKERS (65536+1005)
 
 #if 0
 #define tshark_debug(...) g_warning(__VA_ARGS__)
@@ -161,6 +172,10 @@ static frame_data prev_cap_frame;
 static gboolean perform_two_pass_analysis;
 static guint32 epan_auto_reset_count = 0;
 static gboolean epan_auto_reset = FALSE;
+static guint conversation_timeout = 0;
+static guint max_conversations = 0;
+static guint num_workers = 0;
+static gboolean dissected_by_workers = FALSE;
 
 /*
  * The way the packet decode is to be written.
@@ -233,6 +248,7 @@ static void report_counts_siginfo(int);
 #endif /* HAVE_LIBPCAP */
 
 static void reset_epan_mem(capture_file *cf, epan_dissect_t *edt, gboolean tree, gboolean visual);
+static void print_conversation_aging_stats(void);
 
 typedef enum {
   PROCESS_FILE_SUCCEEDED,
@@ -345,6 +361,7 @@ print_usage(FILE *output)
 #endif
   fprintf(output, "  -y <link type>           link layer type (def: first appropriate)\n");
   fprintf(output, "  --time-stamp-type <type> timestamp method for interface\n");
+  fprintf(output, "  --live-ring-size <KB>    have dumpcap hand packets over in shared memory\n");
   fprintf(output, "  -D                       print list of interfaces and exit\n");
   fprintf(output, "  -L                       print list of link-layer types of iface and exit\n");
   fprintf(output, "  --list-time-stamp-types  print list of timestamp types for iface and exit\n");
@@ -373,6 +390,16 @@ print_usage(FILE *output)
   fprintf(output, "Processing:\n");
   fprintf(output, "  -2                       perform a two-pass analysis\n");
   fprintf(output, "  -M <packet count>        perform session auto reset\n");
+  fprintf(output, "  --conversation-timeout <seconds>\n");
+  fprintf(output, "                           free conversations and reassembly state idle for\n");
+  fprintf(output, "                           this long (single-pass only)\n");
+  fprintf(output, "  --max-conversations <count>\n");
+  fprintf(output, "                           keep at most this many conversations, freeing the\n");
+  fprintf(output, "                           least recently seen ones (single-pass only)\n");
+#ifndef _WIN32
+  fprintf(output, "  --workers <count>        dissect a file in this many processes, each handling\n");
+  fprintf(output, "                           a share of the flows\n");
+#endif
   fprintf(output, "  -R <read filter>         packet Read filter in Wireshark display filter syntax\n");
   fprintf(output, "                           (requires -2)\n");
   fprintf(output, "  -Y <display filter>      packet displaY filter in Wireshark display filter\n");
@@ -694,6 +721,9 @@ main(int argc, char *argv[])
     {"color", no_argument, NULL, LONGOPT_COLOR},
     {"no-duplicate-keys", no_argument, NULL, LONGOPT_NO_DUPLICATE_KEYS},
     {"elastic-mapping-filter", required_argument, NULL, LONGOPT_ELASTIC_MAPPING_FILTER},
+    {"conversation-timeout", required_argument, NULL, LONGOPT_CONVERSATION_TIMEOUT},
+    {"max-conversations", required_argument, NULL, LONGOPT_MAX_CONVERSATIONS},
+    {"workers", required_argument, NULL, LONGOPT_WORKERS},
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -712,6 +742,7 @@ main(int argc, char *argv[])
   volatile int         max_packet_count = 0;
 #endif
   gboolean             quiet = FALSE;
+  gboolean             taps_requested = FALSE;
 #ifdef PCAP_NG_DEFAULT
   volatile int         out_file_type = WTAP_FILE_TYPE_SUBTYPE_PCAPNG;
 #else
@@ -1071,6 +1102,7 @@ main(int argc, char *argv[])
     case 'g':        /* enable group read access on file(s) */
     case 'i':        /* Use interface x */
     case LONGOPT_SET_TSTAMP_TYPE: /* Set capture timestamp type */
+    case LONGOPT_LIVE_RING_SIZE: /* Hand packets over in shared memory */
     case 'p':        /* Don't capture in promiscuous mode */
 #ifdef HAVE_PCAP_REMOTE
     case 'A':        /* Authentication */
@@ -1412,6 +1444,7 @@ main(int argc, char *argv[])
         exit_status = INVALID_OPTION;
         goto clean_exit;
       }
+      taps_requested = TRUE;
       break;
     case 'd':        /* Decode as rule */
     case 'K':        /* Kerberos keytab file */
@@ -1439,6 +1472,7 @@ main(int argc, char *argv[])
         exit_status = INVALID_OPTION;
         goto clean_exit;
       }
+      taps_requested = TRUE;
       break;
     case LONGOPT_COLOR: /* print in color where appropriate */
       dissect_color = TRUE;
@@ -1447,6 +1481,21 @@ main(int argc, char *argv[])
       no_duplicate_keys = TRUE;
       node_children_grouper = proto_node_group_children_by_json_key;
       break;
+    case LONGOPT_CONVERSATION_TIMEOUT:
+      conversation_timeout = get_positive_int(optarg, "conversation timeout");
+      break;
+    case LONGOPT_MAX_CONVERSATIONS:
+      max_conversations = get_positive_int(optarg, "maximum conversation count");
+      break;
+    case LONGOPT_WORKERS:
+#ifdef _WIN32
+      cmdarg_err("--workers is not supported on this platform.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+#else
+      num_workers = get_positive_int(optarg, "worker count");
+      break;
+#endif
     default:
     case '?':        /* Bad flag - print usage message */
       switch(optopt) {
@@ -1604,6 +1653,39 @@ main(int argc, char *argv[])
     goto clean_exit;
   }
 
+  if (conversation_timeout != 0 || max_conversations != 0) {
+    if (perform_two_pass_analysis) {
+      cmdarg_err("--conversation-timeout and --max-conversations do not support two pass analysis.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    conversation_set_aging(conversation_timeout, max_conversations);
+  }
+
+  if (num_workers > 1) {
+    /*
+     * Workers only see the packets of their own flows, so anything
+     * that needs to see all packets, or writes all of them, has to be
+     * done in a single process.
+     */
+    if (cf_name == NULL) {
+      cmdarg_err("--workers can only be used when reading a capture file.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (perform_two_pass_analysis || epan_auto_reset || output_file_name != NULL ||
+        taps_requested || pdu_export_arg != NULL) {
+      cmdarg_err("--workers can't be used with -2, -M, -w, -U, -z or --export-objects.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (output_action == WRITE_JSON || output_action == WRITE_JSON_RAW) {
+      cmdarg_err("--workers doesn't support \"-T json\" and \"-T jsonraw\".");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+  }
+
 #ifdef HAVE_LIBPCAP
   if (caps_queries) {
     /* We're supposed to list the link-layer/timestamp types for an interface;
@@ -2247,6 +2329,10 @@ main(int argc, char *argv[])
 
   if (draw_taps)
     draw_tap_listeners(TRUE);
+
+  /* With workers, each of them reported its own. */
+  if (!dissected_by_workers)
+    print_conversation_aging_stats();
   /* Memory cleanup */
   reset_tap_listeners();
   funnel_dump_all_text_windows();
@@ -2660,6 +2746,10 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
       capture_opts->save_file = NULL;
       return FALSE;
     }
+
+    /* Take the packets from shared memory rather than the file, if we can. */
+    if (cap_session->live_ring != NULL)
+      wtap_set_live_ring(cf->provider.wth, cap_session->live_ring, cap_session->live_ring_seq);
   }
 
   cap_session->state = CAPTURE_RUNNING;
@@ -3320,6 +3410,663 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
   return status;
 }
 
+/*
+ * Create the epan_dissect_t for single-pass dissection, if we're
+ * dissecting at all.
+ */
+static epan_dissect_t *
+single_pass_edt_new(capture_file *cf, guint tap_flags, gboolean *create_proto_tree)
+{
+  gboolean        filtering_tap_listeners;
+
+  *create_proto_tree = FALSE;
+  if (!do_dissection)
+    return NULL;
+
+  /* Do we have any tap listeners with filters? */
+  filtering_tap_listeners = have_filtering_tap_listeners();
+
+  /*
+   * Determine whether we need to create a protocol tree.
+   * We do if:
+   *
+   *    we're going to apply a read filter;
+   *
+   *    we're going to apply a display filter;
+   *
+   *    we're going to print the protocol tree;
+   *
+   *    one of the tap listeners is going to apply a filter;
+   *
+   *    one of the tap listeners requires a protocol tree;
+   *
+   *    a postdissector wants field values or protocols
+   *    on the first pass;
+   *
+   *    we have custom columns (which require field values, which
+   *    currently requires that we build a protocol tree).
+   */
+  *create_proto_tree =
+    (cf->rfcode || cf->dfcode || print_details || filtering_tap_listeners ||
+      (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids() ||
+      have_custom_cols(&cf->cinfo) || dissect_color);
+
+  tshark_debug("tshark: create_proto_tree = %s", *create_proto_tree ? "TRUE" : "FALSE");
+
+  /* The protocol tree will be "visible", i.e., printed, only if we're
+     printing packet details, which is true if we're printing stuff
+     ("print_packet_info" is true) and we're in verbose mode
+     ("packet_details" is true). */
+  return epan_dissect_new(cf->epan, *create_proto_tree, print_packet_info && print_details);
+}
+
+#ifndef _WIN32
+/*
+ * Flow-sharded dissection (--workers).
+ *
+ * This process reads the file and hands every packet to one of several
+ * worker processes, chosen by a hash of the packet's addresses and
+ * ports, so that all packets of a flow are dissected by the same worker.
+ * Each worker has its own epan session and memory scopes, and sends back
+ * the output for every packet it dissected; this process writes that
+ * output in frame order.
+ *
+ * Workers are processes rather than threads as epan keeps its state
+ * (conversations, reassembly tables, wmem scopes) in globals.
+ */
+
+/* Packets handed out but not yet written */
+#define SHARD_MAX_IN_FLIGHT 4096
+/* Bytes queued for a worker before we stop reading */
+#define SHARD_SEND_HIGH_WATER (4 * 1024 * 1024)
+
+/* Sent to a worker for every packet, followed by the comment, the
+   file-type-specific options and the packet data. */
+typedef struct {
+  guint32   framenum;
+  guint32   cum_bytes;      /* bytes in the frames before this one */
+  gint64    offset;
+  nstime_t  prev_ts;        /* time stamp of the previous frame */
+  wtap_rec  rec;            /* without its pointers */
+  guint32   comment_len;
+  guint32   options_len;
+  guint32   data_len;
+} shard_packet_hdr_t;
+
+/* Sent back for every packet, followed by its output */
+typedef struct {
+  guint32   framenum;
+  guint32   len;
+} shard_output_hdr_t;
+
+typedef struct {
+  guint32   framenum;
+  guint32   len;
+  guint8    data[];
+} shard_output_t;
+
+typedef struct {
+  pid_t       pid;
+  int         to_fd;        /* packets to the worker */
+  int         from_fd;      /* output from the worker */
+  GByteArray *send_buf;
+  gsize       send_off;
+  GByteArray *recv_buf;
+  GQueue      outputs;      /* shard_output_t, in frame order */
+} shard_worker_t;
+
+static gboolean
+shard_encap_supported(int encap)
+{
+  switch (encap) {
+
+  case WTAP_ENCAP_ETHERNET:
+  case WTAP_ENCAP_SLL:
+  case WTAP_ENCAP_RAW_IP:
+  case WTAP_ENCAP_RAW_IP4:
+  case WTAP_ENCAP_RAW_IP6:
+    return TRUE;
+
+  default:
+    return FALSE;
+  }
+}
+
+/*
+ * FNV-1a over both endpoints, lowest first, so that both directions of
+ * a flow hash to the same value.
+ */
+static guint32
+shard_hash_endpoints(const guint8 *addr_a, const guint8 *addr_b, guint addr_len,
+                     guint16 port_a, guint16 port_b, guint8 proto)
+{
+  const guint8 *tmp_addr;
+  guint16       tmp_port;
+  guint8        ports[4];
+  guint32       hash = 2166136261U;
+  int           cmp;
+  guint         i;
+
+  cmp = memcmp(addr_a, addr_b, addr_len);
+  if (cmp > 0 || (cmp == 0 && port_a > port_b)) {
+    tmp_addr = addr_a; addr_a = addr_b; addr_b = tmp_addr;
+    tmp_port = port_a; port_a = port_b; port_b = tmp_port;
+  }
+  phton16(ports, port_a);
+  phton16(ports + 2, port_b);
+
+  for (i = 0; i < addr_len; i++)
+    hash = (hash ^ addr_a[i]) * 16777619U;
+  for (i = 0; i < addr_len; i++)
+    hash = (hash ^ addr_b[i]) * 16777619U;
+  for (i = 0; i < sizeof ports; i++)
+    hash = (hash ^ ports[i]) * 16777619U;
+  hash = (hash ^ proto) * 16777619U;
+
+  return hash;
+}
+
+/*
+ * Hash the flow a packet belongs to. Ports are only used for TCP, UDP
+ * and SCTP packets that aren't IP fragments, so that all fragments of a
+ * datagram go to the same worker; anything that isn't IP hashes to 0.
+ */
+static guint32
+shard_flow_hash(const wtap_rec *rec, const guint8 *pd)
+{
+  guint32  caplen, hdr_len;
+  guint16  type;
+  guint16  port_a = 0, port_b = 0;
+  guint8   proto;
+
+  if (rec->rec_type != REC_TYPE_PACKET)
+    return 0;
+  caplen = rec->rec_header.packet_header.caplen;
+
+  switch (rec->rec_header.packet_header.pkt_encap) {
+
+  case WTAP_ENCAP_ETHERNET:
+    if (caplen < 14)
+      return 0;
+    type = pntoh16(pd + 12);
+    hdr_len = 14;
+    while ((type == ETHERTYPE_VLAN || type == ETHERTYPE_IEEE_802_1AD) &&
+           caplen >= hdr_len + 4) {
+      type = pntoh16(pd + hdr_len + 2);
+      hdr_len += 4;
+    }
+    break;
+
+  case WTAP_ENCAP_SLL:
+    if (caplen < 16)
+      return 0;
+    type = pntoh16(pd + 14);
+    hdr_len = 16;
+    break;
+
+  case WTAP_ENCAP_RAW_IP:
+  case WTAP_ENCAP_RAW_IP4:
+  case WTAP_ENCAP_RAW_IP6:
+    if (caplen < 1)
+      return 0;
+    type = (pd[0] >> 4) == 6 ? ETHERTYPE_IPv6 : ETHERTYPE_IP;
+    hdr_len = 0;
+    break;
+
+  default:
+    return 0;
+  }
+  pd += hdr_len;
+  caplen -= hdr_len;
+
+  switch (type) {
+
+  case ETHERTYPE_IP:
+    if (caplen < 20)
+      return 0;
+    hdr_len = (pd[0] & 0x0f) * 4;
+    proto = pd[9];
+    if ((pntoh16(pd + 6) & 0x3fff) == 0 &&
+        (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP || proto == IP_PROTO_SCTP) &&
+        caplen >= hdr_len + 4) {
+      port_a = pntoh16(pd + hdr_len);
+      port_b = pntoh16(pd + hdr_len + 2);
+    }
+    return shard_hash_endpoints(pd + 12, pd + 16, 4, port_a, port_b, proto);
+
+  case ETHERTYPE_IPv6:
+    if (caplen < 40)
+      return 0;
+    proto = pd[6];
+    if ((proto == IP_PROTO_TCP || proto == IP_PROTO_UDP || proto == IP_PROTO_SCTP) &&
+        caplen >= 44) {
+      port_a = pntoh16(pd + 40);
+      port_b = pntoh16(pd + 42);
+    }
+    return shard_hash_endpoints(pd + 8, pd + 24, 16, port_a, port_b, proto);
+
+  default:
+    return 0;
+  }
+}
+
+static gboolean
+shard_read_full(int fd, void *data, size_t len)
+{
+  guint8 *p = (guint8 *)data;
+  ssize_t n;
+
+  while (len > 0) {
+    n = read(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static gboolean
+shard_write_full(int fd, const void *data, size_t len)
+{
+  const guint8 *p = (const guint8 *)data;
+  ssize_t n;
+
+  while (len > 0) {
+    n = write(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return FALSE;
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+/*
+ * Body of a worker process: dissect the packets we're handed and send
+ * back the output for each of them.
+ *
+ * The standard output is redirected to a temporary file, which is
+ * rewound for every packet, so that print_packet() and friends can
+ * write to it as usual.
+ */
+static void G_GNUC_NORETURN
+shard_worker_run(capture_file *cf, int in_fd, int out_fd, guint tap_flags,
+                 const wtap_rec *first_rec)
+{
+  shard_packet_hdr_t hdr;
+  shard_output_hdr_t out_hdr;
+  wtap_rec        rec;
+  Buffer          buf;
+  GByteArray     *out_data;
+  epan_dissect_t *edt;
+  gboolean        create_proto_tree;
+  FILE           *out_file;
+  long            out_len;
+
+  out_file = tmpfile();
+  if (out_file == NULL || dup2(fileno(out_file), 1) < 0) {
+    cmdarg_err("Can't create the output file for a worker: %s", g_strerror(errno));
+    _exit(2);
+  }
+
+  /* All workers use the first frame as the time reference. */
+  frame_data_init(&ref_frame, 1, first_rec, 0, 0);
+  cf->provider.ref = &ref_frame;
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+  out_data = g_byte_array_new();
+
+  edt = single_pass_edt_new(cf, tap_flags, &create_proto_tree);
+
+  while (shard_read_full(in_fd, &hdr, sizeof hdr)) {
+    rec.rec_type = hdr.rec.rec_type;
+    rec.presence_flags = hdr.rec.presence_flags;
+    rec.ts = hdr.rec.ts;
+    rec.tsprec = hdr.rec.tsprec;
+    rec.rec_header = hdr.rec.rec_header;
+
+    g_free(rec.opt_comment);
+    rec.opt_comment = NULL;
+    if (hdr.comment_len != 0) {
+      rec.opt_comment = (gchar *)g_malloc(hdr.comment_len + 1);
+      if (!shard_read_full(in_fd, rec.opt_comment, hdr.comment_len))
+        break;
+      rec.opt_comment[hdr.comment_len] = '\0';
+    }
+    ws_buffer_clean(&rec.options_buf);
+    ws_buffer_assure_space(&rec.options_buf, hdr.options_len);
+    if (!shard_read_full(in_fd, ws_buffer_start_ptr(&rec.options_buf), hdr.options_len))
+      break;
+    ws_buffer_increase_length(&rec.options_buf, hdr.options_len);
+    ws_buffer_clean(&buf);
+    ws_buffer_assure_space(&buf, hdr.data_len);
+    if (!shard_read_full(in_fd, ws_buffer_start_ptr(&buf), hdr.data_len))
+      break;
+    ws_buffer_increase_length(&buf, hdr.data_len);
+
+    /* Make this look like the frames before it were dissected here. */
+    cf->count = hdr.framenum - 1;
+    cum_bytes = hdr.cum_bytes;
+    if (hdr.framenum > 1) {
+      prev_cap_frame.num = hdr.framenum - 1;
+      prev_cap_frame.abs_ts = hdr.prev_ts;
+      cf->provider.prev_cap = &prev_cap_frame;
+      if (cf->dfcode == NULL) {
+        /* Every frame is displayed. */
+        prev_dis_frame = prev_cap_frame;
+        cf->provider.prev_dis = &prev_dis_frame;
+      }
+    }
+
+    rewind(stdout);
+    process_packet_single_pass(cf, edt, hdr.offset, &rec, &buf, tap_flags);
+    fflush(stdout);
+    out_len = ftell(stdout);
+    if (out_len < 0) {
+      show_print_file_io_error(errno);
+      _exit(2);
+    }
+
+    g_byte_array_set_size(out_data, (guint)out_len);
+    if (out_len > 0 && pread(1, out_data->data, out_len, 0) != out_len) {
+      show_print_file_io_error(errno);
+      _exit(2);
+    }
+    out_hdr.framenum = hdr.framenum;
+    out_hdr.len = (guint32)out_len;
+    if (!shard_write_full(out_fd, &out_hdr, sizeof out_hdr) ||
+        !shard_write_full(out_fd, out_data->data, out_len))
+      _exit(2);
+  }
+
+  if (edt)
+    epan_dissect_free(edt);
+  print_conversation_aging_stats();
+  _exit(0);
+}
+
+static void
+shard_queue_packet(shard_worker_t *worker, guint32 framenum, guint32 prev_cum_bytes,
+                   const nstime_t *prev_ts, gint64 offset, const wtap_rec *rec,
+                   Buffer *buf)
+{
+  shard_packet_hdr_t hdr;
+
+  memset(&hdr, 0, sizeof hdr);
+  hdr.framenum = framenum;
+  hdr.cum_bytes = prev_cum_bytes;
+  hdr.offset = offset;
+  hdr.prev_ts = *prev_ts;
+  hdr.rec.rec_type = rec->rec_type;
+  hdr.rec.presence_flags = rec->presence_flags;
+  hdr.rec.ts = rec->ts;
+  hdr.rec.tsprec = rec->tsprec;
+  hdr.rec.rec_header = rec->rec_header;
+  hdr.comment_len = rec->opt_comment ? (guint32)strlen(rec->opt_comment) : 0;
+  hdr.options_len = (guint32)ws_buffer_length(&rec->options_buf);
+  hdr.data_len = (guint32)ws_buffer_length(buf);
+
+  g_byte_array_append(worker->send_buf, (const guint8 *)&hdr, sizeof hdr);
+  if (hdr.comment_len != 0)
+    g_byte_array_append(worker->send_buf, (const guint8 *)rec->opt_comment, hdr.comment_len);
+  g_byte_array_append(worker->send_buf, ws_buffer_start_ptr(&rec->options_buf), hdr.options_len);
+  g_byte_array_append(worker->send_buf, ws_buffer_start_ptr(buf), hdr.data_len);
+}
+
+/*
+ * Split what we received from a worker into outputs.
+ */
+static void
+shard_collect_outputs(shard_worker_t *worker)
+{
+  shard_output_hdr_t hdr;
+  shard_output_t    *output;
+  gsize              off = 0;
+
+  while (worker->recv_buf->len - off >= sizeof hdr) {
+    memcpy(&hdr, worker->recv_buf->data + off, sizeof hdr);
+    if (worker->recv_buf->len - off - sizeof hdr < hdr.len)
+      break;
+    output = (shard_output_t *)g_malloc(sizeof *output + hdr.len);
+    output->framenum = hdr.framenum;
+    output->len = hdr.len;
+    memcpy(output->data, worker->recv_buf->data + off + sizeof hdr, hdr.len);
+    g_queue_push_tail(&worker->outputs, output);
+    off += sizeof hdr + hdr.len;
+  }
+  g_byte_array_remove_range(worker->recv_buf, 0, (guint)off);
+}
+
+static pass_status_t
+process_cap_file_sharded(capture_file *cf, guint tap_flags,
+                         int max_packet_count, gint64 max_byte_count,
+                         int *err, gchar **err_info)
+{
+  shard_worker_t *workers;
+  struct pollfd  *pfds;
+  wtap_rec        rec;
+  Buffer          buf;
+  frame_data      fdata;
+  gint64          data_offset;
+  guint32         framenum = 0, next_framenum = 1;
+  guint32         shard_cum_bytes = 0;
+  nstime_t        prev_ts = NSTIME_INIT_ZERO;
+  guint          *order;
+  guint           order_head = 0, in_flight = 0;
+  gsize           send_pending = 0;
+  gboolean        reading = TRUE, inputs_closed = FALSE;
+  pass_status_t   status = PASS_SUCCEEDED;
+  guint           i;
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+
+  /*
+   * Read the first packet before starting the workers; it's the
+   * time reference for all of them.
+   */
+  *err = 0;
+  if (!wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+    return *err != 0 ? PASS_READ_ERROR : PASS_SUCCEEDED;
+  }
+
+  /* Don't let the workers inherit buffered output, e.g. the preamble. */
+  fflush(stdout);
+  dissected_by_workers = TRUE;
+
+  workers = g_new0(shard_worker_t, num_workers);
+  pfds = g_new0(struct pollfd, 2 * num_workers);
+  order = g_new(guint, SHARD_MAX_IN_FLIGHT);
+  for (i = 0; i < num_workers; i++) {
+    int to_pipe[2], from_pipe[2];
+
+    if (pipe(to_pipe) < 0 || pipe(from_pipe) < 0) {
+      cmdarg_err("Can't create pipes for the workers: %s", g_strerror(errno));
+      exit(2);
+    }
+    workers[i].pid = fork();
+    if (workers[i].pid < 0) {
+      cmdarg_err("Can't start a worker: %s", g_strerror(errno));
+      exit(2);
+    }
+    if (workers[i].pid == 0) {
+      guint j;
+
+      /* Only keep our own ends of our own pipes. */
+      for (j = 0; j < i; j++) {
+        close(workers[j].to_fd);
+        close(workers[j].from_fd);
+      }
+      close(to_pipe[1]);
+      close(from_pipe[0]);
+      shard_worker_run(cf, to_pipe[0], from_pipe[1], tap_flags, &rec);
+    }
+    close(to_pipe[0]);
+    close(from_pipe[1]);
+    workers[i].to_fd = to_pipe[1];
+    workers[i].from_fd = from_pipe[0];
+    fcntl(workers[i].to_fd, F_SETFL, O_NONBLOCK);
+    fcntl(workers[i].from_fd, F_SETFL, O_NONBLOCK);
+    workers[i].send_buf = g_byte_array_new();
+    workers[i].recv_buf = g_byte_array_new();
+    g_queue_init(&workers[i].outputs);
+  }
+
+  for (;;) {
+    /* Hand out packets until enough of them are outstanding. */
+    while (reading && in_flight < SHARD_MAX_IN_FLIGHT &&
+           send_pending < SHARD_SEND_HIGH_WATER) {
+      guint w;
+
+      framenum++;
+      w = shard_flow_hash(&rec, ws_buffer_start_ptr(&buf)) % num_workers;
+      shard_queue_packet(&workers[w], framenum, shard_cum_bytes, &prev_ts,
+                         data_offset, &rec, &buf);
+      order[(order_head + in_flight) % SHARD_MAX_IN_FLIGHT] = w;
+      in_flight++;
+
+      frame_data_init(&fdata, framenum, &rec, data_offset, shard_cum_bytes);
+      shard_cum_bytes = fdata.cum_bytes;
+      frame_data_destroy(&fdata);
+      prev_ts = rec.ts;
+
+      send_pending = 0;
+      for (i = 0; i < num_workers; i++)
+        send_pending += workers[i].send_buf->len - workers[i].send_off;
+
+      /* Stop reading if we have the maximum number of packets. */
+      if ((--max_packet_count == 0) || (max_byte_count != 0 && data_offset >= max_byte_count)) {
+        reading = FALSE;
+      } else if (!wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
+        if (*err != 0)
+          status = PASS_READ_ERROR;
+        reading = FALSE;
+      } else if (read_interrupted) {
+        status = PASS_INTERRUPTED;
+        reading = FALSE;
+      }
+    }
+
+    /* Once everything has been handed out, let the workers finish. */
+    if (!reading && !inputs_closed && send_pending == 0) {
+      for (i = 0; i < num_workers; i++)
+        close(workers[i].to_fd);
+      inputs_closed = TRUE;
+    }
+    if (!reading && in_flight == 0)
+      break;
+
+    for (i = 0; i < num_workers; i++) {
+      pfds[2 * i].fd = workers[i].send_off < workers[i].send_buf->len ? workers[i].to_fd : -1;
+      pfds[2 * i].events = POLLOUT;
+      pfds[2 * i + 1].fd = workers[i].from_fd;
+      pfds[2 * i + 1].events = POLLIN;
+    }
+    if (poll(pfds, 2 * num_workers, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      cmdarg_err("Can't wait for the workers: %s", g_strerror(errno));
+      exit(2);
+    }
+
+    for (i = 0; i < num_workers; i++) {
+      shard_worker_t *worker = &workers[i];
+      ssize_t n;
+
+      if (pfds[2 * i].fd >= 0 && (pfds[2 * i].revents & (POLLOUT | POLLERR | POLLHUP))) {
+        n = write(worker->to_fd, worker->send_buf->data + worker->send_off,
+                  worker->send_buf->len - worker->send_off);
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+          cmdarg_err("A worker exited unexpectedly.");
+          exit(2);
+        }
+        if (n > 0) {
+          worker->send_off += n;
+          send_pending -= n;
+          if (worker->send_off == worker->send_buf->len) {
+            g_byte_array_set_size(worker->send_buf, 0);
+            worker->send_off = 0;
+          }
+        }
+      }
+
+      if (pfds[2 * i + 1].revents & (POLLIN | POLLERR | POLLHUP)) {
+        guint8 chunk[65536];
+
+        n = read(worker->from_fd, chunk, sizeof chunk);
+        if (n == 0) {
+          /* The worker is done; it had better not owe us anything. */
+          guint j, owed = 0;
+
+          for (j = 0; j < in_flight; j++) {
+            if (order[(order_head + j) % SHARD_MAX_IN_FLIGHT] == i)
+              owed++;
+          }
+          if (owed != g_queue_get_length(&worker->outputs)) {
+            cmdarg_err("A worker exited unexpectedly.");
+            exit(2);
+          }
+          close(worker->from_fd);
+          worker->from_fd = -1;
+        } else if (n > 0) {
+          g_byte_array_append(worker->recv_buf, chunk, (guint)n);
+          shard_collect_outputs(worker);
+        }
+      }
+    }
+
+    /* Write out whatever is next in frame order. */
+    while (in_flight != 0) {
+      shard_worker_t *worker = &workers[order[order_head]];
+      shard_output_t *output = (shard_output_t *)g_queue_peek_head(&worker->outputs);
+
+      if (output == NULL)
+        break;
+      g_assert(output->framenum == next_framenum);
+      g_queue_pop_head(&worker->outputs);
+      if (output->len != 0)
+        fwrite(output->data, 1, output->len, stdout);
+      g_free(output);
+      next_framenum++;
+      order_head = (order_head + 1) % SHARD_MAX_IN_FLIGHT;
+      in_flight--;
+    }
+    if (line_buffered)
+      fflush(stdout);
+    if (ferror(stdout)) {
+      show_print_file_io_error(errno);
+      exit(2);
+    }
+  }
+
+  for (i = 0; i < num_workers; i++) {
+    if (workers[i].from_fd >= 0)
+      close(workers[i].from_fd);
+    waitpid(workers[i].pid, NULL, 0);
+    g_byte_array_free(workers[i].send_buf, TRUE);
+    g_byte_array_free(workers[i].recv_buf, TRUE);
+  }
+  g_free(workers);
+  g_free(pfds);
+  g_free(order);
+
+  cf->count = framenum;
+
+  ws_buffer_free(&buf);
+  wtap_rec_cleanup(&rec);
+
+  return status;
+}
+#endif /* _WIN32 */
+
 static pass_status_t
 process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
                              int max_packet_count, gint64 max_byte_count,
@@ -3329,59 +4076,15 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
   wtap_rec        rec;
   Buffer          buf;
   gboolean create_proto_tree = FALSE;
-  gboolean        filtering_tap_listeners;
   guint           tap_flags;
   guint32         framenum;
   epan_dissect_t *edt = NULL;
   gint64          data_offset;
   pass_status_t   status = PASS_SUCCEEDED;
 
-  wtap_rec_init(&rec);
-  ws_buffer_init(&buf, 1514);
-
-  framenum = 0;
-
-  /* Do we have any tap listeners with filters? */
-  filtering_tap_listeners = have_filtering_tap_listeners();
-
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
-  if (do_dissection) {
-    /*
-     * Determine whether we need to create a protocol tree.
-     * We do if:
-     *
-     *    we're going to apply a read filter;
-     *
-     *    we're going to apply a display filter;
-     *
-     *    we're going to print the protocol tree;
-     *
-     *    one of the tap listeners is going to apply a filter;
-     *
-     *    one of the tap listeners requires a protocol tree;
-     *
-     *    a postdissector wants field values or protocols
-     *    on the first pass;
-     *
-     *    we have custom columns (which require field values, which
-     *    currently requires that we build a protocol tree).
-     */
-    create_proto_tree =
-      (cf->rfcode || cf->dfcode || print_details || filtering_tap_listeners ||
-        (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids() ||
-        have_custom_cols(&cf->cinfo) || dissect_color);
-
-    tshark_debug("tshark: create_proto_tree = %s", create_proto_tree ? "TRUE" : "FALSE");
-
-    /* The protocol tree will be "visible", i.e., printed, only if we're
-       printing packet details, which is true if we're printing stuff
-       ("print_packet_info" is true) and we're in verbose mode
-       ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
-  }
-
   /*
    * Force synchronous resolution of IP addresses; we're doing only
    * one pass, so we can't do it in the background and fix up past
@@ -3389,6 +4092,21 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
    */
   set_resolution_synchrony(TRUE);
 
+#ifndef _WIN32
+  if (num_workers > 1 && shard_encap_supported(wtap_file_encap(cf->provider.wth))) {
+    tshark_debug("tshark: dissecting with %u workers", num_workers);
+    return process_cap_file_sharded(cf, tap_flags, max_packet_count,
+                                    max_byte_count, err, err_info);
+  }
+#endif
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+
+  framenum = 0;
+
+  edt = single_pass_edt_new(cf, tap_flags, &create_proto_tree);
+
   *err = 0;
   while (wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
     if (read_interrupted) {
@@ -4362,6 +5080,21 @@ write_failure_message(const char *filename, int err)
              filename, g_strerror(err));
 }
 
+static void
+print_conversation_aging_stats(void)
+{
+  conversation_aging_stats_t aging_stats;
+
+  if (!conversation_aging_enabled())
+    return;
+
+  conversation_get_aging_stats(&aging_stats);
+  fprintf(stderr, "Conversations evicted: %" G_GUINT64_FORMAT " idle, %" G_GUINT64_FORMAT " over limit"
+          " (peak %u), %" G_GUINT64_FORMAT " retained; stale reassemblies dropped: %" G_GUINT64_FORMAT "\n",
+          aging_stats.evicted_idle, aging_stats.evicted_limit, aging_stats.peak,
+          aging_stats.retained, aging_stats.pruned_fragments);
+}
+
 static void reset_epan_mem(capture_file *cf,epan_dissect_t *edt, gboolean tree, gboolean visual)
 {
   if (!epan_auto_reset || (cf->count < epan_auto_reset_count))
@@ -447,6 +447,11 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
                 capture_opts->save_file = NULL;
                 return FALSE;
         }
+
+        /* Take the packets from shared memory rather than the file, if we can. */
+        if (cap_session->live_ring != NULL)
+            wtap_set_live_ring(((capture_file *) cap_session->cf)->provider.wth,
+                               cap_session->live_ring, cap_session->live_ring_seq);
     } else {
         capture_callback_invoke(capture_cb_capture_prepared, cap_session);
     }
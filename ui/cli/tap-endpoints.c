@@ -18,6 +18,7 @@
 #include <epan/tap.h>
 #include <epan/stat_tap_ui.h>
 #include <epan/conversation_table.h>
+#include <epan/addr_resolv.h>
 #include <ui/cmdarg_err.h>
 #include <ui/cli/tshark-tap.h>
 
@@ -27,6 +28,17 @@ typedef struct _endpoints_t {
 	conv_hash_t hash;
 } endpoints_t;
 
+/* The endpoints of a subnet, summed up */
+typedef struct _subnet_endpoint_t {
+	gchar *label;
+	guint64 rx_frames;
+	guint64 tx_frames;
+	guint64 rx_bytes;
+	guint64 tx_bytes;
+} subnet_endpoint_t;
+
+void register_tap_listener_endpoints_subnet(void);
+
 static void
 endpoints_draw(void *arg)
 {
@@ -99,7 +111,96 @@ endpoints_draw(void *arg)
 	printf("================================================================================\n");
 }
 
-void init_hostlists(struct register_ct *ct, const char *filter)
+static void
+subnet_endpoint_free(gpointer data)
+{
+	subnet_endpoint_t *subnet = (subnet_endpoint_t *)data;
+
+	g_free(subnet->label);
+	g_free(subnet);
+}
+
+static gint
+subnet_endpoint_compare_frames(gconstpointer a, gconstpointer b)
+{
+	const subnet_endpoint_t *subnet_a = *(const subnet_endpoint_t * const *)a;
+	const subnet_endpoint_t *subnet_b = *(const subnet_endpoint_t * const *)b;
+	guint64 frames_a = subnet_a->rx_frames + subnet_a->tx_frames;
+	guint64 frames_b = subnet_b->rx_frames + subnet_b->tx_frames;
+
+	if (frames_a != frames_b)
+		return frames_a > frames_b ? -1 : 1;
+	return g_strcmp0(subnet_a->label, subnet_b->label);
+}
+
+/* Sums up the endpoints by the subnets of the subnets files they are in;
+   addresses that aren't in any of them are shown on their own. */
+static void
+endpoints_subnet_draw(void *arg)
+{
+	conv_hash_t *hash = (conv_hash_t*)arg;
+	endpoints_t *iu = (endpoints_t *)hash->user_data;
+	hostlist_talker_t *host;
+	subnet_endpoint_t *subnet;
+	GHashTable *subnets_by_label;
+	GPtrArray *subnets;
+	const gchar *subnet_name;
+	gchar *label, *conversation_str;
+	guint i;
+
+	subnets_by_label = g_hash_table_new(g_str_hash, g_str_equal);
+	subnets = g_ptr_array_new_with_free_func(subnet_endpoint_free);
+	for (i=0; (iu->hash.conv_array && i < iu->hash.conv_array->len); i++) {
+		host = &g_array_index(iu->hash.conv_array, hostlist_talker_t, i);
+
+		subnet_name = get_subnet_name(&host->myaddress, NULL);
+		if (subnet_name) {
+			label = g_strdup(subnet_name);
+		} else {
+			conversation_str = get_conversation_address(NULL, &host->myaddress, TRUE);
+			label = g_strdup(conversation_str);
+			wmem_free(NULL, conversation_str);
+		}
+
+		subnet = (subnet_endpoint_t *)g_hash_table_lookup(subnets_by_label, label);
+		if (subnet) {
+			g_free(label);
+		} else {
+			subnet = g_new0(subnet_endpoint_t, 1);
+			subnet->label = label;
+			g_hash_table_insert(subnets_by_label, label, subnet);
+			g_ptr_array_add(subnets, subnet);
+		}
+		subnet->rx_frames += host->rx_frames;
+		subnet->tx_frames += host->tx_frames;
+		subnet->rx_bytes += host->rx_bytes;
+		subnet->tx_bytes += host->tx_bytes;
+	}
+	g_hash_table_destroy(subnets_by_label);
+	g_ptr_array_sort(subnets, subnet_endpoint_compare_frames);
+
+	printf("================================================================================\n");
+	printf("%s Endpoints by Subnet\n", iu->type);
+	printf("Filter:%s\n", iu->filter ? iu->filter : "<No Filter>");
+
+	printf("                       |  Packets  | |  Bytes  | | Tx Packets | | Tx Bytes | | Rx Packets | | Rx Bytes |\n");
+
+	for (i = 0; i < subnets->len; i++) {
+		subnet = (subnet_endpoint_t *)g_ptr_array_index(subnets, i);
+		printf("%-20s      %6" G_GINT64_MODIFIER "u     %9" G_GINT64_MODIFIER
+		       "u     %6" G_GINT64_MODIFIER "u       %9" G_GINT64_MODIFIER "u      %6"
+		       G_GINT64_MODIFIER "u       %9" G_GINT64_MODIFIER "u   \n",
+			subnet->label,
+			subnet->tx_frames+subnet->rx_frames, subnet->tx_bytes+subnet->rx_bytes,
+			subnet->tx_frames, subnet->tx_bytes,
+			subnet->rx_frames, subnet->rx_bytes);
+	}
+	printf("================================================================================\n");
+	g_ptr_array_free(subnets, TRUE);
+}
+
+static void
+endpoints_init(struct register_ct *ct, const char *filter, tap_draw_cb draw)
 {
 	endpoints_t *iu;
 	GString *error_string;
@@ -109,7 +210,7 @@ void init_hostlists(struct register_ct *ct, const char *filter)
 	iu->filter = g_strdup(filter);
 	iu->hash.user_data = iu;
 
-	error_string = register_tap_listener(proto_get_protocol_filter_name(get_conversation_proto_id(ct)), &iu->hash, filter, 0, NULL, get_hostlist_packet_func(ct), endpoints_draw, NULL);
+	error_string = register_tap_listener(proto_get_protocol_filter_name(get_conversation_proto_id(ct)), &iu->hash, filter, 0, NULL, get_hostlist_packet_func(ct), draw, NULL);
 	if (error_string) {
 		g_free(iu);
 		cmdarg_err("Couldn't register endpoint tap: %s",
@@ -120,6 +221,59 @@ void init_hostlists(struct register_ct *ct, const char *filter)
 
 }
 
+void init_hostlists(struct register_ct *ct, const char *filter)
+{
+	endpoints_init(ct, filter, endpoints_draw);
+}
+
+/* -z endpoints,ip,subnet[,filter] and -z endpoints,ipv6,subnet[,filter] */
+static void
+endpoints_subnet_init(const char *opt_arg, void *userdata)
+{
+	const char *proto_filter_name = (const char *)userdata;
+	register_ct_t *ct;
+	gchar *cmd_str;
+	const char *filter = NULL;
+
+	cmd_str = g_strdup_printf("%s,%s,subnet", HOSTLIST_TAP_PREFIX, proto_filter_name);
+	if (opt_arg[strlen(cmd_str)] == ',') {
+		filter = opt_arg + strlen(cmd_str) + 1;
+	}
+	g_free(cmd_str);
+
+	ct = get_conversation_by_proto_id(proto_get_id_by_filter_name(proto_filter_name));
+	if (ct == NULL) {
+		cmdarg_err("Couldn't register endpoint tap: no %s endpoints", proto_filter_name);
+		exit(1);
+	}
+	endpoints_init(ct, filter, endpoints_subnet_draw);
+}
+
+static stat_tap_ui endpoints_ip_subnet_ui = {
+	REGISTER_STAT_GROUP_ENDPOINT_LIST,
+	NULL,
+	HOSTLIST_TAP_PREFIX ",ip,subnet",
+	endpoints_subnet_init,
+	0,
+	NULL
+};
+
+static stat_tap_ui endpoints_ipv6_subnet_ui = {
+	REGISTER_STAT_GROUP_ENDPOINT_LIST,
+	NULL,
+	HOSTLIST_TAP_PREFIX ",ipv6,subnet",
+	endpoints_subnet_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_endpoints_subnet(void)
+{
+	register_stat_tap_ui(&endpoints_ip_subnet_ui, (void *)"ip");
+	register_stat_tap_ui(&endpoints_ipv6_subnet_ui, (void *)"ipv6");
+}
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
@@ -0,0 +1,129 @@
+/* tap-heurstat.c
+ * Statistics of the heuristic dissectors: how often each one was tried
+ * and how often it accepted the packet
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+
+#include <ui/cmdarg_err.h>
+
+void register_tap_listener_heurstat(void);
+
+static tap_packet_status
+heurstat_packet(void *pss _U_, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *psi _U_)
+{
+	/* The counts are kept by dissector_try_heuristic() */
+	return TAP_PACKET_REDRAW;
+}
+
+static void
+heurstat_add_entry(const gchar *table_name _U_, heur_dtbl_entry_t *hdtbl_entry, gpointer user_data)
+{
+	GPtrArray *entries = (GPtrArray *)user_data;
+
+	if (hdtbl_entry->attempts != 0)
+		g_ptr_array_add(entries, hdtbl_entry);
+}
+
+static gint
+heurstat_compare_attempts(gconstpointer a, gconstpointer b)
+{
+	const heur_dtbl_entry_t *hdtbl_entry_a = *(const heur_dtbl_entry_t * const *)a;
+	const heur_dtbl_entry_t *hdtbl_entry_b = *(const heur_dtbl_entry_t * const *)b;
+
+	if (hdtbl_entry_a->attempts != hdtbl_entry_b->attempts)
+		return hdtbl_entry_a->attempts > hdtbl_entry_b->attempts ? -1 : 1;
+	return g_strcmp0(hdtbl_entry_a->short_name, hdtbl_entry_b->short_name);
+}
+
+static void
+heurstat_draw_table(const char *table_name, struct heur_dissector_list *table _U_, gpointer user_data _U_)
+{
+	GPtrArray *entries = g_ptr_array_new();
+	guint i;
+
+	heur_dissector_table_foreach(table_name, heurstat_add_entry, entries);
+	if (entries->len == 0) {
+		g_ptr_array_free(entries, TRUE);
+		return;
+	}
+	g_ptr_array_sort(entries, heurstat_compare_attempts);
+
+	printf("%s:\n", table_name);
+	for (i = 0; i < entries->len; i++) {
+		heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)g_ptr_array_index(entries, i);
+
+		printf("  %-30s %12" G_GINT64_MODIFIER "u %12" G_GINT64_MODIFIER "u %6.2f%%\n",
+		    hdtbl_entry->short_name, hdtbl_entry->attempts, hdtbl_entry->accepts,
+		    100.0 * (double)hdtbl_entry->accepts / (double)hdtbl_entry->attempts);
+	}
+	g_ptr_array_free(entries, TRUE);
+}
+
+static void
+heurstat_draw(void *pss _U_)
+{
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Heuristic Dissector Statistics:\n");
+	printf("  %-30s %12s %12s %7s\n", "Dissector", "Attempts", "Accepts", "Rate");
+	dissector_all_heur_tables_foreach_table(heurstat_draw_table, NULL, (GCompareFunc)g_strcmp0);
+	printf("===================================================================\n");
+}
+
+static void
+heurstat_init(const char *opt_arg _U_, void *userdata _U_)
+{
+	GString *error_string;
+
+	error_string = register_tap_listener("frame", NULL, NULL, 0, NULL, heurstat_packet, heurstat_draw, NULL);
+	if (error_string) {
+		cmdarg_err("Couldn't register heur,stat tap: %s",
+			error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+}
+
+static stat_tap_ui heurstat_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"heur,stat",
+	heurstat_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_heurstat(void)
+{
+	register_stat_tap_ui(&heurstat_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -93,6 +93,7 @@ commandline_print_usage(gboolean for_help_option) {
 #endif
     fprintf(output, "  -y <link type>           link layer type (def: first appropriate)\n");
     fprintf(output, "  --time-stamp-type <type> timestamp method for interface\n");
+    fprintf(output, "  --live-ring-size <KB>    have dumpcap hand packets over in shared memory\n");
     fprintf(output, "  -D                       print list of interfaces and exit\n");
     fprintf(output, "  -L                       print list of link-layer types of iface and exit\n");
     fprintf(output, "  --list-time-stamp-types  print list of timestamp types for iface and exit\n");
@@ -404,6 +405,7 @@ void commandline_other_options(int argc, char *argv[], gboolean opt_reset)
             case 'p':        /* Don't capture in promiscuous mode */
             case 'i':        /* Use interface x */
             case LONGOPT_SET_TSTAMP_TYPE: /* Set capture timestamp type */
+            case LONGOPT_LIVE_RING_SIZE: /* Hand packets over in shared memory */
 #ifdef HAVE_PCAP_CREATE
             case 'I':        /* Capture in monitor mode, if available */
 #endif
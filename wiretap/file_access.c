@@ -2268,7 +2268,7 @@ wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment_types)
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
 					wtap_compression_type compression_type,
 					int *err);
@@ -2293,7 +2293,7 @@ wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_t
 	   "uncompressed", whether we can write a *compressed* file
 	   of that file type. */
 	if (!wtap_dump_open_check(file_type_subtype, params->encap,
-	    (compression_type != WTAP_UNCOMPRESSED), err))
+	    compression_type, err))
 		return NULL;
 
 	/* Allocate a data structure for the output stream. */
@@ -2538,7 +2538,7 @@ wtap_dump_open_stdout(int file_type_subtype, wtap_compression_type compression_t
 }
 
 static gboolean
-wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -2561,8 +2561,10 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 	if (*err != 0)
 		return FALSE;
 
-	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	/* if compression is wanted, do we support this for this file_type_subtype?
+	   We only write gzip; LZ4 compressed files can be read, not written. */
+	if (compression_type != WTAP_UNCOMPRESSED &&
+	    (compression_type != WTAP_GZIP_COMPRESSED || !wtap_dump_can_compress(file_type_subtype))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
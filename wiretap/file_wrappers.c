@@ -21,12 +21,17 @@
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
 
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif /* HAVE_LZ4 */
+
 /*
  * See RFC 1952:
  *
@@ -34,6 +39,15 @@
  *
  * for a description of the gzip file format.
  *
+ * See
+ *
+ *      https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ *
+ * for a description of the LZ4 frame format.  Unlike gzip, a frame
+ * whose blocks are independent can be decompressed starting at any
+ * block, so we keep only the offset of each block for random access,
+ * rather than a 32K window every megabyte.
+ *
  * Some other compressed file formats we might want to support:
  *
  *      XZ format: http://tukaani.org/xz/
@@ -53,6 +67,9 @@ static struct compression_type {
 } compression_types[] = {
 #ifdef HAVE_ZLIB
     { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed" },
+#endif
+#ifdef HAVE_LZ4
+    { WTAP_LZ4_COMPRESSED, "lz4", "LZ4 compressed" },
 #endif
     { WTAP_UNCOMPRESSED, NULL, NULL }
 };
@@ -60,10 +77,7 @@ static struct compression_type {
 wtap_compression_type
 wtap_get_compression_type(wtap *wth)
 {
-	gboolean is_compressed;
-
-	is_compressed = file_iscompressed((wth->fh == NULL) ? wth->random_fh : wth->fh);
-	return is_compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED;
+	return file_get_compression_type((wth->fh == NULL) ? wth->random_fh : wth->fh);
 }
 
 const char *
@@ -111,7 +125,12 @@ typedef enum {
     UNCOMPRESSED,  /* uncompressed - copy input directly */
 #ifdef HAVE_ZLIB
     ZLIB,          /* decompress a zlib stream */
-    GZIP_AFTER_HEADER
+    GZIP_AFTER_HEADER,
+#endif
+#ifdef HAVE_LZ4
+    LZ4 = 4,       /* decompress the blocks of an LZ4 frame; the value is
+                      saved with fast seek points, so it's the same with or
+                      without zlib */
 #endif
 } compression_t;
 
@@ -134,7 +153,7 @@ struct wtap_reader {
     gint64 start;               /* where the gzip data started, for rewinding */
     gint64 raw;                 /* where the raw data started, for seeking */
     compression_t compression;  /* type of compression, if any */
-    gboolean is_compressed;     /* FALSE if completely uncompressed, TRUE otherwise */
+    wtap_compression_type compression_type; /* WTAP_UNCOMPRESSED if completely uncompressed */
 
     /* seek request */
     gint64 skip;                /* amount to skip (already rewound if backwards) */
@@ -148,10 +167,29 @@ struct wtap_reader {
     /* zlib inflate stream */
     z_stream strm;              /* stream structure in-place (not a pointer) */
     gboolean dont_check_crc;    /* TRUE if we aren't supposed to check the CRC */
+#endif
+#ifdef HAVE_LZ4
+    /* LZ4 frame being read */
+    guint8 lz4_flg;             /* FLG byte of the frame descriptor */
+    guint8 lz4_bd;              /* BD byte of the frame descriptor */
+    guint32 lz4_block_max;      /* maximum size of a block's data */
+    guint8 *lz4_in;             /* compressed block; it's decompressed into the output buffer */
+    guint32 lz4_buf_size;       /* size of lz4_in, and of the output buffer if bigger than size * 2 */
+    guint8 *lz4_dict;           /* last 64K of data, if the blocks are linked */
+    guint32 lz4_dict_len;
 #endif
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+
+    /* live capture data handed over in shared memory */
+    ws_shm_ring *live_ring;     /* ring to take data from before reading the file, if any */
+    guint32 live_ring_seq;      /* sequence number of this file in the ring */
+    gboolean fd_pos_stale;      /* TRUE if the fd's position lags raw_pos, as data came from the ring */
+
+    /* while suspended with file_suspend() */
+    guint suspended_size;       /* buffer size to allocate again */
+    gint64 suspended_pos;       /* position to read from again */
 };
 
 /* Current read offset within a buffer. */
@@ -190,6 +228,58 @@ buf_reset(struct wtap_reader_buf *buf)
     buf->avail = 0;
 }
 
+/* Move the file descriptor to raw_pos if data came from the live ring. */
+static int
+fd_sync(FILE_T state)
+{
+    if (state->fd_pos_stale) {
+        if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1)
+            return -1;
+        state->fd_pos_stale = FALSE;
+    }
+    return 0;
+}
+
+/*
+ * Read from the live ring, if there's one and it has the data at
+ * raw_pos, and from the file otherwise. Records for earlier files,
+ * or for data we already have, are dropped; records for later files
+ * are left for whoever reads those files.
+ */
+static ssize_t
+raw_read(FILE_T state, guint8 *buf, size_t len)
+{
+    guint32 seq, rec_len, n;
+    guint64 offset;
+
+    while (state->live_ring != NULL &&
+           ws_shm_ring_peek(state->live_ring, &seq, &offset, &rec_len)) {
+        if (seq > state->live_ring_seq)
+            break;
+        if (seq < state->live_ring_seq ||
+            offset + rec_len <= (guint64)state->raw_pos) {
+            ws_shm_ring_skip(state->live_ring);
+            continue;
+        }
+        if (offset > (guint64)state->raw_pos) {
+            /* The capture child couldn't publish what's before this
+               record; read that from the file. */
+            len = (size_t)MIN((guint64)len, offset - (guint64)state->raw_pos);
+            break;
+        }
+        n = (guint32)MIN((guint64)len, offset + rec_len - (guint64)state->raw_pos);
+        ws_shm_ring_copy(state->live_ring, (guint32)((guint64)state->raw_pos - offset), buf, n);
+        if ((guint64)state->raw_pos + n == offset + rec_len)
+            ws_shm_ring_skip(state->live_ring);
+        state->fd_pos_stale = TRUE;
+        return n;
+    }
+
+    if (fd_sync(state) == -1)
+        return -1;
+    return ws_read(state->fd, buf, len);
+}
+
 static int
 buf_read(FILE_T state, struct wtap_reader_buf *buf)
 {
@@ -197,6 +287,12 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
     unsigned char *read_ptr;
     ssize_t ret;
 
+    /* If everything in the buffer has been consumed, start over at the
+       beginning, so that we read a full buffer rather than whatever is
+       left between the last read and the end of the buffer. */
+    if (buf->avail == 0)
+        buf_reset(buf);
+
     /* How much space is left at the end of the buffer?
        XXX - the output buffer actually has state->size * 2 bytes. */
     space_left = state->size - bytes_in_buffer(buf);
@@ -215,7 +311,7 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
         to_read = space_left;
     }
 
-    ret = ws_read(state->fd, read_ptr, to_read);
+    ret = raw_read(state, read_ptr, to_read);
     if (ret < 0) {
         state->err = errno;
         state->err_info = NULL;
@@ -242,22 +338,30 @@ fill_in_buffer(FILE_T state)
 
 #define ZLIB_WINSIZE 32768
 
+struct zlib_seek_data {
+#ifdef HAVE_INFLATEPRIME
+    int bits;   /* number of bits (1-7) from byte at in - 1, or 0 */
+#endif
+    unsigned char window[ZLIB_WINSIZE]; /* preceding 32K of uncompressed data */
+
+    /* be gentle with Z_STREAM_END, 8 bytes more... Another solution would be to comment checks out */
+    guint32 adler;
+    guint32 total_out;
+};
+
 struct fast_seek_point {
     gint64 out;         /* corresponding offset in uncompressed data */
     gint64 in;          /* offset in input file of first full byte */
 
     compression_t compression;
     union {
+        /* Only ZLIB points carry a window; there can be a lot of the
+           other kinds, e.g. one for every LZ4 block. */
+        struct zlib_seek_data *zlib;
         struct {
-#ifdef HAVE_INFLATEPRIME
-            int bits;   /* number of bits (1-7) from byte at in - 1, or 0 */
-#endif
-            unsigned char window[ZLIB_WINSIZE]; /* preceding 32K of uncompressed data */
-
-            /* be gentle with Z_STREAM_END, 8 bytes more... Another solution would be to comment checks out */
-            guint32 adler;
-            guint32 total_out;
-        } zlib;
+            guint8 flg; /* frame descriptor of the frame the block is in */
+            guint8 bd;
+        } lz4;
     } data;
 };
 
@@ -294,6 +398,16 @@ fast_seek_find(FILE_T file, gint64 pos)
     return smallest;
 }
 
+static void
+fast_seek_point_free(struct fast_seek_point *item)
+{
+#ifdef HAVE_ZLIB
+    if (item->compression == ZLIB)
+        g_free(item->data.zlib);
+#endif
+    g_free(item);
+}
+
 static void
 fast_seek_header(FILE_T file, gint64 in_pos, gint64 out_pos,
                  compression_t compression)
@@ -330,7 +444,7 @@ fast_seek_reset(
 #endif
 }
 
-#ifdef HAVE_ZLIB
+#if defined(HAVE_ZLIB) || defined(HAVE_LZ4)
 
 /* Get next byte from input, or -1 if end or error.
  *
@@ -368,30 +482,6 @@ gz_next1(FILE_T state, guint8 *ret)
     return 0;
 }
 
-/* Get a two-byte little-endian integer and return 0 on success and the value
-   in *ret.  Otherwise -1 is returned, state->err is set, and *ret is not
-   modified. */
-static int
-gz_next2(FILE_T state, guint16 *ret)
-{
-    guint16 val;
-    int ch;
-
-    val = GZ_GETC();
-    ch = GZ_GETC();
-    if (ch == -1) {
-        if (state->err == 0) {
-            /* EOF */
-            state->err = WTAP_ERR_SHORT_READ;
-            state->err_info = NULL;
-        }
-        return -1;
-    }
-    val += (guint16)ch << 8;
-    *ret = val;
-    return 0;
-}
-
 /* Get a four-byte little-endian integer and return 0 on success and the value
    in *ret.  Otherwise -1 is returned, state->err is set, and *ret is not
    modified. */
@@ -437,6 +527,34 @@ gz_skipn(FILE_T state, size_t n)
     return 0;
 }
 
+#endif /* HAVE_ZLIB || HAVE_LZ4 */
+
+#ifdef HAVE_ZLIB
+
+/* Get a two-byte little-endian integer and return 0 on success and the value
+   in *ret.  Otherwise -1 is returned, state->err is set, and *ret is not
+   modified. */
+static int
+gz_next2(FILE_T state, guint16 *ret)
+{
+    guint16 val;
+    int ch;
+
+    val = GZ_GETC();
+    ch = GZ_GETC();
+    if (ch == -1) {
+        if (state->err == 0) {
+            /* EOF */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+        }
+        return -1;
+    }
+    val += (guint16)ch << 8;
+    *ret = val;
+    return 0;
+}
+
 /* Skip a null-terminated string and return 0 on success.  Otherwise -1
    is returned. */
 static int
@@ -479,16 +597,17 @@ zlib_fast_seek_add(FILE_T file, struct zlib_cur_seek_point *point, int bits, gin
         val->in = in_pos;
         val->out = out_pos;
         val->compression = ZLIB;
+        val->data.zlib = g_new(struct zlib_seek_data, 1);
 #ifdef HAVE_INFLATEPRIME
-        val->data.zlib.bits = bits;
+        val->data.zlib->bits = bits;
 #endif
         if (point->pos != 0) {
             unsigned int left = ZLIB_WINSIZE - point->pos;
 
-            memcpy(val->data.zlib.window, point->window + point->pos, left);
-            memcpy(val->data.zlib.window + left, point->window, point->pos);
+            memcpy(val->data.zlib->window, point->window + point->pos, left);
+            memcpy(val->data.zlib->window + left, point->window, point->pos);
         } else
-            memcpy(val->data.zlib.window, point->window, ZLIB_WINSIZE);
+            memcpy(val->data.zlib->window, point->window, ZLIB_WINSIZE);
 
         /*
          * XXX - strm.adler is a uLong in at least some versions
@@ -503,8 +622,8 @@ zlib_fast_seek_add(FILE_T file, struct zlib_cur_seek_point *point, int bits, gin
          *
          * The same applies to strm.total_out.
          */
-        val->data.zlib.adler = (guint32) file->strm.adler;
-        val->data.zlib.total_out = (guint32) file->strm.total_out;
+        val->data.zlib->adler = (guint32) file->strm.adler;
+        val->data.zlib->total_out = (guint32) file->strm.total_out;
         g_ptr_array_add(file->fast_seek, val);
     }
 }
@@ -642,6 +761,309 @@ DIAG_ON(cast-qual)
 }
 #endif
 
+#define LZ4_MAGIC               0x184D2204U
+#define LZ4_SKIPPABLE_MAGIC     0x184D2A50U     /* low 4 bits are anything */
+
+/* FLG byte of an LZ4 frame descriptor */
+#define LZ4_FLG_VERSION_MASK    0xC0
+#define LZ4_FLG_VERSION_1       0x40
+#define LZ4_FLG_BLOCK_INDEP     0x20
+#define LZ4_FLG_BLOCK_CHECKSUM  0x10
+#define LZ4_FLG_CONTENT_SIZE    0x08
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLG_RESERVED        0x02
+#define LZ4_FLG_DICT_ID         0x01
+
+/* BD byte of an LZ4 frame descriptor */
+#define LZ4_BD_BLOCK_MAX_MASK   0x70
+#define LZ4_BD_RESERVED         0x8F
+
+#define LZ4_BLOCK_UNCOMPRESSED  0x80000000U
+
+/* Linked blocks may refer back this far */
+#define LZ4_DICT_SIZE           65536
+
+#ifdef HAVE_LZ4
+/* Set up for reading the blocks of a frame with the given frame descriptor
+   bytes; returns 0 on success, or -1 with state->err set. */
+static int
+lz4_frame_setup(FILE_T state, guint8 flg, guint8 bd)
+{
+    guint32 block_max;
+    guint8 *buf;
+
+    if ((flg & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION_1) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = "unknown LZ4 frame version";
+        return -1;
+    }
+    if ((flg & LZ4_FLG_RESERVED) || (bd & LZ4_BD_RESERVED)) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = "reserved LZ4 frame descriptor bits set";
+        return -1;
+    }
+    if (flg & LZ4_FLG_DICT_ID) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = "preset dictionary needed";
+        return -1;
+    }
+    /* 4 through 7 mean 64K, 256K, 1M and 4M */
+    if (((bd & LZ4_BD_BLOCK_MAX_MASK) >> 4) < 4) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = "bad LZ4 block maximum size";
+        return -1;
+    }
+    block_max = 1U << (8 + 2 * ((bd & LZ4_BD_BLOCK_MAX_MASK) >> 4));
+
+    /* Whole blocks are decompressed into the output buffer, so it
+       might have to grow; there's nothing in it when we get here. */
+    if (block_max > state->lz4_buf_size) {
+        buf = (guint8 *)g_try_realloc(state->lz4_in, block_max);
+        if (buf == NULL) {
+            state->err = ENOMEM;
+            state->err_info = NULL;
+            return -1;
+        }
+        state->lz4_in = buf;
+        if (block_max > state->size << 1) {
+            buf = (guint8 *)g_try_realloc(state->out.buf, block_max);
+            if (buf == NULL) {
+                state->err = ENOMEM;
+                state->err_info = NULL;
+                return -1;
+            }
+            state->out.buf = buf;
+            buf_reset(&state->out);
+        }
+        state->lz4_buf_size = block_max;
+    }
+    if (!(flg & LZ4_FLG_BLOCK_INDEP) && state->lz4_dict == NULL) {
+        state->lz4_dict = (guint8 *)g_try_malloc(LZ4_DICT_SIZE);
+        if (state->lz4_dict == NULL) {
+            state->err = ENOMEM;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+
+    state->lz4_flg = flg;
+    state->lz4_bd = bd;
+    state->lz4_block_max = block_max;
+    state->lz4_dict_len = 0;
+    state->compression = LZ4;
+    return 0;
+}
+
+/* Get len bytes of a block into dst; big blocks mostly bypass the input
+   buffer.  Returns 0 on success, or -1 with state->err set. */
+static int
+lz4_read_bytes(FILE_T state, guint8 *dst, guint32 len)
+{
+    guint32 n;
+    ssize_t ret;
+
+    while (len != 0) {
+        if (state->in.avail != 0) {
+            n = MIN(len, state->in.avail);
+            memcpy(dst, state->in.next, n);
+            state->in.next += n;
+            state->in.avail -= n;
+        } else if (state->err != 0) {
+            return -1;
+        } else if (state->eof) {
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            return -1;
+        } else if (len >= state->size) {
+            ret = raw_read(state, dst, len);
+            if (ret < 0) {
+                state->err = errno;
+                state->err_info = NULL;
+                return -1;
+            }
+            if (ret == 0)
+                state->eof = TRUE;
+            state->raw_pos += ret;
+            n = (guint32)ret;
+        } else {
+            if (fill_in_buffer(state) == -1)
+                return -1;
+            continue;
+        }
+        dst += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void
+lz4_fast_seek_add(FILE_T file, gint64 in_pos, gint64 out_pos)
+{
+    struct fast_seek_point *item = NULL;
+
+    if (file->fast_seek->len != 0)
+        item = (struct fast_seek_point *)file->fast_seek->pdata[file->fast_seek->len - 1];
+
+    /* Only add points past the last one, as fast_seek_header() does;
+       that also skips the blocks we've been through before. */
+    if (!item || item->out < out_pos) {
+        struct fast_seek_point *val = g_new(struct fast_seek_point,1);
+        val->in = in_pos;
+        val->out = out_pos;
+        val->compression = LZ4;
+        val->data.lz4.flg = file->lz4_flg;
+        val->data.lz4.bd = file->lz4_bd;
+        g_ptr_array_add(file->fast_seek, val);
+    }
+}
+
+/* Keep the last 64K of data for decompressing the next linked block. */
+static void
+lz4_dict_update(FILE_T state, const guint8 *data, guint32 len)
+{
+    guint32 keep;
+
+    if (len >= LZ4_DICT_SIZE) {
+        memcpy(state->lz4_dict, data + len - LZ4_DICT_SIZE, LZ4_DICT_SIZE);
+        state->lz4_dict_len = LZ4_DICT_SIZE;
+        return;
+    }
+    keep = MIN(state->lz4_dict_len, LZ4_DICT_SIZE - len);
+    memmove(state->lz4_dict, state->lz4_dict + state->lz4_dict_len - keep, keep);
+    memcpy(state->lz4_dict + keep, data, len);
+    state->lz4_dict_len = keep + len;
+}
+
+/* Decompress the next block of an LZ4 frame into the output buffer.
+   As with zlib_read(), an error is left in state->err for the caller
+   to find once it has used up the data we got. */
+static void
+lz4_read(FILE_T state)
+{
+    gint64 in_pos = state->raw_pos - state->in.avail;
+    guint32 header, len;
+    int ret;
+
+    if (gz_next4(state, &header) == -1)
+        return;
+    if (header == 0) {
+        /* EndMark; the XXH32 content checksum, if any, follows.
+           XXX - check it? */
+        if (state->lz4_flg & LZ4_FLG_CONTENT_CHECKSUM)
+            (void)gz_skipn(state, 4);
+        state->compression = UNKNOWN;   /* ready for the next frame */
+        return;
+    }
+    len = header & ~LZ4_BLOCK_UNCOMPRESSED;
+    if (len > state->lz4_block_max) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = "LZ4 block is bigger than the frame's maximum block size";
+        return;
+    }
+
+    /* Any block of a frame with independent blocks can be decompressed
+       on its own, so every block is a seek point; with linked blocks,
+       only the first one is. */
+    if (state->fast_seek &&
+        ((state->lz4_flg & LZ4_FLG_BLOCK_INDEP) || state->lz4_dict_len == 0))
+        lz4_fast_seek_add(state, in_pos, state->pos);
+
+    if (header & LZ4_BLOCK_UNCOMPRESSED) {
+        if (lz4_read_bytes(state, state->out.buf, len) == -1)
+            return;
+        ret = (int)len;
+    } else {
+        if (lz4_read_bytes(state, state->lz4_in, len) == -1)
+            return;
+        if (state->lz4_dict_len != 0)
+            ret = LZ4_decompress_safe_usingDict((const char *)state->lz4_in,
+                                                (char *)state->out.buf, (int)len,
+                                                (int)state->lz4_block_max,
+                                                (const char *)state->lz4_dict,
+                                                (int)state->lz4_dict_len);
+        else
+            ret = LZ4_decompress_safe((const char *)state->lz4_in,
+                                      (char *)state->out.buf, (int)len,
+                                      (int)state->lz4_block_max);
+        if (ret < 0) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = "corrupt LZ4 block";
+            return;
+        }
+    }
+
+    /* XXX - check the XXH32 block checksum? */
+    if (state->lz4_flg & LZ4_FLG_BLOCK_CHECKSUM)
+        (void)gz_skipn(state, 4);
+
+    if (!(state->lz4_flg & LZ4_FLG_BLOCK_INDEP))
+        lz4_dict_update(state, state->out.buf, (guint32)ret);
+
+    state->out.next = state->out.buf;
+    state->out.avail = (guint)ret;
+}
+#endif /* HAVE_LZ4 */
+
+/* Look for an LZ4 frame at the current input position, skipping any
+   skippable frames.  Returns 1, set up for reading the frame's blocks, if
+   there's one, 0 if there isn't, and -1 on an error. */
+static int
+lz4_head(FILE_T state)
+{
+    guint32 magic;
+
+    for (;;) {
+        /* we need the four bytes of a magic number in the buffer */
+        while (state->in.avail < 4 && !state->eof) {
+            if (state->in.next != state->in.buf) {
+                memmove(state->in.buf, state->in.next, state->in.avail);
+                state->in.next = state->in.buf;
+            }
+            if (fill_in_buffer(state) == -1)
+                return -1;
+        }
+        if (state->in.avail < 4)
+            return 0;
+
+        magic = pletoh32(state->in.next);
+        if (magic != LZ4_MAGIC &&
+            (magic & 0xFFFFFFF0U) != LZ4_SKIPPABLE_MAGIC)
+            return 0;
+
+#ifdef HAVE_LZ4
+        state->in.next += 4;
+        state->in.avail -= 4;
+        if (magic == LZ4_MAGIC) {
+            guint8 flg, bd;
+
+            if (gz_next1(state, &flg) == -1 || gz_next1(state, &bd) == -1)
+                return -1;
+            if (lz4_frame_setup(state, flg, bd) == -1)
+                return -1;
+
+            /* content size; header checksum (XXX - check it?) */
+            if ((flg & LZ4_FLG_CONTENT_SIZE) && gz_skipn(state, 8) == -1)
+                return -1;
+            if (gz_skipn(state, 1) == -1)
+                return -1;
+
+            state->compression_type = WTAP_LZ4_COMPRESSED;
+            return 1;
+        } else {
+            guint32 len;
+
+            /* user data we know nothing about */
+            if (gz_next4(state, &len) == -1 || gz_skipn(state, len) == -1)
+                return -1;
+        }
+#else /* HAVE_LZ4 */
+        state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
+        state->err_info = "reading LZ4-compressed files isn't supported";
+        return -1;
+#endif /* HAVE_LZ4 */
+    }
+}
+
 static int
 gz_head(FILE_T state)
 {
@@ -655,6 +1077,18 @@ gz_head(FILE_T state)
             return 0;
     }
 
+    switch (lz4_head(state)) {
+
+    case -1:
+        return -1;
+
+    case 1:
+        return 0;
+
+    default:
+        break;
+    }
+
     /* look for the gzip magic header bytes 31 and 139 */
     if (state->in.next[0] == 31) {
         state->in.avail--;
@@ -734,7 +1168,7 @@ gz_head(FILE_T state)
             inflateReset(&(state->strm));
             state->strm.adler = crc32(0L, Z_NULL, 0);
             state->compression = ZLIB;
-            state->is_compressed = TRUE;
+            state->compression_type = WTAP_GZIP_COMPRESSED;
 #ifdef Z_BLOCK
             if (state->fast_seek) {
                 struct zlib_cur_seek_point *cur = g_new(struct zlib_cur_seek_point,1);
@@ -797,6 +1231,11 @@ fill_out_buffer(FILE_T state)
     else if (state->compression == ZLIB) {      /* decompress */
         zlib_read(state, state->out.buf, state->size << 1);
     }
+#endif
+#ifdef HAVE_LZ4
+    else if (state->compression == LZ4) {       /* decompress a block */
+        lz4_read(state);
+    }
 #endif
     return 0;
 }
@@ -893,7 +1332,7 @@ file_fdopen(int fd)
     state->fd = fd;
 
     /* we don't yet know whether it's compressed */
-    state->is_compressed = FALSE;
+    state->compression_type = WTAP_UNCOMPRESSED;
 
     /* save the current position for rewinding (only if reading) */
     state->start = ws_lseek64(state->fd, 0, SEEK_CUR);
@@ -1014,6 +1453,134 @@ file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
     stream->fast_seek = seek;
 }
 
+/*
+ * Appends the fast seek points in seek to buf, in host byte order, so
+ * that they can be restored with file_fast_seek_load() when the same
+ * file is opened again.
+ */
+void
+file_fast_seek_save(const GPtrArray *seek, GByteArray *buf)
+{
+    struct fast_seek_point *item;
+    guint32 compression;
+    guint i;
+
+    for (i = 0; i < seek->len; i++) {
+        item = (struct fast_seek_point *)seek->pdata[i];
+        compression = item->compression;
+        g_byte_array_append(buf, (const guint8 *)&item->out, sizeof item->out);
+        g_byte_array_append(buf, (const guint8 *)&item->in, sizeof item->in);
+        g_byte_array_append(buf, (const guint8 *)&compression, sizeof compression);
+#ifdef HAVE_ZLIB
+        if (item->compression == ZLIB) {
+            gint32 bits = 0;
+
+#ifdef HAVE_INFLATEPRIME
+            bits = item->data.zlib->bits;
+#endif
+            g_byte_array_append(buf, (const guint8 *)&bits, sizeof bits);
+            g_byte_array_append(buf, item->data.zlib->window, ZLIB_WINSIZE);
+            g_byte_array_append(buf, (const guint8 *)&item->data.zlib->adler, sizeof item->data.zlib->adler);
+            g_byte_array_append(buf, (const guint8 *)&item->data.zlib->total_out, sizeof item->data.zlib->total_out);
+        }
+#endif
+#ifdef HAVE_LZ4
+        if (item->compression == LZ4) {
+            g_byte_array_append(buf, &item->data.lz4.flg, sizeof item->data.lz4.flg);
+            g_byte_array_append(buf, &item->data.lz4.bd, sizeof item->data.lz4.bd);
+        }
+#endif
+    }
+}
+
+/*
+ * Restores fast seek points saved by file_fast_seek_save() into seek,
+ * which must be empty. Returns FALSE, leaving seek empty, if the data
+ * is malformed or was written by a build that handles different kinds
+ * of points.
+ */
+gboolean
+file_fast_seek_load(GPtrArray *seek, const guint8 *data, gsize len)
+{
+    struct fast_seek_point *item;
+    const guint8 *end = data + len;
+    guint32 compression;
+
+#define FAST_SEEK_TAKE(dst, size) \
+    do { \
+        if ((gsize)(end - data) < (size)) \
+            goto fail; \
+        memcpy((dst), data, (size)); \
+        data += (size); \
+    } while (0)
+
+    while (data < end) {
+        item = g_new0(struct fast_seek_point, 1);
+        g_ptr_array_add(seek, item);
+        FAST_SEEK_TAKE(&item->out, sizeof item->out);
+        FAST_SEEK_TAKE(&item->in, sizeof item->in);
+        FAST_SEEK_TAKE(&compression, sizeof compression);
+        item->compression = (compression_t)compression;
+        switch (item->compression) {
+
+        case UNCOMPRESSED:
+            break;
+
+#ifdef HAVE_ZLIB
+        case GZIP_AFTER_HEADER:
+            break;
+
+        case ZLIB:
+        {
+            gint32 bits;
+
+            item->data.zlib = g_new(struct zlib_seek_data, 1);
+            FAST_SEEK_TAKE(&bits, sizeof bits);
+#ifdef HAVE_INFLATEPRIME
+            item->data.zlib->bits = bits;
+#else
+            if (bits != 0)
+                goto fail;
+#endif
+            FAST_SEEK_TAKE(item->data.zlib->window, ZLIB_WINSIZE);
+            FAST_SEEK_TAKE(&item->data.zlib->adler, sizeof item->data.zlib->adler);
+            FAST_SEEK_TAKE(&item->data.zlib->total_out, sizeof item->data.zlib->total_out);
+            break;
+        }
+#endif
+
+#ifdef HAVE_LZ4
+        case LZ4:
+            FAST_SEEK_TAKE(&item->data.lz4.flg, sizeof item->data.lz4.flg);
+            FAST_SEEK_TAKE(&item->data.lz4.bd, sizeof item->data.lz4.bd);
+            break;
+#endif
+
+        default:
+            goto fail;
+        }
+    }
+#undef FAST_SEEK_TAKE
+    return TRUE;
+
+fail:
+    file_fast_seek_clear(seek);
+    return FALSE;
+}
+
+/*
+ * Frees the fast seek points in seek, leaving it empty.
+ */
+void
+file_fast_seek_clear(GPtrArray *seek)
+{
+    guint i;
+
+    for (i = 0; i < seek->len; i++)
+        fast_seek_point_free((struct fast_seek_point *)seek->pdata[i]);
+    g_ptr_array_set_size(seek, 0);
+}
+
 gint64
 file_seek(FILE_T file, gint64 offset, int whence, int *err)
 {
@@ -1028,6 +1595,12 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 */
     }
 
+    /* The seeks below are relative to the fd's position */
+    if (fd_sync(file) == -1) {
+        *err = errno;
+        return -1;
+    }
+
     /* Normalize offset to a SEEK_CUR specification */
     if (whence == SEEK_END) {
         /* Seek relative to the end of the file; given that we might be
@@ -1122,12 +1695,16 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
      * We're not seeking within the buffer.  Do we have "fast seek" data
      * for the location to which we will be seeking, and is the offset
      * outside the span for compressed files or is this an uncompressed
-     * file?
+     * file or an LZ4 block, which is cheap to start reading at?
      *
      * XXX, profile
      */
     if ((here = fast_seek_find(file, file->pos + offset)) &&
-        (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED)) {
+        (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED
+#ifdef HAVE_LZ4
+         || here->compression == LZ4
+#endif
+        )) {
         gint64 off, off2;
 
         /*
@@ -1139,7 +1716,7 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 #ifdef HAVE_ZLIB
         if (here->compression == ZLIB) {
 #ifdef HAVE_INFLATEPRIME
-            off = here->in - (here->data.zlib.bits ? 1 : 0);
+            off = here->in - (here->data.zlib->bits ? 1 : 0);
 #else
             off = here->in;
 #endif
@@ -1148,6 +1725,12 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off = here->in;
             off2 = here->out;
         } else
+#endif
+#ifdef HAVE_LZ4
+        if (here->compression == LZ4) {
+            off = here->in;
+            off2 = here->out;
+        } else
 #endif
         {
             off2 = (file->pos + offset);
@@ -1173,10 +1756,10 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             z_stream *strm = &file->strm;
 
             inflateReset(strm);
-            strm->adler = here->data.zlib.adler;
-            strm->total_out = here->data.zlib.total_out;
+            strm->adler = here->data.zlib->adler;
+            strm->total_out = here->data.zlib->total_out;
 #ifdef HAVE_INFLATEPRIME
-            if (here->data.zlib.bits) {
+            if (here->data.zlib->bits) {
                 FILE_T state = file;
                 int ret = GZ_GETC();
 
@@ -1188,10 +1771,10 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
                         *err = state->err;
                     return -1;
                 }
-                (void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
+                (void)inflatePrime(strm, here->data.zlib->bits, ret >> (8 - here->data.zlib->bits));
             }
 #endif
-            (void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
+            (void)inflateSetDictionary(strm, here->data.zlib->window, ZLIB_WINSIZE);
             file->compression = ZLIB;
         } else if (here->compression == GZIP_AFTER_HEADER) {
             z_stream *strm = &file->strm;
@@ -1200,6 +1783,14 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             strm->adler = crc32(0L, Z_NULL, 0);
             file->compression = ZLIB;
         } else
+#endif
+#ifdef HAVE_LZ4
+        if (here->compression == LZ4) {
+            if (lz4_frame_setup(file, here->data.lz4.flg, here->data.lz4.bd) == -1) {
+                *err = file->err;
+                return -1;
+            }
+        } else
 #endif
             file->compression = here->compression;
 
@@ -1327,7 +1918,13 @@ file_fstat(FILE_T stream, ws_statb64 *statb, int *err)
 gboolean
 file_iscompressed(FILE_T stream)
 {
-    return stream->is_compressed;
+    return stream->compression_type != WTAP_UNCOMPRESSED;
+}
+
+wtap_compression_type
+file_get_compression_type(FILE_T stream)
+{
+    return stream->compression_type;
 }
 
 int
@@ -1377,6 +1974,33 @@ file_read(void *buf, unsigned int len, FILE_T file)
                we're at the end of the input; just return
                with what we've gotten so far. */
             break;
+        } else if (file->compression == UNCOMPRESSED &&
+                   file->in.avail == 0 && buf != NULL &&
+                   len >= file->size) {
+            /* We have nothing buffered, the file isn't
+               compressed, and the caller wants at least a
+               buffer's worth of data; read it straight into
+               the caller's buffer rather than copying it
+               through ours. */
+            ssize_t ret;
+
+            /* The data in our buffer no longer precedes the
+               current position, so a backward file_seek()
+               must not find it there. */
+            buf_reset(&file->out);
+            ret = raw_read(file, (guint8 *)buf, len);
+            if (ret < 0) {
+                file->err = errno;
+                file->err_info = NULL;
+                return -1;
+            }
+            if (ret == 0)
+                file->eof = TRUE;
+            file->raw_pos += ret;
+            buf = (char *)buf + ret;
+            len -= (guint)ret;
+            got += (guint)ret;
+            file->pos += ret;
         } else {
             /* We have nothing in the output buffer, and
                we can generate more data; get more output,
@@ -1391,6 +2015,17 @@ file_read(void *buf, unsigned int len, FILE_T file)
     return (int)got;
 }
 
+void
+file_set_live_ring(FILE_T stream, ws_shm_ring *ring, guint32 seq)
+{
+    stream->live_ring = ring;
+    stream->live_ring_seq = seq;
+    if (ring == NULL && fd_sync(stream) == -1) {
+        stream->err = errno;
+        stream->err_info = NULL;
+    }
+}
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -1588,6 +2223,96 @@ file_fdreopen(FILE_T file, const char *path)
     return TRUE;
 }
 
+/*
+ * Close the file descriptor of a stream and free its buffers, remembering
+ * where it was, so that more files can be read one after the other than
+ * can be open at once; file_resume() opens it again.
+ */
+void
+file_suspend(FILE_T file)
+{
+    file->suspended_pos = file_tell(file);
+    file->suspended_size = file->size;
+    if (file->size) {
+#ifdef HAVE_ZLIB
+        inflateEnd(&(file->strm));
+#endif
+        g_free(file->out.buf);
+        g_free(file->in.buf);
+        file->out.buf = NULL;
+        file->in.buf = NULL;
+        file->size = 0;
+    }
+#ifdef HAVE_LZ4
+    g_free(file->lz4_in);
+    file->lz4_in = NULL;
+    g_free(file->lz4_dict);
+    file->lz4_dict = NULL;
+    file->lz4_buf_size = 0;
+#endif
+    ws_close(file->fd);
+    file->fd = -1;
+}
+
+/*
+ * Reopen a stream suspended with file_suspend(). Its data is read again
+ * from the start, as the decompression state is gone, up to where it was;
+ * that's cheap if it was suspended near the start.
+ */
+gboolean
+file_resume(FILE_T file, const char *path, int *err)
+{
+    int fd;
+
+    if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1) {
+        *err = errno;
+        return FALSE;
+    }
+
+    file->in.buf = (unsigned char *)g_try_malloc((gsize)file->suspended_size);
+    file->out.buf = (unsigned char *)g_try_malloc(((gsize)file->suspended_size) << 1);
+    if (file->in.buf == NULL || file->out.buf == NULL) {
+        g_free(file->out.buf);
+        g_free(file->in.buf);
+        file->out.buf = NULL;
+        file->in.buf = NULL;
+        ws_close(fd);
+        *err = ENOMEM;
+        return FALSE;
+    }
+#ifdef HAVE_ZLIB
+    file->strm.zalloc = Z_NULL;
+    file->strm.zfree = Z_NULL;
+    file->strm.opaque = Z_NULL;
+    file->strm.avail_in = 0;
+    file->strm.next_in = Z_NULL;
+    if (inflateInit2(&(file->strm), -15) != Z_OK) {    /* raw inflate */
+        g_free(file->out.buf);
+        g_free(file->in.buf);
+        file->out.buf = NULL;
+        file->in.buf = NULL;
+        ws_close(fd);
+        *err = ENOMEM;
+        return FALSE;
+    }
+#endif
+    file->size = file->suspended_size;
+    file->fd = fd;
+
+    /* start over, then skip to where we were */
+    if (ws_lseek64(file->fd, file->start, SEEK_SET) == -1) {
+        *err = errno;
+        return FALSE;
+    }
+    fast_seek_reset(file);
+    file->raw_pos = file->start;
+    file->fd_pos_stale = FALSE;
+    gz_reset(file);
+    if (file_seek(file, file->suspended_pos, SEEK_SET, err) == -1)
+        return FALSE;
+    return TRUE;
+}
+
 void
 file_close(FILE_T file)
 {
@@ -1601,6 +2326,10 @@ file_close(FILE_T file)
         g_free(file->out.buf);
         g_free(file->in.buf);
     }
+#ifdef HAVE_LZ4
+    g_free(file->lz4_in);
+    g_free(file->lz4_dict);
+#endif
     g_free(file->fast_seek_cur);
     file->err = 0;
     file->err_info = NULL;
@@ -12,16 +12,22 @@
 #include <glib.h>
 #include "wtap.h"
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
 #include "ws_symbol_export.h"
 
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern void file_fast_seek_save(const GPtrArray *seek, GByteArray *buf);
+extern gboolean file_fast_seek_load(GPtrArray *seek, const guint8 *data, gsize len);
+extern void file_fast_seek_clear(GPtrArray *seek);
+extern void file_set_live_ring(FILE_T stream, ws_shm_ring *ring, guint32 seq);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
 extern gint64 file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 WS_DLL_PUBLIC gboolean file_iscompressed(FILE_T stream);
+extern wtap_compression_type file_get_compression_type(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
 WS_DLL_PUBLIC int file_peekc(FILE_T stream);
 WS_DLL_PUBLIC int file_getc(FILE_T stream);
@@ -32,6 +38,8 @@ WS_DLL_PUBLIC int file_error(FILE_T fh, gchar **err_info);
 extern void file_clearerr(FILE_T stream);
 extern void file_fdclose(FILE_T file);
 extern int file_fdreopen(FILE_T file, const char *path);
+extern void file_suspend(FILE_T file);
+extern gboolean file_resume(FILE_T file, const char *path, int *err);
 extern void file_close(FILE_T file);
 
 #ifdef HAVE_ZLIB
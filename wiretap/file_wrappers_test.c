@@ -0,0 +1,150 @@
+/* file_wrappers_test.c
+ * Tests for the buffered file reading routines
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+
+#define TEST_FILE_SIZE  (256 * 1024)
+
+static char *test_filename;
+static guint8 *test_data;
+
+static void
+file_wrappers_test_setup(void)
+{
+    GError *error = NULL;
+    int fd;
+
+    test_data = (guint8 *)g_malloc(TEST_FILE_SIZE);
+    for (guint i = 0; i < TEST_FILE_SIZE; i++) {
+        test_data[i] = (guint8)(i ^ (i >> 8) ^ (i >> 16));
+    }
+
+    fd = g_file_open_tmp("wtap_test_XXXXXX", &test_filename, &error);
+    g_assert(fd != -1);
+    g_assert(ws_write(fd, test_data, TEST_FILE_SIZE) == TEST_FILE_SIZE);
+    ws_close(fd);
+}
+
+static void
+file_wrappers_test_cleanup(void)
+{
+    ws_unlink(test_filename);
+    g_free(test_filename);
+    g_free(test_data);
+}
+
+/*
+ * Large reads of uncompressed files bypass our buffer; seeking back a
+ * little afterwards must not return what the buffer held before.
+ */
+static void
+file_wrappers_test_seek_after_large_read(void)
+{
+    static const guint firsts[] = { 1, 100, 4000, 5000, 20000 };
+    static const guint backs[] = { 1, 10, 1000, 4096, 8192, 30000 };
+    guint8 *buf = (guint8 *)g_malloc(TEST_FILE_SIZE);
+    FILE_T fh;
+    int err;
+
+    fh = file_open(test_filename);
+    g_assert(fh != NULL);
+
+    for (guint i = 0; i < G_N_ELEMENTS(firsts); i++) {
+        for (guint j = 0; j < G_N_ELEMENTS(backs); j++) {
+            guint first = firsts[i];
+            gint64 pos;
+
+            g_assert(file_seek(fh, 0, SEEK_SET, &err) == 0);
+            g_assert(file_read(buf, first, fh) == (int)first);
+            g_assert(file_read(buf, 65536, fh) == 65536);
+            g_assert(memcmp(buf, test_data + first, 65536) == 0);
+
+            pos = first + 65536 - backs[j];
+            g_assert(file_seek(fh, -(gint64)backs[j], SEEK_CUR, &err) == pos);
+            g_assert(file_tell(fh) == pos);
+            g_assert(file_read(buf, backs[j], fh) == (int)backs[j]);
+            g_assert(memcmp(buf, test_data + pos, backs[j]) == 0);
+        }
+    }
+
+    file_close(fh);
+    g_free(buf);
+}
+
+static void
+file_wrappers_test_sequential_read(void)
+{
+    guint8 *buf = (guint8 *)g_malloc(TEST_FILE_SIZE);
+    guint got = 0;
+    guint len = 1;
+    int ret;
+    FILE_T fh;
+
+    fh = file_open(test_filename);
+    g_assert(fh != NULL);
+
+    /* Mix reads smaller and larger than the buffer. */
+    while ((ret = file_read(buf + got, len, fh)) > 0) {
+        got += ret;
+        len = len * 3 + 1;
+        if (len > 100000) {
+            len = 1;
+        }
+    }
+    g_assert(ret == 0);
+    g_assert(got == TEST_FILE_SIZE);
+    g_assert(memcmp(buf, test_data, TEST_FILE_SIZE) == 0);
+    g_assert(file_eof(fh));
+
+    file_close(fh);
+    g_free(buf);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    file_wrappers_test_setup();
+
+    g_test_add_func("/wiretap/file_wrappers/sequential_read",
+                    file_wrappers_test_sequential_read);
+    g_test_add_func("/wiretap/file_wrappers/seek_after_large_read",
+                    file_wrappers_test_seek_after_large_read);
+
+    ret = g_test_run();
+
+    file_wrappers_test_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
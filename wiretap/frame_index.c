@@ -0,0 +1,355 @@
+/* frame_index.c
+ * Routines for the on-disk frame index of a capture file.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+#include "frame_index.h"
+
+#include <wsutil/file_util.h>
+
+/*
+ * The index is written in host byte order and layout; an index written
+ * by a different build or on a different machine fails the magic, version
+ * or record size check and is simply rebuilt.
+ */
+#define FRAME_INDEX_MAGIC       0x58495357      /* "WSIX" on little-endian hosts */
+#define FRAME_INDEX_VERSION     2
+#define FRAME_INDEX_SUFFIX      ".wsidx"
+
+/* Amount of data hashed at each end of the capture file. */
+#define FRAME_INDEX_HASH_SPAN   65536
+#define FRAME_INDEX_HASH_LEN    32              /* SHA-256 */
+
+#define FRAME_INDEX_HAS_COMMENT 0x0001
+
+typedef struct {
+    guint32 magic;
+    guint32 version;
+    guint32 record_size;
+    gint32  file_type_subtype;
+    gint64  file_size;
+    gint64  file_mtime;
+    guint8  file_hash[FRAME_INDEX_HASH_LEN];
+    guint32 num_interfaces;
+    guint32 frame_count;
+    guint64 fast_seek_len;
+} frame_index_header_t;
+
+typedef struct {
+    gint64  offset;
+    gint64  secs;
+    gint32  nsecs;
+    guint32 caplen;
+    guint32 len;
+    guint32 interface_id;
+    guint32 presence_flags;
+    gint32  pkt_encap;
+    guint16 tsprec;
+    guint16 flags;
+} frame_index_record_t;
+
+struct wtap_frame_index {
+    GArray   *records;      /* frame_index_record_t */
+    gboolean  indexable;    /* FALSE once a record that cannot be indexed was seen */
+};
+
+wtap_frame_index_t *
+wtap_frame_index_new(void)
+{
+    wtap_frame_index_t *idx = g_new(wtap_frame_index_t, 1);
+
+    idx->records = g_array_new(FALSE, FALSE, sizeof(frame_index_record_t));
+    idx->indexable = TRUE;
+    return idx;
+}
+
+void
+wtap_frame_index_free(wtap_frame_index_t *idx)
+{
+    if (idx == NULL)
+        return;
+    g_array_free(idx->records, TRUE);
+    g_free(idx);
+}
+
+void
+wtap_frame_index_add(wtap_frame_index_t *idx, const wtap_rec *rec, gint64 data_offset)
+{
+    frame_index_record_t r;
+
+    if (!idx->indexable)
+        return;
+
+    /* Only packets have a fixed set of header fields worth indexing. */
+    if (rec->rec_type != REC_TYPE_PACKET) {
+        idx->indexable = FALSE;
+        g_array_set_size(idx->records, 0);
+        return;
+    }
+
+    r.offset = data_offset;
+    r.secs = rec->ts.secs;
+    r.nsecs = rec->ts.nsecs;
+    r.caplen = rec->rec_header.packet_header.caplen;
+    r.len = rec->rec_header.packet_header.len;
+    r.interface_id = rec->rec_header.packet_header.interface_id;
+    r.presence_flags = rec->presence_flags;
+    r.pkt_encap = rec->rec_header.packet_header.pkt_encap;
+    r.tsprec = (guint16)rec->tsprec;
+    r.flags = (rec->opt_comment != NULL) ? FRAME_INDEX_HAS_COMMENT : 0;
+    g_array_append_val(idx->records, r);
+}
+
+guint32
+wtap_frame_index_count(const wtap_frame_index_t *idx)
+{
+    return idx->records->len;
+}
+
+void
+wtap_frame_index_get(const wtap_frame_index_t *idx, guint32 n, wtap_rec *rec, gint64 *data_offset)
+{
+    const frame_index_record_t *r = &g_array_index(idx->records, frame_index_record_t, n);
+
+    rec->rec_type = REC_TYPE_PACKET;
+    rec->presence_flags = r->presence_flags;
+    rec->ts.secs = (time_t)r->secs;
+    rec->ts.nsecs = r->nsecs;
+    rec->tsprec = r->tsprec;
+    rec->rec_header.packet_header.caplen = r->caplen;
+    rec->rec_header.packet_header.len = r->len;
+    rec->rec_header.packet_header.interface_id = r->interface_id;
+    rec->rec_header.packet_header.pkt_encap = r->pkt_encap;
+    g_free(rec->opt_comment);
+    rec->opt_comment = (r->flags & FRAME_INDEX_HAS_COMMENT) ? g_strdup("") : NULL;
+    *data_offset = r->offset;
+}
+
+static gboolean
+frame_index_file_type_supported(int file_type_subtype)
+{
+    switch (file_type_subtype) {
+
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAPNG:
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+/*
+ * Fills in the size, modification time and hash of a capture file in
+ * hdr. Hashing the whole file would cost as much as reading it, so only
+ * the first and last FRAME_INDEX_HASH_SPAN bytes are hashed; together
+ * with the size and time stamp that catches rewritten files.
+ */
+static gboolean
+frame_index_identify(const char *filename, frame_index_header_t *hdr)
+{
+    ws_statb64 statb;
+    GChecksum *checksum;
+    guint8 *buf;
+    gsize hash_len = FRAME_INDEX_HASH_LEN;
+    gint64 tail;
+    int fd, nread;
+    gboolean ok = TRUE;
+
+    fd = ws_open(filename, O_RDONLY|O_BINARY, 0000);
+    if (fd == -1)
+        return FALSE;
+    if (ws_fstat64(fd, &statb) == -1) {
+        ws_close(fd);
+        return FALSE;
+    }
+    hdr->file_size = statb.st_size;
+    hdr->file_mtime = statb.st_mtime;
+
+    checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    buf = (guint8 *)g_malloc(FRAME_INDEX_HASH_SPAN);
+
+    nread = ws_read(fd, buf, FRAME_INDEX_HASH_SPAN);
+    if (nread < 0)
+        ok = FALSE;
+    else
+        g_checksum_update(checksum, buf, nread);
+
+    tail = statb.st_size - FRAME_INDEX_HASH_SPAN;
+    if (ok && tail > FRAME_INDEX_HASH_SPAN) {
+        if (ws_lseek64(fd, tail, SEEK_SET) == -1)
+            ok = FALSE;
+        else if ((nread = ws_read(fd, buf, FRAME_INDEX_HASH_SPAN)) < 0)
+            ok = FALSE;
+        else
+            g_checksum_update(checksum, buf, nread);
+    }
+
+    if (ok)
+        g_checksum_get_digest(checksum, hdr->file_hash, &hash_len);
+
+    g_free(buf);
+    g_checksum_free(checksum);
+    ws_close(fd);
+    return ok;
+}
+
+gboolean
+wtap_frame_index_write(wtap_frame_index_t *idx, wtap *wth, const char *filename)
+{
+    frame_index_header_t hdr;
+    GByteArray *fast_seek;
+    char *index_name, *tmp_name;
+    FILE *fp;
+    gboolean ok;
+
+    if (!idx->indexable || idx->records->len == 0 ||
+        !frame_index_file_type_supported(wtap_file_type_subtype(wth)))
+        return FALSE;
+
+    memset(&hdr, 0, sizeof hdr);
+    hdr.magic = FRAME_INDEX_MAGIC;
+    hdr.version = FRAME_INDEX_VERSION;
+    hdr.record_size = (guint32)sizeof(frame_index_record_t);
+    hdr.file_type_subtype = wtap_file_type_subtype(wth);
+    hdr.num_interfaces = wth->interface_data->len;
+    hdr.frame_count = idx->records->len;
+    if (!frame_index_identify(filename, &hdr))
+        return FALSE;
+
+    fast_seek = g_byte_array_new();
+    if (wth->fast_seek != NULL)
+        file_fast_seek_save(wth->fast_seek, fast_seek);
+    hdr.fast_seek_len = fast_seek->len;
+
+    /* Write to a temporary file and rename it, so that a reader never
+     * sees a partial index. */
+    index_name = g_strconcat(filename, FRAME_INDEX_SUFFIX, NULL);
+    tmp_name = g_strconcat(index_name, ".tmp", NULL);
+    fp = ws_fopen(tmp_name, "wb");
+    ok = (fp != NULL);
+    if (ok) {
+        ok = fwrite(&hdr, sizeof hdr, 1, fp) == 1 &&
+             fwrite(idx->records->data, sizeof(frame_index_record_t), idx->records->len, fp) == idx->records->len &&
+             (fast_seek->len == 0 || fwrite(fast_seek->data, fast_seek->len, 1, fp) == 1);
+        if (fclose(fp) != 0)
+            ok = FALSE;
+        if (ok)
+            ok = ws_rename(tmp_name, index_name) == 0;
+        if (!ok)
+            ws_unlink(tmp_name);
+    }
+
+    g_free(tmp_name);
+    g_free(index_name);
+    g_byte_array_free(fast_seek, TRUE);
+    return ok;
+}
+
+wtap_frame_index_t *
+wtap_frame_index_read(wtap *wth, const char *filename)
+{
+    frame_index_header_t hdr, cur;
+    wtap_frame_index_t *idx = NULL;
+    guint8 *fast_seek = NULL;
+    ws_statb64 statb;
+    char *index_name;
+    FILE *fp;
+
+    if (!frame_index_file_type_supported(wtap_file_type_subtype(wth)))
+        return NULL;
+
+    index_name = g_strconcat(filename, FRAME_INDEX_SUFFIX, NULL);
+    fp = ws_fopen(index_name, "rb");
+    g_free(index_name);
+    if (fp == NULL)
+        return NULL;
+
+    if (fread(&hdr, sizeof hdr, 1, fp) != 1 ||
+        hdr.magic != FRAME_INDEX_MAGIC ||
+        hdr.version != FRAME_INDEX_VERSION ||
+        hdr.record_size != sizeof(frame_index_record_t) ||
+        hdr.file_type_subtype != wtap_file_type_subtype(wth) ||
+        hdr.num_interfaces > wth->interface_data->len ||
+        hdr.fast_seek_len > G_MAXUINT32)
+        goto done;
+
+    /* A truncated or corrupt index mustn't make us allocate its claims. */
+    if (ws_fstat64(ws_fileno(fp), &statb) == -1 ||
+        (guint64)statb.st_size != sizeof hdr +
+            (guint64)hdr.frame_count * sizeof(frame_index_record_t) + hdr.fast_seek_len)
+        goto done;
+
+    if (!frame_index_identify(filename, &cur) ||
+        cur.file_size != hdr.file_size ||
+        cur.file_mtime != hdr.file_mtime ||
+        memcmp(cur.file_hash, hdr.file_hash, FRAME_INDEX_HASH_LEN) != 0)
+        goto done;
+
+    idx = wtap_frame_index_new();
+    g_array_set_size(idx->records, hdr.frame_count);
+    if (fread(idx->records->data, sizeof(frame_index_record_t), hdr.frame_count, fp) != hdr.frame_count)
+        goto fail;
+
+    if (hdr.fast_seek_len != 0) {
+        fast_seek = (guint8 *)g_malloc((gsize)hdr.fast_seek_len);
+        if (fread(fast_seek, (size_t)hdr.fast_seek_len, 1, fp) != 1)
+            goto fail;
+        /* Without a random stream there is nothing to seek in. The
+         * points from the whole file replace those that opening it
+         * added. */
+        if (wth->fast_seek != NULL) {
+            GPtrArray *points = g_ptr_array_new();
+            guint i;
+
+            if (!file_fast_seek_load(points, fast_seek, (gsize)hdr.fast_seek_len)) {
+                g_ptr_array_free(points, TRUE);
+                goto fail;
+            }
+            file_fast_seek_clear(wth->fast_seek);
+            for (i = 0; i < points->len; i++)
+                g_ptr_array_add(wth->fast_seek, points->pdata[i]);
+            g_ptr_array_free(points, TRUE);
+        }
+    }
+    goto done;
+
+fail:
+    wtap_frame_index_free(idx);
+    idx = NULL;
+done:
+    g_free(fast_seek);
+    fclose(fp);
+    return idx;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,92 @@
+/* frame_index.h
+ * Definitions for the on-disk frame index of a capture file.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+#include "wiretap/wtap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A frame index records, for every record of a capture file, what is
+ * needed to fill in its frame_data without reading it: the file offset,
+ * time stamp, lengths, interface and encapsulation, plus the compressed-file seek points
+ * of the file. It is written next to the capture file, as
+ * "<capture file>.wsidx", after a complete sequential read, and is only
+ * used again if the size, modification time and a hash of the start and
+ * end of the capture file still match.
+ *
+ * Only pcap and pcapng files that contain nothing but packet records are
+ * indexed; for pcapng, every interface must be described before the first
+ * packet, as random access cannot see interfaces added later in the file.
+ */
+typedef struct wtap_frame_index wtap_frame_index_t;
+
+/** Create an empty index, to be filled in during a sequential read. */
+WS_DLL_PUBLIC
+wtap_frame_index_t *wtap_frame_index_new(void);
+
+/** Add the record just returned by wtap_read(), read at data_offset. */
+WS_DLL_PUBLIC
+void wtap_frame_index_add(wtap_frame_index_t *idx, const wtap_rec *rec, gint64 data_offset);
+
+/**
+ * Write the index for the capture file opened as wth, which must have
+ * been read to the end. Returns FALSE if the file cannot be indexed or
+ * the index cannot be written; that is not an error for the caller.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_frame_index_write(wtap_frame_index_t *idx, wtap *wth, const char *filename);
+
+/**
+ * Read and validate the index of the capture file just opened as wth.
+ * On success the compressed-file seek points are installed in wth, so
+ * that random access works without a sequential read. Returns NULL if
+ * there is no usable index.
+ */
+WS_DLL_PUBLIC
+wtap_frame_index_t *wtap_frame_index_read(wtap *wth, const char *filename);
+
+/** Number of records in the index. */
+WS_DLL_PUBLIC
+guint32 wtap_frame_index_count(const wtap_frame_index_t *idx);
+
+/**
+ * Fill in the record metadata of the n-th record (0-based) and its file
+ * offset, as wtap_read() would have. The record has no data and no
+ * options other than, possibly, a placeholder comment.
+ */
+WS_DLL_PUBLIC
+void wtap_frame_index_get(const wtap_frame_index_t *idx, guint32 n, wtap_rec *rec, gint64 *data_offset);
+
+WS_DLL_PUBLIC
+void wtap_frame_index_free(wtap_frame_index_t *idx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_INDEX_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
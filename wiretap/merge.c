@@ -26,6 +26,7 @@
 #include "wtap_opttypes.h"
 #include "pcapng.h"
 #include "wtap-int.h"
+#include "file_wrappers.h"
 
 #include <wsutil/filesystem.h>
 #include "wsutil/os_version_info.h"
@@ -71,21 +72,76 @@ merge_idb_merge_mode_to_string(const int mode)
 }
 
 
+/* Close an input file once it has been merged; cleanup_in_file() frees the
+ * rest. */
 static void
-cleanup_in_file(merge_in_file_t *in_file)
+close_in_file(merge_in_file_t *in_file)
 {
     g_assert(in_file != NULL);
 
+    if (in_file->wth == NULL)
+        return;
+
     wtap_close(in_file->wth);
     in_file->wth = NULL;
 
-    g_array_free(in_file->idb_index_map, TRUE);
-    in_file->idb_index_map = NULL;
-
     wtap_rec_cleanup(&in_file->rec);
     ws_buffer_free(&in_file->frame_buffer);
 }
 
+static void
+cleanup_in_file(merge_in_file_t *in_file)
+{
+    g_assert(in_file != NULL);
+
+    close_in_file(in_file);
+
+    if (in_file->idb_index_map) {
+        g_array_free(in_file->idb_index_map, TRUE);
+        in_file->idb_index_map = NULL;
+    }
+}
+
+/* Close the file descriptor of an input file that won't be read from for
+ * a while, keeping everything read from it so far; resume_in_file() opens
+ * it again. Pipes can't be reopened, so they stay open. */
+static gboolean
+suspend_in_file(merge_in_file_t *in_file)
+{
+    if (in_file->suspended || in_file->wth->ispipe)
+        return FALSE;
+    file_suspend(in_file->wth->fh);
+    in_file->suspended = TRUE;
+    return TRUE;
+}
+
+static gboolean
+resume_in_file(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+    if (!file_resume(in_file->wth->fh, in_file->filename, err)) {
+        *err_info = NULL;
+        in_file->state = GOT_ERROR;
+        return FALSE;
+    }
+    in_file->suspended = FALSE;
+    return TRUE;
+}
+
+/* Read the next record of an input file, and set its state accordingly. */
+static gboolean
+read_in_file(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+    gint64 data_offset;
+
+    if (!wtap_read(in_file->wth, &in_file->rec, &in_file->frame_buffer,
+                   err, err_info, &data_offset)) {
+        in_file->state = (*err != 0) ? GOT_ERROR : AT_EOF;
+        return FALSE;
+    }
+    in_file->state = RECORD_PRESENT;
+    return TRUE;
+}
+
 static void
 add_idb_index_map(merge_in_file_t *in_file, const guint orig_index, const guint found_index)
 {
@@ -102,11 +158,21 @@ add_idb_index_map(merge_in_file_t *in_file, const guint orig_index, const guint
     g_array_append_val(in_file->idb_index_map, found_index);
 }
 
+static gboolean
+merge_pending_before(const merge_in_file_t *in_files, guint a, guint b);
+
 /** Open a number of input files to merge.
+ *
+ * If max_open_files is non-zero, the first record of each file is read,
+ * to know when the merge needs it, and only the max_open_files files that
+ * are needed first are left open; the others are suspended with
+ * suspend_in_file() until the merge gets to them.
  *
  * @param in_file_count number of entries in in_file_names
  * @param in_file_names filenames of the input files
  * @param out_files output pointer with filled file array, or NULL
+ * @param max_open_files limit on the number of open files, or 0
+ * @param do_append whether the files will be merged in file order
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @param err_fileno file on which open failed, if failed
@@ -115,10 +181,13 @@ add_idb_index_map(merge_in_file_t *in_file, const guint orig_index, const guint
 static gboolean
 merge_open_in_files(guint in_file_count, const char *const *in_file_names,
                     merge_in_file_t **out_files, merge_progress_callback_t* cb,
+                    guint max_open_files, gboolean do_append,
                     int *err, gchar **err_info, guint *err_fileno)
 {
     guint i;
     guint j;
+    guint num_open = 0;
+    guint last;
     size_t files_size = in_file_count * sizeof(merge_in_file_t);
     merge_in_file_t *files;
     gint64 size;
@@ -152,6 +221,47 @@ merge_open_in_files(guint in_file_count, const char *const *in_file_names,
         ws_buffer_init(&files[i].frame_buffer, 1514);
         files[i].size = size;
         files[i].idb_index_map = g_array_new(FALSE, FALSE, sizeof(guint));
+        files[i].file_type_subtype = wtap_file_type_subtype(files[i].wth);
+        files[i].encap = wtap_file_encap(files[i].wth);
+
+        if (max_open_files != 0) {
+            if (read_in_file(&files[i], err, err_info)) {
+                files[i].first_has_ts = (files[i].rec.presence_flags & WTAP_HAS_TS) != 0;
+                files[i].first_ts = files[i].rec.ts;
+            } else if (*err != 0) {
+                for (j = 0; j <= i; j++)
+                    cleanup_in_file(&files[j]);
+                g_free(files);
+                *err_fileno = i;
+                return FALSE;
+            }
+
+            /*
+             * Its IDBs are still needed for the headers of the merged
+             * file, so the file isn't closed, but at most
+             * max_open_files are left open: the ones that will be read
+             * from first, by the time stamp of their first record or
+             * in file order.
+             */
+            if (files[i].state == AT_EOF) {
+                suspend_in_file(&files[i]);
+                continue;
+            }
+            num_open++;
+            if (num_open <= max_open_files)
+                continue;
+            last = files[i].wth->ispipe ? G_MAXUINT : i;
+            for (j = 0; j < i; j++) {
+                if (files[j].state == AT_EOF || files[j].suspended ||
+                    files[j].wth->ispipe)
+                    continue;
+                if (last == G_MAXUINT ||
+                    (do_append ? j > last : merge_pending_before(files, last, j)))
+                    last = j;
+            }
+            if (last != G_MAXUINT && suspend_in_file(&files[last]))
+                num_open--;
+        }
     }
 
     if (cb)
@@ -193,10 +303,10 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
     int i;
     int selected_frame_type;
 
-    selected_frame_type = wtap_file_encap(in_files[0].wth);
+    selected_frame_type = in_files[0].encap;
 
     for (i = 1; i < in_file_count; i++) {
-        int this_frame_type = wtap_file_encap(in_files[i].wth);
+        int this_frame_type = in_files[i].encap;
         if (selected_frame_type != this_frame_type) {
             selected_frame_type = WTAP_ENCAP_PER_PACKET;
             break;
@@ -207,22 +317,176 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * State of a chronological merge.
+ *
+ * The files that have a record available are kept in a binary min-heap
+ * ordered by merge_heap_before(), so finding the next record costs
+ * O(log n) instead of a scan over all n input files.
+ *
+ * With a limit on the number of open files, the files are not added to
+ * the heap, and resumed if they were suspended, until the merge reaches
+ * the time stamp of their first record, and are closed at their end.
+ * "pending" lists the files not added yet, in the order they will be
+ * needed.  If a file is needed while the limit is reached, the merge
+ * can't go on in chronological order, and "overlapping" is set.
+ */
+typedef struct {
+    merge_in_file_t *in_files;
+    guint           *heap;          /* indices into in_files */
+    guint            heap_len;
+    merge_in_file_t *last;          /* file whose record was returned last */
+    gboolean         primed;
+    guint            max_open_files; /* 0 for no limit */
+    guint            num_open;
+    guint           *pending;       /* indices into in_files */
+    guint            pending_len;
+    guint            next_pending;
+    gboolean         overlapping;
+} merge_heap_t;
+
+/*
+ * Returns TRUE if a record with the given time stamp from file index a
+ * goes before one from file index b.
+ *
+ * Records with no time stamp are treated as earlier than all other
+ * records, and are taken in file order.  Yes, this means you won't get a
+ * chronological merge of those records, but you obviously *can't* get
+ * that.  Records with the same time stamp are taken from the file with
+ * the higher index first.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_ts_before(gboolean a_has_ts, const nstime_t *a_ts, guint a,
+                gboolean b_has_ts, const nstime_t *b_ts, guint b)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return FALSE;
-    } else if (l->secs < r->secs) { /* left is earlier */
-        return TRUE;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
-        return FALSE;
+    int cmp;
+
+    if (!a_has_ts || !b_has_ts) {
+        if (a_has_ts != b_has_ts)
+            return !a_has_ts;
+        return a < b;
+    }
+    cmp = nstime_cmp(a_ts, b_ts);
+    if (cmp != 0)
+        return cmp < 0;
+    return a > b;
+}
+
+static gboolean
+merge_heap_before(const merge_heap_t *mh, guint a, guint b)
+{
+    const wtap_rec *ra = &mh->in_files[a].rec;
+    const wtap_rec *rb = &mh->in_files[b].rec;
+
+    return merge_ts_before((ra->presence_flags & WTAP_HAS_TS) != 0, &ra->ts, a,
+                           (rb->presence_flags & WTAP_HAS_TS) != 0, &rb->ts, b);
+}
+
+static void
+merge_heap_sift_up(merge_heap_t *mh, guint pos)
+{
+    guint parent, idx = mh->heap[pos];
+
+    while (pos > 0) {
+        parent = (pos - 1) / 2;
+        if (!merge_heap_before(mh, idx, mh->heap[parent]))
+            break;
+        mh->heap[pos] = mh->heap[parent];
+        pos = parent;
     }
-    /* either one < two or one == two
-     * either way, return one
+    mh->heap[pos] = idx;
+}
+
+static void
+merge_heap_sift_down(merge_heap_t *mh, guint pos)
+{
+    guint child, idx = mh->heap[pos];
+
+    for (;;) {
+        child = 2 * pos + 1;
+        if (child >= mh->heap_len)
+            break;
+        if (child + 1 < mh->heap_len &&
+            merge_heap_before(mh, mh->heap[child + 1], mh->heap[child]))
+            child++;
+        if (!merge_heap_before(mh, mh->heap[child], idx))
+            break;
+        mh->heap[pos] = mh->heap[child];
+        pos = child;
+    }
+    mh->heap[pos] = idx;
+}
+
+static void
+merge_heap_push(merge_heap_t *mh, guint idx)
+{
+    mh->heap[mh->heap_len++] = idx;
+    merge_heap_sift_up(mh, mh->heap_len - 1);
+}
+
+static void
+merge_heap_pop(merge_heap_t *mh)
+{
+    mh->heap[0] = mh->heap[--mh->heap_len];
+    if (mh->heap_len > 0)
+        merge_heap_sift_down(mh, 0);
+}
+
+static gboolean
+merge_pending_before(const merge_in_file_t *in_files, guint a, guint b)
+{
+    return merge_ts_before(in_files[a].first_has_ts, &in_files[a].first_ts, a,
+                           in_files[b].first_has_ts, &in_files[b].first_ts, b);
+}
+
+static void
+merge_heap_init(merge_heap_t *mh, merge_in_file_t in_files[],
+                guint in_file_count, guint max_open_files)
+{
+    guint i, j, idx;
+
+    memset(mh, 0, sizeof(*mh));
+    mh->in_files = in_files;
+    mh->heap = g_new(guint, in_file_count);
+
+    if (max_open_files == 0)
+        return;
+
+    /*
+     * List the files that have records by the time stamp of their first
+     * record.  Ring buffer files are usually given in this order already,
+     * so use an insertion sort.  The ones merge_open_in_files() left open
+     * count towards the limit.
      */
-    return TRUE;
+    mh->max_open_files = max_open_files;
+    mh->pending = g_new(guint, in_file_count);
+    for (i = 0; i < in_file_count; i++) {
+        if (in_files[i].state == AT_EOF)
+            continue;
+        if (!in_files[i].suspended)
+            mh->num_open++;
+        idx = i;
+        for (j = mh->pending_len; j > 0 && merge_pending_before(in_files, idx, mh->pending[j - 1]); j--)
+            mh->pending[j] = mh->pending[j - 1];
+        mh->pending[j] = idx;
+        mh->pending_len++;
+    }
+}
+
+static void
+merge_heap_cleanup(merge_heap_t *mh)
+{
+    g_free(mh->heap);
+    g_free(mh->pending);
+}
+
+/* Done with a file that has no more records. */
+static void
+merge_heap_file_done(merge_heap_t *mh, merge_in_file_t *in_file)
+{
+    if (mh->max_open_files != 0) {
+        close_in_file(in_file);
+        mh->num_open--;
+    }
 }
 
 /** Read the next packet, in chronological order, from the set of files to
@@ -237,8 +501,8 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * On an EOF (meaning all the files are at EOF), set *err to 0 and return
  * NULL.
  *
+ * @param mh merge state
  * @param in_file_count number of entries in in_files
- * @param in_files input file array
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -246,80 +510,97 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * all files
  */
 static merge_in_file_t *
-merge_read_packet(int in_file_count, merge_in_file_t in_files[],
+merge_read_packet(merge_heap_t *mh, guint in_file_count,
                   int *err, gchar **err_info)
 {
-    int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
+    merge_in_file_t *in_file;
+    guint i, idx;
 
-    /*
-     * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
-     */
-    for (i = 0; i < in_file_count; i++) {
-        gint64 data_offset;
+    *err = 0;
 
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec,
-                           &in_files[i].frame_buffer, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
+    if (!mh->primed) {
+        /* Read the first record of every open file. */
+        mh->primed = TRUE;
+        for (i = 0; mh->max_open_files == 0 && i < in_file_count; i++) {
+            if (!read_in_file(&mh->in_files[i], err, err_info)) {
+                if (*err != 0)
+                    return &mh->in_files[i];
+                continue;
+            }
+            merge_heap_push(mh, i);
         }
+    }
 
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
+    if (mh->last) {
+        /*
+         * Replace the record returned last, which was at the top of
+         * the heap, by the next record from the same file.
+         */
+        in_file = mh->last;
+        mh->last = NULL;
+        if (read_in_file(in_file, err, err_info)) {
+            merge_heap_sift_down(mh, 0);
+        } else {
+            if (*err != 0)
+                return in_file;
+            merge_heap_pop(mh);
+            merge_heap_file_done(mh, in_file);
+        }
+    }
+
+    /*
+     * Add the pending files whose first record could go before the
+     * current earliest record, resuming them if they were suspended.  If
+     * that would take us over the limit, the records can't be merged in
+     * chronological order; give up rather than write them out of order.
+     */
+    while (mh->next_pending < mh->pending_len) {
+        idx = mh->pending[mh->next_pending];
+        in_file = &mh->in_files[idx];
+        if (mh->heap_len > 0) {
+            const wtap_rec *top = &mh->in_files[mh->heap[0]].rec;
+
+            if (!merge_ts_before(in_file->first_has_ts, &in_file->first_ts, idx,
+                                 (top->presence_flags & WTAP_HAS_TS) != 0,
+                                 &top->ts, mh->heap[0]))
                 break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
+            if (in_file->suspended && mh->num_open >= mh->max_open_files) {
+                merge_debug("merge_read_packet: %s overlaps %u open files",
+                            in_file->filename, mh->num_open);
+                mh->overlapping = TRUE;
+                return in_file;
             }
         }
+        mh->next_pending++;
+
+        if (in_file->suspended) {
+            merge_debug("merge_read_packet: resuming %s", in_file->filename);
+            if (!resume_in_file(in_file, err, err_info))
+                return in_file;
+            mh->num_open++;
+        }
+        /* Its first record was read by merge_open_in_files(). */
+        merge_heap_push(mh, idx);
     }
 
-    if (ei == -1) {
+    if (mh->heap_len == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
-        *err = 0;
         return NULL;
     }
 
+    in_file = &mh->in_files[mh->heap[0]];
+
     /* We'll need to read another packet from this file. */
-    in_files[ei].state = RECORD_NOT_PRESENT;
+    mh->last = in_file;
 
     /* Count this packet. */
-    in_files[ei].packet_num++;
+    in_file->packet_num++;
 
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
      */
-    *err = 0;
-    return &in_files[ei];
+    return in_file;
 }
 
 /** Read the next packet, in file sequence order, from the set of files
@@ -336,6 +617,8 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param close_at_eof resume each file when we get to it, and close it at
+ * its end
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -344,10 +627,9 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  */
 static merge_in_file_t *
 merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
-                         int *err, gchar **err_info)
+                         gboolean close_at_eof, int *err, gchar **err_info)
 {
     int i;
-    gint64 data_offset;
 
     /*
      * Find the first file not at EOF, and read the next packet from it.
@@ -355,17 +637,20 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     for (i = 0; i < in_file_count; i++) {
         if (in_files[i].state == AT_EOF)
             continue; /* This file is already at EOF */
-        if (wtap_read(in_files[i].wth, &in_files[i].rec,
-                      &in_files[i].frame_buffer, err, err_info,
-                      &data_offset))
+        if (in_files[i].state == RECORD_PRESENT)
+            break; /* Its first packet was read when it was opened */
+        if (in_files[i].suspended &&
+            !resume_in_file(&in_files[i], err, err_info))
+            return &in_files[i];
+        if (read_in_file(&in_files[i], err, err_info))
             break; /* We have a packet */
         if (*err != 0) {
             /* Read error - quit immediately. */
-            in_files[i].state = GOT_ERROR;
             return &in_files[i];
         }
-        /* EOF - flag this file as being at EOF, and try the next one. */
-        in_files[i].state = AT_EOF;
+        /* EOF - this file is at EOF; try the next one. */
+        if (close_at_eof)
+            close_in_file(&in_files[i]);
     }
     if (i == in_file_count) {
         /* All the streams are at EOF.  Return an EOF indication. */
@@ -373,6 +658,9 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
         return NULL;
     }
 
+    /* We'll need to read another packet from this file. */
+    in_files[i].state = RECORD_NOT_PRESENT;
+
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
@@ -381,7 +669,6 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     return &in_files[i];
 }
 
-
 /* creates a section header block for the new output file */
 static GArray*
 create_shb_header(const merge_in_file_t *in_files, const guint in_file_count,
@@ -841,7 +1128,7 @@ static merge_result
 merge_process_packets(wtap_dumper *pdh, const int file_type,
                       merge_in_file_t *in_files, const guint in_file_count,
                       const gboolean do_append, guint snaplen,
-                      merge_progress_callback_t* cb,
+                      merge_progress_callback_t* cb, guint max_open_files,
                       GArray *dsb_combined,
                       int *err, gchar **err_info, guint *err_fileno,
                       guint32 *err_framenum)
@@ -851,17 +1138,20 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     gboolean            stop_flag = FALSE;
     wtap_rec *rec,      snap_rec;
+    merge_heap_t        mh;
+
+    merge_heap_init(&mh, in_files, in_file_count, max_open_files);
 
     for (;;) {
         *err = 0;
 
         if (do_append) {
-            in_file = merge_append_read_packet(in_file_count, in_files, err,
+            in_file = merge_append_read_packet(in_file_count, in_files,
+                                               max_open_files != 0, err,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
-                                        err_info);
+            in_file = merge_read_packet(&mh, in_file_count, err, err_info);
         }
 
         if (in_file == NULL) {
@@ -869,6 +1159,12 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
             break;
         }
 
+        if (mh.overlapping) {
+            /* in_file starts before the max_open_files open files end */
+            status = MERGE_ERR_TOO_MANY_OVERLAPPING_FILES;
+            break;
+        }
+
         if (*err != 0) {
             /* I/O error reading from in_file */
             status = MERGE_ERR_CANT_READ_INFILE;
@@ -929,7 +1225,10 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         if (dsb_combined && in_file->wth->dsbs) {
             GArray *in_dsb = in_file->wth->dsbs;
             for (guint i = in_file->dsbs_seen; i < in_dsb->len; i++) {
-                wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
+                /* Copied, as the input file may be closed before the
+                 * output file. */
+                wtap_block_t wblock = wtap_block_create(WTAP_BLOCK_DSB);
+                wtap_block_copy(wblock, g_array_index(in_dsb, wtap_block_t, i));
                 g_array_append_val(dsb_combined, wblock);
                 in_file->dsbs_seen++;
             }
@@ -960,10 +1259,12 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     }
 
     /* Close the input files after the output file in case the latter still
-     * holds references to blocks in the input file (such as the DSB). Even if
-     * those DSBs are only written when wtap_dump is called and nothing bad will
-     * happen now, let's keep all pointers in pdh valid for correctness sake. */
+     * holds references to blocks in the input file. Even if nothing bad will
+     * happen now, let's keep all pointers in pdh valid for correctness sake.
+     * (The DSBs are copied into dsb_combined, as with max_open_files files
+     * are closed at their end.) */
     merge_close_in_files(in_file_count, in_files);
+    merge_heap_cleanup(&mh);
 
     if (status == MERGE_OK || in_file == NULL) {
         *err_fileno = 0;
@@ -983,6 +1284,7 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
                    const guint in_file_count, const gboolean do_append,
                    const idb_merge_mode mode, guint snaplen,
                    const gchar *app_name, merge_progress_callback_t* cb,
+                   guint max_open_files,
                    int *err, gchar **err_info, guint *err_fileno,
                    guint32 *err_framenum)
 {
@@ -1006,8 +1308,14 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
 
     merge_debug("merge_files: begin");
 
+    if (max_open_files >= in_file_count) {
+        /* We can have them all open at once. */
+        max_open_files = 0;
+    }
+
     /* open the input files */
     if (!merge_open_in_files(in_file_count, in_filenames, &in_files, cb,
+                             max_open_files, do_append,
                              err, err_info, err_fileno)) {
         merge_debug("merge_files: merge_open_in_files() failed with err=%d", *err);
         *err_framenum = 0;
@@ -1062,9 +1370,7 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
         g_free(in_files);
         wtap_block_array_free(shb_hdrs);
         wtap_free_idb_info(idb_inf);
-        if (dsb_combined) {
-            g_array_free(dsb_combined, TRUE);
-        }
+        wtap_block_array_free(dsb_combined);
         *err_framenum = 0;
         return MERGE_ERR_CANT_OPEN_OUTFILE;
     }
@@ -1073,15 +1379,14 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
         cb->callback_func(MERGE_EVENT_READY_TO_MERGE, 0, in_files, in_file_count, cb->data);
 
     status = merge_process_packets(pdh, file_type, in_files, in_file_count,
-                                   do_append, snaplen, cb, dsb_combined, err, err_info,
+                                   do_append, snaplen, cb, max_open_files,
+                                   dsb_combined, err, err_info,
                                    err_fileno, err_framenum);
 
     g_free(in_files);
     wtap_block_array_free(shb_hdrs);
     wtap_free_idb_info(idb_inf);
-    if (dsb_combined) {
-        g_array_free(dsb_combined, TRUE);
-    }
+    wtap_block_array_free(dsb_combined);
 
     return status;
 }
@@ -1096,6 +1401,7 @@ merge_files(const gchar* out_filename, const int file_type,
             const char *const *in_filenames, const guint in_file_count,
             const gboolean do_append, const idb_merge_mode mode,
             guint snaplen, const gchar *app_name, merge_progress_callback_t* cb,
+            guint max_open_files,
             int *err, gchar **err_info, guint *err_fileno,
             guint32 *err_framenum)
 {
@@ -1103,8 +1409,9 @@ merge_files(const gchar* out_filename, const int file_type,
 
     return merge_files_common(out_filename, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
-                              err_info, err_fileno, err_framenum);
+                              do_append, mode, snaplen, app_name, cb,
+                              max_open_files, err, err_info, err_fileno,
+                              err_framenum);
 }
 
 /*
@@ -1118,6 +1425,7 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
                         const guint in_file_count, const gboolean do_append,
                         const idb_merge_mode mode, guint snaplen,
                         const gchar *app_name, merge_progress_callback_t* cb,
+                        guint max_open_files,
                         int *err, gchar **err_info, guint *err_fileno,
                         guint32 *err_framenum)
 {
@@ -1128,8 +1436,9 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
 
     return merge_files_common(NULL, out_filenamep, pfx,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
-                              err_info, err_fileno, err_framenum);
+                              do_append, mode, snaplen, app_name, cb,
+                              max_open_files, err, err_info, err_fileno,
+                              err_framenum);
 }
 
 /*
@@ -1142,13 +1451,15 @@ merge_files_to_stdout(const int file_type, const char *const *in_filenames,
                       const guint in_file_count, const gboolean do_append,
                       const idb_merge_mode mode, guint snaplen,
                       const gchar *app_name, merge_progress_callback_t* cb,
+                      guint max_open_files,
                       int *err, gchar **err_info, guint *err_fileno,
                       guint32 *err_framenum)
 {
     return merge_files_common(NULL, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
-                              err_info, err_fileno, err_framenum);
+                              do_append, mode, snaplen, app_name, cb,
+                              max_open_files, err, err_info, err_fileno,
+                              err_framenum);
 }
 
 /*
@@ -29,7 +29,7 @@ typedef enum {
  */
 typedef struct merge_in_file_s {
     const char     *filename;
-    wtap           *wth;
+    wtap           *wth;            /* NULL once the file has been merged, see max_open_files */
     wtap_rec        rec;
     Buffer          frame_buffer;
     in_file_state_e state;
@@ -37,6 +37,11 @@ typedef struct merge_in_file_s {
     gint64          size;           /* file size */
     GArray         *idb_index_map;  /* used for mapping the old phdr interface_id values to new during merge */
     guint           dsbs_seen;      /* number of elements processed so far from wth->dsbs */
+    int             file_type_subtype; /* file type, recorded when the file is first opened */
+    int             encap;          /* file encapsulation, recorded likewise */
+    gboolean        first_has_ts;   /* whether the first record has a time stamp */
+    nstime_t        first_ts;       /* time stamp of the first record */
+    gboolean        suspended;      /* TRUE while its file descriptor is closed, see max_open_files */
 } merge_in_file_t;
 
 /** Return values from merge_files(). */
@@ -50,7 +55,8 @@ typedef enum {
     MERGE_ERR_BAD_PHDR_INTERFACE_ID,
     MERGE_ERR_CANT_WRITE_OUTFILE,
     MERGE_ERR_CANT_CLOSE_OUTFILE,
-    MERGE_ERR_INVALID_OPTION
+    MERGE_ERR_INVALID_OPTION,
+    MERGE_ERR_TOO_MANY_OVERLAPPING_FILES
 } merge_result;
 
 
@@ -124,6 +130,12 @@ typedef struct {
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
+ * @param max_open_files If non-zero, keep at most this many input files
+ *   open at once. The file descriptors of the others are closed until the
+ *   merge reaches the time stamp of their first record, and files are
+ *   closed at their end. If more than max_open_files inputs overlap in
+ *   time, the merge stops with MERGE_ERR_TOO_MANY_OVERLAPPING_FILES rather
+ *   than write records out of order; ring buffer files don't overlap
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
  *   with MERGE_ERR_CANT_OPEN_INFILE, MERGE_ERR_CANT_OPEN_OUTFILE,
  *   MERGE_ERR_CANT_READ_INFILE, MERGE_ERR_CANT_WRITE_OUTFILE, or
@@ -139,6 +151,7 @@ merge_files(const gchar* out_filename, const int file_type,
             const char *const *in_filenames, const guint in_file_count,
             const gboolean do_append, const idb_merge_mode mode,
             guint snaplen, const gchar *app_name, merge_progress_callback_t* cb,
+            guint max_open_files,
             int *err, gchar **err_info, guint *err_fileno,
             guint32 *err_framenum);
 
@@ -155,6 +168,12 @@ merge_files(const gchar* out_filename, const int file_type,
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
+ * @param max_open_files If non-zero, keep at most this many input files
+ *   open at once. The file descriptors of the others are closed until the
+ *   merge reaches the time stamp of their first record, and files are
+ *   closed at their end. If more than max_open_files inputs overlap in
+ *   time, the merge stops with MERGE_ERR_TOO_MANY_OVERLAPPING_FILES rather
+ *   than write records out of order; ring buffer files don't overlap
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
  *   with MERGE_ERR_CANT_OPEN_INFILE, MERGE_ERR_CANT_OPEN_OUTFILE,
  *   MERGE_ERR_CANT_READ_INFILE, MERGE_ERR_CANT_WRITE_OUTFILE, or
@@ -171,6 +190,7 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
                         const guint in_file_count, const gboolean do_append,
                         const idb_merge_mode mode, guint snaplen,
                         const gchar *app_name, merge_progress_callback_t* cb,
+                        guint max_open_files,
                         int *err, gchar **err_info, guint *err_fileno,
                         guint32 *err_framenum);
 
@@ -184,6 +204,12 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
+ * @param max_open_files If non-zero, keep at most this many input files
+ *   open at once. The file descriptors of the others are closed until the
+ *   merge reaches the time stamp of their first record, and files are
+ *   closed at their end. If more than max_open_files inputs overlap in
+ *   time, the merge stops with MERGE_ERR_TOO_MANY_OVERLAPPING_FILES rather
+ *   than write records out of order; ring buffer files don't overlap
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
  *   with MERGE_ERR_CANT_OPEN_INFILE, MERGE_ERR_CANT_OPEN_OUTFILE,
  *   MERGE_ERR_CANT_READ_INFILE, MERGE_ERR_CANT_WRITE_OUTFILE, or
@@ -199,6 +225,7 @@ merge_files_to_stdout(const int file_type, const char *const *in_filenames,
                       const guint in_file_count, const gboolean do_append,
                       const idb_merge_mode mode, guint snaplen,
                       const gchar *app_name, merge_progress_callback_t* cb,
+                      guint max_open_files,
                       int *err, gchar **err_info, guint *err_fileno,
                       guint32 *err_framenum);
 
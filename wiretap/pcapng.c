@@ -504,6 +504,56 @@ pcapng_read_option(FILE_T fh, pcapng_t *pn, pcapng_option_header_t *oh,
     return block_read;
 }
 
+/*
+ * Like pcapng_read_option(), but for options that have already been read
+ * into memory. The option header is byte-swapped in place if necessary,
+ * and *content is set to point to the option content within opts.
+ */
+static int
+pcapng_parse_option(pcapng_t *pn, guint8 *opts, guint to_read,
+                    pcapng_option_header_t *oh, guint8 **content,
+                    int *err, gchar **err_info, gchar* block_name)
+{
+    guint   block_read;
+    guint   padding;
+
+    /* sanity check: don't run past the end of the block */
+    if (to_read < sizeof (*oh)) {
+        *err = WTAP_ERR_BAD_FILE;
+        *err_info = g_strdup_printf("pcapng_parse_option: Not enough data to read header of the %s block",
+                                    block_name);
+        return -1;
+    }
+
+    memcpy(oh, opts, sizeof (*oh));
+    block_read = sizeof (*oh);
+    if (pn->byte_swapped) {
+        oh->option_code      = GUINT16_SWAP_LE_BE(oh->option_code);
+        oh->option_length    = GUINT16_SWAP_LE_BE(oh->option_length);
+    }
+
+    /* sanity check: don't run past the end of the block */
+    if (to_read < sizeof (*oh) + oh->option_length) {
+        *err = WTAP_ERR_BAD_FILE;
+        *err_info = g_strdup_printf("pcapng_parse_option: Not enough data to handle option length (%d) of the %s block",
+                                    oh->option_length, block_name);
+        return -1;
+    }
+
+    *content = opts + block_read;
+    block_read += oh->option_length;
+
+    /* jump over potential padding bytes at end of option */
+    if ((oh->option_length % 4) != 0) {
+        padding = 4 - (oh->option_length % 4);
+        if (padding > to_read - block_read)
+            padding = to_read - block_read;
+        block_read += padding;
+    }
+
+    return (int)block_read;
+}
+
 typedef enum {
     PCAPNG_BLOCK_OK,
     PCAPNG_BLOCK_NOT_SHB,
@@ -1129,6 +1179,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     interface_info_t iface_info;
     guint64 ts;
     guint8 *opt_ptr;
+    pcapng_option_header_t option_header;
     pcapng_option_header_t *oh;
     guint8 *option_content;
     int pseudo_header_len;
@@ -1309,18 +1360,20 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     wblock->rec->ts.secs = (time_t)(ts / iface_info.time_units_per_second);
     wblock->rec->ts.nsecs = (int)(((ts % iface_info.time_units_per_second) * 1000000000) / iface_info.time_units_per_second);
 
-    /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                packet.cap_len - pseudo_header_len, err, err_info))
+    /*
+     * Read the rest of the block, i.e. the capture data, its padding and
+     * the options, with a single read into the frame buffer. The capture
+     * data is then where the caller expects it, at the start of the
+     * buffer, and the options are parsed in place behind it.
+     */
+    to_read = block_total_length -
+        (int)sizeof(pcapng_block_header_t) -
+        block_read -    /* fixed part and pseudo-header */
+        (int)sizeof(bh->block_total_length);
+    ws_buffer_assure_space(wblock->frame_buffer, to_read);
+    if (!wtap_read_bytes(fh, ws_buffer_start_ptr(wblock->frame_buffer),
+                         to_read, err, err_info))
         return FALSE;
-    block_read += packet.cap_len - pseudo_header_len;
-
-    /* jump over potential padding bytes at end of the packet data */
-    if (padding != 0) {
-        if (!wtap_read_bytes(fh, NULL, padding, err, err_info))
-            return FALSE;
-        block_read += padding;
-    }
 
     /* Option defaults */
     g_free(wblock->rec->opt_comment);   /* Free memory from an earlier read. */
@@ -1337,30 +1390,21 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
      * epb_hash       3
      * epb_dropcount  4
      */
-    to_read = block_total_length -
-        (int)sizeof(pcapng_block_header_t) -
-        block_read -    /* fixed and variable part, including padding */
-        (int)sizeof(bh->block_total_length);
-
-    /* Ensure sufficient temporary memory to hold all options. It is not freed
-     * on return to avoid frequent reallocations. When called for sequential
-     * read (wtap_read), "wblock->rec == &wth->rec" (options_buf will be freed
-     * by wtap_sequential_close). For random access, memory is managed by the
-     * caller of wtap_seek_read. */
+    opt_ptr = ws_buffer_start_ptr(wblock->frame_buffer) +
+        (packet.cap_len - pseudo_header_len) + padding;
+    to_read -= (packet.cap_len - pseudo_header_len) + padding;
     opt_cont_buf_len = to_read;
-    ws_buffer_assure_space(&wblock->rec->options_buf, opt_cont_buf_len);
-    opt_ptr = ws_buffer_start_ptr(&wblock->rec->options_buf);
+    oh = &option_header;
 
     while (to_read != 0) {
-        /* read option */
-        oh = (pcapng_option_header_t *)(void *)opt_ptr;
-        option_content = opt_ptr + sizeof (pcapng_option_header_t);
-        bytes_read = pcapng_read_option(fh, pn, oh, option_content, opt_cont_buf_len, to_read, err, err_info, "packet");
+        /* parse option */
+        bytes_read = pcapng_parse_option(pn, opt_ptr, to_read, oh, &option_content, err, err_info, "packet");
         if (bytes_read <= 0) {
             pcapng_debug("pcapng_read_packet_block: failed to read option");
             /* XXX - free anything? */
             return FALSE;
         }
+        opt_ptr += bytes_read;
         to_read -= bytes_read;
 
         /* handle option content */
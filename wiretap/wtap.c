@@ -1206,12 +1206,6 @@ wtap_sequential_close(wtap *wth)
 	}
 }
 
-static void
-g_fast_seek_item_free(gpointer data, gpointer user_data _U_)
-{
-	g_free(data);
-}
-
 /*
  * Close the file descriptors for the sequential and random streams, but
  * don't discard any information about those streams.  Used on Windows if
@@ -1241,7 +1235,7 @@ wtap_close(wtap *wth)
 	g_free(wth->priv);
 
 	if (wth->fast_seek != NULL) {
-		g_ptr_array_foreach(wth->fast_seek, g_fast_seek_item_free, NULL);
+		file_fast_seek_clear(wth->fast_seek);
 		g_ptr_array_free(wth->fast_seek, TRUE);
 	}
 
@@ -1259,6 +1253,12 @@ wtap_cleareof(wtap *wth) {
 	file_clearerr(wth->fh);
 }
 
+void
+wtap_set_live_ring(wtap *wth, struct ws_shm_ring *ring, guint32 seq)
+{
+	file_set_live_ring(wth->fh, ring, seq);
+}
+
 void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4) {
 	if (wth)
 		wth->add_new_ipv4 = add_new_ipv4;
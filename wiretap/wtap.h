@@ -1742,6 +1742,17 @@ struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err
 WS_DLL_PUBLIC
 void wtap_cleareof(wtap *wth);
 
+/**
+ * While tailing a file being written by a live capture, take the data
+ * from the shared memory ring the capture child also publishes it in,
+ * falling back on the file for anything missing from the ring. seq is
+ * the sequence number of this file within the capture. Pass a NULL ring
+ * to go back to reading only the file.
+ */
+struct ws_shm_ring;
+WS_DLL_PUBLIC
+void wtap_set_live_ring(wtap *wth, struct ws_shm_ring *ring, guint32 seq);
+
 /**
  * Set callback functions to add new hostnames. Currently pcapng-only.
  * MUST match add_ipv4_name and add_ipv6_name in addr_resolv.c.
@@ -1814,7 +1825,8 @@ void wtap_rec_cleanup(wtap_rec *rec);
  */
 typedef enum {
     WTAP_UNCOMPRESSED,
-    WTAP_GZIP_COMPRESSED
+    WTAP_GZIP_COMPRESSED,
+    WTAP_LZ4_COMPRESSED
 } wtap_compression_type;
 
 WS_DLL_PUBLIC
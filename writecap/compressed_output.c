@@ -0,0 +1,373 @@
+/* compressed_output.c
+ * Our own private code for compressing the capture files we write.
+ *
+ * The stdio stream the capture file is written to is opened on a pipe;
+ * a thread reads the other end, compresses what it gets and writes it to
+ * the file. That keeps the pcapio routines unchanged and takes the
+ * compression off the thread doing the capture. Closing the stream ends
+ * the compressed data properly, e.g. when the ring buffer switches to the
+ * next file.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+
+#ifdef HAVE_ZLIB
+#define ZLIB_CONST
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZ4FRAME_H
+#include <lz4frame.h>
+#endif
+
+#include <wsutil/file_util.h>
+
+#include "compressed_output.h"
+
+/* How much we read from the pipe at a time. */
+#define CO_BUFSIZE      (256 * 1024)
+
+/* How much the capture may be ahead of the compressor. */
+#define CO_PIPE_SIZE    (1024 * 1024)
+
+struct compressed_output {
+        output_compression_t type;
+        int             in_fd;          /* read end of the pipe */
+        int             out_fd;         /* the file */
+        GThread        *thread;
+        int             err;            /* first error, 0 if none */
+        guint8         *in;
+        guint8         *out;
+        size_t          out_size;
+#ifdef HAVE_ZLIB
+        z_stream        strm;
+#endif
+#ifdef HAVE_LZ4FRAME_H
+        LZ4F_compressionContext_t lz4;
+        LZ4F_preferences_t lz4_prefs;
+#endif
+};
+
+static const struct {
+        const char *name;
+        const char *extension;
+        output_compression_t type;
+} compression_types[] = {
+#ifdef HAVE_ZLIB
+        { "gzip", "gz", OUTPUT_COMPRESSED_GZIP },
+#endif
+#ifdef HAVE_LZ4FRAME_H
+        { "lz4", "lz4", OUTPUT_COMPRESSED_LZ4 },
+#endif
+        { NULL, NULL, OUTPUT_UNCOMPRESSED }
+};
+
+gboolean
+compressed_output_lookup(const char *name, output_compression_t *type)
+{
+        int i;
+
+        for (i = 0; compression_types[i].name != NULL; i++) {
+                if (g_ascii_strcasecmp(name, compression_types[i].name) == 0) {
+                        *type = compression_types[i].type;
+                        return TRUE;
+                }
+        }
+        return FALSE;
+}
+
+const char *
+compressed_output_names(void)
+{
+        static char *names;
+        int i;
+
+        if (names == NULL) {
+                GString *str = g_string_new("");
+
+                for (i = 0; compression_types[i].name != NULL; i++) {
+                        if (i > 0)
+                                g_string_append(str, ", ");
+                        g_string_append(str, compression_types[i].name);
+                }
+                names = g_string_free(str, FALSE);
+        }
+        return names;
+}
+
+const char *
+compressed_output_extension(output_compression_t type)
+{
+        int i;
+
+        for (i = 0; compression_types[i].name != NULL; i++) {
+                if (compression_types[i].type == type)
+                        return compression_types[i].extension;
+        }
+        return NULL;
+}
+
+/* Write all of a buffer to the file; remember the first error. */
+static void
+write_out(compressed_output *co, const guint8 *data, size_t len)
+{
+        ssize_t nwritten;
+
+        while (len != 0 && co->err == 0) {
+                nwritten = ws_write(co->out_fd, data, (unsigned int)MIN(len, G_MAXINT));
+                if (nwritten < 0) {
+                        if (errno != EINTR)
+                                co->err = errno;
+                } else if (nwritten == 0) {
+                        /* Treat a write that gets nowhere as a full disk. */
+                        co->err = ENOSPC;
+                } else {
+                        data += nwritten;
+                        len -= (size_t)nwritten;
+                }
+        }
+}
+
+static gboolean
+compress_init(compressed_output *co)
+{
+        switch (co->type) {
+
+#ifdef HAVE_ZLIB
+        case OUTPUT_COMPRESSED_GZIP:
+                co->out_size = CO_BUFSIZE;
+                memset(&co->strm, 0, sizeof co->strm);
+                /* 15 + 16: a gzip header and trailer around the deflate data.
+                   Favour speed, so the compressor keeps up with the capture. */
+                if (deflateInit2(&co->strm, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                                 Z_DEFAULT_STRATEGY) != Z_OK) {
+                        co->err = ENOMEM;
+                        return FALSE;
+                }
+                break;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+        case OUTPUT_COMPRESSED_LZ4:
+                memset(&co->lz4_prefs, 0, sizeof co->lz4_prefs);
+                /* Blocks that can be decompressed on their own allow reading
+                   the file at random. */
+                co->lz4_prefs.frameInfo.blockSizeID = LZ4F_max256KB;
+                co->lz4_prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+                co->lz4_prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+                if (LZ4F_isError(LZ4F_createCompressionContext(&co->lz4, LZ4F_VERSION))) {
+                        co->err = ENOMEM;
+                        return FALSE;
+                }
+                /* Room for the frame header and footer too. */
+                co->out_size = LZ4F_compressBound(CO_BUFSIZE, &co->lz4_prefs) + 64;
+                break;
+#endif
+
+        default:
+                co->err = EINVAL;
+                return FALSE;
+        }
+
+        co->in = (guint8 *)g_malloc(CO_BUFSIZE);
+        co->out = (guint8 *)g_malloc(co->out_size);
+
+#ifdef HAVE_LZ4FRAME_H
+        if (co->type == OUTPUT_COMPRESSED_LZ4) {
+                size_t len = LZ4F_compressBegin(co->lz4, co->out, co->out_size,
+                                                &co->lz4_prefs);
+
+                if (LZ4F_isError(len))
+                        co->err = EIO;
+                else
+                        write_out(co, co->out, len);
+        }
+#endif
+        return TRUE;
+}
+
+/* Compress len bytes from co->in; len == 0 ends the compressed data. */
+static void
+compress_data(compressed_output *co, size_t len)
+{
+        switch (co->type) {
+
+#ifdef HAVE_ZLIB
+        case OUTPUT_COMPRESSED_GZIP:
+        {
+                int flush = (len == 0) ? Z_FINISH : Z_NO_FLUSH;
+                int ret;
+
+                co->strm.next_in = co->in;
+                co->strm.avail_in = (uInt)len;
+                do {
+                        co->strm.next_out = co->out;
+                        co->strm.avail_out = (uInt)co->out_size;
+                        ret = deflate(&co->strm, flush);
+                        if (ret == Z_STREAM_ERROR) {
+                                co->err = EIO;
+                                return;
+                        }
+                        write_out(co, co->out, co->out_size - co->strm.avail_out);
+                } while (co->strm.avail_out == 0 ||
+                         (flush == Z_FINISH && ret != Z_STREAM_END));
+                break;
+        }
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+        case OUTPUT_COMPRESSED_LZ4:
+        {
+                size_t produced;
+
+                if (len == 0)
+                        produced = LZ4F_compressEnd(co->lz4, co->out, co->out_size, NULL);
+                else
+                        produced = LZ4F_compressUpdate(co->lz4, co->out, co->out_size,
+                                                       co->in, len, NULL);
+                if (LZ4F_isError(produced)) {
+                        co->err = EIO;
+                        return;
+                }
+                write_out(co, co->out, produced);
+                break;
+        }
+#endif
+
+        default:
+                break;
+        }
+}
+
+static void
+compress_cleanup(compressed_output *co)
+{
+        switch (co->type) {
+
+#ifdef HAVE_ZLIB
+        case OUTPUT_COMPRESSED_GZIP:
+                deflateEnd(&co->strm);
+                break;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+        case OUTPUT_COMPRESSED_LZ4:
+                LZ4F_freeCompressionContext(co->lz4);
+                break;
+#endif
+
+        default:
+                break;
+        }
+        g_free(co->in);
+        g_free(co->out);
+}
+
+static gpointer
+compressor_thread(gpointer data)
+{
+        compressed_output *co = (compressed_output *)data;
+        ssize_t nread;
+
+        for (;;) {
+                nread = ws_read(co->in_fd, co->in, CO_BUFSIZE);
+                if (nread < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        if (co->err == 0)
+                                co->err = errno;
+                        break;
+                }
+                /* After an error, keep draining the pipe so the writer
+                   doesn't block; it hears about the error on close. */
+                if (co->err == 0)
+                        compress_data(co, (size_t)nread);
+                if (nread == 0)
+                        break;
+        }
+
+        ws_close(co->in_fd);
+        if (ws_close(co->out_fd) == -1 && co->err == 0)
+                co->err = errno;
+        return NULL;
+}
+
+compressed_output *
+compressed_output_open(int fd, output_compression_t type, int *in_fd, int *err)
+{
+        compressed_output *co;
+        int fds[2];
+
+#ifdef _WIN32
+        if (_pipe(fds, CO_PIPE_SIZE, _O_BINARY) == -1) {
+#else
+        if (pipe(fds) == -1) {
+#endif
+                *err = errno;
+                return NULL;
+        }
+#ifdef F_SETPIPE_SZ
+        /* Best effort; the default is 64 KiB on Linux. */
+        (void)fcntl(fds[1], F_SETPIPE_SZ, CO_PIPE_SIZE);
+#endif
+
+        co = g_new0(compressed_output, 1);
+        co->type = type;
+        co->in_fd = fds[0];
+        co->out_fd = fd;
+        if (!compress_init(co)) {
+                *err = co->err;
+                ws_close(fds[0]);
+                ws_close(fds[1]);
+                g_free(co);
+                return NULL;
+        }
+        co->thread = g_thread_new("Compress output", compressor_thread, co);
+
+        *in_fd = fds[1];
+        return co;
+}
+
+gboolean
+compressed_output_close(compressed_output *co, int *err)
+{
+        gboolean ok;
+
+        g_thread_join(co->thread);
+        ok = (co->err == 0);
+        if (!ok)
+                *err = co->err;
+        compress_cleanup(co);
+        g_free(co);
+        return ok;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 expandtab:
+ * :indentSize=8:tabSize=8:noTabs=true:
+ */
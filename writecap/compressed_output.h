@@ -0,0 +1,66 @@
+/* compressed_output.h
+ * Declarations of our own routines for compressing the capture files
+ * we write.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __COMPRESSED_OUTPUT_H__
+#define __COMPRESSED_OUTPUT_H__
+
+/** How a capture file gets compressed. */
+typedef enum {
+        OUTPUT_UNCOMPRESSED,
+        OUTPUT_COMPRESSED_GZIP,         /**< gzip, as wiretap reads it */
+        OUTPUT_COMPRESSED_LZ4           /**< LZ4 frame, independent blocks */
+} output_compression_t;
+
+typedef struct compressed_output compressed_output;
+
+/** Look up a compression type by name ("gzip", "lz4").
+   Returns FALSE if it's unknown or not supported by this build. */
+extern gboolean
+compressed_output_lookup(const char *name, output_compression_t *type);
+
+/** The names of the compression types supported by this build, separated
+   by commas. */
+extern const char *
+compressed_output_names(void);
+
+/** The file name extension for a compression type, without the dot, or
+   NULL for OUTPUT_UNCOMPRESSED. */
+extern const char *
+compressed_output_extension(output_compression_t type);
+
+/** Start compressing into fd, which we take over and close if we succeed.
+   The data to compress is written to *in_fd; it's read, compressed and
+   written to fd by a thread of its own, so the writer never waits for the
+   compressor as long as the pipe in between has room.
+   Returns NULL, and sets "*err", on failure. */
+extern compressed_output *
+compressed_output_open(int fd, output_compression_t type, int *in_fd, int *err);
+
+/** Finish the compressed stream once *in_fd has been closed, and close
+   the file. Returns FALSE, and sets "*err" to an errno value, if anything
+   went wrong since compressed_output_open(). */
+extern gboolean
+compressed_output_close(compressed_output *co, int *err);
+
+#endif /* __COMPRESSED_OUTPUT_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 expandtab:
+ * :indentSize=8:tabSize=8:noTabs=true:
+ */
@@ -164,6 +164,14 @@ struct option {
 #define ISB_USRDELIV      8
 #define ADD_PADDING(x) ((((x) + 3) >> 2) << 2)
 
+static pcapio_tee_func write_tee;
+
+void
+pcapio_set_tee(pcapio_tee_func tee)
+{
+        write_tee = tee;
+}
+
 /* Write to capture file */
 static gboolean
 write_to_file(FILE* pfile, const guint8* data, size_t data_length,
@@ -181,6 +189,8 @@ write_to_file(FILE* pfile, const guint8* data, size_t data_length,
                 return FALSE;
         }
 
+        if (write_tee != NULL)
+                write_tee(data, data_length, *bytes_written);
         (*bytes_written) += data_length;
         return TRUE;
 }
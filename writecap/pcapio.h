@@ -13,6 +13,16 @@
 
 /* Writing pcap files */
 
+/** Callback that gets everything the routines below write, along with
+   the number of bytes written to the file before it. */
+typedef void (*pcapio_tee_func)(const guint8 *data, size_t data_length,
+                                guint64 offset);
+
+/** Set the callback that gets a copy of everything written, or NULL
+   for none. */
+extern void
+pcapio_set_tee(pcapio_tee_func tee);
+
 /** Write the file header to a dump file.
    Returns TRUE on success, FALSE on failure.
    Sets "*err" to an error code, or 0 for a short write, on failure*/
@@ -0,0 +1,235 @@
+/* aho_corasick.c
+ * Searching for many byte strings in one pass
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "aho_corasick.h"
+#include "ws_mempbrk.h"
+
+/* ws_mempbrk_exec() can only look for this many bytes with SSE 4.2 */
+#define AC_MAX_START_BYTES  16
+
+struct ws_aho_corasick {
+    GPtrArray          *patterns;       /* GByteArray, until compiled */
+    guint               count;
+    guint8              byte_class[256];
+    guint               n_classes;
+    /*
+     * The transitions, n_classes per state. An entry is the index of the
+     * row of the next state, shifted left by one, with the low bit set if
+     * a pattern ends in that state or at a suffix of it.
+     */
+    guint32            *delta;
+    gboolean            use_mempbrk;
+    ws_mempbrk_pattern  start_bytes;
+};
+
+static void
+free_pattern(gpointer data)
+{
+    g_byte_array_free((GByteArray *)data, TRUE);
+}
+
+ws_aho_corasick *
+ws_aho_corasick_new(void)
+{
+    ws_aho_corasick *ac = g_new0(ws_aho_corasick, 1);
+
+    ac->patterns = g_ptr_array_new_with_free_func(free_pattern);
+    return ac;
+}
+
+void
+ws_aho_corasick_free(ws_aho_corasick *ac)
+{
+    if (ac == NULL)
+        return;
+
+    if (ac->patterns)
+        g_ptr_array_free(ac->patterns, TRUE);
+    g_free(ac->delta);
+    g_free(ac);
+}
+
+void
+ws_aho_corasick_add(ws_aho_corasick *ac, const guint8 *pattern, gsize len)
+{
+    GByteArray *copy;
+
+    g_assert(ac->patterns != NULL);
+
+    copy = g_byte_array_sized_new((guint)len);
+    g_byte_array_append(copy, pattern, (guint)len);
+    g_ptr_array_add(ac->patterns, copy);
+    ac->count++;
+}
+
+guint
+ws_aho_corasick_count(const ws_aho_corasick *ac)
+{
+    return ac->count;
+}
+
+/*
+ * Use ws_mempbrk_exec() to skip the bytes that can't start a pattern if
+ * there are few enough others for SSE 4.2. The needles are a C string, and
+ * ws_mempbrk_compile() only handles ASCII, so neither NUL nor bytes with
+ * the top bit set may start a pattern.
+ */
+static void
+compile_start_bytes(ws_aho_corasick *ac)
+{
+    gchar needles[AC_MAX_START_BYTES + 1];
+    gboolean seen[256];
+    guint n = 0, i;
+    GByteArray *pattern;
+
+    memset(seen, 0, sizeof seen);
+    for (i = 0; i < ac->patterns->len; i++) {
+        pattern = (GByteArray *)g_ptr_array_index(ac->patterns, i);
+        if (pattern->len == 0 || seen[pattern->data[0]])
+            continue;
+        if (pattern->data[0] == 0 || pattern->data[0] >= 0x80 || n == AC_MAX_START_BYTES)
+            return;
+        seen[pattern->data[0]] = TRUE;
+        needles[n++] = (gchar)pattern->data[0];
+    }
+    needles[n] = '\0';
+    if (n == 0)
+        return;
+
+    memset(&ac->start_bytes, 0, sizeof ac->start_bytes);
+    ws_mempbrk_compile(&ac->start_bytes, needles);
+    ac->use_mempbrk = TRUE;
+}
+
+gboolean
+ws_aho_corasick_compile(ws_aho_corasick *ac)
+{
+    GByteArray *pattern;
+    guint8 *match;
+    guint32 *goto_fn, *fail, *queue;
+    guint32 n_states = 1, s, t, head = 0, tail = 0;
+    guint64 max_states = 1;
+    guint i, j, c, nc;
+
+    g_assert(ac->patterns != NULL);
+
+    /* Number the bytes that occur in the patterns; all others are class 0 */
+    ac->n_classes = 1;
+    for (i = 0; i < ac->patterns->len; i++) {
+        pattern = (GByteArray *)g_ptr_array_index(ac->patterns, i);
+        max_states += pattern->len;
+        for (j = 0; j < pattern->len; j++) {
+            if (ac->byte_class[pattern->data[j]] == 0)
+                ac->byte_class[pattern->data[j]] = ac->n_classes++;
+        }
+    }
+    nc = ac->n_classes;
+    if (max_states * nc * 2 > G_MAXUINT32)
+        return FALSE;
+
+    /* The trie of the patterns; 0, the root, is no transition */
+    goto_fn = g_new0(guint32, max_states * nc);
+    match = g_new0(guint8, max_states);
+    for (i = 0; i < ac->patterns->len; i++) {
+        pattern = (GByteArray *)g_ptr_array_index(ac->patterns, i);
+        if (pattern->len == 0)
+            continue;
+        s = 0;
+        for (j = 0; j < pattern->len; j++) {
+            c = ac->byte_class[pattern->data[j]];
+            if (goto_fn[s * nc + c] == 0)
+                goto_fn[s * nc + c] = n_states++;
+            s = goto_fn[s * nc + c];
+        }
+        match[s] = 1;
+    }
+
+    /*
+     * Fill in the missing transitions breadth first: a state without a
+     * transition on c goes where its failure state, the state of its
+     * longest proper suffix in the trie, goes on c. That one is less deep,
+     * so its transitions are complete by then.
+     */
+    fail = g_new0(guint32, n_states);
+    queue = g_new(guint32, n_states);
+    for (c = 0; c < nc; c++) {
+        if (goto_fn[c] != 0)
+            queue[tail++] = goto_fn[c];
+    }
+    while (head < tail) {
+        s = queue[head++];
+        for (c = 0; c < nc; c++) {
+            t = goto_fn[s * nc + c];
+            if (t != 0) {
+                fail[t] = goto_fn[fail[s] * nc + c];
+                match[t] |= match[fail[t]];
+                queue[tail++] = t;
+            } else {
+                goto_fn[s * nc + c] = goto_fn[fail[s] * nc + c];
+            }
+        }
+    }
+
+    ac->delta = g_new(guint32, (gsize)n_states * nc);
+    for (i = 0; i < n_states * nc; i++) {
+        t = goto_fn[i];
+        ac->delta[i] = (t * nc) << 1 | match[t];
+    }
+
+    compile_start_bytes(ac);
+
+    g_free(queue);
+    g_free(fail);
+    g_free(match);
+    g_free(goto_fn);
+    g_ptr_array_free(ac->patterns, TRUE);
+    ac->patterns = NULL;
+    return TRUE;
+}
+
+gboolean
+ws_aho_corasick_search(const ws_aho_corasick *ac, const guint8 *haystack, gsize len)
+{
+    const guint8 *p = haystack;
+    const guint8 *end = haystack + len;
+    guint32 row = 0, next;
+
+    g_assert(ac->delta != NULL);
+
+    while (p < end) {
+        if (row == 0 && ac->use_mempbrk) {
+            p = ws_mempbrk_exec(p, end - p, &ac->start_bytes, NULL);
+            if (p == NULL)
+                return FALSE;
+        }
+        next = ac->delta[row + ac->byte_class[*p++]];
+        if (next & 1)
+            return TRUE;
+        row = next >> 1;
+    }
+    return FALSE;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,77 @@
+/* aho_corasick.h
+ * Searching for many byte strings in one pass
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WSUTIL_AHO_CORASICK_H__
+#define __WSUTIL_AHO_CORASICK_H__
+
+#include "ws_symbol_export.h"
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * An Aho-Corasick automaton over a set of byte strings, compiled into a
+ * deterministic table with one transition per state and byte class (the
+ * bytes that appear in no pattern share a class). Searching a buffer
+ * looks at each byte once, however many patterns there are; while the
+ * automaton is in its start state, ws_mempbrk_exec() skips ahead to the
+ * next byte that can start a pattern.
+ *
+ * Patterns are added first, then the automaton is compiled once and can
+ * be searched, also by several threads at the same time. Empty patterns
+ * never match.
+ */
+
+typedef struct ws_aho_corasick ws_aho_corasick;
+
+WS_DLL_PUBLIC ws_aho_corasick *ws_aho_corasick_new(void);
+
+WS_DLL_PUBLIC void ws_aho_corasick_free(ws_aho_corasick *ac);
+
+/** Adds a copy of the pattern of len bytes; not after compiling. */
+WS_DLL_PUBLIC void ws_aho_corasick_add(ws_aho_corasick *ac, const guint8 *pattern, gsize len);
+
+/**
+ * Builds the automaton from the patterns added so far. Returns FALSE if
+ * it would be too large, in which case it can't be searched.
+ */
+WS_DLL_PUBLIC gboolean ws_aho_corasick_compile(ws_aho_corasick *ac);
+
+/** The number of patterns added. */
+WS_DLL_PUBLIC guint ws_aho_corasick_count(const ws_aho_corasick *ac);
+
+/**
+ * Returns TRUE if any of the patterns occurs in the len bytes of
+ * haystack. The automaton must have been compiled.
+ */
+WS_DLL_PUBLIC gboolean ws_aho_corasick_search(const ws_aho_corasick *ac,
+        const guint8 *haystack, gsize len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WSUTIL_AHO_CORASICK_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,375 @@
+/* dedup.c
+ * Duplicate packet detection over a window of packets or of time
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dedup.h"
+#include "pint.h"
+
+/* A packet in the window, in insertion order. */
+typedef struct {
+    guint64     h1;
+    guint64     h2;
+    guint32     len;
+    nstime_t    ts;
+} dedup_packet;
+
+/*
+ * An entry of the hash set: the packets in the window with the same hash
+ * and length. refs == 0 marks an empty slot.
+ */
+typedef struct {
+    guint64     h1;
+    guint64     h2;
+    guint64     newest;     /* Sequence number of the last such packet */
+    guint32     len;
+    guint32     refs;       /* Number of such packets in the window */
+} dedup_slot;
+
+struct ws_dedup {
+    gboolean        by_time;
+    nstime_t        window;
+    guint           capacity;       /* Maximum number of packets in the window */
+
+    /* Ring of the packets in the window, grown up to capacity. */
+    dedup_packet   *ring;
+    guint           ring_size;      /* Power of two */
+    guint           ring_head;      /* Index of the oldest packet */
+    guint           ring_count;
+    guint64         next_seq;       /* Sequence number of the next packet */
+
+    /* Open-addressed hash set with linear probing. */
+    dedup_slot     *slots;
+    guint           n_slots;        /* Power of two */
+    guint           n_used;
+
+    guint64         last_h1;
+    guint64         last_h2;
+};
+
+#define DEDUP_MIN_SIZE  64
+
+/*
+ * MurmurHash3 x64 128-bit, by Austin Appleby, placed in the public domain.
+ * Input words are read as little-endian so the hash is the same on every
+ * platform.
+ */
+static inline guint64
+dedup_rotl64(guint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64
+dedup_fmix64(guint64 k)
+{
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    return k;
+}
+
+static void
+dedup_hash(const guint8 *data, guint32 len, guint64 *out1, guint64 *out2)
+{
+    const guint64 c1 = G_GUINT64_CONSTANT(0x87c37b91114253d5);
+    const guint64 c2 = G_GUINT64_CONSTANT(0x4cf5ad432745937f);
+    guint64 h1 = 0, h2 = 0;
+    guint64 k1, k2;
+    guint32 nblocks = len / 16;
+    const guint8 *tail;
+
+    for (guint32 i = 0; i < nblocks; i++) {
+        k1 = pletoh64(data + i * 16);
+        k2 = pletoh64(data + i * 16 + 8);
+
+        k1 *= c1; k1 = dedup_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = dedup_rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = dedup_rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = dedup_rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    tail = data + nblocks * 16;
+    k1 = 0;
+    k2 = 0;
+    switch (len & 15) {
+        case 15: k2 ^= (guint64)tail[14] << 48; /* FALLTHROUGH */
+        case 14: k2 ^= (guint64)tail[13] << 40; /* FALLTHROUGH */
+        case 13: k2 ^= (guint64)tail[12] << 32; /* FALLTHROUGH */
+        case 12: k2 ^= (guint64)tail[11] << 24; /* FALLTHROUGH */
+        case 11: k2 ^= (guint64)tail[10] << 16; /* FALLTHROUGH */
+        case 10: k2 ^= (guint64)tail[ 9] << 8;  /* FALLTHROUGH */
+        case  9: k2 ^= (guint64)tail[ 8];
+                 k2 *= c2; k2 = dedup_rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+                 /* FALLTHROUGH */
+        case  8: k1 ^= (guint64)tail[ 7] << 56; /* FALLTHROUGH */
+        case  7: k1 ^= (guint64)tail[ 6] << 48; /* FALLTHROUGH */
+        case  6: k1 ^= (guint64)tail[ 5] << 40; /* FALLTHROUGH */
+        case  5: k1 ^= (guint64)tail[ 4] << 32; /* FALLTHROUGH */
+        case  4: k1 ^= (guint64)tail[ 3] << 24; /* FALLTHROUGH */
+        case  3: k1 ^= (guint64)tail[ 2] << 16; /* FALLTHROUGH */
+        case  2: k1 ^= (guint64)tail[ 1] << 8;  /* FALLTHROUGH */
+        case  1: k1 ^= (guint64)tail[ 0];
+                 k1 *= c1; k1 = dedup_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+                 break;
+        default:
+            break;
+    }
+
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1 = dedup_fmix64(h1);
+    h2 = dedup_fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+
+    *out1 = h1;
+    *out2 = h2;
+}
+
+static ws_dedup *
+dedup_new(guint capacity)
+{
+    ws_dedup *dedup = g_new0(ws_dedup, 1);
+
+    dedup->capacity = capacity;
+    dedup->ring_size = DEDUP_MIN_SIZE;
+    dedup->ring = g_new(dedup_packet, dedup->ring_size);
+    dedup->n_slots = DEDUP_MIN_SIZE;
+    dedup->slots = g_new0(dedup_slot, dedup->n_slots);
+    return dedup;
+}
+
+ws_dedup *
+ws_dedup_new_count(guint window)
+{
+    return dedup_new(window);
+}
+
+ws_dedup *
+ws_dedup_new_time(const nstime_t *window, guint max_packets)
+{
+    ws_dedup *dedup = dedup_new(max_packets);
+
+    dedup->by_time = TRUE;
+    dedup->window = *window;
+    return dedup;
+}
+
+void
+ws_dedup_free(ws_dedup *dedup)
+{
+    if (dedup) {
+        g_free(dedup->ring);
+        g_free(dedup->slots);
+        g_free(dedup);
+    }
+}
+
+/* Returns the slot holding the key, or the empty slot where it belongs. */
+static guint
+dedup_find(const ws_dedup *dedup, guint64 h1, guint64 h2, guint32 len)
+{
+    guint mask = dedup->n_slots - 1;
+    guint idx = (guint)h1 & mask;
+
+    while (dedup->slots[idx].refs != 0) {
+        const dedup_slot *slot = &dedup->slots[idx];
+        if (slot->h1 == h1 && slot->h2 == h2 && slot->len == len) {
+            break;
+        }
+        idx = (idx + 1) & mask;
+    }
+    return idx;
+}
+
+static void
+dedup_grow_slots(ws_dedup *dedup)
+{
+    dedup_slot *old_slots = dedup->slots;
+    guint old_n_slots = dedup->n_slots;
+
+    dedup->n_slots *= 2;
+    dedup->slots = g_new0(dedup_slot, dedup->n_slots);
+    for (guint i = 0; i < old_n_slots; i++) {
+        if (old_slots[i].refs != 0) {
+            guint idx = dedup_find(dedup, old_slots[i].h1, old_slots[i].h2, old_slots[i].len);
+            dedup->slots[idx] = old_slots[i];
+        }
+    }
+    g_free(old_slots);
+}
+
+/* Empties a slot, moving later entries of the probe sequence back into it. */
+static void
+dedup_remove_slot(ws_dedup *dedup, guint idx)
+{
+    guint mask = dedup->n_slots - 1;
+    guint hole = idx;
+    guint next = idx;
+
+    dedup->slots[hole].refs = 0;
+    for (;;) {
+        next = (next + 1) & mask;
+        if (dedup->slots[next].refs == 0) {
+            break;
+        }
+        guint home = (guint)dedup->slots[next].h1 & mask;
+        /* Leave the entry where it is if its home slot lies in (hole, next]. */
+        if (hole <= next ? (hole < home && home <= next) : (hole < home || home <= next)) {
+            continue;
+        }
+        dedup->slots[hole] = dedup->slots[next];
+        dedup->slots[next].refs = 0;
+        hole = next;
+    }
+    dedup->n_used--;
+}
+
+static void
+dedup_evict_oldest(ws_dedup *dedup)
+{
+    const dedup_packet *oldest = &dedup->ring[dedup->ring_head];
+    guint idx = dedup_find(dedup, oldest->h1, oldest->h2, oldest->len);
+
+    if (--dedup->slots[idx].refs == 0) {
+        dedup_remove_slot(dedup, idx);
+    }
+    dedup->ring_head = (dedup->ring_head + 1) & (dedup->ring_size - 1);
+    dedup->ring_count--;
+}
+
+static void
+dedup_grow_ring(ws_dedup *dedup)
+{
+    dedup_packet *ring = g_new(dedup_packet, dedup->ring_size * 2);
+    guint first = dedup->ring_size - dedup->ring_head;
+
+    if (first > dedup->ring_count) {
+        first = dedup->ring_count;
+    }
+    memcpy(ring, dedup->ring + dedup->ring_head, first * sizeof(dedup_packet));
+    memcpy(ring + first, dedup->ring, (dedup->ring_count - first) * sizeof(dedup_packet));
+    g_free(dedup->ring);
+    dedup->ring = ring;
+    dedup->ring_size *= 2;
+    dedup->ring_head = 0;
+}
+
+static const dedup_packet *
+dedup_packet_by_seq(const ws_dedup *dedup, guint64 seq)
+{
+    guint64 oldest_seq = dedup->next_seq - dedup->ring_count;
+
+    return &dedup->ring[(dedup->ring_head + (guint)(seq - oldest_seq)) & (dedup->ring_size - 1)];
+}
+
+gboolean
+ws_dedup_add(ws_dedup *dedup, const guint8 *data, guint32 len, guint32 frame_len, const nstime_t *ts)
+{
+    guint64 h1, h2;
+    gboolean by_time = dedup->by_time && ts != NULL;
+    gboolean duplicate = FALSE;
+    guint idx;
+
+    dedup_hash(data, len, &h1, &h2);
+    dedup->last_h1 = h1;
+    dedup->last_h2 = h2;
+
+    if (dedup->capacity == 0) {
+        return FALSE;
+    }
+
+    /* Drop the packets that fell out of the window. */
+    if (by_time) {
+        while (dedup->ring_count > 0) {
+            nstime_t delta;
+            nstime_delta(&delta, ts, &dedup->ring[dedup->ring_head].ts);
+            if (nstime_cmp(&delta, &dedup->window) <= 0) {
+                break;
+            }
+            dedup_evict_oldest(dedup);
+        }
+    }
+    while (dedup->ring_count >= dedup->capacity) {
+        dedup_evict_oldest(dedup);
+    }
+
+    idx = dedup_find(dedup, h1, h2, frame_len);
+    if (dedup->slots[idx].refs != 0) {
+        if (by_time) {
+            /* Out-of-order packets do not match later ones, like editcap always did. */
+            const dedup_packet *newest = dedup_packet_by_seq(dedup, dedup->slots[idx].newest);
+            nstime_t delta;
+            nstime_delta(&delta, ts, &newest->ts);
+            duplicate = nstime_cmp(ts, &newest->ts) >= 0 && nstime_cmp(&delta, &dedup->window) <= 0;
+        } else {
+            duplicate = TRUE;
+        }
+    }
+
+    /* Add the packet. */
+    if (dedup->ring_count == dedup->ring_size) {
+        dedup_grow_ring(dedup);
+    }
+    dedup_packet *packet = &dedup->ring[(dedup->ring_head + dedup->ring_count) & (dedup->ring_size - 1)];
+    packet->h1 = h1;
+    packet->h2 = h2;
+    packet->len = frame_len;
+    if (ts) {
+        packet->ts = *ts;
+    } else {
+        nstime_set_unset(&packet->ts);
+    }
+    dedup->ring_count++;
+
+    if (dedup->slots[idx].refs == 0) {
+        if ((dedup->n_used + 1) * 4 > dedup->n_slots * 3) {
+            dedup_grow_slots(dedup);
+            idx = dedup_find(dedup, h1, h2, frame_len);
+        }
+        dedup->slots[idx].h1 = h1;
+        dedup->slots[idx].h2 = h2;
+        dedup->slots[idx].len = frame_len;
+        dedup->n_used++;
+    }
+    dedup->slots[idx].refs++;
+    dedup->slots[idx].newest = dedup->next_seq++;
+
+    return duplicate;
+}
+
+void
+ws_dedup_last_hash(const ws_dedup *dedup, guint8 hash[WS_DEDUP_HASH_LEN])
+{
+    for (int i = 0; i < 8; i++) {
+        hash[i] = (guint8)(dedup->last_h1 >> (56 - 8 * i));
+        hash[8 + i] = (guint8)(dedup->last_h2 >> (56 - 8 * i));
+    }
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,83 @@
+/* dedup.h
+ * Duplicate packet detection over a window of packets or of time
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WSUTIL_DEDUP_H__
+#define __WSUTIL_DEDUP_H__
+
+#include "ws_symbol_export.h"
+
+#include <glib.h>
+
+#include <wsutil/nstime.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Packets are identified by a 128-bit non-cryptographic hash of their data
+ * and by their length. The packets in the window are kept in insertion
+ * order for eviction and in a hash set for lookup, so checking a packet
+ * takes constant time whatever the size of the window.
+ */
+
+/** Size of the hash returned by ws_dedup_last_hash(). */
+#define WS_DEDUP_HASH_LEN   16
+
+typedef struct ws_dedup ws_dedup;
+
+/**
+ * Creates a detector for packets that are duplicates of one of the
+ * previous window - 1 packets ("editcap -D window").
+ */
+WS_DLL_PUBLIC ws_dedup *ws_dedup_new_count(guint window);
+
+/**
+ * Creates a detector for packets that are duplicates of a packet seen at
+ * most window earlier ("editcap -w window"). At most max_packets packets
+ * are remembered. Packets are expected in chronological order; a packet
+ * only matches if the last packet with the same contents is not newer.
+ */
+WS_DLL_PUBLIC ws_dedup *ws_dedup_new_time(const nstime_t *window, guint max_packets);
+
+WS_DLL_PUBLIC void ws_dedup_free(ws_dedup *dedup);
+
+/**
+ * Adds a packet to the window and returns TRUE if it is a duplicate of a
+ * packet already in it. The data is hashed, frame_len must also match.
+ * ts is the packet's time stamp, it is ignored by count windows.
+ */
+WS_DLL_PUBLIC gboolean ws_dedup_add(ws_dedup *dedup, const guint8 *data, guint32 len,
+        guint32 frame_len, const nstime_t *ts);
+
+/**
+ * Gets the hash of the packet last passed to ws_dedup_add(), e.g. to
+ * print it.
+ */
+WS_DLL_PUBLIC void ws_dedup_last_hash(const ws_dedup *dedup, guint8 hash[WS_DEDUP_HASH_LEN]);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WSUTIL_DEDUP_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
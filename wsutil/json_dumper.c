@@ -14,6 +14,7 @@
 #include "json_dumper.h"
 
 #include <math.h>
+#include <string.h>
 
 /*
  * json_dumper.state[current_depth] describes a nested element:
@@ -42,11 +43,120 @@ enum json_dumper_change {
     JSON_DUMPER_FINISH,
 };
 
+/*
+ * Output is collected in dumper->buffer and written to the output file in
+ * chunks, see JSON_DUMPER_BUFFER_SIZE.
+ */
+static void
+json_dumper_flush(json_dumper *dumper)
+{
+    if (dumper->buffer_len > 0) {
+        fwrite(dumper->buffer, 1, dumper->buffer_len, dumper->output_file);
+        dumper->buffer_len = 0;
+    }
+}
+
+static void
+json_dumper_write(json_dumper *dumper, const char *data, size_t len)
+{
+    if (len > JSON_DUMPER_BUFFER_SIZE - dumper->buffer_len) {
+        json_dumper_flush(dumper);
+        if (len >= JSON_DUMPER_BUFFER_SIZE) {
+            fwrite(data, 1, len, dumper->output_file);
+            return;
+        }
+    }
+    memcpy(dumper->buffer + dumper->buffer_len, data, len);
+    dumper->buffer_len += len;
+}
+
+static inline void
+json_dumper_putc(json_dumper *dumper, char c)
+{
+    if (dumper->buffer_len == JSON_DUMPER_BUFFER_SIZE) {
+        json_dumper_flush(dumper);
+    }
+    dumper->buffer[dumper->buffer_len++] = c;
+}
+
+static inline void
+json_dumper_puts(json_dumper *dumper, const char *str)
+{
+    json_dumper_write(dumper, str, strlen(str));
+}
+
+static void
+json_dumper_vprintf(json_dumper *dumper, const char *format, va_list ap)
+{
+    va_list ap2;
+    size_t avail = JSON_DUMPER_BUFFER_SIZE - dumper->buffer_len;
+    int len;
+
+    va_copy(ap2, ap);
+    len = vsnprintf(dumper->buffer + dumper->buffer_len, avail, format, ap2);
+    va_end(ap2);
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len < avail) {
+        dumper->buffer_len += len;
+        return;
+    }
+
+    /* Did not fit, vsnprintf truncated it. */
+    json_dumper_flush(dumper);
+    if ((size_t)len < JSON_DUMPER_BUFFER_SIZE) {
+        len = vsnprintf(dumper->buffer, JSON_DUMPER_BUFFER_SIZE, format, ap);
+        dumper->buffer_len = len;
+    } else {
+        vfprintf(dumper->output_file, format, ap);
+    }
+}
+
+/*
+ * Called once a value has been completed. Whole top-level values and whole
+ * elements of a top-level array or object (e.g. a packet in "tshark -T json")
+ * are passed on to the output file, so output does not lag behind by more
+ * than one such element.
+ */
+static inline void
+json_dumper_value_done(json_dumper *dumper)
+{
+    if (dumper->current_depth <= 1) {
+        json_dumper_flush(dumper);
+    }
+}
+
+#define JSON_ONES   G_GUINT64_CONSTANT(0x0101010101010101)
+#define JSON_HIGHS  G_GUINT64_CONSTANT(0x8080808080808080)
+/* Non-zero if any byte of x is zero. */
+#define JSON_HAS_ZERO(x)        (((x) - JSON_ONES) & ~(x) & JSON_HIGHS)
+/* Non-zero if any byte of x is less than n (n <= 128). */
+#define JSON_HAS_LESS(x, n)     (((x) - JSON_ONES * (n)) & ~(x) & JSON_HIGHS)
+/* Non-zero if any byte of x equals c. */
+#define JSON_HAS_BYTE(x, c)     JSON_HAS_ZERO((x) ^ (JSON_ONES * (guint8)(c)))
+
+/*
+ * Checks eight characters at once for anything that might need escaping:
+ * control characters, '"', '\\', '/' (only after '<') and, when converting
+ * keys, '.'.
+ */
+static inline gboolean
+json_word_needs_escape(guint64 w, gboolean dot_to_underscore)
+{
+    guint64 hit = JSON_HAS_LESS(w, 0x20) | JSON_HAS_BYTE(w, '"') |
+                  JSON_HAS_BYTE(w, '\\') | JSON_HAS_BYTE(w, '/');
+    if (dot_to_underscore) {
+        hit |= JSON_HAS_BYTE(w, '.');
+    }
+    return hit != 0;
+}
+
 static void
-json_puts_string(FILE *fp, const char *str, gboolean dot_to_underscore)
+json_puts_string(json_dumper *dumper, const char *str, gboolean dot_to_underscore)
 {
     if (!str) {
-        fputs("null", fp);
+        json_dumper_write(dumper, "null", 4);
         return;
     }
 
@@ -55,25 +165,50 @@ json_puts_string(FILE *fp, const char *str, gboolean dot_to_underscore)
         "u0010", "u0011", "u0012", "u0013", "u0014", "u0015", "u0016", "u0017", "u0018", "u0019", "u001a", "u001b", "u001c", "u001d", "u001e", "u001f"
     };
 
-    fputc('"', fp);
-    for (int i = 0; str[i]; i++) {
-        if ((guint)str[i] < 0x20) {
-            fputc('\\', fp);
-            fputs(json_cntrl[(guint)str[i]], fp);
-        } else if (i > 0 && str[i - 1] == '<' && str[i] == '/') {
-            // Convert </script> to <\/script> to avoid breaking web pages.
-            fputs("\\/", fp);
-        } else {
-            if (str[i] == '\\' || str[i] == '"') {
-                fputc('\\', fp);
+    size_t len = strlen(str);
+    size_t span_start = 0;
+    size_t i = 0;
+
+    json_dumper_putc(dumper, '"');
+    while (i < len) {
+        /* Skip over plain characters, eight at a time. */
+        while (i + 8 <= len) {
+            guint64 w;
+            memcpy(&w, str + i, sizeof(w));
+            if (json_word_needs_escape(w, dot_to_underscore)) {
+                break;
             }
-            if (dot_to_underscore && str[i] == '.')
-                fputc('_', fp);
-            else
-                fputc(str[i], fp);
+            i += 8;
+        }
+        if (i >= len) {
+            break;
+        }
+
+        guint8 c = (guint8)str[i];
+        if (c < 0x20) {
+            json_dumper_write(dumper, str + span_start, i - span_start);
+            json_dumper_putc(dumper, '\\');
+            json_dumper_puts(dumper, json_cntrl[c]);
+            span_start = i + 1;
+        } else if (c == '/' && i > 0 && str[i - 1] == '<') {
+            // Convert </script> to <\/script> to avoid breaking web pages.
+            json_dumper_write(dumper, str + span_start, i - span_start);
+            json_dumper_write(dumper, "\\/", 2);
+            span_start = i + 1;
+        } else if (c == '\\' || c == '"') {
+            json_dumper_write(dumper, str + span_start, i - span_start);
+            json_dumper_putc(dumper, '\\');
+            json_dumper_putc(dumper, c);
+            span_start = i + 1;
+        } else if (dot_to_underscore && c == '.') {
+            json_dumper_write(dumper, str + span_start, i - span_start);
+            json_dumper_putc(dumper, '_');
+            span_start = i + 1;
         }
+        i++;
     }
-    fputc('"', fp);
+    json_dumper_write(dumper, str + span_start, len - span_start);
+    json_dumper_putc(dumper, '"');
 }
 
 /**
@@ -100,6 +235,7 @@ json_dumper_bad(json_dumper *dumper, enum json_dumper_change change,
         /* Console output can be slow, disable log calls to speed up fuzzing. */
         return;
     }
+    json_dumper_flush(dumper);
     fflush(dumper->output_file);
     g_error("Bad json_dumper state: %s; change=%d type=%d depth=%d prev/curr/next state=%02x %02x %02x",
             what, change, type, dumper->current_depth, states[0], states[1], states[2]);
@@ -167,12 +303,12 @@ json_dumper_check_state(json_dumper *dumper, enum json_dumper_change change, enu
 }
 
 static void
-print_newline_indent(const json_dumper *dumper, int depth)
+print_newline_indent(json_dumper *dumper, int depth)
 {
     if ((dumper->flags & JSON_DUMPER_FLAGS_PRETTY_PRINT)) {
-        fputc('\n', dumper->output_file);
+        json_dumper_putc(dumper, '\n');
         for (int i = 0; i < depth; i++) {
-            fputs("  ", dumper->output_file);
+            json_dumper_write(dumper, "  ", 2);
         }
     }
 }
@@ -208,7 +344,7 @@ prepare_token(json_dumper *dumper)
     }
 
     if (dumper->state[dumper->current_depth]) {
-        fputc(',', dumper->output_file);
+        json_dumper_putc(dumper, ',');
     }
     print_newline_indent(dumper, dumper->current_depth);
 }
@@ -218,13 +354,13 @@ prepare_token(json_dumper *dumper)
  * necessary, it is preceded by newline and indentation).
  */
 static void
-finish_token(const json_dumper *dumper, char close_char)
+finish_token(json_dumper *dumper, char close_char)
 {
     // if the object/array was non-empty, add a newline and indentation.
     if (dumper->state[dumper->current_depth]) {
         print_newline_indent(dumper, dumper->current_depth - 1);
     }
-    fputc(close_char, dumper->output_file);
+    json_dumper_putc(dumper, close_char);
 }
 
 void
@@ -235,7 +371,7 @@ json_dumper_begin_object(json_dumper *dumper)
     }
 
     prepare_token(dumper);
-    fputc('{', dumper->output_file);
+    json_dumper_putc(dumper, '{');
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_OBJECT;
     ++dumper->current_depth;
@@ -250,10 +386,10 @@ json_dumper_set_member_name(json_dumper *dumper, const char *name)
     }
 
     prepare_token(dumper);
-    json_puts_string(dumper->output_file, name, dumper->flags & JSON_DUMPER_DOT_TO_UNDERSCORE);
-    fputc(':', dumper->output_file);
+    json_puts_string(dumper, name, dumper->flags & JSON_DUMPER_DOT_TO_UNDERSCORE);
+    json_dumper_putc(dumper, ':');
     if ((dumper->flags & JSON_DUMPER_FLAGS_PRETTY_PRINT)) {
-        fputc(' ', dumper->output_file);
+        json_dumper_putc(dumper, ' ');
     }
 
     dumper->state[dumper->current_depth - 1] |= JSON_DUMPER_HAS_NAME;
@@ -269,6 +405,7 @@ json_dumper_end_object(json_dumper *dumper)
     finish_token(dumper, '}');
 
     --dumper->current_depth;
+    json_dumper_value_done(dumper);
 }
 
 void
@@ -279,7 +416,7 @@ json_dumper_begin_array(json_dumper *dumper)
     }
 
     prepare_token(dumper);
-    fputc('[', dumper->output_file);
+    json_dumper_putc(dumper, '[');
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_ARRAY;
     ++dumper->current_depth;
@@ -296,6 +433,7 @@ json_dumper_end_array(json_dumper *dumper)
     finish_token(dumper, ']');
 
     --dumper->current_depth;
+    json_dumper_value_done(dumper);
 }
 
 void
@@ -306,9 +444,10 @@ json_dumper_value_string(json_dumper *dumper, const char *value)
     }
 
     prepare_token(dumper);
-    json_puts_string(dumper->output_file, value, FALSE);
+    json_puts_string(dumper, value, FALSE);
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
+    json_dumper_value_done(dumper);
 }
 
 void
@@ -321,12 +460,13 @@ json_dumper_value_double(json_dumper *dumper, double value)
     prepare_token(dumper);
     gchar buffer[G_ASCII_DTOSTR_BUF_SIZE] = { 0 };
     if (isfinite(value) && g_ascii_dtostr(buffer, G_ASCII_DTOSTR_BUF_SIZE, value) && buffer[0]) {
-        fputs(buffer, dumper->output_file);
+        json_dumper_puts(dumper, buffer);
     } else {
-        fputs("null", dumper->output_file);
+        json_dumper_write(dumper, "null", 4);
     }
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
+    json_dumper_value_done(dumper);
 }
 
 void
@@ -337,9 +477,10 @@ json_dumper_value_va_list(json_dumper *dumper, const char *format, va_list ap)
     }
 
     prepare_token(dumper);
-    vfprintf(dumper->output_file, format, ap);
+    json_dumper_vprintf(dumper, format, ap);
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
+    json_dumper_value_done(dumper);
 }
 
 void
@@ -359,7 +500,8 @@ json_dumper_finish(json_dumper *dumper)
         return FALSE;
     }
 
-    fputc('\n', dumper->output_file);
+    json_dumper_putc(dumper, '\n');
+    json_dumper_flush(dumper);
     dumper->state[0] = 0;
     return TRUE;
 }
@@ -376,7 +518,7 @@ json_dumper_begin_base64(json_dumper *dumper)
 
     prepare_token(dumper);
 
-    fputc('"', dumper->output_file);
+    json_dumper_putc(dumper, '"');
 
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_BASE64;
     ++dumper->current_depth;
@@ -396,7 +538,7 @@ json_dumper_write_base64(json_dumper* dumper, const guchar *data, size_t len)
     while (len > 0) {
         gsize chunk_size = len < CHUNK_SIZE ? len : CHUNK_SIZE;
         gsize output_size = g_base64_encode_step(data, chunk_size, FALSE, buf, &dumper->base64_state, &dumper->base64_save);
-        fwrite(buf, 1, output_size, dumper->output_file);
+        json_dumper_write(dumper, buf, output_size);
         data += chunk_size;
         len -= chunk_size;
     }
@@ -415,9 +557,10 @@ json_dumper_end_base64(json_dumper *dumper)
     gsize wrote;
 
     wrote = g_base64_encode_close(FALSE, buf, &dumper->base64_state, &dumper->base64_save);
-    fwrite(buf, 1, wrote, dumper->output_file);
+    json_dumper_write(dumper, buf, wrote);
 
-    fputc('"', dumper->output_file);
+    json_dumper_putc(dumper, '"');
 
     --dumper->current_depth;
+    json_dumper_value_done(dumper);
 }
@@ -50,6 +50,13 @@ extern "C" {
 
 /** Maximum object/array nesting depth. */
 #define JSON_DUMPER_MAX_DEPTH   1100
+/**
+ * Size of the output buffer. Output is collected there and written to
+ * output_file when the buffer is full, when a top-level value or an
+ * element of a top-level array or object is complete, and on
+ * json_dumper_finish().
+ */
+#define JSON_DUMPER_BUFFER_SIZE 8192
 typedef struct json_dumper {
     FILE   *output_file;    /**< Output file, must be set. */
 #define JSON_DUMPER_FLAGS_PRETTY_PRINT  (1 << 0)    /* Enable pretty printing. */
@@ -60,6 +67,8 @@ typedef struct json_dumper {
     gint    base64_state;
     gint    base64_save;
     guint8  state[JSON_DUMPER_MAX_DEPTH];
+    size_t  buffer_len;
+    char    buffer[JSON_DUMPER_BUFFER_SIZE];
 } json_dumper;
 
 WS_DLL_PUBLIC void
@@ -0,0 +1,260 @@
+/* lpm_trie.c
+ * Longest prefix match over IPv4 and IPv6 prefixes
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "lpm_trie.h"
+
+#define LPM_MAX_BYTES   16
+
+/*
+ * A node of the trie. Its prefix extends that of its parent by at least
+ * one bit; the first bit after the parent's prefix selects the child.
+ * Nodes without a value are the root and branches, which always have two
+ * children.
+ */
+typedef struct {
+    guint8      key[LPM_MAX_BYTES];     /* The prefix, zero past bit_len */
+    guint32     child[2];               /* Indexes in nodes; 0 (the root) is none */
+    gpointer    value;
+    guint       bit_len;
+} lpm_node;
+
+struct ws_lpm_trie {
+    GArray         *nodes;              /* lpm_node, the root first */
+    guint           max_bits;
+    guint           count;
+    GDestroyNotify  value_free;
+};
+
+static inline guint
+key_bit(const guint8 *key, guint bit)
+{
+    return (key[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+/* Does key start with the first bit_len bits of prefix? */
+static inline gboolean
+key_has_prefix(const guint8 *key, const guint8 *prefix, guint bit_len)
+{
+    guint bytes = bit_len >> 3;
+    guint bits = bit_len & 7;
+
+    if (memcmp(key, prefix, bytes) != 0)
+        return FALSE;
+    return bits == 0 || ((key[bytes] ^ prefix[bytes]) & (0xff00 >> bits)) == 0;
+}
+
+/* The number of leading bits, at most max_len, a and b have in common. */
+static guint
+common_prefix_len(const guint8 *a, const guint8 *b, guint max_len)
+{
+    guint len = 0;
+    guint8 diff;
+
+    while (len < max_len) {
+        diff = a[len >> 3] ^ b[len >> 3];
+        if (diff != 0) {
+            while (!(diff & 0x80)) {
+                diff <<= 1;
+                len++;
+            }
+            break;
+        }
+        len += 8;
+    }
+    return MIN(len, max_len);
+}
+
+static guint32
+add_node(ws_lpm_trie *trie, const guint8 *prefix, guint bit_len, gpointer value)
+{
+    lpm_node node;
+    guint bytes = (bit_len + 7) >> 3;
+
+    memset(&node, 0, sizeof node);
+    memcpy(node.key, prefix, bytes);
+    if (bit_len & 7)
+        node.key[bytes - 1] &= (guint8)(0xff00 >> (bit_len & 7));
+    node.bit_len = bit_len;
+    node.value = value;
+    g_array_append_val(trie->nodes, node);
+    return trie->nodes->len - 1;
+}
+
+#define NODE(trie, idx) (&g_array_index((trie)->nodes, lpm_node, (idx)))
+
+ws_lpm_trie *
+ws_lpm_trie_new(guint max_bits, GDestroyNotify value_free)
+{
+    ws_lpm_trie *trie;
+    static const guint8 root_key[LPM_MAX_BYTES];
+
+    g_assert(max_bits > 0 && max_bits <= LPM_MAX_BYTES * 8);
+
+    trie = g_new(ws_lpm_trie, 1);
+    trie->nodes = g_array_new(FALSE, FALSE, sizeof(lpm_node));
+    trie->max_bits = max_bits;
+    trie->count = 0;
+    trie->value_free = value_free;
+    add_node(trie, root_key, 0, NULL);
+    return trie;
+}
+
+void
+ws_lpm_trie_free(ws_lpm_trie *trie)
+{
+    guint i;
+
+    if (trie == NULL)
+        return;
+
+    if (trie->value_free) {
+        for (i = 0; i < trie->nodes->len; i++) {
+            if (NODE(trie, i)->value)
+                trie->value_free(NODE(trie, i)->value);
+        }
+    }
+    g_array_free(trie->nodes, TRUE);
+    g_free(trie);
+}
+
+guint
+ws_lpm_trie_count(const ws_lpm_trie *trie)
+{
+    return trie ? trie->count : 0;
+}
+
+gboolean
+ws_lpm_trie_insert(ws_lpm_trie *trie, const guint8 *prefix, guint prefix_len, gpointer value)
+{
+    guint32 idx = 0, child, added, branch;
+    guint bit, cpl;
+    lpm_node *node;
+
+    g_assert(prefix_len <= trie->max_bits && value != NULL);
+
+    for (;;) {
+        /* The node's prefix is a prefix of the new one. */
+        node = NODE(trie, idx);
+        if (node->bit_len == prefix_len) {
+            if (node->value)
+                return FALSE;
+            node->value = value;
+            trie->count++;
+            return TRUE;
+        }
+
+        bit = key_bit(prefix, node->bit_len);
+        child = node->child[bit];
+        if (child == 0) {
+            added = add_node(trie, prefix, prefix_len, value);
+            NODE(trie, idx)->child[bit] = added;
+            trie->count++;
+            return TRUE;
+        }
+
+        node = NODE(trie, child);
+        cpl = common_prefix_len(node->key, prefix, MIN(node->bit_len, prefix_len));
+        if (cpl == node->bit_len) {
+            idx = child;
+            continue;
+        }
+
+        /* The new prefix goes between idx and its child. */
+        if (cpl == prefix_len) {
+            added = add_node(trie, prefix, prefix_len, value);
+            NODE(trie, added)->child[key_bit(NODE(trie, child)->key, prefix_len)] = child;
+            NODE(trie, idx)->child[bit] = added;
+        } else {
+            /* They part after cpl bits; add a branch there. */
+            branch = add_node(trie, prefix, cpl, NULL);
+            added = add_node(trie, prefix, prefix_len, value);
+            NODE(trie, branch)->child[key_bit(prefix, cpl)] = added;
+            NODE(trie, branch)->child[key_bit(NODE(trie, child)->key, cpl)] = child;
+            NODE(trie, idx)->child[bit] = branch;
+        }
+        trie->count++;
+        return TRUE;
+    }
+}
+
+gpointer
+ws_lpm_trie_lookup(const ws_lpm_trie *trie, const guint8 *addr, guint *prefix_len)
+{
+    const lpm_node *node, *best = NULL;
+    guint32 idx;
+
+    if (trie == NULL || trie->count == 0)
+        return NULL;
+
+    node = NODE(trie, 0);
+    for (;;) {
+        if (node->value)
+            best = node;
+        if (node->bit_len == trie->max_bits)
+            break;
+        idx = node->child[key_bit(addr, node->bit_len)];
+        if (idx == 0)
+            break;
+        node = NODE(trie, idx);
+        /* Check the bits skipped by the path compression. */
+        if (!key_has_prefix(addr, node->key, node->bit_len))
+            break;
+    }
+
+    if (best == NULL)
+        return NULL;
+    if (prefix_len)
+        *prefix_len = best->bit_len;
+    return best->value;
+}
+
+gboolean
+ws_lpm_trie_overlaps(const ws_lpm_trie *trie, const guint8 *prefix, guint prefix_len)
+{
+    const lpm_node *node;
+    guint32 idx;
+
+    if (trie == NULL || trie->count == 0)
+        return FALSE;
+
+    node = NODE(trie, 0);
+    for (;;) {
+        /*
+         * Once the node's prefix is at least as long as the one we look
+         * for, everything below it starts with that one, and as branches
+         * have two children, there is a value down there.
+         */
+        if (node->value || node->bit_len >= prefix_len)
+            return TRUE;
+        idx = node->child[key_bit(prefix, node->bit_len)];
+        if (idx == 0)
+            return FALSE;
+        node = NODE(trie, idx);
+        if (!key_has_prefix(prefix, node->key, MIN(node->bit_len, prefix_len)))
+            return FALSE;
+    }
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,89 @@
+/* lpm_trie.h
+ * Longest prefix match over IPv4 and IPv6 prefixes
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WSUTIL_LPM_TRIE_H__
+#define __WSUTIL_LPM_TRIE_H__
+
+#include "ws_symbol_export.h"
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A path-compressed binary trie of prefixes of up to 128 bits. Chains of
+ * nodes with a single child are collapsed, so there is at most one node
+ * per stored prefix plus one per branch, and a lookup is a single walk
+ * from the root that remembers the last prefix matched on the way down.
+ *
+ * Keys are byte strings in network byte order, i.e. an IPv4 or IPv6
+ * address as it appears on the wire. Bits past the prefix length are
+ * ignored. The functions that only read the trie accept NULL as an empty
+ * trie.
+ */
+
+typedef struct ws_lpm_trie ws_lpm_trie;
+
+/**
+ * Creates an empty trie of prefixes of at most max_bits (32 or 128) bits.
+ * value_free, if not NULL, is called for the values when the trie is
+ * freed.
+ */
+WS_DLL_PUBLIC ws_lpm_trie *ws_lpm_trie_new(guint max_bits, GDestroyNotify value_free);
+
+WS_DLL_PUBLIC void ws_lpm_trie_free(ws_lpm_trie *trie);
+
+/** The number of prefixes in the trie. */
+WS_DLL_PUBLIC guint ws_lpm_trie_count(const ws_lpm_trie *trie);
+
+/**
+ * Adds the prefix of prefix_len bits of prefix, with a value that must not
+ * be NULL. If the prefix is already in the trie, it keeps its value and
+ * FALSE is returned; the caller still owns value then.
+ */
+WS_DLL_PUBLIC gboolean ws_lpm_trie_insert(ws_lpm_trie *trie, const guint8 *prefix,
+        guint prefix_len, gpointer value);
+
+/**
+ * Finds the longest prefix in the trie that addr, a key of max_bits bits,
+ * starts with. Returns its value and, if prefix_len is not NULL, sets
+ * *prefix_len to its length. Returns NULL if there is no such prefix.
+ */
+WS_DLL_PUBLIC gpointer ws_lpm_trie_lookup(const ws_lpm_trie *trie, const guint8 *addr,
+        guint *prefix_len);
+
+/**
+ * Returns TRUE if the prefix of prefix_len bits of prefix and some prefix
+ * in the trie have an address in common, i.e. if one of them is a prefix
+ * of the other.
+ */
+WS_DLL_PUBLIC gboolean ws_lpm_trie_overlaps(const ws_lpm_trie *trie, const guint8 *prefix,
+        guint prefix_len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WSUTIL_LPM_TRIE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
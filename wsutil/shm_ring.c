@@ -0,0 +1,388 @@
+/* shm_ring.c
+ * Single-producer, single-consumer ring buffer in shared memory
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wsutil/unicode-utils.h>
+#include <wsutil/win32-utils.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW 0
+#endif
+#endif
+
+#include "shm_ring.h"
+#include <wsutil/file_util.h>
+
+#define SHM_RING_MAGIC      0x57535252  /* "WSRR" */
+
+/*
+ * Every failure to attach gets the same message, so that it doesn't tell
+ * whether a file of that name exists.
+ */
+#define SHM_RING_ATTACH_ERR(name) \
+    g_strdup_printf("Can't attach to capture ring \"%s\"", (name))
+
+/* Keep what each side writes in a cache line of its own. */
+#define SHM_RING_LINE       64
+
+/*
+ * The start of the shared memory. head and tail are free-running byte
+ * counts; the data area is a power of two in size, so they are turned into
+ * offsets by masking and their difference is the amount of data in use,
+ * even after they wrap around.
+ */
+typedef struct {
+    guint32 magic;
+    guint32 size;                   /* size of the data area */
+    guint8  pad0[SHM_RING_LINE - 2 * sizeof(guint32)];
+    gint    head;                   /* written by the producer only */
+    guint8  pad1[SHM_RING_LINE - sizeof(gint)];
+    gint    tail;                   /* written by the consumer only */
+    guint8  pad2[SHM_RING_LINE - sizeof(gint)];
+    guint64 overrun_records;        /* written by the producer only */
+    guint64 overrun_bytes;
+    guint8  pad3[SHM_RING_LINE - 2 * sizeof(guint64)];
+} shm_ring_header;
+
+/* Header of each record; records start on 8-byte boundaries. */
+typedef struct {
+    guint32 seq;
+    guint32 len;
+    guint64 offset;
+} shm_ring_record;
+
+#define SHM_RING_RECORD_SPACE(len) \
+    (((guint32)sizeof(shm_ring_record) + (len) + 7U) & ~7U)
+
+struct ws_shm_ring {
+    shm_ring_header *hdr;
+    guint8          *data;
+    guint32          size;
+    guint32          mask;
+    size_t           map_size;
+    gchar           *name;
+    gboolean         owner;         /* we created it, and remove it */
+#ifdef _WIN32
+    HANDLE           mapping;
+#else
+    int              fd;
+#endif
+};
+
+static void
+ring_write(ws_shm_ring *ring, guint32 pos, const void *src, guint32 len)
+{
+    guint32 off = pos & ring->mask;
+    guint32 first = MIN(len, ring->size - off);
+
+    memcpy(ring->data + off, src, first);
+    memcpy(ring->data, (const guint8 *)src + first, len - first);
+}
+
+static void
+ring_read(const ws_shm_ring *ring, guint32 pos, void *dst, guint32 len)
+{
+    guint32 off = pos & ring->mask;
+    guint32 first = MIN(len, ring->size - off);
+
+    memcpy(dst, ring->data + off, first);
+    memcpy((guint8 *)dst + first, ring->data, len - first);
+}
+
+static gboolean
+ring_map(ws_shm_ring *ring, gboolean create, gchar **err_str)
+{
+#ifdef _WIN32
+    void *view;
+
+    if (create) {
+        static guint counter;
+
+        ring->name = g_strdup_printf("Local\\wireshark_ring_%lu_%u",
+                                     GetCurrentProcessId(), counter++);
+        ring->mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL,
+                                          PAGE_READWRITE, 0, (DWORD)ring->map_size,
+                                          utf_8to16(ring->name));
+        if (ring->mapping == NULL) {
+            *err_str = g_strdup_printf("Can't open shared memory \"%s\": %s",
+                                       ring->name, win32strerror(GetLastError()));
+            return FALSE;
+        }
+    } else {
+        ring->mapping = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE,
+                                        utf_8to16(ring->name));
+        if (ring->mapping == NULL) {
+            *err_str = SHM_RING_ATTACH_ERR(ring->name);
+            return FALSE;
+        }
+    }
+    view = MapViewOfFile(ring->mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (view == NULL) {
+        if (create)
+            *err_str = g_strdup_printf("Can't map shared memory \"%s\": %s",
+                                       ring->name, win32strerror(GetLastError()));
+        else
+            *err_str = SHM_RING_ATTACH_ERR(ring->name);
+        CloseHandle(ring->mapping);
+        return FALSE;
+    }
+    ring->hdr = (shm_ring_header *)view;
+#else
+    void *addr;
+
+    if (create) {
+        /*
+         * Prefer a memory file system, so the ring never gets written
+         * back to disk.
+         */
+        const char *dir = g_file_test("/dev/shm", G_FILE_TEST_IS_DIR) ?
+            "/dev/shm" : g_get_tmp_dir();
+
+        ring->name = g_build_filename(dir, "wireshark_ring_XXXXXX", NULL);
+        ring->fd = g_mkstemp_full(ring->name, O_RDWR, 0600);
+        if (ring->fd == -1) {
+            *err_str = g_strdup_printf("Can't create \"%s\": %s",
+                                       ring->name, g_strerror(errno));
+            return FALSE;
+        }
+        if (ftruncate(ring->fd, (off_t)ring->map_size) == -1) {
+            *err_str = g_strdup_printf("Can't size \"%s\": %s",
+                                       ring->name, g_strerror(errno));
+            ws_close(ring->fd);
+            ws_unlink(ring->name);
+            return FALSE;
+        }
+    } else {
+        ws_statb64 statb;
+
+        /*
+         * Only attach to a regular file of our real user, and never
+         * follow a symbolic link to one.
+         */
+        ring->fd = ws_open(ring->name, O_RDWR|O_NOFOLLOW, 0);
+        if (ring->fd == -1) {
+            *err_str = SHM_RING_ATTACH_ERR(ring->name);
+            return FALSE;
+        }
+        if (ws_fstat64(ring->fd, &statb) == -1 ||
+            !S_ISREG(statb.st_mode) || statb.st_uid != getuid() ||
+            (size_t)statb.st_size < sizeof(shm_ring_header)) {
+            *err_str = SHM_RING_ATTACH_ERR(ring->name);
+            ws_close(ring->fd);
+            return FALSE;
+        }
+        ring->map_size = (size_t)statb.st_size;
+    }
+    addr = mmap(NULL, ring->map_size, PROT_READ|PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    if (addr == MAP_FAILED) {
+        if (create)
+            *err_str = g_strdup_printf("Can't map \"%s\": %s",
+                                       ring->name, g_strerror(errno));
+        else
+            *err_str = SHM_RING_ATTACH_ERR(ring->name);
+        ws_close(ring->fd);
+        if (create)
+            ws_unlink(ring->name);
+        return FALSE;
+    }
+    ring->hdr = (shm_ring_header *)addr;
+#endif
+    ring->data = (guint8 *)ring->hdr + sizeof(shm_ring_header);
+    return TRUE;
+}
+
+static void
+ring_unmap(ws_shm_ring *ring)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(ring->hdr);
+    CloseHandle(ring->mapping);
+#else
+    munmap(ring->hdr, ring->map_size);
+    ws_close(ring->fd);
+    if (ring->owner)
+        ws_unlink(ring->name);
+#endif
+}
+
+ws_shm_ring *
+ws_shm_ring_create(guint32 size, gchar **err_str)
+{
+    ws_shm_ring *ring;
+    guint32 pow2 = WS_SHM_RING_MIN_SIZE;
+
+    size = CLAMP(size, WS_SHM_RING_MIN_SIZE, WS_SHM_RING_MAX_SIZE);
+    while (pow2 < size)
+        pow2 <<= 1;
+
+    ring = g_new0(ws_shm_ring, 1);
+    ring->size = pow2;
+    ring->mask = pow2 - 1;
+    ring->map_size = sizeof(shm_ring_header) + pow2;
+    ring->owner = TRUE;
+    if (!ring_map(ring, TRUE, err_str)) {
+        g_free(ring->name);
+        g_free(ring);
+        return NULL;
+    }
+
+    /* A new mapping is zero-filled, so head, tail and the counters are 0. */
+    ring->hdr->size = pow2;
+    g_atomic_int_set((gint *)&ring->hdr->magic, SHM_RING_MAGIC);
+    return ring;
+}
+
+ws_shm_ring *
+ws_shm_ring_attach(const char *name, gchar **err_str)
+{
+    ws_shm_ring *ring;
+    guint32 size;
+
+    ring = g_new0(ws_shm_ring, 1);
+    ring->name = g_strdup(name);
+    if (!ring_map(ring, FALSE, err_str)) {
+        g_free(ring->name);
+        g_free(ring);
+        return NULL;
+    }
+
+    size = ring->hdr->size;
+    if ((guint32)g_atomic_int_get((gint *)&ring->hdr->magic) != SHM_RING_MAGIC ||
+        size < WS_SHM_RING_MIN_SIZE || (size & (size - 1)) != 0
+#ifndef _WIN32
+        || ring->map_size < sizeof(shm_ring_header) + size
+#endif
+        ) {
+        *err_str = SHM_RING_ATTACH_ERR(name);
+        ring_unmap(ring);
+        g_free(ring->name);
+        g_free(ring);
+        return NULL;
+    }
+    ring->size = size;
+    ring->mask = size - 1;
+    return ring;
+}
+
+const char *
+ws_shm_ring_name(const ws_shm_ring *ring)
+{
+    return ring->name;
+}
+
+void
+ws_shm_ring_close(ws_shm_ring *ring)
+{
+    if (ring == NULL)
+        return;
+
+    ring_unmap(ring);
+    g_free(ring->name);
+    g_free(ring);
+}
+
+gboolean
+ws_shm_ring_put(ws_shm_ring *ring, guint32 seq, guint64 offset,
+                const guint8 *data, guint32 len)
+{
+    shm_ring_header *hdr = ring->hdr;
+    shm_ring_record rec;
+    guint32 head, tail, space;
+
+    head = (guint32)hdr->head;
+    tail = (guint32)g_atomic_int_get(&hdr->tail);
+    space = SHM_RING_RECORD_SPACE(len);
+    if (len > ring->size || space > ring->size - (head - tail)) {
+        hdr->overrun_records++;
+        hdr->overrun_bytes += len;
+        return FALSE;
+    }
+
+    rec.seq = seq;
+    rec.len = len;
+    rec.offset = offset;
+    ring_write(ring, head, &rec, sizeof rec);
+    ring_write(ring, head + (guint32)sizeof rec, data, len);
+
+    /* Publish the record; this is a full barrier, so the data is visible first. */
+    g_atomic_int_set(&hdr->head, (gint)(head + space));
+    return TRUE;
+}
+
+void
+ws_shm_ring_get_overruns(const ws_shm_ring *ring, guint64 *records, guint64 *bytes)
+{
+    *records = ring->hdr->overrun_records;
+    *bytes = ring->hdr->overrun_bytes;
+}
+
+gboolean
+ws_shm_ring_peek(ws_shm_ring *ring, guint32 *seq, guint64 *offset, guint32 *len)
+{
+    shm_ring_header *hdr = ring->hdr;
+    shm_ring_record rec;
+    guint32 head, tail;
+
+    tail = (guint32)hdr->tail;
+    head = (guint32)g_atomic_int_get(&hdr->head);
+    if (head == tail)
+        return FALSE;
+
+    ring_read(ring, tail, &rec, sizeof rec);
+    *seq = rec.seq;
+    *offset = rec.offset;
+    *len = rec.len;
+    return TRUE;
+}
+
+void
+ws_shm_ring_copy(ws_shm_ring *ring, guint32 from, guint8 *buf, guint32 len)
+{
+    guint32 tail = (guint32)ring->hdr->tail;
+
+    ring_read(ring, tail + (guint32)sizeof(shm_ring_record) + from, buf, len);
+}
+
+void
+ws_shm_ring_skip(ws_shm_ring *ring)
+{
+    shm_ring_header *hdr = ring->hdr;
+    shm_ring_record rec;
+    guint32 tail = (guint32)hdr->tail;
+
+    ring_read(ring, tail, &rec, sizeof rec);
+
+    /* Hand the space back; the copies out of it are done by now. */
+    g_atomic_int_set(&hdr->tail, (gint)(tail + SHM_RING_RECORD_SPACE(rec.len)));
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
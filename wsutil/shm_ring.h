@@ -0,0 +1,105 @@
+/* shm_ring.h
+ * Single-producer, single-consumer ring buffer in shared memory, used to
+ * hand captured data from dumpcap to the program reading the capture
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WSUTIL_SHM_RING_H__
+#define __WSUTIL_SHM_RING_H__
+
+#include "ws_symbol_export.h"
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The ring carries records, each holding a range of bytes of a capture
+ * file: the file's sequence number (the n-th file written during the
+ * capture), the offset of the range in the file and the bytes themselves.
+ * The consumer creates the ring and passes its name to the producer,
+ * which attaches to it.
+ *
+ * Neither side ever waits for the other. If a record doesn't fit, the
+ * producer drops it and counts it as an overrun; the consumer notices the
+ * gap in the offsets and reads the missing range from the file instead.
+ */
+
+typedef struct ws_shm_ring ws_shm_ring;
+
+/** Smallest and largest ring size, in bytes. */
+#define WS_SHM_RING_MIN_SIZE    (64U * 1024U)
+#define WS_SHM_RING_MAX_SIZE    (1024U * 1024U * 1024U)
+
+/**
+ * Creates a ring of at least size bytes, rounded up to a power of two.
+ * Called by the consumer; the ring is removed when the consumer closes it.
+ * Returns NULL and sets *err_str on failure.
+ */
+WS_DLL_PUBLIC ws_shm_ring *ws_shm_ring_create(guint32 size, gchar **err_str);
+
+/**
+ * Attaches to the ring with the given name. Called by the producer.
+ * On UN*X the ring must be a regular file owned by our real user ID, and
+ * isn't reached through a symbolic link.
+ * Returns NULL and sets *err_str on failure; the message is the same
+ * whatever the reason, so it doesn't tell whether the file exists.
+ */
+WS_DLL_PUBLIC ws_shm_ring *ws_shm_ring_attach(const char *name, gchar **err_str);
+
+/** The name to pass to ws_shm_ring_attach(). */
+WS_DLL_PUBLIC const char *ws_shm_ring_name(const ws_shm_ring *ring);
+
+/** Detaches from the ring, and removes it if we created it. */
+WS_DLL_PUBLIC void ws_shm_ring_close(ws_shm_ring *ring);
+
+/**
+ * Producer: publishes len bytes found at offset in file seq. Returns FALSE,
+ * and counts an overrun, if there isn't enough room.
+ */
+WS_DLL_PUBLIC gboolean ws_shm_ring_put(ws_shm_ring *ring, guint32 seq,
+        guint64 offset, const guint8 *data, guint32 len);
+
+/** Number of records, and of bytes in them, the producer had to drop. */
+WS_DLL_PUBLIC void ws_shm_ring_get_overruns(const ws_shm_ring *ring,
+        guint64 *records, guint64 *bytes);
+
+/**
+ * Consumer: gets the description of the oldest record, if there is one.
+ * The record stays in the ring until ws_shm_ring_skip() is called.
+ */
+WS_DLL_PUBLIC gboolean ws_shm_ring_peek(ws_shm_ring *ring, guint32 *seq,
+        guint64 *offset, guint32 *len);
+
+/** Consumer: copies len bytes, starting at from, out of the oldest record. */
+WS_DLL_PUBLIC void ws_shm_ring_copy(ws_shm_ring *ring, guint32 from,
+        guint8 *buf, guint32 len);
+
+/** Consumer: removes the oldest record. */
+WS_DLL_PUBLIC void ws_shm_ring_skip(ws_shm_ring *ring);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WSUTIL_SHM_RING_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,754 @@
+/* test_wsutil.c
+ * wsutil unit tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include <wsutil/aho_corasick.h>
+#include <wsutil/dedup.h>
+#include <wsutil/file_util.h>
+#include <wsutil/lpm_trie.h>
+#include <wsutil/shm_ring.h>
+
+/* Deterministic pseudo-random stream, so failures can be reproduced. */
+static guint32
+test_rand(guint32 *state)
+{
+    *state = *state * 1103515245 + 12345;
+    return *state >> 8;
+}
+
+/* Fills a packet whose contents are determined by id. */
+static void
+test_packet(guint8 *buf, guint32 len, guint32 id)
+{
+    memset(buf, 0, len);
+    buf[0] = (guint8)(id >> 24);
+    buf[1] = (guint8)(id >> 16);
+    buf[2] = (guint8)(id >> 8);
+    buf[3] = (guint8)id;
+}
+
+static void
+wsutil_test_dedup_insert(void)
+{
+    guint8 a[60], b[60];
+    guint8 hash[WS_DEDUP_HASH_LEN], hash_a[WS_DEDUP_HASH_LEN];
+    ws_dedup *dedup = ws_dedup_new_count(5);
+
+    test_packet(a, sizeof a, 1);
+    test_packet(b, sizeof b, 2);
+
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, NULL));
+    ws_dedup_last_hash(dedup, hash_a);
+    g_assert(!ws_dedup_add(dedup, b, sizeof b, sizeof b, NULL));
+    ws_dedup_last_hash(dedup, hash);
+    g_assert(memcmp(hash, hash_a, sizeof hash) != 0);
+    g_assert(ws_dedup_add(dedup, a, sizeof a, sizeof a, NULL));
+    ws_dedup_last_hash(dedup, hash);
+    g_assert(memcmp(hash, hash_a, sizeof hash) == 0);
+    g_assert(ws_dedup_add(dedup, b, sizeof b, sizeof b, NULL));
+
+    ws_dedup_free(dedup);
+
+    /* A window of 0 never finds duplicates but still hashes. */
+    dedup = ws_dedup_new_count(0);
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, NULL));
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, NULL));
+    ws_dedup_last_hash(dedup, hash);
+    g_assert(memcmp(hash, hash_a, sizeof hash) == 0);
+    ws_dedup_free(dedup);
+}
+
+static void
+wsutil_test_dedup_collision(void)
+{
+    guint8 a[60];
+    ws_dedup *dedup = ws_dedup_new_count(10);
+
+    test_packet(a, sizeof a, 1);
+
+    /* Same captured bytes, different frame lengths: both share a hash. */
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, 100, NULL));
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, 200, NULL));
+    g_assert(ws_dedup_add(dedup, a, sizeof a, 100, NULL));
+    g_assert(ws_dedup_add(dedup, a, sizeof a, 200, NULL));
+
+    /* Captured length is part of the hash. */
+    g_assert(!ws_dedup_add(dedup, a, sizeof a - 1, 100, NULL));
+    g_assert(ws_dedup_add(dedup, a, sizeof a - 1, 100, NULL));
+
+    ws_dedup_free(dedup);
+}
+
+/*
+ * Compares the detector against a linear scan of the previous window - 1
+ * packets. Drawing ids from a small set keeps many equal packets in the
+ * window; drawing them from a large one fills the hash set, so that entries
+ * share probe sequences and are moved back when an earlier one is removed.
+ */
+static void
+wsutil_test_dedup_window(guint window, guint32 n_ids, guint n_packets)
+{
+    ws_dedup *dedup = ws_dedup_new_count(window);
+    guint32 *ids = g_new(guint32, n_packets);
+    guint32 *lens = g_new(guint32, n_packets);
+    guint32 state = window ^ n_ids;
+    guint8 buf[64];
+
+    for (guint i = 0; i < n_packets; i++) {
+        gboolean expected = FALSE;
+
+        ids[i] = test_rand(&state) % n_ids;
+        lens[i] = 60 + test_rand(&state) % 2;
+        for (guint j = i > window - 1 ? i - (window - 1) : 0; j < i; j++) {
+            if (ids[j] == ids[i] && lens[j] == lens[i]) {
+                expected = TRUE;
+                break;
+            }
+        }
+        test_packet(buf, sizeof buf, ids[i]);
+        if (ws_dedup_add(dedup, buf, sizeof buf, lens[i], NULL) != expected) {
+            g_test_message("window %u, packet %u (id %u)", window, i, ids[i]);
+            g_assert_not_reached();
+        }
+    }
+
+    g_free(lens);
+    g_free(ids);
+    ws_dedup_free(dedup);
+}
+
+static void
+wsutil_test_dedup_backshift(void)
+{
+    wsutil_test_dedup_window(5, 8, 10000);
+    wsutil_test_dedup_window(40, 64, 10000);
+    wsutil_test_dedup_window(47, 100000, 10000);
+}
+
+static void
+wsutil_test_dedup_resize(void)
+{
+    /* Grow the ring and the hash set well past their initial 64 entries. */
+    wsutil_test_dedup_window(1000, 1500, 20000);
+    wsutil_test_dedup_window(5000, 1000000, 20000);
+}
+
+static void
+wsutil_test_dedup_time(void)
+{
+    guint8 a[60], b[60];
+    nstime_t window = { 1, 0 };
+    nstime_t ts;
+    ws_dedup *dedup = ws_dedup_new_time(&window, 100);
+
+    test_packet(a, sizeof a, 1);
+    test_packet(b, sizeof b, 2);
+
+    nstime_set_zero(&ts);
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, &ts));
+    ts.nsecs = 500000000;
+    g_assert(!ws_dedup_add(dedup, b, sizeof b, sizeof b, &ts));
+    /* Exactly one window after the previous copy is still a duplicate. */
+    ts.secs = 1;
+    ts.nsecs = 0;
+    g_assert(ws_dedup_add(dedup, a, sizeof a, sizeof a, &ts));
+    /* More than a window after the previous copy is not. */
+    ts.secs = 2;
+    ts.nsecs = 1;
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, &ts));
+    g_assert(!ws_dedup_add(dedup, b, sizeof b, sizeof b, &ts));
+
+    /* Packets before the newest copy don't match it. */
+    ts.secs = 1;
+    ts.nsecs = 500000000;
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, &ts));
+
+    /* max_packets still bounds the window. */
+    ws_dedup_free(dedup);
+    dedup = ws_dedup_new_time(&window, 2);
+    nstime_set_zero(&ts);
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, &ts));
+    g_assert(!ws_dedup_add(dedup, b, sizeof b, sizeof b, &ts));
+    g_assert(ws_dedup_add(dedup, b, sizeof b, sizeof b, &ts));
+    g_assert(!ws_dedup_add(dedup, a, sizeof a, sizeof a, &ts));
+    ws_dedup_free(dedup);
+}
+
+static void
+wsutil_test_shm_ring_put_get(void)
+{
+    gchar *err_str = NULL;
+    ws_shm_ring *consumer, *producer;
+    guint8 data[5000], buf[5000];
+    guint64 overrun_records, overrun_bytes;
+    guint64 put_offset = 0, get_offset = 0;
+    guint32 seq, len;
+    guint64 offset;
+    guint n_put = 0, n_get = 0;
+
+    for (guint i = 0; i < sizeof data; i++) {
+        data[i] = (guint8)(i * 7);
+    }
+
+    consumer = ws_shm_ring_create(WS_SHM_RING_MIN_SIZE, &err_str);
+    g_assert(consumer != NULL);
+    producer = ws_shm_ring_attach(ws_shm_ring_name(consumer), &err_str);
+    g_assert(producer != NULL);
+    g_assert(!ws_shm_ring_peek(consumer, &seq, &offset, &len));
+
+    /* Go around the ring several times, with records that straddle its end. */
+    while (n_get < 1000) {
+        while (ws_shm_ring_put(producer, n_put, put_offset, data, 1 + (n_put * 997) % sizeof data)) {
+            put_offset += 1 + (n_put * 997) % sizeof data;
+            n_put++;
+        }
+        /* Leave a record in the ring now and then. */
+        while ((n_get % 7 != 6 || n_get + 1 >= n_put) &&
+               ws_shm_ring_peek(consumer, &seq, &offset, &len)) {
+            g_assert(seq == n_get);
+            g_assert(offset == get_offset);
+            g_assert(len == 1 + (n_get * 997) % sizeof data);
+            ws_shm_ring_copy(consumer, 0, buf, len);
+            g_assert(memcmp(buf, data, len) == 0);
+            if (len > 10) {
+                ws_shm_ring_copy(consumer, 10, buf, len - 10);
+                g_assert(memcmp(buf, data + 10, len - 10) == 0);
+            }
+            ws_shm_ring_skip(consumer);
+            get_offset += len;
+            n_get++;
+        }
+        if (n_get % 7 == 6 && n_get + 1 < n_put) {
+            g_assert(ws_shm_ring_peek(consumer, &seq, &offset, &len));
+            ws_shm_ring_skip(consumer);
+            get_offset += len;
+            n_get++;
+        }
+    }
+
+    /* The producer filled the ring on every pass. */
+    ws_shm_ring_get_overruns(consumer, &overrun_records, &overrun_bytes);
+    g_assert(overrun_records > 0);
+    g_assert(overrun_bytes > 0);
+
+    /* Records bigger than the ring never fit. */
+    g_assert(!ws_shm_ring_put(producer, 0, 0, data, WS_SHM_RING_MIN_SIZE + 1));
+
+    ws_shm_ring_close(producer);
+    ws_shm_ring_close(consumer);
+}
+
+#ifndef _WIN32
+static void
+wsutil_test_shm_ring_attach(void)
+{
+    gchar *err_str = NULL, *err_missing = NULL;
+    gchar *name = g_strdup_printf("test_wsutil_ring_%d", (int)getpid());
+    gchar *path = g_build_filename(g_get_tmp_dir(), name, NULL);
+    guint8 junk[4096];
+    ws_shm_ring *ring;
+    int fd;
+
+    memset(junk, 0, sizeof junk);
+    ws_unlink(path);
+    ring = ws_shm_ring_create(WS_SHM_RING_MIN_SIZE, &err_str);
+    g_assert(ring != NULL);
+
+    g_assert(ws_shm_ring_attach(path, &err_missing) == NULL);
+    g_assert(err_missing != NULL);
+
+    /* The ring itself, but through a symbolic link. */
+    g_assert(symlink(ws_shm_ring_name(ring), path) == 0);
+    g_assert(ws_shm_ring_attach(path, &err_str) == NULL);
+    g_assert(strcmp(err_str, err_missing) == 0);
+    g_free(err_str);
+    ws_unlink(path);
+
+    /* A file too small to be a ring, and one of the right size. */
+    fd = ws_open(path, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+    g_assert(fd != -1);
+    g_assert(ws_write(fd, junk, 16) == 16);
+    g_assert(ws_shm_ring_attach(path, &err_str) == NULL);
+    g_assert(strcmp(err_str, err_missing) == 0);
+    g_free(err_str);
+    g_assert(ws_write(fd, junk, sizeof junk) == sizeof junk);
+    ws_close(fd);
+    g_assert(ws_shm_ring_attach(path, &err_str) == NULL);
+    g_assert(strcmp(err_str, err_missing) == 0);
+    g_free(err_str);
+    ws_unlink(path);
+
+    /* Not a regular file. */
+    g_assert(ws_mkdir(path, 0700) == 0);
+    g_assert(ws_shm_ring_attach(path, &err_str) == NULL);
+    g_assert(strcmp(err_str, err_missing) == 0);
+    g_free(err_str);
+    ws_remove(path);
+
+    g_free(err_missing);
+    ws_shm_ring_close(ring);
+    g_free(path);
+    g_free(name);
+}
+#endif
+
+/* An IPv4 address in network byte order. */
+static void
+test_ipv4(guint8 *addr, guint8 a, guint8 b, guint8 c, guint8 d)
+{
+    addr[0] = a;
+    addr[1] = b;
+    addr[2] = c;
+    addr[3] = d;
+}
+
+static void
+wsutil_test_lpm_trie_longest_prefix(void)
+{
+    static const guint8 prefixes[][5] = {
+        /* address, prefix length */
+        { 10, 0, 0, 0, 8 },
+        { 10, 1, 0, 0, 16 },
+        { 10, 1, 2, 0, 24 },
+        { 10, 1, 2, 3, 32 },
+        { 10, 1, 128, 0, 17 },
+        { 10, 64, 0, 0, 10 },
+    };
+    static const guint8 lookups[][6] = {
+        /* address, index in prefixes + 1 or 0, prefix length */
+        { 10, 1, 2, 3, 4, 32 },
+        { 10, 1, 2, 4, 3, 24 },
+        { 10, 1, 3, 0, 2, 16 },
+        { 10, 1, 200, 1, 5, 17 },
+        { 10, 2, 0, 0, 1, 8 },
+        { 10, 127, 0, 0, 6, 10 },
+        { 10, 128, 0, 0, 1, 8 },
+        { 11, 1, 2, 3, 0, 0 },
+        { 0, 0, 0, 0, 0, 0 },
+    };
+    ws_lpm_trie *trie;
+    guint8 addr[4];
+    guint prefix_len;
+    guint order, i, j;
+
+    /* Insertion order changes the shape of the trie, not the answers. */
+    for (order = 0; order < 2; order++) {
+        trie = ws_lpm_trie_new(32, NULL);
+        for (i = 0; i < G_N_ELEMENTS(prefixes); i++) {
+            j = order ? G_N_ELEMENTS(prefixes) - 1 - i : i;
+            g_assert(ws_lpm_trie_insert(trie, prefixes[j], prefixes[j][4], GUINT_TO_POINTER(j + 1)));
+        }
+        g_assert(ws_lpm_trie_count(trie) == G_N_ELEMENTS(prefixes));
+
+        /* The prefix is already there; bits past it don't matter. */
+        test_ipv4(addr, 10, 1, 99, 99);
+        g_assert(!ws_lpm_trie_insert(trie, addr, 16, GUINT_TO_POINTER(99)));
+        g_assert(ws_lpm_trie_count(trie) == G_N_ELEMENTS(prefixes));
+
+        for (i = 0; i < G_N_ELEMENTS(lookups); i++) {
+            prefix_len = 99;
+            g_assert(ws_lpm_trie_lookup(trie, lookups[i], &prefix_len) == GUINT_TO_POINTER(lookups[i][4]));
+            if (lookups[i][4] != 0)
+                g_assert(prefix_len == lookups[i][5]);
+            else
+                g_assert(prefix_len == 99);
+        }
+        g_assert(ws_lpm_trie_lookup(trie, lookups[0], NULL) == GUINT_TO_POINTER(4));
+        ws_lpm_trie_free(trie);
+    }
+
+    g_assert(ws_lpm_trie_lookup(NULL, lookups[0], NULL) == NULL);
+    g_assert(ws_lpm_trie_count(NULL) == 0);
+}
+
+static void
+wsutil_test_lpm_trie_bounds(void)
+{
+    ws_lpm_trie *trie = ws_lpm_trie_new(32, NULL);
+    guint8 addr[16];
+    guint prefix_len;
+
+    /* /0 matches everything, /32 only its own address. */
+    test_ipv4(addr, 192, 168, 1, 1);
+    g_assert(ws_lpm_trie_insert(trie, addr, 0, GUINT_TO_POINTER(1)));
+    g_assert(ws_lpm_trie_insert(trie, addr, 32, GUINT_TO_POINTER(2)));
+    g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(2));
+    g_assert(prefix_len == 32);
+    test_ipv4(addr, 192, 168, 1, 0);
+    g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(1));
+    g_assert(prefix_len == 0);
+    test_ipv4(addr, 255, 255, 255, 255);
+    g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(1));
+    g_assert(!ws_lpm_trie_insert(trie, addr, 0, GUINT_TO_POINTER(3)));
+    g_assert(ws_lpm_trie_insert(trie, addr, 32, GUINT_TO_POINTER(3)));
+    g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(3));
+    g_assert(prefix_len == 32);
+    g_assert(ws_lpm_trie_count(trie) == 3);
+    ws_lpm_trie_free(trie);
+
+    /* The same in 128 bits, with prefixes that part in the last bit. */
+    trie = ws_lpm_trie_new(128, NULL);
+    memset(addr, 0x20, sizeof addr);
+    g_assert(ws_lpm_trie_insert(trie, addr, 128, GUINT_TO_POINTER(1)));
+    addr[15] ^= 1;
+    g_assert(ws_lpm_trie_lookup(trie, addr, NULL) == NULL);
+    g_assert(ws_lpm_trie_insert(trie, addr, 128, GUINT_TO_POINTER(2)));
+    g_assert(ws_lpm_trie_insert(trie, addr, 0, GUINT_TO_POINTER(3)));
+    g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(2));
+    g_assert(prefix_len == 128);
+    addr[15] ^= 1;
+    g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(1));
+    g_assert(prefix_len == 128);
+    addr[0] = 0;
+    g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(3));
+    g_assert(prefix_len == 0);
+    ws_lpm_trie_free(trie);
+}
+
+static void
+wsutil_test_lpm_trie_overlaps(void)
+{
+    ws_lpm_trie *trie = ws_lpm_trie_new(32, NULL);
+    guint8 addr[4];
+
+    test_ipv4(addr, 10, 0, 0, 0);
+    g_assert(!ws_lpm_trie_overlaps(NULL, addr, 8));
+    g_assert(!ws_lpm_trie_overlaps(trie, addr, 0));
+
+    test_ipv4(addr, 10, 1, 0, 0);
+    ws_lpm_trie_insert(trie, addr, 16, GUINT_TO_POINTER(1));
+    test_ipv4(addr, 10, 2, 0, 0);
+    ws_lpm_trie_insert(trie, addr, 16, GUINT_TO_POINTER(2));
+    test_ipv4(addr, 192, 168, 1, 7);
+    ws_lpm_trie_insert(trie, addr, 32, GUINT_TO_POINTER(3));
+
+    /* Prefixes containing one in the trie. */
+    test_ipv4(addr, 0, 0, 0, 0);
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 0));
+    test_ipv4(addr, 10, 0, 0, 0);
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 8));
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 14));
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 15));
+    test_ipv4(addr, 10, 2, 0, 0);
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 15));
+    test_ipv4(addr, 192, 168, 1, 0);
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 24));
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 29));
+
+    /* Prefixes contained in one, and equal ones. */
+    test_ipv4(addr, 10, 1, 2, 3);
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 32));
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 16));
+    test_ipv4(addr, 192, 168, 1, 7);
+    g_assert(ws_lpm_trie_overlaps(trie, addr, 32));
+
+    /* Disjoint ones, including one under the 10.0.0.0/14 branch. */
+    test_ipv4(addr, 10, 3, 0, 0);
+    g_assert(!ws_lpm_trie_overlaps(trie, addr, 16));
+    g_assert(!ws_lpm_trie_overlaps(trie, addr, 32));
+    test_ipv4(addr, 10, 0, 0, 0);
+    g_assert(!ws_lpm_trie_overlaps(trie, addr, 16));
+    test_ipv4(addr, 11, 0, 0, 0);
+    g_assert(!ws_lpm_trie_overlaps(trie, addr, 8));
+    test_ipv4(addr, 192, 168, 1, 8);
+    g_assert(!ws_lpm_trie_overlaps(trie, addr, 29));
+    g_assert(!ws_lpm_trie_overlaps(trie, addr, 32));
+
+    ws_lpm_trie_free(trie);
+}
+
+static guint lpm_trie_freed;
+
+static void
+lpm_trie_value_free(gpointer value _U_)
+{
+    lpm_trie_freed++;
+}
+
+/* The first prefix_len bits of an IPv4 address, as a number. */
+static guint32
+test_ipv4_prefix(const guint8 *addr, guint prefix_len)
+{
+    guint32 value = (guint32)addr[0] << 24 | (guint32)addr[1] << 16 |
+                    (guint32)addr[2] << 8 | addr[3];
+
+    return prefix_len == 0 ? 0 : value >> (32 - prefix_len);
+}
+
+/*
+ * Inserts random prefixes of a few addresses, so they nest and share
+ * bits, checking lookups against a linear scan.
+ */
+static void
+wsutil_test_lpm_trie_random(void)
+{
+    static const guint8 bases[][4] = {
+        { 10, 1, 2, 3 }, { 10, 1, 130, 0 }, { 10, 200, 0, 1 }, { 172, 16, 0, 1 },
+    };
+    struct {
+        const guint8 *addr;
+        guint prefix_len;
+        gboolean present;
+    } set[G_N_ELEMENTS(bases) * 33];
+    guint n_set = 0;
+    ws_lpm_trie *trie = ws_lpm_trie_new(32, lpm_trie_value_free);
+    guint32 state = 1;
+    guint8 addr[4];
+    guint prefix_len, count = 0, i, j, best, step;
+
+    /* Every distinct prefix of the base addresses. */
+    for (i = 0; i < G_N_ELEMENTS(bases); i++) {
+        for (prefix_len = 0; prefix_len <= 32; prefix_len++) {
+            for (j = 0; j < n_set; j++) {
+                if (set[j].prefix_len == prefix_len &&
+                    test_ipv4_prefix(set[j].addr, prefix_len) == test_ipv4_prefix(bases[i], prefix_len))
+                    break;
+            }
+            if (j == n_set) {
+                set[n_set].addr = bases[i];
+                set[n_set].prefix_len = prefix_len;
+                set[n_set].present = FALSE;
+                n_set++;
+            }
+        }
+    }
+
+    lpm_trie_freed = 0;
+    for (step = 0; step < 2000; step++) {
+        i = test_rand(&state) % n_set;
+        g_assert(ws_lpm_trie_insert(trie, set[i].addr, set[i].prefix_len,
+                    GUINT_TO_POINTER(i + 1)) == !set[i].present);
+        if (!set[i].present)
+            count++;
+        set[i].present = TRUE;
+        g_assert(ws_lpm_trie_count(trie) == count);
+
+        /* A base address, possibly with one bit flipped. */
+        memcpy(addr, bases[test_rand(&state) % G_N_ELEMENTS(bases)], 4);
+        j = test_rand(&state) % 33;
+        if (j < 32)
+            addr[j >> 3] ^= 0x80 >> (j & 7);
+        best = 0;
+        for (i = 0; i < n_set; i++) {
+            if (set[i].present &&
+                test_ipv4_prefix(set[i].addr, set[i].prefix_len) == test_ipv4_prefix(addr, set[i].prefix_len) &&
+                (best == 0 || set[i].prefix_len > set[best - 1].prefix_len))
+                best = i + 1;
+        }
+        prefix_len = 99;
+        g_assert(ws_lpm_trie_lookup(trie, addr, &prefix_len) == GUINT_TO_POINTER(best));
+        g_assert(best == 0 || prefix_len == set[best - 1].prefix_len);
+
+        /* The same address as a prefix; overlapping means nested. */
+        prefix_len = test_rand(&state) % 33;
+        for (i = 0; i < n_set; i++) {
+            if (set[i].present &&
+                test_ipv4_prefix(set[i].addr, MIN(set[i].prefix_len, prefix_len)) ==
+                test_ipv4_prefix(addr, MIN(set[i].prefix_len, prefix_len)))
+                break;
+        }
+        g_assert(ws_lpm_trie_overlaps(trie, addr, prefix_len) == (i < n_set));
+    }
+
+    /* The trie frees the values in it, and only those. */
+    g_assert(lpm_trie_freed == 0);
+    ws_lpm_trie_free(trie);
+    g_assert(lpm_trie_freed == count);
+}
+
+/*
+ * Searches for str in a copy of exactly its length, so that reading past
+ * the end is caught by memory checkers.
+ */
+static gboolean
+test_ac_search(const ws_aho_corasick *ac, const char *str)
+{
+    gsize len = strlen(str);
+    guint8 *copy = (guint8 *)g_memdup(str, (guint)len);
+    gboolean found;
+
+    found = ws_aho_corasick_search(ac, copy, len);
+    g_free(copy);
+    return found;
+}
+
+static ws_aho_corasick *
+test_ac_new(const char * const *patterns)
+{
+    ws_aho_corasick *ac = ws_aho_corasick_new();
+
+    for (; *patterns; patterns++)
+        ws_aho_corasick_add(ac, (const guint8 *)*patterns, strlen(*patterns));
+    g_assert(ws_aho_corasick_compile(ac));
+    return ac;
+}
+
+static void
+wsutil_test_aho_corasick_overlaps(void)
+{
+    static const char * const classic[] = { "he", "she", "his", "hers", NULL };
+    /* Found only by following the failure state of "abc" to "bc". */
+    static const char * const suffix[] = { "abcx", "bcd", NULL };
+    static const char * const nested[] = { "abcdef", "cd", NULL };
+    ws_aho_corasick *ac;
+
+    ac = test_ac_new(classic);
+    g_assert(ws_aho_corasick_count(ac) == 4);
+    g_assert(test_ac_search(ac, "ushers"));
+    g_assert(test_ac_search(ac, "this"));
+    g_assert(test_ac_search(ac, "ahishe"));
+    g_assert(!test_ac_search(ac, "hi s h e"));
+    g_assert(!test_ac_search(ac, "sh"));
+    ws_aho_corasick_free(ac);
+
+    ac = test_ac_new(suffix);
+    g_assert(test_ac_search(ac, "abcd"));
+    g_assert(test_ac_search(ac, "aabcx"));
+    g_assert(!test_ac_search(ac, "abcabc"));
+    g_assert(!test_ac_search(ac, "bcbc"));
+    ws_aho_corasick_free(ac);
+
+    ac = test_ac_new(nested);
+    g_assert(test_ac_search(ac, "abcdx"));
+    g_assert(test_ac_search(ac, "xxcd"));
+    g_assert(!test_ac_search(ac, "abcabc"));
+    ws_aho_corasick_free(ac);
+}
+
+static void
+wsutil_test_aho_corasick_empty(void)
+{
+    static const char * const none[] = { NULL };
+    static const char * const empty[] = { "", NULL };
+    static const char * const some[] = { "", "ab", NULL };
+    ws_aho_corasick *ac;
+
+    /* Nothing matches without patterns, or with an empty one. */
+    ac = test_ac_new(none);
+    g_assert(ws_aho_corasick_count(ac) == 0);
+    g_assert(!test_ac_search(ac, ""));
+    g_assert(!test_ac_search(ac, "abc"));
+    ws_aho_corasick_free(ac);
+
+    ac = test_ac_new(empty);
+    g_assert(ws_aho_corasick_count(ac) == 1);
+    g_assert(!test_ac_search(ac, ""));
+    g_assert(!test_ac_search(ac, "abc"));
+    ws_aho_corasick_free(ac);
+
+    /* An empty haystack matches nothing, even with a NULL pointer. */
+    ac = test_ac_new(some);
+    g_assert(ws_aho_corasick_count(ac) == 2);
+    g_assert(!ws_aho_corasick_search(ac, NULL, 0));
+    g_assert(!test_ac_search(ac, ""));
+    g_assert(!test_ac_search(ac, "a"));
+    g_assert(test_ac_search(ac, "ab"));
+    ws_aho_corasick_free(ac);
+
+    ws_aho_corasick_free(NULL);
+}
+
+/*
+ * Matches at the start and end of the buffer, and patterns cut off by
+ * its end, both with start bytes that ws_mempbrk_exec() skips to and
+ * with ones (NUL and 0xff) that it can't.
+ */
+static void
+wsutil_test_aho_corasick_boundary(void)
+{
+    static const guint8 ascii[][3] = { { 'x', 'y', 'z' }, { 'q', 'q', 'q' } };
+    static const guint8 binary[][3] = { { 0x00, 0x01, 0xff }, { 0xff, 0xff, 0x00 } };
+    const guint8 (*patterns)[3];
+    ws_aho_corasick *ac;
+    guint8 *buf;
+    guint len, pos, i, k;
+
+    for (k = 0; k < 2; k++) {
+        patterns = k == 0 ? ascii : binary;
+        ac = ws_aho_corasick_new();
+        ws_aho_corasick_add(ac, patterns[0], 3);
+        ws_aho_corasick_add(ac, patterns[1], 3);
+        g_assert(ws_aho_corasick_compile(ac));
+
+        for (len = 3; len <= 40; len++) {
+            buf = (guint8 *)g_malloc(len);
+            for (pos = 0; pos + 3 <= len; pos++) {
+                memset(buf, 'a', len);
+                memcpy(buf + pos, patterns[pos & 1], 3);
+                g_assert(ws_aho_corasick_search(ac, buf, len));
+                /* Cut off before the last byte of the pattern. */
+                g_assert(!ws_aho_corasick_search(ac, buf, pos + 2));
+                /* Only the part of the buffer after the start counts. */
+                g_assert(!ws_aho_corasick_search(ac, buf + pos + 1, len - pos - 1));
+            }
+            /* Everything but the last byte of a pattern at the end. */
+            memset(buf, 'a', len);
+            for (i = 0; i + 1 < len; i += 3)
+                memcpy(buf + i, patterns[1], MIN(2, len - 1 - i));
+            g_assert(!ws_aho_corasick_search(ac, buf, len));
+            g_free(buf);
+        }
+        ws_aho_corasick_free(ac);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/wsutil/dedup/insert",    wsutil_test_dedup_insert);
+    g_test_add_func("/wsutil/dedup/collision", wsutil_test_dedup_collision);
+    g_test_add_func("/wsutil/dedup/backshift", wsutil_test_dedup_backshift);
+    g_test_add_func("/wsutil/dedup/resize",    wsutil_test_dedup_resize);
+    g_test_add_func("/wsutil/dedup/time",      wsutil_test_dedup_time);
+
+    g_test_add_func("/wsutil/shm_ring/put_get", wsutil_test_shm_ring_put_get);
+#ifndef _WIN32
+    g_test_add_func("/wsutil/shm_ring/attach",  wsutil_test_shm_ring_attach);
+#endif
+
+    g_test_add_func("/wsutil/lpm_trie/longest_prefix", wsutil_test_lpm_trie_longest_prefix);
+    g_test_add_func("/wsutil/lpm_trie/bounds",         wsutil_test_lpm_trie_bounds);
+    g_test_add_func("/wsutil/lpm_trie/overlaps",       wsutil_test_lpm_trie_overlaps);
+    g_test_add_func("/wsutil/lpm_trie/random",         wsutil_test_lpm_trie_random);
+
+    g_test_add_func("/wsutil/aho_corasick/overlaps", wsutil_test_aho_corasick_overlaps);
+    g_test_add_func("/wsutil/aho_corasick/empty",    wsutil_test_aho_corasick_empty);
+    g_test_add_func("/wsutil/aho_corasick/boundary", wsutil_test_aho_corasick_boundary);
+
+    ret = g_test_run();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */